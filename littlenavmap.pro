@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui sql xml network svg
+QT       += core gui sql xml network svg concurrent
 
 # axcontainer axserver concurrent core dbus declarative designer gui help multimedia
 # multimediawidgets network opengl printsupport qml qmltest x11extras quick script scripttools
@@ -167,7 +167,26 @@ SOURCES += src/main.cpp\
     src/options/optiondata.cpp \
     src/common/settingsmigrate.cpp \
     src/search/searchbase.cpp \
-    src/search/sqlcontroller.cpp
+    src/search/sqlcontroller.cpp \
+    src/route/routegraph.cpp \
+    src/route/routeindexheap.cpp \
+    src/route/routelandmarks.cpp \
+    src/route/routecalcalldialog.cpp \
+    src/route/routecalcworker.cpp \
+    src/route/routenodegrid.cpp \
+    src/route/routebenchmark.cpp \
+    src/route/routehierarchy.cpp \
+    src/mapgui/mapprefetchworker.cpp \
+    src/mapgui/mapscreengrid.cpp \
+    src/mapgui/maplodbuilder.cpp \
+    src/mapgui/mapobjectstore.cpp \
+    src/common/maptypesbenchmark.cpp \
+    src/db/spatialindexbuilder.cpp \
+    src/mapgui/mapairwaygeometry.cpp \
+    src/common/projectioncache.cpp \
+    src/common/maplabellayout.cpp \
+    src/mapgui/maptilerenderer.cpp \
+    src/common/benchmarkarguments.cpp
 
 HEADERS  += src/gui/mainwindow.h \
     src/search/columnlist.h \
@@ -230,13 +249,33 @@ HEADERS  += src/gui/mainwindow.h \
     src/options/optiondata.h \
     src/common/settingsmigrate.h \
     src/search/searchbase.h \
-    src/search/sqlcontroller.h
+    src/search/sqlcontroller.h \
+    src/route/routegraph.h \
+    src/route/routeindexheap.h \
+    src/route/routelandmarks.h \
+    src/route/routecalcalldialog.h \
+    src/route/routecalcworker.h \
+    src/route/routenodegrid.h \
+    src/route/routebenchmark.h \
+    src/route/routehierarchy.h \
+    src/mapgui/mapprefetchworker.h \
+    src/mapgui/mapscreengrid.h \
+    src/mapgui/maplodbuilder.h \
+    src/mapgui/mapobjectstore.h \
+    src/common/maptypesbenchmark.h \
+    src/db/spatialindexbuilder.h \
+    src/mapgui/mapairwaygeometry.h \
+    src/common/projectioncache.h \
+    src/common/maplabellayout.h \
+    src/mapgui/maptilerenderer.h \
+    src/common/benchmarkarguments.h
 
 FORMS    += src/gui/mainwindow.ui \
     src/db/databasedialog.ui \
     src/route/parkingdialog.ui \
     src/connect/connectdialog.ui \
-    src/options/options.ui
+    src/options/options.ui \
+    src/route/routecalcalldialog.ui
 
 DISTFILES += \
     uncrustify.cfg \
@@ -0,0 +1,80 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "common/benchmarkarguments.h"
+
+#include <QDebug>
+#include <QFile>
+
+BenchmarkArguments::BenchmarkArguments(const QStringList& arguments, const QString& benchmarkOption,
+                                       const QStringList& flagOptions, const QStringList& valueOptions)
+{
+  QStringList args = arguments.mid(arguments.indexOf(benchmarkOption) + 1);
+  for(int i = 0; i < args.size(); i++)
+  {
+    const QString& arg = args.at(i);
+    if(flagOptions.contains(arg))
+      flags.append(arg);
+    else if(valueOptions.contains(arg))
+    {
+      if(i + 1 < args.size())
+        values.insert(arg, args.at(++i));
+      else
+      {
+        qWarning() << "Missing value for benchmark option" << arg;
+        valid = false;
+      }
+    }
+    else if(!arg.startsWith("--"))
+      files.append(arg);
+    else
+    {
+      qWarning() << "Unknown benchmark option" << arg;
+      valid = false;
+    }
+  }
+}
+
+bool BenchmarkArguments::isBenchmark(const QStringList& arguments, const QString& benchmarkOption)
+{
+  return arguments.contains(benchmarkOption);
+}
+
+int BenchmarkArguments::intValue(const QString& option, int defaultValue, bool& ok) const
+{
+  ok = true;
+  if(values.contains(option))
+    return values.value(option).toInt(&ok);
+  else
+    return defaultValue;
+}
+
+void BenchmarkArguments::printUsage(const QString& benchmarkOption, const QString& usage)
+{
+  qCritical().noquote() << "Usage:" << benchmarkOption << usage;
+}
+
+bool BenchmarkArguments::openOutput(QFile& file, const QString& filename)
+{
+  file.setFileName(filename);
+  bool open = filename.isEmpty() ?
+              file.open(stdout, QIODevice::WriteOnly) :
+              file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+  if(!open)
+    qCritical() << "Cannot open output" << filename << file.errorString();
+  return open;
+}
@@ -0,0 +1,77 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_BENCHMARKARGUMENTS_H
+#define LITTLENAVMAP_BENCHMARKARGUMENTS_H
+
+#include <QHash>
+#include <QStringList>
+
+class QFile;
+
+/*
+ * Command line of the headless benchmarks. All application arguments following the benchmark option are
+ * parsed into flags, options with a value and plain file arguments.
+ */
+class BenchmarkArguments
+{
+public:
+  /*
+   * @param arguments all application arguments
+   * @param benchmarkOption option that starts the benchmark like "--route-benchmark"
+   * @param flagOptions options without value
+   * @param valueOptions options followed by a value
+   */
+  BenchmarkArguments(const QStringList& arguments, const QString& benchmarkOption,
+                     const QStringList& flagOptions, const QStringList& valueOptions = QStringList());
+
+  /* true if the application command line requests the benchmark */
+  static bool isBenchmark(const QStringList& arguments, const QString& benchmarkOption);
+
+  /* false if unknown options were given or a value is missing */
+  bool isValid() const
+  {
+    return valid;
+  }
+
+  bool hasFlag(const QString& flag) const
+  {
+    return flags.contains(flag);
+  }
+
+  /* Integer value of an option or defaultValue if not given. ok is set to false if not a number. */
+  int intValue(const QString& option, int defaultValue, bool& ok) const;
+
+  /* All arguments that are not options */
+  const QStringList& getFiles() const
+  {
+    return files;
+  }
+
+  /* Print usage message for the benchmark option */
+  static void printUsage(const QString& benchmarkOption, const QString& usage);
+
+  /* Open the file for writing or stdout if filename is empty. Prints an error on failure. */
+  static bool openOutput(QFile& file, const QString& filename);
+
+private:
+  QStringList flags, files;
+  QHash<QString, QString> values;
+  bool valid = true;
+};
+
+#endif // LITTLENAVMAP_BENCHMARKARGUMENTS_H
@@ -80,6 +80,15 @@ const QString OPTIONS_DIALOG_DB_ADDON_EXCLUDE = "OptionsDialog/DatabaseAddonExcl
 /* Other options that are only accessible in the configuration file */
 const QString OPTIONS_LANGUAGE = "Options/Language";
 const QString OPTIONS_MARBLEDEBUG = "Options/MarbleDebug";
+const QString OPTIONS_ROUTE_PRELOAD_NETWORK = "Options/RoutePreloadNetwork";
+const QString OPTIONS_ROUTE_LANDMARKS = "Options/RouteLandmarks";
+const QString OPTIONS_ROUTE_BIDIRECTIONAL = "Options/RouteBidirectional";
+const QString OPTIONS_ROUTE_INCREMENTAL = "Options/RouteIncremental";
+const QString OPTIONS_ROUTE_HIERARCHIES = "Options/RouteHierarchies";
+const QString OPTIONS_MAP_PREFETCH = "Options/MapPrefetch";
+const QString OPTIONS_MAP_LOD = "Options/MapLevelOfDetail";
+const QString OPTIONS_SPATIAL_INDEX = "Options/SpatialIndex";
+const QString OPTIONS_MAP_TILED_RENDERING = "Options/MapTiledRendering";
 const QString OPTIONS_VERSION = "Options/Version";
 
 /* File dialog patterns */
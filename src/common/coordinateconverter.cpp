@@ -17,17 +17,29 @@
 
 #include "common/coordinateconverter.h"
 
+#include "common/projectioncache.h"
+#include "geo/calculations.h"
 #include "geo/pos.h"
 
 #include <marble/ViewportParams.h>
 
+#include <cmath>
+
 using namespace Marble;
 using namespace atools::geo;
 
 const QSize CoordinateConverter::DEFAULT_WTOS_SIZE(100, 100);
 
-CoordinateConverter::CoordinateConverter(const ViewportParams *viewportParams)
-  : viewport(viewportParams)
+namespace {
+const double PI = 3.14159265358979323846;
+
+/* Latitude limit of the Mercator projection which is 85.0511287798 degree */
+const double MAX_MERCATOR_LAT_RAD = 1.4844222297452172;
+}
+
+CoordinateConverter::CoordinateConverter(const ViewportParams *viewportParams,
+                                         ProjectionCache *projectionCache)
+  : viewport(viewportParams), cache(projectionCache)
 {
 }
 
@@ -82,14 +94,140 @@ bool CoordinateConverter::wToS(const atools::geo::Pos& coords, float& x, float&
 bool CoordinateConverter::wToS(const atools::geo::Pos& coords, double& x, double& y, const QSize& size,
                                bool *isHidden) const
 {
+  bool useCache = cache != nullptr && size == DEFAULT_WTOS_SIZE;
+  if(useCache)
+  {
+    // Drops all points if the view has changed since the last call
+    cache->update(viewport);
+
+    const ProjectionCache::Point *point = cache->find(coords);
+    if(point != nullptr)
+    {
+      x = point->x;
+      y = point->y;
+      if(isHidden != nullptr)
+        *isHidden = point->hidden;
+      return point->visible;
+    }
+  }
+
   bool hidden;
   bool visible = wToS(Marble::GeoDataCoordinates(coords.getLonX(),
                                                  coords.getLatY(), 0, DEG), x, y, size, &hidden);
   if(isHidden != nullptr)
     *isHidden = hidden;
+
+  if(useCache)
+    cache->insert(coords, {x, y, visible && !hidden, hidden});
+
   return visible && !hidden;
 }
 
+void CoordinateConverter::wToS(const atools::geo::Pos *coords, int num, double *x, double *y,
+                               bool *visible) const
+{
+  if(viewport->projection() == Marble::Spherical)
+    wToSSpherical(coords, num, x, y, visible);
+  else if(viewport->projection() == Marble::Mercator)
+    wToSMercator(coords, num, x, y, visible);
+  else
+  {
+    for(int i = 0; i < num; i++)
+    {
+      bool vis = wToS(coords[i], x[i], y[i]);
+      if(visible != nullptr)
+        visible[i] = vis;
+    }
+  }
+}
+
+void CoordinateConverter::wToS(const QVector<atools::geo::Pos>& coords, QVector<QPoint>& points,
+                               QVector<bool> *visible) const
+{
+  QVector<double> x(coords.size()), y(coords.size());
+  if(visible != nullptr)
+    visible->resize(coords.size());
+
+  wToS(coords.constData(), coords.size(), x.data(), y.data(), visible != nullptr ? visible->data() : nullptr);
+
+  points.resize(coords.size());
+  for(int i = 0; i < coords.size(); i++)
+    points[i] = QPoint(static_cast<int>(std::round(x.at(i))), static_cast<int>(std::round(y.at(i))));
+}
+
+/* Orthographic projection rotated to the view center. Same as Marble's SphericalProjection. */
+void CoordinateConverter::wToSSpherical(const atools::geo::Pos *coords, int num, double *x, double *y,
+                                        bool *visible) const
+{
+  using atools::geo::toRadians;
+
+  double width = viewport->width(), height = viewport->height(), radius = viewport->radius();
+  double centerLonX = viewport->centerLongitude();
+  double sinCenterLatY = std::sin(viewport->centerLatitude());
+  double cosCenterLatY = std::cos(viewport->centerLatitude());
+  double marginX = DEFAULT_WTOS_SIZE.width() / 2., marginY = DEFAULT_WTOS_SIZE.height() / 2.;
+
+  for(int i = 0; i < num; i++)
+  {
+    double lonX = toRadians(static_cast<double>(coords[i].getLonX())) - centerLonX;
+    double latY = toRadians(static_cast<double>(coords[i].getLatY()));
+    double sinLatY = std::sin(latY), cosLatY = std::cos(latY), cosLonX = std::cos(lonX);
+
+    x[i] = width / 2. + radius * cosLatY * std::sin(lonX);
+    y[i] = height / 2. - radius * (cosCenterLatY * sinLatY - sinCenterLatY * cosLatY * cosLonX);
+
+    if(visible != nullptr)
+    {
+      // Points on the back side of the globe are hidden
+      bool front = sinCenterLatY * sinLatY + cosCenterLatY * cosLatY * cosLonX >= 0.;
+      visible[i] = front && x[i] + marginX >= 0. && x[i] - marginX < width &&
+                   y[i] + marginY >= 0. && y[i] - marginY < height;
+    }
+  }
+}
+
+/* Same as Marble's MercatorProjection. Uses the leftmost visible repetition like wToSInternal. */
+void CoordinateConverter::wToSMercator(const atools::geo::Pos *coords, int num, double *x, double *y,
+                                       bool *visible) const
+{
+  using atools::geo::toRadians;
+
+  double width = viewport->width(), height = viewport->height(), radius = viewport->radius();
+  double centerLonX = viewport->centerLongitude();
+  double centerLatYInv = std::atanh(std::sin(qBound(-MAX_MERCATOR_LAT_RAD, viewport->centerLatitude(),
+                                                    MAX_MERCATOR_LAT_RAD)));
+  double rad2Pixel = 2. * radius / PI, repeat = 4. * radius;
+  double marginX = DEFAULT_WTOS_SIZE.width() / 2., marginY = DEFAULT_WTOS_SIZE.height() / 2.;
+
+  for(int i = 0; i < num; i++)
+  {
+    double lonX = toRadians(static_cast<double>(coords[i].getLonX()));
+    double latY = qBound(-MAX_MERCATOR_LAT_RAD, toRadians(static_cast<double>(coords[i].getLatY())),
+                         MAX_MERCATOR_LAT_RAD);
+
+    x[i] = width / 2. + rad2Pixel * (lonX - centerLonX);
+    y[i] = height / 2. - rad2Pixel * (std::atanh(std::sin(latY)) - centerLatYInv);
+
+    bool vis = y[i] + marginY >= 0. && y[i] < height + marginY;
+    if(vis)
+    {
+      // Find leftmost repetition of the point which is visible
+      double repX = x[i];
+      if(repX + 2. * marginX > repeat)
+        repX -= std::floor((repX + 2. * marginX) / repeat) * repeat;
+      if(repX + marginX < 0.)
+        repX += repeat;
+
+      vis = repX < width + marginX;
+      if(vis)
+        x[i] = repX;
+    }
+
+    if(visible != nullptr)
+      visible[i] = vis;
+  }
+}
+
 bool CoordinateConverter::wToS(const Marble::GeoDataCoordinates& coords, double& x, double& y,
                                const QSize& size, bool *isHidden) const
 {
@@ -22,6 +22,7 @@
 
 #include <QPoint>
 #include <QSize>
+#include <QVector>
 
 namespace Marble {
 class ViewportParams;
@@ -33,15 +34,28 @@ class Pos;
 }
 }
 
+class ProjectionCache;
+
 /*
  * Converter for screen and world coordinates.
+ *
+ * Conversions of atools::geo::Pos using the default size are stored in the projection cache if one is
+ * given. Converters sharing a cache share the projected coordinates for the current frame.
  */
 class CoordinateConverter
 {
 public:
-  CoordinateConverter(const Marble::ViewportParams *viewportParams);
+  CoordinateConverter(const Marble::ViewportParams *viewportParams,
+                      ProjectionCache *projectionCache = nullptr);
   ~CoordinateConverter();
 
+  /* Use another viewport and cache. Used by painters that draw map tiles with an own viewport copy. */
+  void setViewport(const Marble::ViewportParams *viewportParams, ProjectionCache *projectionCache = nullptr)
+  {
+    viewport = viewportParams;
+    cache = projectionCache;
+  }
+
   /* Default size (100x100) for the screen object. Needed to find the repeating pattern for the
    *  Mercator projection. */
   const static QSize DEFAULT_WTOS_SIZE;
@@ -97,6 +111,19 @@ public:
   bool wToS(const atools::geo::Pos& coords, double& x, double& y, const QSize& size = DEFAULT_WTOS_SIZE,
             bool *isHidden = nullptr) const;
 
+  /*
+   * Convert an array of world coordinates in one pass using the default size. Spherical and Mercator
+   * projections are calculated directly in a plain loop. All other projections use the single conversion.
+   * Does not use the projection cache.
+   * @param x,y resulting screen coordinates
+   * @param visible if not null will receive true for each coordinate that is visible and not hidden
+   */
+  void wToS(const atools::geo::Pos *coords, int num, double *x, double *y, bool *visible = nullptr) const;
+
+  /* As above for a vector of coordinates. Points are rounded to integer screen coordinates. */
+  void wToS(const QVector<atools::geo::Pos>& coords, QVector<QPoint>& points,
+            QVector<bool> *visible = nullptr) const;
+
   bool sToW(int x, int y, Marble::GeoDataCoordinates& coords) const;
 
   /* Converte screen to world coordinates */
@@ -115,7 +142,11 @@ private:
   bool wToSInternal(const Marble::GeoDataCoordinates& coords, double& x, double& y, const QSize& size,
                     bool *isHidden) const;
 
+  void wToSSpherical(const atools::geo::Pos *coords, int num, double *x, double *y, bool *visible) const;
+  void wToSMercator(const atools::geo::Pos *coords, int num, double *x, double *y, bool *visible) const;
+
   const Marble::ViewportParams *viewport;
+  ProjectionCache *cache;
 
 };
 
@@ -0,0 +1,309 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "common/maplabellayout.h"
+
+#include "common/maptypes.h"
+
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+
+namespace labelprio {
+
+int airportPriority(const maptypes::MapAirport& airport)
+{
+  // Same criteria as the airport rating in the database
+  int rating = static_cast<int>(airport.addon()) + static_cast<int>(airport.parking()) +
+               static_cast<int>(airport.taxiway()) + static_cast<int>(airport.apron()) +
+               static_cast<int>(airport.tower());
+
+  // Runway length in feet is used to sort airports with the same rating
+  return AIRPORT + rating * 20000 + std::min(std::max(airport.longestRunwayLength, 0), 19999);
+}
+
+}
+
+MapLabelLayout::MapLabelLayout()
+{
+  symbolPainter = new SymbolPainter();
+}
+
+MapLabelLayout::~MapLabelLayout()
+{
+  delete symbolPainter;
+}
+
+void MapLabelLayout::beginFrame(QPainter *painter, const QSize& size)
+{
+  labels.clear();
+  placed.clear();
+
+  // Metrics depend on the resolution of the paint device - evict fonts only here since pending labels
+  // refer to them by index
+  int dpi = painter->device()->logicalDpiY();
+  if(dpi != logicalDpi || fonts.size() >= MAX_FONTS)
+  {
+    clearFonts();
+    logicalDpi = dpi;
+  }
+
+  int columns = (size.width() + CELL_SIZE - 1) / CELL_SIZE;
+  int rows = (size.height() + CELL_SIZE - 1) / CELL_SIZE;
+  if(columns != gridColumns || rows != gridRows)
+  {
+    gridColumns = columns;
+    gridRows = rows;
+    grid.clear();
+    grid.resize(gridColumns * gridRows);
+  }
+  else
+  {
+    // Keep the allocated cell vectors
+    for(QVector<int>& cell : grid)
+      cell.clear();
+  }
+}
+
+void MapLabelLayout::addLabel(QPainter *painter, const QStringList& texts, const QPen& textPen, int x, int y,
+                              textatt::TextAttributes atts, int transparency, int priority)
+{
+  if(texts.isEmpty() || (!positionRect.isNull() && !positionRect.contains(x, y)))
+    return;
+
+  // Apply the same attributes as SymbolPainter::textBox
+  QFont font = painter->font();
+  if(atts.testFlag(textatt::ITALIC) || atts.testFlag(textatt::BOLD) || atts.testFlag(textatt::UNDERLINE))
+  {
+    font.setBold(atts.testFlag(textatt::BOLD));
+    font.setItalic(atts.testFlag(textatt::ITALIC));
+    font.setUnderline(atts.testFlag(textatt::UNDERLINE));
+  }
+
+  Label label;
+  label.fontIndex = fontIndex(painter, font);
+  const QFontMetrics& fontMetrics = metrics.at(label.fontIndex);
+  int h = fontMetrics.height();
+
+  // Calculate bounding rectangle of all lines
+  int yoffset = 0;
+  for(const QString& text : texts)
+  {
+    QStaticText prepared = staticText(label.fontIndex, text);
+    label.texts.append(prepared);
+
+    int w = static_cast<int>(std::round(prepared.size().width())) + 2;
+    int newx = x;
+    if(atts.testFlag(textatt::RIGHT))
+      newx -= w;
+    else if(atts.testFlag(textatt::CENTER))
+      newx -= w / 2;
+
+    label.rect |= QRect(newx, y - fontMetrics.ascent() + yoffset - 1, w, h);
+    yoffset += h;
+  }
+
+  label.pen = textPen;
+  label.x = x;
+  label.y = y;
+  label.transparency = transparency;
+  label.priority = priority;
+  label.atts = atts;
+  labels.append(label);
+}
+
+void MapLabelLayout::addLabels(QPainter *painter, const MapLabelLayout& other)
+{
+  for(const Label& label : other.labels)
+  {
+    // Font indexes differ between layouts and texts might be prepared in another thread
+    Label copy = label;
+    copy.fontIndex = fontIndex(painter, other.fonts.at(label.fontIndex));
+    for(QStaticText& text : copy.texts)
+      text = staticText(copy.fontIndex, text.text());
+    labels.append(copy);
+  }
+}
+
+void MapLabelLayout::drawLabels(QPainter *painter)
+{
+  // Sort by priority but keep painter order for labels with the same priority
+  QVector<int> order(labels.size());
+  for(int i = 0; i < order.size(); i++)
+    order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(), [this](int index1, int index2) -> bool
+                   {
+                     return labels.at(index1).priority > labels.at(index2).priority;
+                   });
+
+  QRect screen(0, 0, gridColumns * CELL_SIZE, gridRows * CELL_SIZE);
+
+  painter->save();
+  for(int index : order)
+  {
+    const Label& label = labels.at(index);
+    if(!label.rect.intersects(screen))
+      continue;
+
+    QRect rect = label.rect.adjusted(-LABEL_MARGIN, -LABEL_MARGIN, LABEL_MARGIN, LABEL_MARGIN);
+    if(label.priority < labelprio::ROUTE && !isFree(rect))
+      continue;
+
+    occupy(rect);
+
+    painter->setFont(fonts.at(label.fontIndex));
+    symbolPainter->textBox(painter, label.texts, label.pen, label.x, label.y, label.atts,
+                           label.transparency);
+  }
+  painter->restore();
+}
+
+const QStringList *MapLabelLayout::findObjectTexts(int type, int id, textflags::TextFlags flags) const
+{
+  QHash<quint64, QStringList>::const_iterator it = objectTexts.constFind(objectTextKey(type, id, flags));
+  if(it != objectTexts.constEnd())
+    return &it.value();
+  else
+    return nullptr;
+}
+
+void MapLabelLayout::insertObjectTexts(int type, int id, textflags::TextFlags flags, const QStringList& texts)
+{
+  if(objectTexts.size() >= MAX_OBJECT_TEXTS)
+    objectTexts.clear();
+
+  objectTexts.insert(objectTextKey(type, id, flags), texts);
+}
+
+void MapLabelLayout::clearTextCache()
+{
+  clearFonts();
+  objectTexts.clear();
+}
+
+void MapLabelLayout::clearFonts()
+{
+  fonts.clear();
+  metrics.clear();
+  staticTexts.clear();
+}
+
+quint64 MapLabelLayout::objectTextKey(int type, int id, textflags::TextFlags flags)
+{
+  // Object type uses 24 bits and text flags 8 bits
+  return (static_cast<quint64>(type) << 40) | (static_cast<quint64>(flags & textflags::ALL) << 32) |
+         static_cast<quint32>(id);
+}
+
+int MapLabelLayout::fontIndex(QPainter *painter, const QFont& font)
+{
+  // Only a few fonts are used for labels
+  for(int i = 0; i < fonts.size(); i++)
+  {
+    if(fonts.at(i) == font)
+      return i;
+  }
+
+  painter->save();
+  painter->setFont(font);
+  metrics.append(painter->fontMetrics());
+  painter->restore();
+
+  fonts.append(font);
+  staticTexts.append(QHash<QString, QStaticText>());
+  return fonts.size() - 1;
+}
+
+QStaticText MapLabelLayout::staticText(int index, const QString& text)
+{
+  QHash<QString, QStaticText>& texts = staticTexts[index];
+
+  QHash<QString, QStaticText>::const_iterator it = texts.constFind(text);
+  if(it != texts.constEnd())
+    return it.value();
+
+  if(texts.size() >= MAX_TEXTS)
+    texts.clear();
+
+  // Layout and glyphs are created once and reused while drawing
+  QStaticText prepared(text);
+  prepared.setTextFormat(Qt::PlainText);
+  prepared.setPerformanceHint(QStaticText::AggressiveCaching);
+  prepared.prepare(QTransform(), fonts.at(index));
+  texts.insert(text, prepared);
+  return prepared;
+}
+
+bool MapLabelLayout::isFree(const QRect& rect) const
+{
+  int x1, y1, x2, y2;
+  if(!cellRange(rect, x1, y1, x2, y2))
+    return true;
+
+  for(int y = y1; y <= y2; y++)
+  {
+    for(int x = x1; x <= x2; x++)
+    {
+      for(int index : grid.at(y * gridColumns + x))
+      {
+        if(placed.at(index).intersects(rect))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+void MapLabelLayout::occupy(const QRect& rect)
+{
+  placed.append(rect);
+
+  int x1, y1, x2, y2;
+  if(!cellRange(rect, x1, y1, x2, y2))
+    return;
+
+  int index = placed.size() - 1;
+  for(int y = y1; y <= y2; y++)
+  {
+    for(int x = x1; x <= x2; x++)
+      grid[y * gridColumns + x].append(index);
+  }
+}
+
+bool MapLabelLayout::cellRange(const QRect& rect, int& x1, int& y1, int& x2, int& y2) const
+{
+  if(gridColumns == 0 || gridRows == 0)
+    return false;
+
+  // Division rounds towards zero - keep negative coordinates out of the first cell
+  if(rect.right() < 0 || rect.bottom() < 0)
+    return false;
+
+  x1 = std::max(rect.left(), 0) / CELL_SIZE;
+  y1 = std::max(rect.top(), 0) / CELL_SIZE;
+  x2 = rect.right() / CELL_SIZE;
+  y2 = rect.bottom() / CELL_SIZE;
+
+  if(x1 >= gridColumns || y1 >= gridRows)
+    return false;
+
+  x2 = std::min(x2, gridColumns - 1);
+  y2 = std::min(y2, gridRows - 1);
+  return true;
+}
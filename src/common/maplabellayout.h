@@ -0,0 +1,165 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPLABELLAYOUT_H
+#define LITTLENAVMAP_MAPLABELLAYOUT_H
+
+#include "common/symbolpainter.h"
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QHash>
+#include <QPen>
+#include <QRect>
+#include <QStaticText>
+#include <QVector>
+
+namespace maptypes {
+struct MapAirport;
+
+}
+
+namespace labelprio {
+/* Placement priorities for map labels. Labels with higher values are placed first. */
+enum LabelPriority
+{
+  NONE = 0,
+  MARKER = 100,
+  WAYPOINT = 200,
+  NDB = 300,
+  VOR = 400,
+  AIRPORT = 1000, /* Base for airports. Rating and longest runway are added */
+  ROUTE = 1000000 /* Flight plan labels are always drawn */
+};
+
+/* Priority for an airport label depending on rating and longest runway */
+int airportPriority(const maptypes::MapAirport& airport);
+
+}
+
+/*
+ * Collects the map labels of one frame and draws them after all symbols. Labels are placed in order of
+ * priority using a screen grid. Labels that overlap an already placed label are dropped without drawing
+ * any text. Flight plan labels are always drawn.
+ *
+ * Formatted texts of map objects and prepared static texts are kept across frames. Static texts are
+ * stored per font which includes the scale factor from the options.
+ */
+class MapLabelLayout
+{
+public:
+  MapLabelLayout();
+  ~MapLabelLayout();
+
+  /* Remove all labels and prepare the grid for the given screen size */
+  void beginFrame(QPainter *painter, const QSize& size);
+
+  /* Add a text box using the same parameters as SymbolPainter::textBox. Font is taken from the painter. */
+  void addLabel(QPainter *painter, const QStringList& texts, const QPen& textPen, int x, int y,
+                textatt::TextAttributes atts, int transparency, int priority);
+
+  /* Add all labels of another layout which was filled for a map tile */
+  void addLabels(QPainter *painter, const MapLabelLayout& other);
+
+  /* Ignore labels positioned outside of this rectangle. Used by map tiles to avoid duplicate labels of
+   * objects that are drawn by neighbor tiles too. Null rectangle accepts all labels. */
+  void setPositionRect(const QRect& rect)
+  {
+    positionRect = rect;
+  }
+
+  /* Place all labels by priority and draw the ones that do not overlap */
+  void drawLabels(QPainter *painter);
+
+  /* Formatted texts of a map object or null if not cached. Pointer is valid until the next insert.
+   * @param type maptypes::MapObjectType */
+  const QStringList *findObjectTexts(int type, int id, textflags::TextFlags flags) const;
+  void insertObjectTexts(int type, int id, textflags::TextFlags flags, const QStringList& texts);
+
+  /* Drop all formatted and prepared texts. Call after changing options or loading a database. */
+  void clearTextCache();
+
+  /* Number of labels added and drawn in the last frame */
+  int getNumLabels() const
+  {
+    return labels.size();
+  }
+
+  int getNumLabelsDrawn() const
+  {
+    return placed.size();
+  }
+
+private:
+  struct Label
+  {
+    QVector<QStaticText> texts;
+    QPen pen;
+    QRect rect; /* Screen rectangle covering all lines */
+    int x, y, fontIndex, transparency, priority;
+    textatt::TextAttributes atts;
+  };
+
+  /* Index into fonts. Adds font and metrics if not found. */
+  int fontIndex(QPainter *painter, const QFont& font);
+
+  /* Text prepared for the font with the given index */
+  QStaticText staticText(int index, const QString& text);
+  void clearFonts();
+
+  static quint64 objectTextKey(int type, int id, textflags::TextFlags flags);
+
+  /* true if rect does not overlap any placed label */
+  bool isFree(const QRect& rect) const;
+  void occupy(const QRect& rect);
+
+  /* Range of grid cells covered by rect. Returns false if rect is outside of the grid. */
+  bool cellRange(const QRect& rect, int& x1, int& y1, int& x2, int& y2) const;
+
+  QVector<Label> labels;
+
+  /* Fonts with attributes applied, metrics and prepared texts with the same index */
+  QVector<QFont> fonts;
+  QList<QFontMetrics> metrics;
+  QVector<QHash<QString, QStaticText> > staticTexts;
+  int logicalDpi = 0;
+
+  /* Formatted texts by object type, id and text flags */
+  QHash<quint64, QStringList> objectTexts;
+
+  /* Rectangles of drawn labels and indexes into placed for each grid cell */
+  QVector<QRect> placed;
+  QVector<QVector<int> > grid;
+  int gridColumns = 0, gridRows = 0;
+  QRect positionRect;
+
+  /* Used to draw the placed labels */
+  SymbolPainter *symbolPainter;
+
+  /* Size of a grid cell in pixel */
+  static Q_DECL_CONSTEXPR int CELL_SIZE = 64;
+
+  /* Minimum distance between labels in pixel */
+  static Q_DECL_CONSTEXPR int LABEL_MARGIN = 2;
+
+  /* Start over if too many fonts or texts were cached. Fonts are evicted only at the start of a frame */
+  static Q_DECL_CONSTEXPR int MAX_FONTS = 32;
+  static Q_DECL_CONSTEXPR int MAX_TEXTS = 20000;
+  static Q_DECL_CONSTEXPR int MAX_OBJECT_TEXTS = 50000;
+};
+
+#endif // LITTLENAVMAP_MAPLABELLAYOUT_H
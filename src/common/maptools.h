@@ -43,14 +43,17 @@ void insertSortedByDistance(const CoordinateConverter& conv, QList<TYPE>& list,
 
   if(ids == nullptr || !ids->contains(type.getId()))
   {
-    auto it = std::lower_bound(list.begin(), list.end(), type,
-                               [ = ](const TYPE &a1, const TYPE &a2)->bool
+    // Project the new element only once. List elements are usually found in the projection cache of conv.
+    int x, y;
+    conv.wToS(type.getPosition(), x, y);
+    int distance = atools::geo::manhattanDistance(x, y, xs, ys);
+
+    auto it = std::lower_bound(list.begin(), list.end(), distance,
+                               [&conv, xs, ys](const TYPE &a1, int dist)->bool
                                {
-                                 int x1, y1, x2, y2;
+                                 int x1, y1;
                                  conv.wToS(a1.getPosition(), x1, y1);
-                                 conv.wToS(a2.getPosition(), x2, y2);
-                                 return atools::geo::manhattanDistance(x1, y1, xs, ys) <
-                                 atools::geo::manhattanDistance(x2, y2, xs, ys);
+                                 return atools::geo::manhattanDistance(x1, y1, xs, ys) < dist;
                                });
     list.insert(it, type);
 
@@ -64,14 +67,16 @@ template<typename TYPE>
 void insertSortedByTowerDistance(const CoordinateConverter& conv, QList<TYPE>& list, int xs, int ys,
                                  TYPE type)
 {
-  auto it = std::lower_bound(list.begin(), list.end(), type,
-                             [ = ](const TYPE &a1, const TYPE &a2)->bool
+  int x, y;
+  conv.wToS(type.towerCoords, x, y);
+  int distance = atools::geo::manhattanDistance(x, y, xs, ys);
+
+  auto it = std::lower_bound(list.begin(), list.end(), distance,
+                             [&conv, xs, ys](const TYPE &a1, int dist)->bool
                              {
-                               int x1, y1, x2, y2;
+                               int x1, y1;
                                conv.wToS(a1.towerCoords, x1, y1);
-                               conv.wToS(a2.towerCoords, x2, y2);
-                               return atools::geo::manhattanDistance(x1, y1, xs, ys) <
-                               atools::geo::manhattanDistance(x2, y2, xs, ys);
+                               return atools::geo::manhattanDistance(x1, y1, xs, ys) < dist;
                              });
   list.insert(it, type);
 }
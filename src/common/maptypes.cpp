@@ -275,6 +275,42 @@ QString parkingNameForFlightplan(const maptypes::MapParking& parking)
   return parkingNameMap.value(parking.name).toUpper() + " " + QString::number(parking.number);
 }
 
+int MapAirportDiagram::memorySize() const
+{
+  auto stringSize = [](const QString& str) -> int
+                    {
+                      return str.size() * static_cast<int>(sizeof(QChar));
+                    };
+
+  int size = static_cast<int>(sizeof(MapAirportDiagram));
+  size += runways.size() * static_cast<int>(sizeof(MapRunway));
+  for(const MapRunway& runway : runways)
+    size += stringSize(runway.surface) + stringSize(runway.primaryName) + stringSize(runway.secondaryName) +
+            stringSize(runway.edgeLight);
+
+  size += aprons.size() * static_cast<int>(sizeof(MapApron));
+  for(const MapApron& apron : aprons)
+    size += apron.vertices.size() * static_cast<int>(sizeof(atools::geo::Pos)) + stringSize(apron.surface);
+
+  size += taxiPaths.size() * static_cast<int>(sizeof(MapTaxiPath));
+  for(const MapTaxiPath& taxiPath : taxiPaths)
+    size += stringSize(taxiPath.surface) + stringSize(taxiPath.name);
+
+  size += parkings.size() * static_cast<int>(sizeof(MapParking));
+  for(const MapParking& parking : parkings)
+    size += stringSize(parking.type) + stringSize(parking.name) + stringSize(parking.airlineCodes);
+
+  size += starts.size() * static_cast<int>(sizeof(MapStart));
+  for(const MapStart& start : starts)
+    size += stringSize(start.type) + stringSize(start.runwayName);
+
+  size += helipads.size() * static_cast<int>(sizeof(MapHelipad));
+  for(const MapHelipad& helipad : helipads)
+    size += stringSize(helipad.surface) + stringSize(helipad.type);
+
+  return size;
+}
+
 bool MapAirport::closed() const
 {
   return flags.testFlag(AP_CLOSED);
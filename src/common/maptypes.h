@@ -24,6 +24,7 @@
 
 #include <QColor>
 #include <QString>
+#include <QVector>
 
 /*
  * Maptypes are mostly filled from database tables and are used to pass airport, navaid and more information
@@ -304,6 +305,21 @@ struct MapHelipad
 
 };
 
+/* All objects needed to draw the diagram of one airport. Loaded at once and cached by MapQuery. */
+struct MapAirportDiagram
+{
+  QVector<MapRunway> runways; /* Sorted to have hard and long runways at the end */
+  QVector<MapApron> aprons;
+  QVector<MapTaxiPath> taxiPaths;
+  QVector<MapParking> parkings;
+  QVector<MapStart> starts;
+  QVector<MapHelipad> helipads;
+
+  /* Approximate memory usage in bytes including strings and apron vertices */
+  int memorySize() const;
+
+};
+
 /* VOR station */
 struct MapVor
 {
@@ -0,0 +1,247 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "common/maptypesbenchmark.h"
+
+#include "common/benchmarkarguments.h"
+#include "common/maptypesfactory.h"
+#include "mapgui/mapquery.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlrecord.h"
+#include "exception.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+using atools::sql::SqlDatabase;
+using atools::sql::SqlQuery;
+
+namespace {
+/* Command line option that starts the benchmark */
+const QString BENCHMARK_OPTION("--maptypes-benchmark");
+
+/* CSV header. Keep in sync with MapTypesBenchmark::runTable. */
+const QString CSV_HEADER("table,method,queries,rows,time_ms,rows_per_ms");
+
+}
+
+MapTypesBenchmark::MapTypesBenchmark(const QStringList& arguments)
+{
+  BenchmarkArguments args(arguments, BENCHMARK_OPTION, QStringList(), {"--tile-size", "--repeat"});
+  bool tileSizeValid, repeatValid;
+  tileSizeDeg = args.intValue("--tile-size", tileSizeDeg, tileSizeValid);
+  repeat = args.intValue("--repeat", repeat, repeatValid);
+
+  const QStringList& files = args.getFiles();
+  if(args.isValid() && tileSizeValid && repeatValid && tileSizeDeg > 0 && repeat > 0 &&
+     (files.size() == 1 || files.size() == 2))
+  {
+    databaseFile = files.at(0);
+    outputFile = files.value(1);
+    argumentsValid = true;
+  }
+}
+
+MapTypesBenchmark::~MapTypesBenchmark()
+{
+  delete factory;
+
+  if(db != nullptr)
+  {
+    db->close();
+    delete db;
+    SqlDatabase::removeDatabase(DATABASE_NAME);
+  }
+}
+
+bool MapTypesBenchmark::isBenchmark(const QStringList& arguments)
+{
+  return BenchmarkArguments::isBenchmark(arguments, BENCHMARK_OPTION);
+}
+
+int MapTypesBenchmark::run()
+{
+  if(!argumentsValid)
+  {
+    BenchmarkArguments::printUsage(BENCHMARK_OPTION,
+                                   "DATABASE [OUTPUT] [--tile-size DEGREES] [--repeat COUNT]");
+    return 1;
+  }
+
+  QFile outFile;
+  if(!BenchmarkArguments::openOutput(outFile, outputFile))
+    return 1;
+  QTextStream out(&outFile);
+
+  try
+  {
+    db = new SqlDatabase(SqlDatabase::addDatabase(DATABASE_TYPE, DATABASE_NAME));
+    db->setDatabaseName(databaseFile);
+    db->open();
+    factory = new MapTypesFactory();
+
+    out << CSV_HEADER << endl;
+    runTable("airport", AIRPORT, out);
+    runTable("airport_large", AIRPORT_OVERVIEW, out);
+    runTable("airport_medium", AIRPORT_OVERVIEW, out);
+    runTable("waypoint", WAYPOINT, out);
+    runTable("vor", VOR, out);
+    runTable("ndb", NDB, out);
+  }
+  catch(atools::Exception& e)
+  {
+    qCritical() << "Benchmark failed" << e.what();
+    return 1;
+  }
+
+  qInfo() << "Benchmark done";
+  return 0;
+}
+
+/* Run all rectangles for both methods and write a CSV line for each */
+void MapTypesBenchmark::runTable(const QString& table, ObjectType type, QTextStream& out)
+{
+  SqlQuery query(db);
+  query.prepare("select * from " + table +
+                " where lonx between :leftx and :rightx and laty between :bottomy and :topy limit " +
+                QString::number(MapQuery::QUERY_ROW_LIMIT));
+
+  // Warm up the database page cache so that the first method is not penalized
+  runPass(query, type, false);
+
+  PassResult record, streaming;
+  for(int i = 0; i < repeat; i++)
+  {
+    // Alternate methods to spread out any caching effects
+    PassResult result = runPass(query, type, false);
+    record.timeMs += result.timeMs;
+    record.rows += result.rows;
+    record.queries += result.queries;
+    record.checksum += result.checksum;
+
+    result = runPass(query, type, true);
+    streaming.timeMs += result.timeMs;
+    streaming.rows += result.rows;
+    streaming.queries += result.queries;
+    streaming.checksum += result.checksum;
+  }
+
+  if(record.rows != streaming.rows || record.checksum != streaming.checksum)
+    qWarning() << "Results differ for" << table << "rows" << record.rows << streaming.rows
+               << "checksum" << record.checksum << streaming.checksum;
+
+  auto writeLine = [ =, &out](const QString& method, const PassResult& result) -> void
+                   {
+                     out << table << "," << method << "," << result.queries << "," << result.rows << ","
+                         << result.timeMs << ","
+                         << QString::number(result.timeMs > 0 ?
+                                            static_cast<double>(result.rows) / result.timeMs : 0., 'f', 1)
+                         << endl;
+                   };
+  writeLine("record", record);
+  writeLine("streaming", streaming);
+}
+
+/* Query all tiles of the world once */
+MapTypesBenchmark::PassResult MapTypesBenchmark::runPass(SqlQuery& query, ObjectType type, bool streaming)
+{
+  PassResult result;
+  MapTypesColumns columns;
+
+  QElapsedTimer timer;
+  timer.start();
+  for(int lonx = -180; lonx < 180; lonx += tileSizeDeg)
+  {
+    for(int laty = -90; laty < 90; laty += tileSizeDeg)
+    {
+      query.bindValue(":leftx", lonx);
+      query.bindValue(":rightx", lonx + tileSizeDeg);
+      query.bindValue(":bottomy", laty);
+      query.bindValue(":topy", laty + tileSizeDeg);
+      query.exec();
+      while(query.next())
+      {
+        result.checksum += fillRow(query, type, streaming, columns);
+        result.rows++;
+      }
+      result.queries++;
+    }
+  }
+  result.timeMs = timer.elapsed();
+  return result;
+}
+
+/* Create one object and return a checksum of a few attributes */
+qint64 MapTypesBenchmark::fillRow(SqlQuery& query, ObjectType type, bool streaming, MapTypesColumns& columns)
+{
+  switch(type)
+  {
+    case AIRPORT:
+    case AIRPORT_OVERVIEW:
+      {
+        maptypes::MapAirport airport;
+        if(type == AIRPORT_OVERVIEW)
+        {
+          if(streaming)
+            factory->fillAirportForOverview(query, columns, airport);
+          else
+            factory->fillAirportForOverview(query.record(), airport);
+        }
+        else
+        {
+          if(streaming)
+            factory->fillAirport(query, columns, airport);
+          else
+            factory->fillAirport(query.record(), airport, true);
+        }
+        return airport.id + static_cast<int>(airport.flags) + airport.ident.size() + airport.name.size();
+      }
+
+    case WAYPOINT:
+      {
+        maptypes::MapWaypoint waypoint;
+        if(streaming)
+          factory->fillWaypoint(query, columns, waypoint);
+        else
+          factory->fillWaypoint(query.record(), waypoint);
+        return waypoint.id + waypoint.ident.size() + waypoint.hasVictorAirways + waypoint.hasJetAirways;
+      }
+
+    case VOR:
+      {
+        maptypes::MapVor vor;
+        if(streaming)
+          factory->fillVor(query, columns, vor);
+        else
+          factory->fillVor(query.record(), vor);
+        return vor.id + vor.frequency + vor.ident.size() + vor.name.size() + vor.dmeOnly + vor.hasDme;
+      }
+
+    case NDB:
+      {
+        maptypes::MapNdb ndb;
+        if(streaming)
+          factory->fillNdb(query, columns, ndb);
+        else
+          factory->fillNdb(query.record(), ndb);
+        return ndb.id + ndb.frequency + ndb.ident.size() + ndb.name.size();
+      }
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPTYPESBENCHMARK_H
+#define LITTLENAVMAP_MAPTYPESBENCHMARK_H
+
+#include <QStringList>
+
+class QTextStream;
+class MapTypesFactory;
+class MapTypesColumns;
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+class SqlQuery;
+}
+}
+
+/*
+ * Headless micro-benchmark for MapTypesFactory. Runs bounding rectangle queries over the whole world for
+ * airports, waypoints, VOR and NDB and compares the record based fill methods with the streaming ones.
+ * Writes time and row count for each table and method as CSV.
+ *
+ * Started from main using the command line:
+ * littlenavmap --maptypes-benchmark DATABASE [OUTPUT] [--tile-size DEGREES] [--repeat COUNT]
+ *
+ * Output goes to stdout if OUTPUT is not given. Add "-platform offscreen" if no display is available.
+ */
+class MapTypesBenchmark
+{
+public:
+  /* All application command line arguments */
+  MapTypesBenchmark(const QStringList& arguments);
+  ~MapTypesBenchmark();
+
+  /* Run all queries. Returns the process exit code. */
+  int run();
+
+  /* true if the application command line requests a benchmark run */
+  static bool isBenchmark(const QStringList& arguments);
+
+private:
+  enum ObjectType
+  {
+    AIRPORT,
+    AIRPORT_OVERVIEW,
+    WAYPOINT,
+    VOR,
+    NDB
+  };
+
+  struct PassResult
+  {
+    qint64 timeMs = 0;
+    int rows = 0, queries = 0;
+    qint64 checksum = 0; /* Sum of ids and some attributes to compare both methods */
+  };
+
+  void runTable(const QString& table, ObjectType type, QTextStream& out);
+  PassResult runPass(atools::sql::SqlQuery& query, ObjectType type, bool streaming);
+  qint64 fillRow(atools::sql::SqlQuery& query, ObjectType type, bool streaming, MapTypesColumns& columns);
+
+  QString databaseFile, outputFile;
+  int tileSizeDeg = 4, repeat = 3;
+  bool argumentsValid = false;
+
+  atools::sql::SqlDatabase *db = nullptr;
+  MapTypesFactory *factory = nullptr;
+
+  const QString DATABASE_NAME = "LNMDB_MAPTYPES_BENCHMARK";
+  const QString DATABASE_TYPE = "QSQLITE";
+};
+
+#endif // LITTLENAVMAP_MAPTYPESBENCHMARK_H
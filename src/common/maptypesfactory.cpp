@@ -19,11 +19,122 @@
 
 #include <cmath>
 #include "sql/sqlrecord.h"
+#include "sql/sqlquery.h"
 
 using namespace atools::geo;
 using atools::sql::SqlRecord;
+using atools::sql::SqlQuery;
 using namespace maptypes;
 
+namespace {
+/* Column indexes for the streaming methods. Order has to match the name lists below. */
+enum AirportColumn
+{
+  COL_AP_ID, COL_AP_IDENT, COL_AP_NAME,
+  COL_AP_TOWER_FREQ, COL_AP_ATIS_FREQ, COL_AP_AWOS_FREQ, COL_AP_ASOS_FREQ, COL_AP_UNICOM_FREQ,
+  COL_AP_RUNWAY_LENGTH, COL_AP_RUNWAY_HEADING, COL_AP_MAGVAR,
+  COL_AP_LEFT, COL_AP_TOP, COL_AP_RIGHT, COL_AP_BOTTOM,
+  COL_AP_TOWER_OBJECT, COL_AP_TOWER_LONX, COL_AP_TOWER_LATY,
+  COL_AP_LONX, COL_AP_LATY, COL_AP_ALTITUDE, COL_AP_RATING,
+  COL_AP_FLAGS /* First column of AIRPORT_FLAG_COLUMNS */
+};
+
+enum NavColumn
+{
+  COL_NAV_ID, COL_NAV_IDENT, COL_NAV_REGION, COL_NAV_TYPE, COL_NAV_NAME,
+  COL_NAV_FREQUENCY, COL_NAV_RANGE, COL_NAV_MAGVAR, COL_NAV_LONX, COL_NAV_LATY, COL_NAV_ALTITUDE,
+  COL_NAV_DME_ONLY, COL_NAV_DME_ALTITUDE /* VOR only */
+};
+
+enum WaypointColumn
+{
+  COL_WP_ID, COL_WP_IDENT, COL_WP_REGION, COL_WP_TYPE, COL_WP_MAGVAR, COL_WP_LONX, COL_WP_LATY,
+  COL_WP_NUM_VICTOR, COL_WP_NUM_JET
+};
+
+struct FlagColumn
+{
+  const char *name;
+  MapAirportFlag flag;
+};
+
+/* Columns setting an airport flag if not null and not 0. The first NUM_OVERVIEW_FLAG_COLUMNS are
+ * also used for the overview. Same as in MapTypesFactory::fillAirportFlags. */
+const FlagColumn AIRPORT_FLAG_COLUMNS[] =
+{
+  {"num_helipad", AP_HELIPAD},
+  {"has_avgas", AP_AVGAS},
+  {"has_jetfuel", AP_JETFUEL},
+  {"tower_frequency", AP_TOWER},
+  {"is_closed", AP_CLOSED},
+  {"is_military", AP_MIL},
+  {"is_addon", AP_ADDON},
+  {"num_runway_hard", AP_HARD},
+  {"num_runway_soft", AP_SOFT},
+  {"num_runway_water", AP_WATER},
+  {"num_approach", AP_APPR},
+  {"num_runway_light", AP_LIGHT},
+  {"num_runway_end_ils", AP_ILS},
+  {"num_apron", AP_APRON},
+  {"num_taxi_path", AP_TAXIWAY},
+  {"has_tower_object", AP_TOWER_OBJ},
+  {"num_parking_gate", AP_PARKING},
+  {"num_parking_ga_ramp", AP_PARKING},
+  {"num_parking_cargo", AP_PARKING},
+  {"num_parking_mil_cargo", AP_PARKING},
+  {"num_parking_mil_combat", AP_PARKING},
+  {"num_runway_end_vasi", AP_VASI},
+  {"num_runway_end_als", AP_ALS},
+  {"num_boundary_fence", AP_FENCE},
+  {"num_runway_end_closed", AP_RW_CLOSED}
+};
+
+const int NUM_FLAG_COLUMNS = sizeof(AIRPORT_FLAG_COLUMNS) / sizeof(FlagColumn);
+const int NUM_OVERVIEW_FLAG_COLUMNS = 10;
+
+QStringList airportColumnNames()
+{
+  QStringList names({"airport_id", "ident", "name",
+                     "tower_frequency", "atis_frequency", "awos_frequency", "asos_frequency",
+                     "unicom_frequency",
+                     "longest_runway_length", "longest_runway_heading", "mag_var",
+                     "left_lonx", "top_laty", "right_lonx", "bottom_laty",
+                     "has_tower_object", "tower_lonx", "tower_laty",
+                     "lonx", "laty", "altitude", "rating"});
+  for(const FlagColumn& column : AIRPORT_FLAG_COLUMNS)
+    names.append(column.name);
+  return names;
+}
+
+const QStringList AIRPORT_COLUMN_NAMES = airportColumnNames();
+
+const QStringList VOR_COLUMN_NAMES({"vor_id", "ident", "region", "type", "name",
+                                    "frequency", "range", "mag_var", "lonx", "laty", "altitude",
+                                    "dme_only", "dme_altitude"});
+
+const QStringList NDB_COLUMN_NAMES({"ndb_id", "ident", "region", "type", "name",
+                                    "frequency", "range", "mag_var", "lonx", "laty", "altitude"});
+
+const QStringList WAYPOINT_COLUMN_NAMES({"waypoint_id", "ident", "region", "type", "mag_var", "lonx", "laty",
+                                         "num_victor_airway", "num_jet_airway"});
+
+/* Value of the current row or a null value if the column is not part of the query */
+inline QVariant columnValue(const SqlQuery& query, const MapTypesColumns& columns, int column)
+{
+  int index = columns.at(column);
+  return index == -1 ? QVariant() : query.value(index);
+}
+
+}
+
+void MapTypesColumns::resolve(const SqlRecord& record, const QStringList& names)
+{
+  indexes.clear();
+  indexes.reserve(names.size());
+  for(const QString& name : names)
+    indexes.append(record.indexOf(name));
+}
+
 MapTypesFactory::MapTypesFactory()
 {
 
@@ -344,3 +455,139 @@ void MapTypesFactory::fillStart(const SqlRecord& record, maptypes::MapStart& sta
   start.position = Pos(record.valueFloat("lonx"), record.valueFloat("laty"), record.valueFloat("altitude"));
   start.heading = static_cast<int>(std::roundf(record.valueFloat("heading")));
 }
+
+// ---------------------------------------------------------------------------------
+// Streaming methods
+void MapTypesFactory::fillAirport(const SqlQuery& query, MapTypesColumns& columns,
+                                  maptypes::MapAirport& airport)
+{
+  if(!columns.isResolved())
+    columns.resolve(query.record(), AIRPORT_COLUMN_NAMES);
+
+  fillAirportBase(query, columns, airport);
+
+  airport.flags = fillAirportFlags(query, columns, false);
+  if(columns.at(COL_AP_TOWER_OBJECT) != -1)
+    airport.towerCoords = Pos(columnValue(query, columns, COL_AP_TOWER_LONX).toFloat(),
+                              columnValue(query, columns, COL_AP_TOWER_LATY).toFloat());
+
+  airport.atisFrequency = columnValue(query, columns, COL_AP_ATIS_FREQ).toInt();
+  airport.awosFrequency = columnValue(query, columns, COL_AP_AWOS_FREQ).toInt();
+  airport.asosFrequency = columnValue(query, columns, COL_AP_ASOS_FREQ).toInt();
+  airport.unicomFrequency = columnValue(query, columns, COL_AP_UNICOM_FREQ).toInt();
+
+  airport.position = Pos(columnValue(query, columns, COL_AP_LONX).toFloat(),
+                         columnValue(query, columns, COL_AP_LATY).toFloat(),
+                         columnValue(query, columns, COL_AP_ALTITUDE).toFloat());
+}
+
+void MapTypesFactory::fillAirportForOverview(const SqlQuery& query, MapTypesColumns& columns,
+                                             maptypes::MapAirport& airport)
+{
+  if(!columns.isResolved())
+    columns.resolve(query.record(), AIRPORT_COLUMN_NAMES);
+
+  fillAirportBase(query, columns, airport);
+
+  airport.flags = fillAirportFlags(query, columns, true);
+  airport.position = Pos(columnValue(query, columns, COL_AP_LONX).toFloat(),
+                         columnValue(query, columns, COL_AP_LATY).toFloat(), 0.f);
+}
+
+void MapTypesFactory::fillAirportBase(const SqlQuery& query, const MapTypesColumns& columns,
+                                      maptypes::MapAirport& ap)
+{
+  ap.id = columnValue(query, columns, COL_AP_ID).toInt();
+  ap.towerFrequency = columnValue(query, columns, COL_AP_TOWER_FREQ).toInt();
+  ap.ident = columnValue(query, columns, COL_AP_IDENT).toString();
+  ap.name = columnValue(query, columns, COL_AP_NAME).toString();
+  ap.longestRunwayLength = columnValue(query, columns, COL_AP_RUNWAY_LENGTH).toInt();
+  ap.longestRunwayHeading =
+    static_cast<int>(std::round(columnValue(query, columns, COL_AP_RUNWAY_HEADING).toFloat()));
+  ap.magvar = columnValue(query, columns, COL_AP_MAGVAR).toFloat();
+
+  ap.bounding = Rect(columnValue(query, columns, COL_AP_LEFT).toFloat(),
+                     columnValue(query, columns, COL_AP_TOP).toFloat(),
+                     columnValue(query, columns, COL_AP_RIGHT).toFloat(),
+                     columnValue(query, columns, COL_AP_BOTTOM).toFloat());
+  ap.flags |= AP_COMPLETE;
+}
+
+maptypes::MapAirportFlags MapTypesFactory::fillAirportFlags(const SqlQuery& query,
+                                                            const MapTypesColumns& columns, bool overview)
+{
+  MapAirportFlags flags = 0;
+  int numColumns = overview ? NUM_OVERVIEW_FLAG_COLUMNS : NUM_FLAG_COLUMNS;
+  for(int i = 0; i < numColumns; i++)
+  {
+    // Null values are converted to 0
+    if(columnValue(query, columns, COL_AP_FLAGS + i).toInt() != 0)
+      flags |= AIRPORT_FLAG_COLUMNS[i].flag;
+  }
+
+  if(overview && columnValue(query, columns, COL_AP_RATING).toInt() > 0)
+  {
+    // Force non empty airports for overview results
+    flags |= AP_APRON;
+    flags |= AP_TAXIWAY;
+    flags |= AP_TOWER_OBJ;
+  }
+
+  return flags;
+}
+
+void MapTypesFactory::fillVor(const SqlQuery& query, MapTypesColumns& columns, maptypes::MapVor& vor)
+{
+  if(!columns.isResolved())
+    columns.resolve(query.record(), VOR_COLUMN_NAMES);
+
+  vor.id = columnValue(query, columns, COL_NAV_ID).toInt();
+  vor.ident = columnValue(query, columns, COL_NAV_IDENT).toString();
+  vor.region = columnValue(query, columns, COL_NAV_REGION).toString();
+  vor.name = columnValue(query, columns, COL_NAV_NAME).toString();
+  vor.type = columnValue(query, columns, COL_NAV_TYPE).toString();
+  vor.frequency = columnValue(query, columns, COL_NAV_FREQUENCY).toInt();
+  vor.range = columnValue(query, columns, COL_NAV_RANGE).toInt();
+  vor.magvar = columnValue(query, columns, COL_NAV_MAGVAR).toFloat();
+  vor.position = Pos(columnValue(query, columns, COL_NAV_LONX).toFloat(),
+                     columnValue(query, columns, COL_NAV_LATY).toFloat(),
+                     columnValue(query, columns, COL_NAV_ALTITUDE).toFloat());
+
+  vor.dmeOnly = columnValue(query, columns, COL_NAV_DME_ONLY).toInt() > 0;
+  vor.hasDme = !columnValue(query, columns, COL_NAV_DME_ALTITUDE).isNull();
+}
+
+void MapTypesFactory::fillNdb(const SqlQuery& query, MapTypesColumns& columns, maptypes::MapNdb& ndb)
+{
+  if(!columns.isResolved())
+    columns.resolve(query.record(), NDB_COLUMN_NAMES);
+
+  ndb.id = columnValue(query, columns, COL_NAV_ID).toInt();
+  ndb.ident = columnValue(query, columns, COL_NAV_IDENT).toString();
+  ndb.region = columnValue(query, columns, COL_NAV_REGION).toString();
+  ndb.name = columnValue(query, columns, COL_NAV_NAME).toString();
+  ndb.type = columnValue(query, columns, COL_NAV_TYPE).toString();
+  ndb.frequency = columnValue(query, columns, COL_NAV_FREQUENCY).toInt();
+  ndb.range = columnValue(query, columns, COL_NAV_RANGE).toInt();
+  ndb.magvar = columnValue(query, columns, COL_NAV_MAGVAR).toFloat();
+  ndb.position = Pos(columnValue(query, columns, COL_NAV_LONX).toFloat(),
+                     columnValue(query, columns, COL_NAV_LATY).toFloat(),
+                     columnValue(query, columns, COL_NAV_ALTITUDE).toFloat());
+}
+
+void MapTypesFactory::fillWaypoint(const SqlQuery& query, MapTypesColumns& columns,
+                                   maptypes::MapWaypoint& waypoint)
+{
+  if(!columns.isResolved())
+    columns.resolve(query.record(), WAYPOINT_COLUMN_NAMES);
+
+  waypoint.id = columnValue(query, columns, COL_WP_ID).toInt();
+  waypoint.ident = columnValue(query, columns, COL_WP_IDENT).toString();
+  waypoint.region = columnValue(query, columns, COL_WP_REGION).toString();
+  waypoint.type = columnValue(query, columns, COL_WP_TYPE).toString();
+  waypoint.magvar = columnValue(query, columns, COL_WP_MAGVAR).toFloat();
+  waypoint.hasVictorAirways = columnValue(query, columns, COL_WP_NUM_VICTOR).toInt() > 0;
+  waypoint.hasJetAirways = columnValue(query, columns, COL_WP_NUM_JET).toInt() > 0;
+  waypoint.position = Pos(columnValue(query, columns, COL_WP_LONX).toFloat(),
+                          columnValue(query, columns, COL_WP_LATY).toFloat());
+}
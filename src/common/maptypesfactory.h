@@ -20,13 +20,45 @@
 
 #include "common/maptypes.h"
 
+#include <QVector>
+
 namespace atools {
 namespace sql {
 
 class SqlRecord;
+class SqlQuery;
 }
 }
 
+/*
+ * Column indexes of a query result used by the streaming fill methods of MapTypesFactory.
+ * Resolved by name on the first row and kept until cleared. Missing columns have the index -1.
+ * Use one object for each prepared query and clear it when the query is prepared again.
+ */
+class MapTypesColumns
+{
+public:
+  bool isResolved() const
+  {
+    return !indexes.isEmpty();
+  }
+
+  void resolve(const atools::sql::SqlRecord& record, const QStringList& names);
+
+  void clear()
+  {
+    indexes.clear();
+  }
+
+  int at(int column) const
+  {
+    return indexes.at(column);
+  }
+
+private:
+  QVector<int> indexes;
+};
+
 /*
  * Create all map objects (namespace maptypes) from sql records. The sql records can be
  * a result from sql queries or manually built.
@@ -67,6 +99,21 @@ public:
   void fillParking(const atools::sql::SqlRecord& record, maptypes::MapParking& parking);
   void fillStart(const atools::sql::SqlRecord& record, maptypes::MapStart& start);
 
+  /*
+   * Streaming versions of the methods above for the bounding rectangle queries. These read the current
+   * row of query by column index and avoid copying each row into a record and looking up fields by name.
+   * Results are the same as for the record based methods.
+   * @param columns resolved on first use
+   */
+  void fillAirport(const atools::sql::SqlQuery& query, MapTypesColumns& columns,
+                   maptypes::MapAirport& airport);
+  void fillAirportForOverview(const atools::sql::SqlQuery& query, MapTypesColumns& columns,
+                              maptypes::MapAirport& airport);
+  void fillVor(const atools::sql::SqlQuery& query, MapTypesColumns& columns, maptypes::MapVor& vor);
+  void fillNdb(const atools::sql::SqlQuery& query, MapTypesColumns& columns, maptypes::MapNdb& ndb);
+  void fillWaypoint(const atools::sql::SqlQuery& query, MapTypesColumns& columns,
+                    maptypes::MapWaypoint& waypoint);
+
 private:
   void fillVorBase(const atools::sql::SqlRecord& record, maptypes::MapVor& vor);
 
@@ -76,6 +123,11 @@ private:
                                         maptypes::MapAirportFlags airportFlag);
   maptypes::MapAirportFlags fillAirportFlags(const atools::sql::SqlRecord& record, bool overview);
 
+  void fillAirportBase(const atools::sql::SqlQuery& query, const MapTypesColumns& columns,
+                       maptypes::MapAirport& ap);
+  maptypes::MapAirportFlags fillAirportFlags(const atools::sql::SqlQuery& query,
+                                             const MapTypesColumns& columns, bool overview);
+
 };
 
 #endif // LITTLENAVMAP_MAPTYPESFACTORY_H
@@ -0,0 +1,79 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "common/projectioncache.h"
+
+#include "geo/pos.h"
+
+#include <marble/ViewportParams.h>
+
+#include <cstring>
+
+ProjectionCache::ProjectionCache()
+{
+}
+
+ProjectionCache::~ProjectionCache()
+{
+}
+
+void ProjectionCache::update(const Marble::ViewportParams *viewport)
+{
+  if(viewport->projection() != projection || viewport->centerLongitude() != centerLonX ||
+     viewport->centerLatitude() != centerLatY || viewport->radius() != radius ||
+     viewport->size() != viewportSize)
+  {
+    projection = viewport->projection();
+    centerLonX = viewport->centerLongitude();
+    centerLatY = viewport->centerLatitude();
+    radius = viewport->radius();
+    viewportSize = viewport->size();
+    points.clear();
+  }
+}
+
+const ProjectionCache::Point *ProjectionCache::find(const atools::geo::Pos& pos) const
+{
+  QHash<quint64, Point>::const_iterator it = points.constFind(key(pos));
+  if(it != points.constEnd())
+    return &it.value();
+  else
+    return nullptr;
+}
+
+void ProjectionCache::insert(const atools::geo::Pos& pos, const Point& point)
+{
+  if(points.size() >= MAX_POINTS)
+    points.clear();
+  points.insert(key(pos), point);
+}
+
+void ProjectionCache::clear()
+{
+  points.clear();
+  projection = Marble::VerticalPerspective;
+}
+
+quint64 ProjectionCache::key(const atools::geo::Pos& pos)
+{
+  // Use the binary representation of both coordinates to avoid floating point compares
+  float lonX = pos.getLonX(), latY = pos.getLatY();
+  quint32 lonBits, latBits;
+  std::memcpy(&lonBits, &lonX, sizeof(lonBits));
+  std::memcpy(&latBits, &latY, sizeof(latBits));
+  return static_cast<quint64>(lonBits) << 32 | latBits;
+}
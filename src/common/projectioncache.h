@@ -0,0 +1,86 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_PROJECTIONCACHE_H
+#define LITTLENAVMAP_PROJECTIONCACHE_H
+
+#include <QHash>
+#include <QSize>
+
+#include <marble/MarbleGlobal.h>
+
+namespace Marble {
+class ViewportParams;
+}
+
+namespace atools {
+namespace geo {
+class Pos;
+}
+}
+
+/*
+ * Screen coordinates of world positions for the current frame. Used by CoordinateConverter to avoid
+ * projecting the same position several times in painters, screen index and nearest object sorting.
+ *
+ * All points are dropped automatically once the viewport parameters change. Only conversions using the
+ * default size are cached since visibility depends on the size.
+ */
+class ProjectionCache
+{
+public:
+  ProjectionCache();
+  ~ProjectionCache();
+
+  /* Projected position */
+  struct Point
+  {
+    double x, y;
+    bool visible, hidden;
+  };
+
+  /* Drop all points if the viewport parameters differ from the last call */
+  void update(const Marble::ViewportParams *viewport);
+
+  /* @return cached point or null if not found */
+  const Point *find(const atools::geo::Pos& pos) const;
+
+  void insert(const atools::geo::Pos& pos, const Point& point);
+
+  void clear();
+
+  int size() const
+  {
+    return points.size();
+  }
+
+private:
+  static quint64 key(const atools::geo::Pos& pos);
+
+  QHash<quint64, Point> points;
+
+  /* Values of the current frame to detect view changes */
+  double centerLonX = 0., centerLatY = 0.;
+  int radius = 0;
+  QSize viewportSize;
+  Marble::Projection projection = Marble::VerticalPerspective; // VerticalPerspective is never used
+
+  /* Start over if a frame contains an unusual high number of positions */
+  static Q_DECL_CONSTEXPR int MAX_POINTS = 100000;
+};
+
+#endif // LITTLENAVMAP_PROJECTIONCACHE_H
@@ -20,12 +20,16 @@
 #include "common/maptypes.h"
 #include "mapgui/mapquery.h"
 #include "common/mapcolors.h"
+#include "common/maplabellayout.h"
 #include "options/optiondata.h"
 
 #include <QPainter>
 #include <QApplication>
+#include <QStaticText>
 #include <marble/GeoPainter.h>
 
+#include <cmath>
+
 using namespace Marble;
 using namespace maptypes;
 
@@ -35,6 +39,30 @@ const QVector<QLine> AIRCRAFTLINES({QLine(0, -20, 0, 16), // Body
                                     QLine(-10, 18, 0, 14), QLine(0, 14, 10, 18) // Horizontal stabilizer
                                    });
 
+namespace {
+/* Symbol types for the sprite key */
+enum SpriteType
+{
+  SPRITE_AIRPORT = 1,
+  SPRITE_WAYPOINT,
+  SPRITE_VOR,
+  SPRITE_NDB,
+  SPRITE_MARKER
+};
+
+/* Runway heading of airport symbols is rounded to this value to limit the number of variants */
+const int AIRPORT_HEADING_STEP = 5;
+
+/* Additional space around symbols in the atlas for fuel spikes and pen widths */
+const int SPRITE_MARGIN = 10;
+}
+
+uint qHash(const SymbolPainter::SpriteKey& key)
+{
+  return (static_cast<uint>(key.type) | static_cast<uint>(key.size) << 8 | static_cast<uint>(key.dpr) << 24 |
+          static_cast<uint>(key.antialiasing) << 31) ^ key.variant * 31 ^ key.color;
+}
+
 SymbolPainter::SymbolPainter(QColor backgroundColor)
 {
   iconBackground = backgroundColor;
@@ -110,8 +138,163 @@ QIcon SymbolPainter::createUserpointIcon(int size)
   return QIcon(pixmap);
 }
 
+bool SymbolPainter::drawSprite(QPainter *painter, SpriteKey key, int x, int y, const DrawFunctionType& draw)
+{
+  if(key.size < 1 || key.size > MAX_SPRITE_SIZE || painter->transform().type() > QTransform::TxTranslate)
+    return false;
+
+  int dpr = painter->device()->devicePixelRatio();
+  key.dpr = static_cast<quint8>(dpr);
+  key.antialiasing = painter->testRenderHint(QPainter::Antialiasing);
+
+  int extent = key.size * 2 + SPRITE_MARGIN;
+  QHash<SpriteKey, QImage>::const_iterator it = sprites.constFind(key);
+  if(it == sprites.constEnd())
+  {
+    if(sprites.size() >= MAX_SPRITES)
+      sprites.clear();
+
+    // Render symbol centered into a transparent image using the resolution of the target device.
+    // Images are used instead of pixmaps since map tiles are drawn in worker threads.
+    QImage image(extent * dpr, extent * dpr, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QPainter spritePainter(&image);
+    spritePainter.setRenderHints(painter->renderHints());
+    draw(&spritePainter, extent / 2, extent / 2);
+    spritePainter.end();
+
+    it = sprites.insert(key, image);
+  }
+
+  painter->drawImage(x - extent / 2, y - extent / 2, it.value());
+  return true;
+}
+
 void SymbolPainter::drawAirportSymbol(QPainter *painter, const maptypes::MapAirport& airport,
                                       int x, int y, int size, bool isAirportDiagram, bool fast)
+{
+  bool simple = fast && !isAirportDiagram;
+  bool hard = airport.flags.testFlag(AP_HARD), mil = airport.flags.testFlag(AP_MIL),
+       closed = airport.flags.testFlag(AP_CLOSED);
+
+  SpriteKey key;
+  key.type = SPRITE_AIRPORT;
+  key.size = static_cast<quint16>(size);
+  key.color = mapcolors::colorForAirport(airport).rgba();
+  key.variant = (hard ? 0x01u : 0u) | (mil ? 0x02u : 0u) | (closed ? 0x04u : 0u) |
+                (airport.anyFuel() ? 0x08u : 0u) | (airport.waterOnly() ? 0x10u : 0u) |
+                (airport.helipadOnly() ? 0x20u : 0u) | (airport.longestRunwayLength == 0 ? 0x40u : 0u) |
+                (simple ? 0x80u : 0u);
+
+  // Runway line is symmetric - use rounded heading in the range 0 to 180 degree
+  int numHeadingSteps = 180 / AIRPORT_HEADING_STEP;
+  int headingStep = static_cast<int>(std::round(static_cast<float>(airport.longestRunwayHeading) /
+                                                AIRPORT_HEADING_STEP)) % numHeadingSteps;
+  if(headingStep < 0)
+    headingStep += numHeadingSteps;
+  int symbolSize = airport.longestRunwayLength == 0 ? size * 4 / 5 : size;
+  if(hard && !mil && !closed && !simple && symbolSize > 6)
+    // Runway line is drawn
+    key.variant |= static_cast<quint32>(headingStep) << 8;
+
+  auto draw = [this, &airport, headingStep, size, isAirportDiagram, fast](QPainter *p, int xs, int ys) -> void
+              {
+                maptypes::MapAirport ap(airport);
+                ap.longestRunwayHeading = headingStep * AIRPORT_HEADING_STEP;
+                drawAirportSymbolVector(p, ap, xs, ys, size, isAirportDiagram, fast);
+              };
+
+  if(!drawSprite(painter, key, x, y, draw))
+    drawAirportSymbolVector(painter, airport, x, y, size, isAirportDiagram, fast);
+}
+
+void SymbolPainter::drawWaypointSymbol(QPainter *painter, const QColor& col, int x, int y, int size,
+                                       bool fill, bool fast)
+{
+  SpriteKey key;
+  key.type = SPRITE_WAYPOINT;
+  key.size = static_cast<quint16>(size);
+  key.color = col.isValid() ? col.rgba() : mapcolors::waypointSymbolColor.rgba();
+  key.variant = static_cast<quint32>(fill) | static_cast<quint32>(fast) << 1;
+
+  auto draw = [this, &col, size, fill, fast](QPainter *p, int xs, int ys) -> void
+              {
+                drawWaypointSymbolVector(p, col, xs, ys, size, fill, fast);
+              };
+
+  if(!drawSprite(painter, key, x, y, draw))
+    drawWaypointSymbolVector(painter, col, x, y, size, fill, fast);
+}
+
+void SymbolPainter::drawVorSymbol(QPainter *painter, const maptypes::MapVor& vor, int x, int y, int size,
+                                  bool routeFill, bool fast, int largeSize)
+{
+  if(!fast && largeSize > 0 && !vor.dmeOnly)
+  {
+    // Compass rose is rotated by magnetic variation
+    drawVorSymbolVector(painter, vor, x, y, size, routeFill, fast, largeSize);
+    return;
+  }
+
+  SpriteKey key;
+  key.type = SPRITE_VOR;
+  key.size = static_cast<quint16>(size);
+  key.variant = static_cast<quint32>(routeFill) | static_cast<quint32>(fast) << 1 |
+                static_cast<quint32>(vor.hasDme) << 2 | static_cast<quint32>(vor.dmeOnly) << 3;
+
+  auto draw = [this, &vor, size, routeFill, fast](QPainter *p, int xs, int ys) -> void
+              {
+                drawVorSymbolVector(p, vor, xs, ys, size, routeFill, fast, 0);
+              };
+
+  if(!drawSprite(painter, key, x, y, draw))
+    drawVorSymbolVector(painter, vor, x, y, size, routeFill, fast, largeSize);
+}
+
+void SymbolPainter::drawNdbSymbol(QPainter *painter, int x, int y, int size, bool routeFill, bool fast)
+{
+  SpriteKey key;
+  key.type = SPRITE_NDB;
+  key.size = static_cast<quint16>(size);
+  key.variant = static_cast<quint32>(routeFill) | static_cast<quint32>(fast) << 1;
+
+  auto draw = [this, size, routeFill, fast](QPainter *p, int xs, int ys) -> void
+              {
+                drawNdbSymbolVector(p, xs, ys, size, routeFill, fast);
+              };
+
+  if(!drawSprite(painter, key, x, y, draw))
+    drawNdbSymbolVector(painter, x, y, size, routeFill, fast);
+}
+
+void SymbolPainter::drawMarkerSymbol(QPainter *painter, const maptypes::MapMarker& marker, int x, int y,
+                                     int size, bool fast)
+{
+  if(!fast && size > 5)
+  {
+    // Lens is rotated by marker heading
+    drawMarkerSymbolVector(painter, marker, x, y, size, fast);
+    return;
+  }
+
+  SpriteKey key;
+  key.type = SPRITE_MARKER;
+  key.size = static_cast<quint16>(size);
+  key.variant = static_cast<quint32>(fast);
+
+  auto draw = [this, &marker, size, fast](QPainter *p, int xs, int ys) -> void
+              {
+                drawMarkerSymbolVector(p, marker, xs, ys, size, fast);
+              };
+
+  if(!drawSprite(painter, key, x, y, draw))
+    drawMarkerSymbolVector(painter, marker, x, y, size, fast);
+}
+
+void SymbolPainter::drawAirportSymbolVector(QPainter *painter, const maptypes::MapAirport& airport,
+                                            int x, int y, int size, bool isAirportDiagram, bool fast)
 {
   if(airport.longestRunwayLength == 0)
     size = size * 4 / 5;
@@ -201,8 +384,8 @@ void SymbolPainter::drawAirportSymbol(QPainter *painter, const maptypes::MapAirp
   painter->restore();
 }
 
-void SymbolPainter::drawWaypointSymbol(QPainter *painter, const QColor& col, int x, int y, int size,
-                                       bool fill, bool fast)
+void SymbolPainter::drawWaypointSymbolVector(QPainter *painter, const QColor& col, int x, int y, int size,
+                                             bool fill, bool fast)
 {
   painter->save();
   painter->setBackgroundMode(Qt::TransparentMode);
@@ -281,8 +464,8 @@ void SymbolPainter::drawAircraftSymbol(QPainter *painter, int x, int y, int size
   painter->drawLines(lines);
 }
 
-void SymbolPainter::drawVorSymbol(QPainter *painter, const maptypes::MapVor& vor, int x, int y, int size,
-                                  bool routeFill, bool fast, int largeSize)
+void SymbolPainter::drawVorSymbolVector(QPainter *painter, const maptypes::MapVor& vor, int x, int y,
+                                        int size, bool routeFill, bool fast, int largeSize)
 {
   painter->save();
   painter->setBackgroundMode(Qt::TransparentMode);
@@ -357,7 +540,7 @@ void SymbolPainter::drawVorSymbol(QPainter *painter, const maptypes::MapVor& vor
   painter->restore();
 }
 
-void SymbolPainter::drawNdbSymbol(QPainter *painter, int x, int y, int size, bool routeFill, bool fast)
+void SymbolPainter::drawNdbSymbolVector(QPainter *painter, int x, int y, int size, bool routeFill, bool fast)
 {
   painter->save();
 
@@ -392,8 +575,8 @@ void SymbolPainter::drawNdbSymbol(QPainter *painter, int x, int y, int size, boo
   painter->restore();
 }
 
-void SymbolPainter::drawMarkerSymbol(QPainter *painter, const maptypes::MapMarker& marker, int x, int y,
-                                     int size, bool fast)
+void SymbolPainter::drawMarkerSymbolVector(QPainter *painter, const maptypes::MapMarker& marker, int x, int y,
+                                           int size, bool fast)
 {
   painter->save();
   int radius = size / 2;
@@ -421,15 +604,20 @@ void SymbolPainter::drawMarkerSymbol(QPainter *painter, const maptypes::MapMarke
 void SymbolPainter::drawNdbText(QPainter *painter, const maptypes::MapNdb& ndb, int x, int y,
                                 textflags::TextFlags flags, int size, bool fill)
 {
-  QStringList texts;
-
-  if(flags & textflags::IDENT && flags & textflags::TYPE)
-    texts.append(ndb.ident + " (" + (ndb.type == tr("COMPASS_POINT") ? tr("CP") : ndb.type) + ")");
-  else if(flags & textflags::IDENT)
-    texts.append(ndb.ident);
-
-  if(flags & textflags::FREQ)
-    texts.append(QLocale().toString(ndb.frequency / 100., 'f', 1));
+  auto createTexts = [&ndb, flags]() -> QStringList
+                     {
+                       QStringList texts;
+                       if(flags & textflags::IDENT && flags & textflags::TYPE)
+                         texts.append(ndb.ident + " (" +
+                                      (ndb.type == tr("COMPASS_POINT") ? tr("CP") : ndb.type) + ")");
+                       else if(flags & textflags::IDENT)
+                         texts.append(ndb.ident);
+
+                       if(flags & textflags::FREQ)
+                         texts.append(QLocale().toString(ndb.frequency / 100., 'f', 1));
+                       return texts;
+                     };
+  QStringList texts = objectTexts(maptypes::NDB, ndb.id, flags, createTexts);
 
   textatt::TextAttributes textAttrs = textatt::BOLD;
   if(flags & textflags::ROUTE_TEXT)
@@ -448,15 +636,19 @@ void SymbolPainter::drawNdbText(QPainter *painter, const maptypes::MapNdb& ndb,
 void SymbolPainter::drawVorText(QPainter *painter, const maptypes::MapVor& vor, int x, int y,
                                 textflags::TextFlags flags, int size, bool fill)
 {
-  QStringList texts;
-
-  if(flags & textflags::IDENT && flags & textflags::TYPE)
-    texts.append(vor.ident + " (" + vor.type.left(1) + ")");
-  else if(flags & textflags::IDENT)
-    texts.append(vor.ident);
-
-  if(flags & textflags::FREQ)
-    texts.append(QLocale().toString(vor.frequency / 1000., 'f', 2));
+  auto createTexts = [&vor, flags]() -> QStringList
+                     {
+                       QStringList texts;
+                       if(flags & textflags::IDENT && flags & textflags::TYPE)
+                         texts.append(vor.ident + " (" + vor.type.left(1) + ")");
+                       else if(flags & textflags::IDENT)
+                         texts.append(vor.ident);
+
+                       if(flags & textflags::FREQ)
+                         texts.append(QLocale().toString(vor.frequency / 1000., 'f', 2));
+                       return texts;
+                     };
+  QStringList texts = objectTexts(maptypes::VOR, vor.id, flags, createTexts);
 
   textatt::TextAttributes textAttrs = textatt::BOLD;
   if(flags & textflags::ROUTE_TEXT)
@@ -497,7 +689,11 @@ void SymbolPainter::drawWaypointText(QPainter *painter, const maptypes::MapWaypo
 void SymbolPainter::drawAirportText(QPainter *painter, const maptypes::MapAirport& airport, int x, int y,
                                     textflags::TextFlags flags, int size, bool diagram)
 {
-  QStringList texts = airportTexts(flags, airport);
+  auto createTexts = [this, flags, &airport]() -> QStringList
+                     {
+                       return airportTexts(flags, airport);
+                     };
+  QStringList texts = objectTexts(maptypes::AIRPORT, airport.id, flags, createTexts);
   if(!texts.isEmpty())
   {
     textatt::TextAttributes atts = textatt::BOLD;
@@ -518,6 +714,21 @@ void SymbolPainter::drawAirportText(QPainter *painter, const maptypes::MapAirpor
   }
 }
 
+QStringList SymbolPainter::objectTexts(int type, int id, textflags::TextFlags flags,
+                                       const std::function<QStringList()>& createTexts)
+{
+  if(labelLayout == nullptr || id < 0)
+    return createTexts();
+
+  const QStringList *cached = labelLayout->findObjectTexts(type, id, flags);
+  if(cached != nullptr)
+    return *cached;
+
+  QStringList texts = createTexts();
+  labelLayout->insertObjectTexts(type, id, flags, texts);
+  return texts;
+}
+
 QStringList SymbolPainter::airportTexts(textflags::TextFlags flags, const maptypes::MapAirport& airport)
 {
   QStringList texts;
@@ -561,38 +772,15 @@ void SymbolPainter::textBox(QPainter *painter, const QStringList& texts, const Q
   if(texts.isEmpty())
     return;
 
-  painter->save();
-
-  QColor backColor;
-  if(atts.testFlag(textatt::ROUTE_BG_COLOR))
-    backColor = mapcolors::routeTextBoxColor;
-  else
-    backColor = mapcolors::textBoxColor;
-
-  if(transparency != 255)
+  if(labelLayout != nullptr)
   {
-    if(transparency == 0)
-      // Do not fill at all
-      painter->setBrush(Qt::NoBrush);
-    else
-    {
-      // Use an alpha channel for semi transparency
-      backColor.setAlpha(transparency);
-      painter->setBrush(backColor);
-    }
+    // Placed and drawn later if not covered by other labels
+    labelLayout->addLabel(painter, texts, textPen, x, y, atts, transparency, labelPriority);
+    return;
   }
-  else
-    // Fill background
-    painter->setBrush(backColor);
 
-  if(atts.testFlag(textatt::ITALIC) || atts.testFlag(textatt::BOLD) || atts.testFlag(textatt::UNDERLINE))
-  {
-    QFont f = painter->font();
-    f.setBold(atts.testFlag(textatt::BOLD));
-    f.setItalic(atts.testFlag(textatt::ITALIC));
-    f.setUnderline(atts.testFlag(textatt::UNDERLINE));
-    painter->setFont(f);
-  }
+  painter->save();
+  textBoxStyle(painter, atts, transparency);
 
   QFontMetrics metrics = painter->fontMetrics();
   int h = metrics.height();
@@ -637,6 +825,83 @@ void SymbolPainter::textBox(QPainter *painter, const QStringList& texts, const Q
   painter->restore();
 }
 
+void SymbolPainter::textBox(QPainter *painter, const QVector<QStaticText>& texts, const QPen& textPen, int x,
+                            int y, textatt::TextAttributes atts, int transparency)
+{
+  if(texts.isEmpty())
+    return;
+
+  painter->save();
+  textBoxStyle(painter, atts, transparency);
+
+  QFontMetrics metrics = painter->fontMetrics();
+  int h = metrics.height();
+
+  // Static texts are positioned by the top left corner
+  int ytop = y - metrics.ascent();
+  for(const QStaticText& text : texts)
+  {
+    int w = static_cast<int>(std::round(text.size().width()));
+    int rectx = x, textx = x;
+    if(atts.testFlag(textatt::RIGHT))
+    {
+      rectx -= w + 2;
+      textx -= w;
+    }
+    else if(atts.testFlag(textatt::CENTER))
+    {
+      rectx -= (w + 2) / 2;
+      textx -= w / 2;
+    }
+
+    if(transparency != 0)
+    {
+      // Draw filled rectangle in the background
+      painter->setPen(mapcolors::textBackgroundPen);
+      painter->drawRect(rectx, ytop - 1, w + 2, h);
+    }
+
+    painter->setPen(textPen);
+    painter->drawStaticText(textx, ytop, text);
+    ytop += h;
+  }
+  painter->restore();
+}
+
+void SymbolPainter::textBoxStyle(QPainter *painter, textatt::TextAttributes atts, int transparency)
+{
+  QColor backColor;
+  if(atts.testFlag(textatt::ROUTE_BG_COLOR))
+    backColor = mapcolors::routeTextBoxColor;
+  else
+    backColor = mapcolors::textBoxColor;
+
+  if(transparency != 255)
+  {
+    if(transparency == 0)
+      // Do not fill at all
+      painter->setBrush(Qt::NoBrush);
+    else
+    {
+      // Use an alpha channel for semi transparency
+      backColor.setAlpha(transparency);
+      painter->setBrush(backColor);
+    }
+  }
+  else
+    // Fill background
+    painter->setBrush(backColor);
+
+  if(atts.testFlag(textatt::ITALIC) || atts.testFlag(textatt::BOLD) || atts.testFlag(textatt::UNDERLINE))
+  {
+    QFont f = painter->font();
+    f.setBold(atts.testFlag(textatt::BOLD));
+    f.setItalic(atts.testFlag(textatt::ITALIC));
+    f.setUnderline(atts.testFlag(textatt::UNDERLINE));
+    painter->setFont(f);
+  }
+}
+
 QRect SymbolPainter::textBoxSize(QPainter *painter, const QStringList& texts, textatt::TextAttributes atts)
 {
   QRect retval;
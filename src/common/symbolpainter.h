@@ -21,9 +21,17 @@
 #include <QColor>
 #include <QIcon>
 #include <QApplication>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+
+#include <functional>
 
 class QPainter;
 class QPen;
+class QStaticText;
+class MapLabelLayout;
 
 namespace Marble {
 class GeoPainter;
@@ -85,6 +93,10 @@ Q_DECLARE_OPERATORS_FOR_FLAGS(TextAttributes);
  * Separate functions are available for texts/captions.
  * An additional parameter "fast" is used to draw icons with less details while scrolling the map.
  * Instead of using a text collision detection text are placed on different sides of the symbols.
+ * If a label layout is set all text boxes are passed to the layout which drops overlapping labels.
+ *
+ * Airport, navaid and waypoint symbols are rendered once per variant into an image atlas and copied to the
+ * painter afterwards. Rotated, large or otherwise uncommon symbols are drawn using vector primitives.
  */
 class SymbolPainter
 {
@@ -141,17 +153,90 @@ public:
   /* Simulator aircraft symbol */
   void drawAircraftSymbol(QPainter *painter, int x, int y, int size, bool onGround);
 
+  /* Collect all text boxes in the given layout instead of drawing them. Null draws text boxes directly. */
+  void setLabelLayout(MapLabelLayout *layout)
+  {
+    labelLayout = layout;
+  }
+
+  /* Placement priority used for following text boxes if a label layout is set.
+   * See labelprio::LabelPriority */
+  void setLabelPriority(int priority)
+  {
+    labelPriority = priority;
+  }
+
   /* Draw a custom text box */
   void textBox(QPainter *painter, const QStringList& texts, const QPen& textPen, int x, int y,
                textatt::TextAttributes atts = textatt::NONE, int transparency = 255);
 
+  /* Draw a custom text box using texts prepared for the painter font including attributes */
+  void textBox(QPainter *painter, const QVector<QStaticText>& texts, const QPen& textPen, int x, int y,
+               textatt::TextAttributes atts = textatt::NONE, int transparency = 255);
+
   /* Get dimensions of a custom text box */
   QRect textBoxSize(QPainter *painter, const QStringList& texts, textatt::TextAttributes atts);
 
 private:
+  /* Identifies one pre-rendered symbol variant in the atlas */
+  struct SpriteKey
+  {
+    quint8 type = 0, dpr = 1;
+    quint16 size = 0;
+    quint32 variant = 0; /* Symbol type dependent flags */
+    QRgb color = 0;
+    bool antialiasing = false;
+
+    bool operator==(const SpriteKey& other) const
+    {
+      return type == other.type && dpr == other.dpr && size == other.size && variant == other.variant &&
+             color == other.color && antialiasing == other.antialiasing;
+    }
+
+  };
+
+  friend uint qHash(const SymbolPainter::SpriteKey& key);
+
+  typedef std::function<void (QPainter *painter, int x, int y)> DrawFunctionType;
+
+  /* Copy the symbol from the atlas to the painter and create it using draw on first use.
+   * @return false if painter is rotated or scaled or symbol is too large. Symbol has to be drawn using
+   * vector primitives in this case. */
+  bool drawSprite(QPainter *painter, SpriteKey key, int x, int y, const DrawFunctionType& draw);
+
+  void drawAirportSymbolVector(QPainter *painter, const maptypes::MapAirport& airport, int x, int y, int size,
+                               bool isAirportDiagram, bool fast);
+  void drawWaypointSymbolVector(QPainter *painter, const QColor& col, int x, int y, int size, bool fill,
+                                bool fast);
+  void drawVorSymbolVector(QPainter *painter, const maptypes::MapVor& vor, int x, int y, int size,
+                           bool routeFill, bool fast, int largeSize);
+  void drawNdbSymbolVector(QPainter *painter, int x, int y, int size, bool routeFill, bool fast);
+  void drawMarkerSymbolVector(QPainter *painter, const maptypes::MapMarker& marker, int x, int y, int size,
+                              bool fast);
+
+  /* Set background brush and font attributes for a text box */
+  void textBoxStyle(QPainter *painter, textatt::TextAttributes atts, int transparency);
+
+  /* Get formatted texts from the label layout or create and add them if not found.
+   * @param type maptypes::MapObjectType */
+  QStringList objectTexts(int type, int id, textflags::TextFlags flags,
+                          const std::function<QStringList()>& createTexts);
+
   QStringList airportTexts(textflags::TextFlags flags, const maptypes::MapAirport& airport);
 
   QColor iconBackground;
+
+  MapLabelLayout *labelLayout = nullptr;
+  int labelPriority = 0;
+
+  /* Pre-rendered symbols */
+  QHash<SpriteKey, QImage> sprites;
+
+  /* Symbols larger than this are always drawn using vector primitives */
+  static Q_DECL_CONSTEXPR int MAX_SPRITE_SIZE = 64;
+
+  /* Start over if too many variants were created, e.g. after changing the symbol scale often */
+  static Q_DECL_CONSTEXPR int MAX_SPRITES = 2000;
 };
 
 #endif // LITTLENAVMAP_SYMBOLPAINTER_H
@@ -31,6 +31,10 @@
 #include "sql/sqlutil.h"
 #include "gui/errorhandler.h"
 #include "gui/mainwindow.h"
+#include "route/routenetworkairway.h"
+#include "route/routenetworkradio.h"
+#include "mapgui/maplodbuilder.h"
+#include "db/spatialindexbuilder.h"
 
 #include <QDebug>
 #include <QElapsedTimer>
@@ -430,6 +434,12 @@ bool DatabaseManager::runInternal()
             // Successfully loaded
             DatabaseMeta dbmeta(db);
             dbmeta.updateAll();
+
+            // Needs the updated metadata which is part of the cache file fingerprint
+            buildRouteLandmarks();
+            buildRouteHierarchies();
+            buildMapLod();
+            buildSpatialIndex();
             reopenDialog = false;
           }
         }
@@ -550,6 +560,113 @@ bool DatabaseManager::loadScenery()
   return success;
 }
 
+/* Prepare landmark tables for flight plan calculation in both networks instead of at the first calculation */
+void DatabaseManager::buildRouteLandmarks()
+{
+  if(!Settings::instance().getAndStoreValue(lnm::OPTIONS_ROUTE_LANDMARKS, true).toBool())
+    return;
+
+  runPreparationStep(tr("Preparing radio navaid network for flight plan calculation ..."),
+                     "radio route landmarks",
+                     [this](const ProgressCallbackType& progress) -> bool
+                     {
+                       RouteNetworkRadio network(db);
+                       return network.buildLandmarks(progress);
+                     });
+
+  runPreparationStep(tr("Preparing airway network for flight plan calculation ..."), "airway route landmarks",
+                     [this](const ProgressCallbackType& progress) -> bool
+                     {
+                       RouteNetworkAirway network(db);
+                       return network.buildLandmarks(progress);
+                     });
+}
+
+/* Prepare contraction hierarchies for flight plan calculation in the airway network */
+void DatabaseManager::buildRouteHierarchies()
+{
+  if(!Settings::instance().getAndStoreValue(lnm::OPTIONS_ROUTE_HIERARCHIES, true).toBool())
+    return;
+
+  runPreparationStep(tr("Preparing airway network for flight plan calculation ..."), "route hierarchies",
+                     [this](const ProgressCallbackType& progress) -> bool
+                     {
+                       RouteNetworkAirway network(db);
+                       return network.buildHierarchies(progress);
+                     });
+}
+
+/* Create level of detail tables for the map display or remove them if disabled */
+void DatabaseManager::buildMapLod()
+{
+  bool enabled = Settings::instance().getAndStoreValue(lnm::OPTIONS_MAP_LOD, true).toBool();
+  runPreparationStep(tr("Preparing map display ..."), "map level of detail",
+                     [this, enabled](const ProgressCallbackType& progress) -> bool
+                     {
+                       MapLodBuilder builder(db);
+                       if(enabled)
+                         return builder.build(progress);
+
+                       // Map falls back to truncated queries
+                       builder.drop();
+                       return false;
+                     });
+}
+
+/* Create R*Tree tables for all rectangle queries or remove them if disabled */
+void DatabaseManager::buildSpatialIndex()
+{
+  bool enabled = Settings::instance().getAndStoreValue(lnm::OPTIONS_SPATIAL_INDEX, true).toBool();
+  runPreparationStep(tr("Preparing spatial index ..."), "spatial index",
+                     [this, enabled](const ProgressCallbackType& progress) -> bool
+                     {
+                       SpatialIndexBuilder builder(db);
+                       if(enabled)
+                         return builder.build(progress);
+
+                       // Queries fall back to coordinate conditions
+                       builder.drop();
+                       return false;
+                     });
+}
+
+/* Run a preparation step after loading the scenery database. The progress dialog is shown when the step
+ * reports progress the first time. Failure or cancel is not an error since all users fall back to
+ * the plain queries. */
+void DatabaseManager::runPreparationStep(const QString& title, const QString& name,
+                                         const std::function<bool(const ProgressCallbackType&)>& step)
+{
+  QProgressDialog progress(title, tr("&Skip"), 0, 0, databaseDialog);
+  progress.setWindowModality(Qt::WindowModal);
+  progress.setMinimumDuration(0);
+
+  auto callback = [&progress](int current, int total) -> bool
+                  {
+                    if(!progress.isVisible())
+                      progress.show();
+                    progress.setMaximum(total);
+                    progress.setValue(current);
+                    QApplication::processEvents();
+                    return progress.wasCanceled();
+                  };
+
+  QElapsedTimer timer;
+  timer.start();
+  try
+  {
+    bool built = step(callback);
+    qInfo() << "Built" << name << built << "in" << timer.elapsed() << "ms";
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << "Cannot build" << name << e.what();
+  }
+  catch(...)
+  {
+    qWarning() << "Cannot build" << name;
+  }
+}
+
 /* Simulator was changed in scenery database loading dialog */
 void DatabaseManager::simulatorChangedFromComboBox(FsPaths::SimulatorType value)
 {
@@ -25,6 +25,8 @@
 #include <QAction>
 #include <QObject>
 
+#include <functional>
+
 namespace atools {
 namespace fs {
 class NavDatabaseProgress;
@@ -140,6 +142,15 @@ private:
   void updateSimulatorFlags();
   void updateSimulatorPathsFromDialog();
   bool loadScenery();
+  void buildRouteLandmarks();
+  void buildRouteHierarchies();
+  void buildMapLod();
+  void buildSpatialIndex();
+  /* Called with the current and total number of steps. Return true to cancel. */
+  typedef std::function<bool (int current, int total)> ProgressCallbackType;
+
+  void runPreparationStep(const QString& title, const QString& name,
+                          const std::function<bool(const ProgressCallbackType&)>& step);
 
   const QString DATABASE_NAME = "LNMDB";
   const QString DATABASE_TYPE = "QSQLITE";
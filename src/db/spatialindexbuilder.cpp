@@ -0,0 +1,160 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "db/spatialindexbuilder.h"
+
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlutil.h"
+#include "fs/db/databasemeta.h"
+#include "exception.h"
+
+#include <QDateTime>
+#include <QDebug>
+
+using atools::sql::SqlDatabase;
+using atools::sql::SqlQuery;
+
+namespace {
+/* Source table, id column and the columns for the bounding rectangle. Points use the same column twice. */
+struct IndexTable
+{
+  const char *table, *idColumn, *left, *right, *bottom, *top;
+};
+
+const IndexTable INDEX_TABLES[] =
+{
+  {"airport", "airport_id", "lonx", "lonx", "laty", "laty"},
+  {"vor", "vor_id", "lonx", "lonx", "laty", "laty"},
+  {"ndb", "ndb_id", "lonx", "lonx", "laty", "laty"},
+  {"waypoint", "waypoint_id", "lonx", "lonx", "laty", "laty"},
+  {"ils", "ils_id", "lonx", "lonx", "laty", "laty"},
+  {"marker", "marker_id", "lonx", "lonx", "laty", "laty"},
+  {"nav_search", "nav_search_id", "lonx", "lonx", "laty", "laty"},
+  {"airway", "airway_id", "left_lonx", "right_lonx", "bottom_laty", "top_laty"},
+  {"route_node_radio", "node_id", "lonx", "lonx", "laty", "laty"},
+  {"route_node_airway", "node_id", "lonx", "lonx", "laty", "laty"}
+};
+
+const QString META_TABLE("spatial_index_meta");
+
+}
+
+SpatialIndexBuilder::SpatialIndexBuilder(atools::sql::SqlDatabase *sqlDb)
+  : db(sqlDb)
+{
+}
+
+SpatialIndexBuilder::~SpatialIndexBuilder()
+{
+}
+
+bool SpatialIndexBuilder::build(const ProgressCallbackType& progress)
+{
+  // Remove old tables first so that queries do not use stale data if the build is canceled
+  drop();
+
+  int totalSteps = static_cast<int>(sizeof(INDEX_TABLES) / sizeof(IndexTable)), step = 0;
+  try
+  {
+    for(const IndexTable& indexTable : INDEX_TABLES)
+    {
+      if(progress && progress(step++, totalSteps))
+      {
+        drop();
+        return false;
+      }
+
+      QString table(indexTable.table), rtreeTable = table + "_rtree";
+
+      db->transaction();
+      // Fails if the SQLite library was built without R*Tree support
+      SqlQuery(db).exec("create virtual table " + rtreeTable +
+                        " using rtree(id, min_lonx, max_lonx, min_laty, max_laty)");
+
+      // R*Tree stores 32 bit floats rounded outwards so results can contain objects very close to the border
+      SqlQuery(db).exec("insert into " + rtreeTable + " (id, min_lonx, max_lonx, min_laty, max_laty) " +
+                        QString("select %1, %2, %3, %4, %5 from %6").
+                        arg(indexTable.idColumn).arg(indexTable.left).arg(indexTable.right).
+                        arg(indexTable.bottom).arg(indexTable.top).arg(table));
+      db->commit();
+    }
+
+    // Remember the scenery load which is checked when preparing the queries
+    db->transaction();
+    SqlQuery(db).exec("create table " + META_TABLE + " (fingerprint varchar(100) not null)");
+    SqlQuery insert(db);
+    insert.prepare("insert into " + META_TABLE + " (fingerprint) values (:fingerprint)");
+    insert.bindValue(":fingerprint", sceneryFingerprint(db));
+    insert.exec();
+    db->commit();
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << "Cannot build spatial index" << e.what();
+    db->rollback();
+    drop();
+    return false;
+  }
+  return true;
+}
+
+void SpatialIndexBuilder::drop()
+{
+  db->transaction();
+  SqlQuery query(db);
+  query.exec("drop table if exists " + META_TABLE);
+  for(const IndexTable& indexTable : INDEX_TABLES)
+    query.exec("drop table if exists " + QString(indexTable.table) + "_rtree");
+  db->commit();
+}
+
+bool SpatialIndexBuilder::isValid(atools::sql::SqlDatabase *sqlDb)
+{
+  SqlQuery query(sqlDb);
+  query.prepare("select count(1) from sqlite_master where type = 'table' and name = :name");
+  query.bindValue(":name", META_TABLE);
+  query.exec();
+  if(!query.next() || query.value(0).toInt() == 0)
+    return false;
+
+  query.exec("select fingerprint from " + META_TABLE);
+  return query.next() && query.value(0).toString() == sceneryFingerprint(sqlDb);
+}
+
+QString SpatialIndexBuilder::whereRect(const QString& table, const QString& idColumn, const QString& left,
+                                       const QString& right, const QString& bottom, const QString& top)
+{
+  return QString("%1 in (select id from %2_rtree where "
+                 "max_lonx >= %3 and min_lonx <= %4 and max_laty >= %5 and min_laty <= %6)").
+         arg(idColumn).arg(table).arg(left).arg(right).arg(bottom).arg(top);
+}
+
+QString SpatialIndexBuilder::whereRect(const QString& table, const QString& idColumn)
+{
+  return whereRect(table, idColumn, ":leftx", ":rightx", ":bottomy", ":topy");
+}
+
+QString SpatialIndexBuilder::sceneryFingerprint(atools::sql::SqlDatabase *sqlDb)
+{
+  atools::fs::db::DatabaseMeta meta(sqlDb);
+  atools::sql::SqlUtil util(sqlDb);
+  return QString("%1;%2;%3").
+         arg(meta.getLastLoadTime().toString(Qt::ISODate)).
+         arg(util.rowCount("airport")).
+         arg(util.rowCount("waypoint"));
+}
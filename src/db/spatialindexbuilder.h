@@ -0,0 +1,77 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_SPATIALINDEXBUILDER_H
+#define LITTLENAVMAP_SPATIALINDEXBUILDER_H
+
+#include <QString>
+
+#include <functional>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+}
+}
+
+/*
+ * Builds SQLite R*Tree virtual tables for all tables that are queried by bounding rectangle after loading
+ * the scenery database. These allow to use both coordinates for a lookup while the normal index on
+ * lonx/laty can use only one dimension.
+ *
+ * Tables are named like the source table with the suffix "_rtree" and contain the id of the source table and
+ * the bounding rectangle of the object. Queries have to fall back to the plain coordinate condition if
+ * isValid returns false.
+ */
+class SpatialIndexBuilder
+{
+public:
+  /* Called with the current and total number of steps. Return true to cancel. */
+  typedef std::function<bool (int current, int total)> ProgressCallbackType;
+
+  SpatialIndexBuilder(atools::sql::SqlDatabase *sqlDb);
+  ~SpatialIndexBuilder();
+
+  /* Build all tables. Drops all tables if canceled or if the SQLite library does not support R*Trees.
+   * @return true if all tables were created */
+  bool build(const ProgressCallbackType& progress);
+
+  /* Remove all tables */
+  void drop();
+
+  /* true if the tables exist and were built for the currently loaded scenery */
+  static bool isValid(atools::sql::SqlDatabase *sqlDb);
+
+  /*
+   * Get a condition selecting all objects of table overlapping the rectangle. Arguments can be bind
+   * variables like ":leftx" or numbers.
+   * @param idColumn primary key of table
+   */
+  static QString whereRect(const QString& table, const QString& idColumn, const QString& left,
+                           const QString& right, const QString& bottom, const QString& top);
+
+  /* Same as above using the bind variables :leftx, :rightx, :bottomy and :topy */
+  static QString whereRect(const QString& table, const QString& idColumn);
+
+  /* Changes if the scenery database is reloaded. Used to detect stale tables built from the database. */
+  static QString sceneryFingerprint(atools::sql::SqlDatabase *sqlDb);
+
+private:
+  atools::sql::SqlDatabase *db;
+};
+
+#endif // LITTLENAVMAP_SPATIALINDEXBUILDER_H
@@ -108,6 +108,10 @@ MainWindow::MainWindow()
     mapQuery = new MapQuery(this, databaseManager->getDatabase());
     mapQuery->initQueries();
 
+    // Load map objects around the view and along the flight plan in a background thread
+    if(Settings::instance().getAndStoreValue(lnm::OPTIONS_MAP_PREFETCH, true).toBool())
+      mapQuery->startPrefetch();
+
     infoQuery = new InfoQuery(this, databaseManager->getDatabase());
     infoQuery->initQueries();
 
@@ -509,6 +513,8 @@ void MainWindow::connectAllSlots()
           routeController, &RouteController::calculateLowAlt);
   connect(ui->actionRouteCalcSetAlt, &QAction::triggered,
           routeController, &RouteController::calculateSetAlt);
+  connect(ui->actionRouteCalcAll, &QAction::triggered,
+          routeController, &RouteController::calculateAll);
   connect(ui->actionRouteReverse, &QAction::triggered,
           routeController, &RouteController::reverse);
 
@@ -848,7 +854,7 @@ bool RouteController::hasValidParking() const
 {
   if(hasValidDeparture())
   {
-    const QList<maptypes::MapParking> *parkingCache = query->getParkingsForAirport(route.first().getId());
+    const QVector<maptypes::MapParking> *parkingCache = query->getParkingsForAirport(route.first().getId());
 
     if(!parkingCache->isEmpty())
       return route.hasDepartureParking() || route.hasDepartureHelipad();
@@ -1269,6 +1275,7 @@ void MainWindow::updateActionStates()
   ui->actionRouteCalcHighAlt->setEnabled(hasStartAndDest);
   ui->actionRouteCalcLowAlt->setEnabled(hasStartAndDest);
   ui->actionRouteCalcSetAlt->setEnabled(hasStartAndDest && ui->spinBoxRouteAlt->value() > 0);
+  ui->actionRouteCalcAll->setEnabled(hasStartAndDest);
   ui->actionRouteReverse->setEnabled(hasFlightplan);
 
   ui->actionMapShowHome->setEnabled(mapWidget->getHomePos().isValid());
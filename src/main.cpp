@@ -28,6 +28,8 @@
 #include "db/databasemanager.h"
 #include "common/settingsmigrate.h"
 #include "common/aircrafttrack.h"
+#include "route/routebenchmark.h"
+#include "common/maptypesbenchmark.h"
 
 #include <QDebug>
 #include <QSplashScreen>
@@ -76,6 +78,14 @@ int main(int argc, char *argv[])
   int retval = 0;
   Application app(argc, argv);
 
+  // Run flight plan calculation benchmark without any user interface and exit
+  if(RouteBenchmark::isBenchmark(Application::arguments()))
+    return RouteBenchmark(Application::arguments()).run();
+
+  // Run map object loading benchmark without any user interface and exit
+  if(MapTypesBenchmark::isBenchmark(Application::arguments()))
+    return MapTypesBenchmark(Application::arguments()).run();
+
   // Start splash screen
   QPixmap pixmap(":/littlenavmap/resources/icons/splash.png");
   QSplashScreen splash(pixmap);
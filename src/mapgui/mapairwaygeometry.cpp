@@ -0,0 +1,208 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mapgui/mapairwaygeometry.h"
+
+#include "common/coordinateconverter.h"
+#include "common/maptypes.h"
+#include "mapgui/mapscale.h"
+#include "geo/pos.h"
+
+#include <marble/ViewportParams.h>
+
+#include <cmath>
+#include <limits>
+
+using atools::geo::Pos;
+
+namespace {
+/* Angular distance between points for each level from coarse to fine */
+const float LEVEL_STEP_DEG[] = {4.f, 1.f, 0.25f};
+
+/* Select the coarsest level that gives a line at least every this many pixels */
+const float PIXEL_PER_LINE = 40.f;
+
+/* Limit points for very long segments */
+const int MAX_SEGMENTS = 72;
+
+const float METER_PER_DEGREE = 111319.5f;
+}
+
+MapAirwayGeometry::MapAirwayGeometry()
+{
+}
+
+MapAirwayGeometry::~MapAirwayGeometry()
+{
+}
+
+void MapAirwayGeometry::beginFrame(const Marble::ViewportParams *viewport, const MapScale *scale)
+{
+  int level = NUM_LEVELS - 1;
+  if(scale->isValid())
+  {
+    float pixelPerDegree = scale->getPixelForMeter(METER_PER_DEGREE);
+    for(int i = 0; i < NUM_LEVELS; i++)
+    {
+      if(LEVEL_STEP_DEG[i] * pixelPerDegree <= PIXEL_PER_LINE)
+      {
+        level = i;
+        break;
+      }
+    }
+  }
+
+  if(viewport != frameViewport || level != frameLevel || viewport->projection() != frameProjection ||
+     viewport->centerLongitude() != frameCenterLonX || viewport->centerLatitude() != frameCenterLatY ||
+     viewport->radius() != frameRadius || viewport->size() != frameSize)
+  {
+    // View has changed - projected points are not valid anymore
+    frameViewport = viewport;
+    frameLevel = level;
+    frameProjection = viewport->projection();
+    frameCenterLonX = viewport->centerLongitude();
+    frameCenterLatY = viewport->centerLatitude();
+    frameRadius = viewport->radius();
+    frameSize = viewport->size();
+
+    screenPoints.clear();
+    polylines.clear();
+    projected.clear();
+  }
+}
+
+int MapAirwayGeometry::project(const maptypes::MapAirway& airway, int& firstPolyline)
+{
+  QHash<int, Projected>::const_iterator projIt = projected.constFind(airway.id);
+  if(projIt != projected.constEnd())
+  {
+    // Already done in this frame
+    firstPolyline = projIt.value().first;
+    return projIt.value().size;
+  }
+
+  firstPolyline = polylines.size();
+  if(frameViewport == nullptr)
+    return 0;
+
+  QHash<int, Entry>::const_iterator entryIt = entries.constFind(airway.id);
+  if(entryIt == entries.constEnd())
+    entryIt = entries.insert(airway.id, createEntry(airway));
+  const Entry& entry = entryIt.value();
+
+  // World is repeated horizontally every four radius pixels for the flat projections
+  // Consecutive points that are more than half of it apart are on different sides of the anti meridian
+  int maxJump = frameProjection == Marble::Spherical ? std::numeric_limits<int>::max() : frameRadius * 2;
+
+  Projected proj;
+  proj.first = polylines.size();
+  proj.size = 0;
+
+  Polyline polyline;
+  polyline.offset = screenPoints.size();
+  polyline.size = 0;
+
+  // Add the current polyline if it is not a single point and start a new one
+  auto closePolyline = [this, &proj, &polyline]() -> void
+                       {
+                         if(polyline.size > 1)
+                         {
+                           polylines.append(polyline);
+                           proj.size++;
+                         }
+                         else
+                           screenPoints.resize(polyline.offset);
+                         polyline.offset = screenPoints.size();
+                         polyline.size = 0;
+                       };
+
+  CoordinateConverter conv(frameViewport);
+  const float *pt = coords.constData() + entry.offset[frameLevel] * 2;
+  int lastX = 0;
+  for(int i = 0; i < entry.size[frameLevel]; i++)
+  {
+    int x, y;
+    bool hidden = false;
+    conv.wToS(Pos(pt[i * 2], pt[i * 2 + 1]), x, y, CoordinateConverter::DEFAULT_WTOS_SIZE, &hidden);
+
+    if(hidden || (polyline.size > 0 && std::abs(x - lastX) > maxJump))
+      closePolyline();
+
+    if(!hidden)
+    {
+      screenPoints.append(QPoint(x, y));
+      polyline.size++;
+      lastX = x;
+    }
+  }
+  closePolyline();
+
+  projected.insert(airway.id, proj);
+  return proj.size;
+}
+
+void MapAirwayGeometry::clear()
+{
+  coords.clear();
+  coords.squeeze();
+  entries.clear();
+  screenPoints.clear();
+  polylines.clear();
+  projected.clear();
+  frameViewport = nullptr;
+}
+
+MapAirwayGeometry::Entry MapAirwayGeometry::createEntry(const maptypes::MapAirway& airway)
+{
+  Entry entry;
+  float distanceMeter = airway.from.distanceMeterTo(airway.to);
+  float distanceDeg = distanceMeter / METER_PER_DEGREE;
+
+  for(int level = 0; level < NUM_LEVELS; level++)
+  {
+    int numSegments = static_cast<int>(std::ceil(distanceDeg / LEVEL_STEP_DEG[level]));
+    if(numSegments < 1)
+      numSegments = 1;
+    else if(numSegments > MAX_SEGMENTS)
+      numSegments = MAX_SEGMENTS;
+
+    if(level > 0 && entry.size[level - 1] == numSegments + 1)
+    {
+      // Short segment - no need to store the same points again
+      entry.offset[level] = entry.offset[level - 1];
+      entry.size[level] = entry.size[level - 1];
+      continue;
+    }
+
+    entry.offset[level] = coords.size() / 2;
+    entry.size[level] = static_cast<quint8>(numSegments + 1);
+    for(int i = 0; i <= numSegments; i++)
+    {
+      Pos pos;
+      if(i == 0)
+        pos = airway.from;
+      else if(i == numSegments)
+        pos = airway.to;
+      else
+        pos = airway.from.interpolate(airway.to, distanceMeter,
+                                      static_cast<float>(i) / static_cast<float>(numSegments));
+      coords.append(pos.getLonX());
+      coords.append(pos.getLatY());
+    }
+  }
+  return entry;
+}
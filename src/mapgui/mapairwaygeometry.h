@@ -0,0 +1,121 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPAIRWAYGEOMETRY_H
+#define LITTLENAVMAP_MAPAIRWAYGEOMETRY_H
+
+#include <QHash>
+#include <QPoint>
+#include <QSize>
+#include <QVector>
+
+#include <marble/MarbleGlobal.h>
+
+namespace Marble {
+class ViewportParams;
+}
+
+namespace maptypes {
+struct MapAirway;
+}
+
+class MapScale;
+
+/*
+ * Great circle polylines for airway segments. Points are calculated once per segment for a few fixed
+ * angular resolutions and kept as coordinate pairs in one shared buffer until the database changes.
+ *
+ * Screen coordinates are projected once per frame. Painter and screen index use the same projected
+ * polylines as long as viewport and resolution do not change.
+ */
+class MapAirwayGeometry
+{
+public:
+  MapAirwayGeometry();
+  ~MapAirwayGeometry();
+
+  /* Range of one projected polyline in the screen point buffer */
+  struct Polyline
+  {
+    int offset, size;
+  };
+
+  /* Select resolution for the current scale and drop all projected points if the viewport has changed */
+  void beginFrame(const Marble::ViewportParams *viewport, const MapScale *scale);
+
+  /* Project airway segment if not already done in this frame. Calculates the great circle points on
+   * first use. Polylines are split at points hidden behind the globe and at the anti meridian.
+   * @param firstPolyline index of the first polyline for getPolyline
+   * @return number of polylines which is 0 if the segment is not visible */
+  int project(const maptypes::MapAirway& airway, int& firstPolyline);
+
+  const Polyline& getPolyline(int index) const
+  {
+    return polylines.at(index);
+  }
+
+  /* Screen coordinates of the polyline */
+  const QPoint *getPoints(const Polyline& polyline) const
+  {
+    return screenPoints.constData() + polyline.offset;
+  }
+
+  /* Remove all calculated and projected points. Call after database change. */
+  void clear();
+
+  /* Number of coordinate pairs in the geometry buffer */
+  int size() const
+  {
+    return coords.size() / 2;
+  }
+
+private:
+  static Q_DECL_CONSTEXPR int NUM_LEVELS = 3;
+
+  /* Geometry of one airway segment. Levels having the same number of points share the offset. */
+  struct Entry
+  {
+    int offset[NUM_LEVELS];
+    quint8 size[NUM_LEVELS];
+  };
+
+  /* Projected polylines of one airway segment for the current frame */
+  struct Projected
+  {
+    int first, size;
+  };
+
+  Entry createEntry(const maptypes::MapAirway& airway);
+
+  /* Longitude and latitude pairs for all levels of all segments */
+  QVector<float> coords;
+  QHash<int, Entry> entries;
+
+  /* Projected for the current frame */
+  QVector<QPoint> screenPoints;
+  QVector<Polyline> polylines;
+  QHash<int, Projected> projected;
+
+  /* Values of the last frame to detect view changes */
+  const Marble::ViewportParams *frameViewport = nullptr;
+  double frameCenterLonX = 0., frameCenterLatY = 0.;
+  int frameRadius = 0, frameLevel = 0;
+  QSize frameSize;
+  Marble::Projection frameProjection = Marble::VerticalPerspective; // VerticalPerspective is never used
+};
+
+#endif // LITTLENAVMAP_MAPAIRWAYGEOMETRY_H
@@ -53,6 +53,12 @@ public:
     return src == other->src && layerMinRunwayLength == other->layerMinRunwayLength;
   }
 
+  /* @return a key that is equal for all layers having the same query parameters */
+  int getQueryParameterKey() const
+  {
+    return static_cast<int>(src) << 24 | layerMinRunwayLength;
+  }
+
   /* Show airports */
   MapLayer& airport(bool value = true);
 
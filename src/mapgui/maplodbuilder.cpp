@@ -0,0 +1,199 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mapgui/maplodbuilder.h"
+
+#include "mapgui/mapquery.h"
+#include "db/spatialindexbuilder.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+
+#include <QSet>
+
+#include <cmath>
+
+using atools::sql::SqlDatabase;
+using atools::sql::SqlQuery;
+
+namespace {
+/* Table name and order clause putting the most important objects first */
+struct LodTable
+{
+  const char *table, *order;
+};
+
+const LodTable LOD_TABLES[] =
+{
+  {"airport", "rating desc, longest_runway_length desc"},
+  {"waypoint", "num_victor_airway + num_jet_airway desc"},
+  {"vor", "range desc"},
+  {"ndb", "range desc"}
+};
+
+const QString META_TABLE("map_lod_meta");
+
+}
+
+MapLodBuilder::MapLodBuilder(atools::sql::SqlDatabase *sqlDb)
+  : db(sqlDb)
+{
+}
+
+MapLodBuilder::~MapLodBuilder()
+{
+}
+
+bool MapLodBuilder::build(const ProgressCallbackType& progress)
+{
+  // Remove old tables first so that queries do not use stale data if the build is canceled
+  drop();
+
+  int numLevels = MapQuery::MAX_TILE_LEVEL - MapQuery::MIN_TILE_LEVEL + 1;
+  int totalSteps = static_cast<int>(sizeof(LOD_TABLES) / sizeof(LodTable)) * numLevels, step = 0;
+
+  for(const LodTable& lodTable : LOD_TABLES)
+  {
+    QString table(lodTable.table);
+    QVector<LodObject> objects;
+
+    SqlQuery query(db);
+    query.exec("select " + table + "_id, lonx, laty from " + table + " order by " + lodTable.order);
+    while(query.next())
+      objects.append({query.value(0).toInt(), LEVEL_NONE,
+                      query.value(1).toDouble(), query.value(2).toDouble()});
+
+    if(!assignLevels(objects, step, totalSteps, progress))
+    {
+      drop();
+      return false;
+    }
+    writeTable(table, objects);
+  }
+
+  // Remember the scenery load which is checked when opening the map queries
+  db->transaction();
+  SqlQuery(db).exec("create table " + META_TABLE + " (fingerprint varchar(100) not null)");
+  SqlQuery insert(db);
+  insert.prepare("insert into " + META_TABLE + " (fingerprint) values (:fingerprint)");
+  insert.bindValue(":fingerprint", fingerprint(db));
+  insert.exec();
+  db->commit();
+  return true;
+}
+
+bool MapLodBuilder::assignLevels(QVector<LodObject>& objects, int& step, int totalSteps,
+                                 const ProgressCallbackType& progress)
+{
+  for(int level = MapQuery::MAX_TILE_LEVEL; level >= MapQuery::MIN_TILE_LEVEL; level--)
+  {
+    if(progress && progress(step++, totalSteps))
+      return false;
+
+    double cellSize = std::ldexp(1., level) / CELLS_PER_TILE;
+    auto cellKey = [cellSize](const LodObject& obj) -> quint64
+                   {
+                     quint64 x = static_cast<quint64>(std::floor((obj.lonX + 180.) / cellSize));
+                     quint64 y = static_cast<quint64>(std::floor((obj.latY + 90.) / cellSize));
+                     return x << 32 | y;
+                   };
+
+    // Cells taken by objects of coarser levels
+    QSet<quint64> cells;
+    for(const LodObject& obj : objects)
+    {
+      if(obj.level != LEVEL_NONE)
+        cells.insert(cellKey(obj));
+    }
+
+    // Take the most important object for each empty cell
+    for(LodObject& obj : objects)
+    {
+      if(obj.level == LEVEL_NONE)
+      {
+        quint64 key = cellKey(obj);
+        if(!cells.contains(key))
+        {
+          cells.insert(key);
+          obj.level = level;
+        }
+      }
+    }
+  }
+
+  // All remaining objects are shown on the finest level so that nothing disappears. Their number per tile
+  // is limited by the density of the scenery only.
+  for(LodObject& obj : objects)
+  {
+    if(obj.level == LEVEL_NONE)
+      obj.level = MapQuery::MIN_TILE_LEVEL;
+  }
+  return true;
+}
+
+void MapLodBuilder::writeTable(const QString& table, const QVector<LodObject>& objects)
+{
+  QString lodTable = table + "_lod", idColumn = table + "_id";
+
+  db->transaction();
+  SqlQuery(db).exec("create table " + lodTable + " (" + idColumn + " integer primary key, "
+                    "lod_level integer not null, lonx double not null, laty double not null)");
+
+  SqlQuery insert(db);
+  insert.prepare("insert into " + lodTable + " (" + idColumn + ", lod_level, lonx, laty) "
+                 "values (:id, :level, :lonx, :laty)");
+  for(const LodObject& obj : objects)
+  {
+    insert.bindValue(":id", obj.id);
+    insert.bindValue(":level", obj.level);
+    insert.bindValue(":lonx", obj.lonX);
+    insert.bindValue(":laty", obj.latY);
+    insert.exec();
+  }
+
+  // Allows index lookup for each level in the "in" clause of the map queries
+  SqlQuery(db).exec("create index idx_" + lodTable + "_level on " + lodTable + " (lod_level, lonx, laty)");
+  db->commit();
+}
+
+void MapLodBuilder::drop()
+{
+  db->transaction();
+  SqlQuery query(db);
+  query.exec("drop table if exists " + META_TABLE);
+  for(const LodTable& lodTable : LOD_TABLES)
+    query.exec("drop table if exists " + QString(lodTable.table) + "_lod");
+  db->commit();
+}
+
+bool MapLodBuilder::isValid(atools::sql::SqlDatabase *sqlDb)
+{
+  SqlQuery query(sqlDb);
+  query.prepare("select count(1) from sqlite_master where type = 'table' and name = :name");
+  query.bindValue(":name", META_TABLE);
+  query.exec();
+  if(!query.next() || query.value(0).toInt() == 0)
+    return false;
+
+  query.exec("select fingerprint from " + META_TABLE);
+  return query.next() && query.value(0).toString() == fingerprint(sqlDb);
+}
+
+QString MapLodBuilder::fingerprint(atools::sql::SqlDatabase *sqlDb)
+{
+  // Tables of older versions are rebuilt
+  return SpatialIndexBuilder::sceneryFingerprint(sqlDb) + "/" + QString::number(LOD_VERSION);
+}
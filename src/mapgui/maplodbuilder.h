@@ -0,0 +1,88 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPLODBUILDER_H
+#define LITTLENAVMAP_MAPLODBUILDER_H
+
+#include <QVector>
+
+#include <functional>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+}
+}
+
+/*
+ * Builds level of detail tables for the map tile queries after loading the scenery database.
+ *
+ * A grid of CELLS_PER_TILE x CELLS_PER_TILE cells is laid over each tile of a MapQuery tile level. Starting
+ * at the coarsest level the most important object of each empty cell is assigned to the level.
+ * Objects of coarser levels occupy their cells on finer levels. A tile query for a level then returns all
+ * objects assigned to this or a coarser level which are at most one per cell and evenly distributed.
+ * Objects never selected are assigned to the finest level which returns all remaining objects.
+ *
+ * Tables are named like the source table with the suffix "_lod" and contain id, level and coordinates.
+ */
+class MapLodBuilder
+{
+public:
+  /* Called with the current and total number of steps. Return true to cancel. */
+  typedef std::function<bool (int current, int total)> ProgressCallbackType;
+
+  MapLodBuilder(atools::sql::SqlDatabase *sqlDb);
+  ~MapLodBuilder();
+
+  /* Build tables for airports, waypoints, VOR and NDB. Drops all tables if canceled.
+   * @return true if all tables were created */
+  bool build(const ProgressCallbackType& progress);
+
+  /* Remove all tables - queries fall back to truncated results */
+  void drop();
+
+  /* true if the tables exist and were built for the currently loaded scenery */
+  static bool isValid(atools::sql::SqlDatabase *sqlDb);
+
+  /* Maximum number of objects per tile and level is the square of this */
+  static Q_DECL_CONSTEXPR int CELLS_PER_TILE = 16;
+
+private:
+  struct LodObject
+  {
+    int id, level;
+    double lonX, latY;
+  };
+
+  /* Assign levels to objects sorted by descending importance */
+  bool assignLevels(QVector<LodObject>& objects, int& step, int totalSteps,
+                    const ProgressCallbackType& progress);
+  void writeTable(const QString& table, const QVector<LodObject>& objects);
+
+  /* Scenery load and version of the tables */
+  static QString fingerprint(atools::sql::SqlDatabase *sqlDb);
+
+  /* Increase when changing the level assignment to rebuild existing tables */
+  static Q_DECL_CONSTEXPR int LOD_VERSION = 2;
+
+  /* Level for objects not assigned yet */
+  static Q_DECL_CONSTEXPR int LEVEL_NONE = 1000;
+
+  atools::sql::SqlDatabase *db;
+};
+
+#endif // LITTLENAVMAP_MAPLODBUILDER_H
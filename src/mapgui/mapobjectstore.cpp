@@ -0,0 +1,257 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mapgui/mapobjectstore.h"
+
+using atools::geo::Pos;
+using atools::geo::Rect;
+using maptypes::MapAirport;
+using maptypes::MapVor;
+using maptypes::MapNdb;
+using maptypes::MapWaypoint;
+
+MapStringPool::MapStringPool()
+{
+  clear();
+}
+
+MapStringPool::~MapStringPool()
+{
+}
+
+quint32 MapStringPool::intern(const QString& str)
+{
+  if(str.isEmpty())
+    return 0;
+
+  QHash<QString, quint32>::const_iterator it = index.constFind(str);
+  if(it != index.constEnd())
+    return it.value();
+
+  quint32 id = static_cast<quint32>(strings.size());
+  strings.append(str);
+  index.insert(str, id);
+  return id;
+}
+
+void MapStringPool::clear()
+{
+  strings.clear();
+  index.clear();
+  strings.append(QString());
+}
+
+void MapObjectColumns::appendPosition(int id, const Pos& pos)
+{
+  ids.append(id);
+  lonX.append(pos.getLonX());
+  latY.append(pos.getLatY());
+}
+
+// ---------------------------------------------------------------------------------
+void MapObjectStore<MapAirport>::append(const MapAirport& obj, MapStringPool& pool)
+{
+  appendPosition(obj.id, obj.position);
+
+  Row row;
+  row.altitude = obj.position.getAltitude();
+  row.magvar = obj.magvar;
+  row.hasTowerCoords = obj.towerCoords.isValid();
+  row.towerLonX = row.hasTowerCoords ? obj.towerCoords.getLonX() : 0.f;
+  row.towerLatY = row.hasTowerCoords ? obj.towerCoords.getLatY() : 0.f;
+  row.hasBounding = obj.bounding.isValid();
+  row.boundingWest = row.hasBounding ? obj.bounding.getWest() : 0.f;
+  row.boundingNorth = row.hasBounding ? obj.bounding.getNorth() : 0.f;
+  row.boundingEast = row.hasBounding ? obj.bounding.getEast() : 0.f;
+  row.boundingSouth = row.hasBounding ? obj.bounding.getSouth() : 0.f;
+  row.towerFrequency = obj.towerFrequency;
+  row.atisFrequency = obj.atisFrequency;
+  row.awosFrequency = obj.awosFrequency;
+  row.asosFrequency = obj.asosFrequency;
+  row.unicomFrequency = obj.unicomFrequency;
+  row.longestRunwayLength = obj.longestRunwayLength;
+  row.longestRunwayHeading = static_cast<qint16>(obj.longestRunwayHeading);
+  row.flags = static_cast<quint32>(obj.flags);
+  row.ident = pool.intern(obj.ident);
+  row.name = pool.intern(obj.name);
+  rows.append(row);
+}
+
+void MapObjectStore<MapAirport>::get(int index, const MapStringPool& pool, MapAirport& obj) const
+{
+  const Row& row = rows.at(index);
+  obj.id = getId(index);
+  obj.position = Pos(lonXAt(index), latYAt(index), row.altitude);
+  obj.magvar = row.magvar;
+
+  if(row.hasTowerCoords)
+    obj.towerCoords = Pos(row.towerLonX, row.towerLatY);
+  if(row.hasBounding)
+    obj.bounding = Rect(row.boundingWest, row.boundingNorth, row.boundingEast, row.boundingSouth);
+
+  obj.towerFrequency = row.towerFrequency;
+  obj.atisFrequency = row.atisFrequency;
+  obj.awosFrequency = row.awosFrequency;
+  obj.asosFrequency = row.asosFrequency;
+  obj.unicomFrequency = row.unicomFrequency;
+  obj.longestRunwayLength = row.longestRunwayLength;
+  obj.longestRunwayHeading = row.longestRunwayHeading;
+  obj.flags = maptypes::MapAirportFlags(static_cast<int>(row.flags));
+  obj.ident = pool.string(row.ident);
+}
+
+void MapObjectStore<MapAirport>::remapStrings(const MapStringPool& from, MapStringPool& to)
+{
+  for(Row& row : rows)
+  {
+    row.ident = to.intern(from.string(row.ident));
+    row.name = to.intern(from.string(row.name));
+  }
+}
+
+// ---------------------------------------------------------------------------------
+void MapObjectStore<MapVor>::append(const MapVor& obj, MapStringPool& pool)
+{
+  appendPosition(obj.id, obj.position);
+
+  Row row;
+  row.altitude = obj.position.getAltitude();
+  row.magvar = obj.magvar;
+  row.frequency = obj.frequency;
+  row.range = obj.range;
+  row.ident = pool.intern(obj.ident);
+  row.region = pool.intern(obj.region);
+  row.type = pool.intern(obj.type);
+  row.name = pool.intern(obj.name);
+  row.airportIdent = pool.intern(obj.airportIdent);
+  row.dmeOnly = obj.dmeOnly;
+  row.hasDme = obj.hasDme;
+  rows.append(row);
+}
+
+void MapObjectStore<MapVor>::get(int index, const MapStringPool& pool, MapVor& obj) const
+{
+  const Row& row = rows.at(index);
+  obj.id = getId(index);
+  obj.position = Pos(lonXAt(index), latYAt(index), row.altitude);
+  obj.magvar = row.magvar;
+  obj.frequency = row.frequency;
+  obj.range = row.range;
+  obj.ident = pool.string(row.ident);
+  obj.region = pool.string(row.region);
+  obj.type = pool.string(row.type);
+  obj.airportIdent = pool.string(row.airportIdent);
+  obj.dmeOnly = row.dmeOnly;
+  obj.hasDme = row.hasDme;
+}
+
+void MapObjectStore<MapVor>::remapStrings(const MapStringPool& from, MapStringPool& to)
+{
+  for(Row& row : rows)
+  {
+    row.ident = to.intern(from.string(row.ident));
+    row.region = to.intern(from.string(row.region));
+    row.type = to.intern(from.string(row.type));
+    row.name = to.intern(from.string(row.name));
+    row.airportIdent = to.intern(from.string(row.airportIdent));
+  }
+}
+
+// ---------------------------------------------------------------------------------
+void MapObjectStore<MapNdb>::append(const MapNdb& obj, MapStringPool& pool)
+{
+  appendPosition(obj.id, obj.position);
+
+  Row row;
+  row.altitude = obj.position.getAltitude();
+  row.magvar = obj.magvar;
+  row.frequency = obj.frequency;
+  row.range = obj.range;
+  row.ident = pool.intern(obj.ident);
+  row.region = pool.intern(obj.region);
+  row.type = pool.intern(obj.type);
+  row.name = pool.intern(obj.name);
+  row.airportIdent = pool.intern(obj.airportIdent);
+  rows.append(row);
+}
+
+void MapObjectStore<MapNdb>::get(int index, const MapStringPool& pool, MapNdb& obj) const
+{
+  const Row& row = rows.at(index);
+  obj.id = getId(index);
+  obj.position = Pos(lonXAt(index), latYAt(index), row.altitude);
+  obj.magvar = row.magvar;
+  obj.frequency = row.frequency;
+  obj.range = row.range;
+  obj.ident = pool.string(row.ident);
+  obj.region = pool.string(row.region);
+  obj.type = pool.string(row.type);
+  obj.airportIdent = pool.string(row.airportIdent);
+}
+
+void MapObjectStore<MapNdb>::remapStrings(const MapStringPool& from, MapStringPool& to)
+{
+  for(Row& row : rows)
+  {
+    row.ident = to.intern(from.string(row.ident));
+    row.region = to.intern(from.string(row.region));
+    row.type = to.intern(from.string(row.type));
+    row.name = to.intern(from.string(row.name));
+    row.airportIdent = to.intern(from.string(row.airportIdent));
+  }
+}
+
+// ---------------------------------------------------------------------------------
+void MapObjectStore<MapWaypoint>::append(const MapWaypoint& obj, MapStringPool& pool)
+{
+  appendPosition(obj.id, obj.position);
+
+  Row row;
+  row.magvar = obj.magvar;
+  row.ident = pool.intern(obj.ident);
+  row.region = pool.intern(obj.region);
+  row.type = pool.intern(obj.type);
+  row.airportIdent = pool.intern(obj.airportIdent);
+  row.hasVictorAirways = obj.hasVictorAirways;
+  row.hasJetAirways = obj.hasJetAirways;
+  rows.append(row);
+}
+
+void MapObjectStore<MapWaypoint>::get(int index, const MapStringPool& pool, MapWaypoint& obj) const
+{
+  const Row& row = rows.at(index);
+  obj.id = getId(index);
+  obj.position = Pos(lonXAt(index), latYAt(index));
+  obj.magvar = row.magvar;
+  obj.ident = pool.string(row.ident);
+  obj.region = pool.string(row.region);
+  obj.type = pool.string(row.type);
+  obj.airportIdent = pool.string(row.airportIdent);
+  obj.hasVictorAirways = row.hasVictorAirways;
+  obj.hasJetAirways = row.hasJetAirways;
+}
+
+void MapObjectStore<MapWaypoint>::remapStrings(const MapStringPool& from, MapStringPool& to)
+{
+  for(Row& row : rows)
+  {
+    row.ident = to.intern(from.string(row.ident));
+    row.region = to.intern(from.string(row.region));
+    row.type = to.intern(from.string(row.type));
+    row.airportIdent = to.intern(from.string(row.airportIdent));
+  }
+}
@@ -0,0 +1,286 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPOBJECTSTORE_H
+#define LITTLENAVMAP_MAPOBJECTSTORE_H
+
+#include "common/maptypes.h"
+
+#include <QHash>
+#include <QVector>
+
+/*
+ * Keeps one instance of each string so that identical idents, regions and types share their data.
+ * Id 0 is always the empty string.
+ */
+class MapStringPool
+{
+public:
+  MapStringPool();
+  ~MapStringPool();
+
+  /* Get the id of str and add it if not already present */
+  quint32 intern(const QString& str);
+
+  const QString& string(quint32 id) const
+  {
+    return strings.at(static_cast<int>(id));
+  }
+
+  /* Remove all strings. Ids returned before are invalid. */
+  void clear();
+
+  int size() const
+  {
+    return strings.size();
+  }
+
+private:
+  QVector<QString> strings;
+  QHash<QString, quint32> index;
+};
+
+/*
+ * Base for the compact column stores. Keeps ids and packed float coordinates in separate columns.
+ */
+class MapObjectColumns
+{
+public:
+  int size() const
+  {
+    return ids.size();
+  }
+
+  int getId(int index) const
+  {
+    return ids.at(index);
+  }
+
+  /* Approximate memory usage in bytes */
+  int memorySize() const
+  {
+    return ids.size() * static_cast<int>(sizeof(int) + 2 * sizeof(float));
+  }
+
+protected:
+  void appendPosition(int id, const atools::geo::Pos& pos);
+
+  float lonXAt(int index) const
+  {
+    return lonX.at(index);
+  }
+
+  float latYAt(int index) const
+  {
+    return latY.at(index);
+  }
+
+private:
+  QVector<int> ids;
+  QVector<float> lonX, latY;
+};
+
+/*
+ * Storage for the objects of one cache tile. Objects are converted when adding and materialized again
+ * when reading. The generic version stores the objects in a contiguous vector.
+ * Specializations for airports, VOR, NDB and waypoints use columns of ids and coordinates, packed
+ * attribute rows and string ids from a MapStringPool. Names of airports, VOR and NDB are not filled by get
+ * and are materialized only when needed using getNameId.
+ */
+template<typename TYPE>
+class MapObjectStore
+{
+public:
+  void append(const TYPE& obj, MapStringPool& pool)
+  {
+    Q_UNUSED(pool);
+    objects.append(obj);
+  }
+
+  /* Fill obj from the object at index */
+  void get(int index, const MapStringPool& pool, TYPE& obj) const
+  {
+    Q_UNUSED(pool);
+    obj = objects.at(index);
+  }
+
+  /* String id of the name which is not filled by get. 0 for types without separate name. */
+  quint32 getNameId(int index) const
+  {
+    Q_UNUSED(index);
+    return 0;
+  }
+
+  /* Move all strings from pool "from" into "to" and update the ids */
+  void remapStrings(const MapStringPool& from, MapStringPool& to)
+  {
+    Q_UNUSED(from);
+    Q_UNUSED(to);
+  }
+
+  int size() const
+  {
+    return objects.size();
+  }
+
+  int getId(int index) const
+  {
+    return objects.at(index).id;
+  }
+
+  int memorySize() const
+  {
+    return objects.size() * static_cast<int>(sizeof(TYPE));
+  }
+
+private:
+  QVector<TYPE> objects;
+};
+
+template<>
+class MapObjectStore<maptypes::MapAirport> :
+  public MapObjectColumns
+{
+public:
+  void append(const maptypes::MapAirport& obj, MapStringPool& pool);
+  void get(int index, const MapStringPool& pool, maptypes::MapAirport& obj) const;
+
+  quint32 getNameId(int index) const
+  {
+    return rows.at(index).name;
+  }
+
+  void remapStrings(const MapStringPool& from, MapStringPool& to);
+
+  int memorySize() const
+  {
+    return MapObjectColumns::memorySize() + rows.size() * static_cast<int>(sizeof(Row));
+  }
+
+private:
+  struct Row
+  {
+    float altitude, magvar;
+    float towerLonX, towerLatY;
+    float boundingWest, boundingNorth, boundingEast, boundingSouth;
+    qint32 towerFrequency, atisFrequency, awosFrequency, asosFrequency, unicomFrequency;
+    qint32 longestRunwayLength;
+    quint32 flags; /* MapAirportFlags */
+    quint32 ident, name;
+    qint16 longestRunwayHeading;
+    quint8 hasTowerCoords : 1, hasBounding : 1;
+  };
+
+  QVector<Row> rows;
+};
+
+template<>
+class MapObjectStore<maptypes::MapVor> :
+  public MapObjectColumns
+{
+public:
+  void append(const maptypes::MapVor& obj, MapStringPool& pool);
+  void get(int index, const MapStringPool& pool, maptypes::MapVor& obj) const;
+
+  quint32 getNameId(int index) const
+  {
+    return rows.at(index).name;
+  }
+
+  void remapStrings(const MapStringPool& from, MapStringPool& to);
+
+  int memorySize() const
+  {
+    return MapObjectColumns::memorySize() + rows.size() * static_cast<int>(sizeof(Row));
+  }
+
+private:
+  struct Row
+  {
+    float altitude, magvar;
+    qint32 frequency, range;
+    quint32 ident, region, type, name, airportIdent;
+    quint8 dmeOnly : 1, hasDme : 1;
+  };
+
+  QVector<Row> rows;
+};
+
+template<>
+class MapObjectStore<maptypes::MapNdb> :
+  public MapObjectColumns
+{
+public:
+  void append(const maptypes::MapNdb& obj, MapStringPool& pool);
+  void get(int index, const MapStringPool& pool, maptypes::MapNdb& obj) const;
+
+  quint32 getNameId(int index) const
+  {
+    return rows.at(index).name;
+  }
+
+  void remapStrings(const MapStringPool& from, MapStringPool& to);
+
+  int memorySize() const
+  {
+    return MapObjectColumns::memorySize() + rows.size() * static_cast<int>(sizeof(Row));
+  }
+
+private:
+  struct Row
+  {
+    float altitude, magvar;
+    qint32 frequency, range;
+    quint32 ident, region, type, name, airportIdent;
+  };
+
+  QVector<Row> rows;
+};
+
+template<>
+class MapObjectStore<maptypes::MapWaypoint> :
+  public MapObjectColumns
+{
+public:
+  void append(const maptypes::MapWaypoint& obj, MapStringPool& pool);
+  void get(int index, const MapStringPool& pool, maptypes::MapWaypoint& obj) const;
+
+  quint32 getNameId(int index) const
+  {
+    Q_UNUSED(index);
+    return 0;
+  }
+
+  void remapStrings(const MapStringPool& from, MapStringPool& to);
+
+  int memorySize() const
+  {
+    return MapObjectColumns::memorySize() + rows.size() * static_cast<int>(sizeof(Row));
+  }
+
+private:
+  struct Row
+  {
+    float magvar;
+    quint32 ident, region, type, airportIdent;
+    quint8 hasVictorAirways : 1, hasJetAirways : 1;
+  };
+
+  QVector<Row> rows;
+};
+
+#endif // LITTLENAVMAP_MAPOBJECTSTORE_H
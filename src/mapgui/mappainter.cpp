@@ -29,8 +29,8 @@ using namespace Marble;
 using namespace atools::geo;
 
 MapPainter::MapPainter(MapWidget *parentMapWidget, MapQuery *mapQuery, MapScale *mapScale)
-  : CoordinateConverter(parentMapWidget->viewport()), mapWidget(parentMapWidget), query(mapQuery),
-    scale(mapScale)
+  : CoordinateConverter(parentMapWidget->viewport(), parentMapWidget->getProjectionCache()),
+    mapWidget(parentMapWidget), query(mapQuery), scale(mapScale)
 {
   symbolPainter = new SymbolPainter();
 }
@@ -40,6 +40,11 @@ MapPainter::~MapPainter()
   delete symbolPainter;
 }
 
+void MapPainter::setLabelLayout(MapLabelLayout *layout)
+{
+  symbolPainter->setLabelLayout(layout);
+}
+
 void MapPainter::setRenderHints(GeoPainter *painter)
 {
   if(mapWidget->viewContext() == Marble::Still)
@@ -25,6 +25,7 @@
 #include <marble/MarbleWidget.h>
 #include <QPen>
 #include <QApplication>
+#include <QSet>
 
 namespace atools {
 namespace geo {
@@ -38,6 +39,7 @@ class GeoPainter;
 }
 
 class SymbolPainter;
+class MapLabelLayout;
 class MapLayer;
 class MapQuery;
 class MapScale;
@@ -67,6 +69,20 @@ struct PaintContext
 
 };
 
+/* Map objects copied from the query caches on the GUI thread. Used to draw map tiles in worker threads which
+ * must not access the query. Lists share data with the caches until they are modified. */
+struct PaintObjects
+{
+  QList<maptypes::MapAirport> airports; /* Airports of view and flight plan */
+  QSet<int> routeAirportIds; /* Ids of flight plan airports */
+  QHash<int, QVector<maptypes::MapRunway> > overviewRunways; /* Runways for airport overview by airport id */
+  QList<maptypes::MapWaypoint> waypoints;
+  QList<maptypes::MapVor> vors;
+  QList<maptypes::MapNdb> ndbs;
+  QList<maptypes::MapMarker> markers;
+  QList<maptypes::MapIls> ils;
+};
+
 /*
  * Base class for all map painters
  */
@@ -81,6 +97,10 @@ public:
 
   virtual void render(const PaintContext *context) = 0;
 
+  /* Pass all texts to the given layout which draws them after all painters are done.
+   * Null draws texts directly. */
+  void setLabelLayout(MapLabelLayout *layout);
+
 protected:
   /* Set render hints for anti aliasing depending on the view context (still or animation) */
   void setRenderHints(Marble::GeoPainter *painter);
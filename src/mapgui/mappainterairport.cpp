@@ -18,6 +18,7 @@
 #include "mapgui/mappainterairport.h"
 
 #include "common/symbolpainter.h"
+#include "common/maplabellayout.h"
 #include "mapgui/mapscale.h"
 #include "mapgui/maplayer.h"
 #include "mapgui/mapquery.h"
@@ -48,10 +49,72 @@ MapPainterAirport::~MapPainterAirport()
 
 void MapPainterAirport::render(const PaintContext *context)
 {
-  // Get all airports from the route and add them to the map
-  QHash<int, const MapAirport *> airportMap; // Collect all airports from route and bounding rectangle
-  QSet<int> routeAirportIds; // Airport ids from departure and destination
+  QHash<int, const MapAirport *> airportMap;
+  QSet<int> routeAirportIds;
+  if(!collectAirports(context, airportMap, routeAirportIds))
+    return;
+
+  setRenderHints(context->painter);
+
+  for(const MapAirport *airport : airportMap.values())
+  {
+    int x, y;
+    if(isAirportVisible(context, *airport, routeAirportIds.contains(airport->id), x, y))
+    {
+      const QVector<MapRunway> *runways = nullptr;
+      if(hasRunwayOverview(context, *airport))
+        runways = query->getRunwaysForOverview(airport->id);
+
+      paintAirport(context, *airport, x, y, routeAirportIds.contains(airport->id), runways);
+    }
+  }
+}
+
+void MapPainterAirport::fetchObjects(const PaintContext *context, PaintObjects& objects)
+{
+  QHash<int, const MapAirport *> airportMap;
+  if(!collectAirports(context, airportMap, objects.routeAirportIds))
+    return;
+
+  // Names are not kept in the cached objects - fill them here on the GUI thread if labels need them
+  bool fillNames = context->mapLayer->isAirportName() || context->mapLayer->isAirportInfo();
+
+  for(const MapAirport *airport : airportMap.values())
+  {
+    objects.airports.append(*airport);
+    if(fillNames)
+      query->fillName(objects.airports.last());
+
+    if(hasRunwayOverview(context, *airport))
+    {
+      const QVector<MapRunway> *runways = query->getRunwaysForOverview(airport->id);
+      if(runways != nullptr)
+        objects.overviewRunways.insert(airport->id, *runways);
+    }
+  }
+}
+
+void MapPainterAirport::renderObjects(const PaintContext *context, const PaintObjects& objects)
+{
+  setRenderHints(context->painter);
+
+  for(const MapAirport& airport : objects.airports)
+  {
+    int x, y;
+    if(isAirportVisible(context, airport, objects.routeAirportIds.contains(airport.id), x, y))
+    {
+      QHash<int, QVector<MapRunway> >::const_iterator it = objects.overviewRunways.constFind(airport.id);
+      paintAirport(context, airport, x, y, objects.routeAirportIds.contains(airport.id),
+                   it != objects.overviewRunways.constEnd() ? &it.value() : nullptr);
+    }
+  }
+}
 
+bool MapPainterAirport::collectAirports(const PaintContext *context,
+                                        QHash<int, const MapAirport *>& airportMap,
+                                        QSet<int>& routeAirportIds)
+{
+  // Get all airports from the route and add them to the map
   if(context->objectTypes.testFlag(maptypes::ROUTE))
   {
     for(const RouteMapObject& rmo : routeController->getRouteMapObjects())
@@ -66,7 +129,7 @@ void MapPainterAirport::render(const PaintContext *context)
 
   if((!context->objectTypes.testFlag(maptypes::AIRPORT) || !context->mapLayer->isAirport()) &&
      (!context->mapLayerEffective->isAirportDiagram()) && airportMap.isEmpty())
-    return;
+    return false;
 
   // Get airports from cache/database for the bounding rectangle and add them to the map
   const GeoDataLatLonAltBox& curBox = context->viewport->viewLatLonAltBox();
@@ -79,57 +142,58 @@ void MapPainterAirport::render(const PaintContext *context)
   for(const MapAirport& ap : *airportCache)
     airportMap.insert(ap.id, &ap);
 
-  if(airportMap.isEmpty())
-    // Nothing found in bounding rectangle and route
-    return;
-
-  setRenderHints(context->painter);
+  // Nothing found in bounding rectangle and route
+  return !airportMap.isEmpty();
+}
 
-  for(const MapAirport *airport : airportMap.values())
-  {
-    const MapLayer *layer = context->mapLayer;
+bool MapPainterAirport::isAirportVisible(const PaintContext *context, const maptypes::MapAirport& airport,
+                                         bool routeAirport, int& x, int& y)
+{
+  // Either part of the route or enabled in the actions/menus/toolbar
+  if(!airport.isVisible(context->objectTypes) && !routeAirport)
+    return false;
 
-    // Either part of the route or enabled in the actions/menus/toolbar
-    if(!airport->isVisible(context->objectTypes) && !routeAirportIds.contains(airport->id))
-      continue;
+  bool visible = wToS(airport.position, x, y, scale->getScreeenSizeForRect(airport.bounding));
 
-    int x, y;
-    bool visible = wToS(airport->position, x, y, scale->getScreeenSizeForRect(airport->bounding));
+  if(!visible)
+    // Check bounding rect for visibility
+    visible = airport.bounding.overlaps(context->viewportRect);
+  return visible;
+}
 
-    if(!visible)
-      // Check bounding rect for visibility
-      visible = airport->bounding.overlaps(context->viewportRect);
+void MapPainterAirport::paintAirport(const PaintContext *context, const maptypes::MapAirport& airport,
+                                     int x, int y, bool routeAirport,
+                                     const QVector<maptypes::MapRunway> *overviewRunways)
+{
+  const MapLayer *layer = context->mapLayer;
 
-    if(visible)
-    {
-      // Airport diagram is not influenced by detail level
-      if(context->mapLayerEffective->isAirportDiagram())
-        drawAirportDiagram(context, *airport, context->drawFast);
-      else
-        drawAirportSymbolOverview(context, *airport);
+  // Airport diagram is not influenced by detail level
+  if(context->mapLayerEffective->isAirportDiagram())
+    drawAirportDiagram(context, airport, context->drawFast);
+  else if(overviewRunways != nullptr)
+    drawAirportSymbolOverview(context, airport, overviewRunways);
 
-      // More detailed symbol will be drawn by the route painter
-      if(!routeAirportIds.contains(airport->id))
-      {
-        // Symbol will be omitted for runway overview
-        drawAirportSymbol(context, *airport, x, y);
+  // More detailed symbol will be drawn by the route painter
+  if(!routeAirport)
+  {
+    // Symbol will be omitted for runway overview
+    drawAirportSymbol(context, airport, x, y);
 
-        // Build and draw airport text
-        textflags::TextFlags flags;
+    // Build and draw airport text
+    textflags::TextFlags flags;
 
-        if(layer->isAirportInfo())
-          flags = textflags::IDENT | textflags::NAME | textflags::INFO;
+    if(layer->isAirportInfo())
+      flags = textflags::IDENT | textflags::NAME | textflags::INFO;
 
-        if(layer->isAirportIdent())
-          flags |= textflags::IDENT;
-        else if(layer->isAirportName())
-          flags |= textflags::NAME;
+    if(layer->isAirportIdent())
+      flags |= textflags::IDENT;
+    else if(layer->isAirportName())
+      flags |= textflags::NAME;
 
-        symbolPainter->drawAirportText(context->painter, *airport, x, y, flags,
-                                       context->symSize(context->mapLayerEffective->getAirportSymbolSize()),
-                                       context->mapLayerEffective->isAirportDiagram());
-      }
-    }
+    symbolPainter->setLabelPriority(labelprio::airportPriority(airport));
+    symbolPainter->drawAirportText(context->painter, airport, x, y, flags,
+                                   context->symSize(context->mapLayerEffective->getAirportSymbolSize()),
+                                   context->mapLayerEffective->isAirportDiagram());
   }
 }
 
@@ -149,7 +213,7 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
                        Qt::SolidLine, Qt::RoundCap));
 
   // Get all runways for this airport
-  const QList<MapRunway> *runways = query->getRunways(airport.id);
+  const QVector<MapRunway> *runways = query->getRunways(airport.id);
 
   // Calculate all runway screen coordinates
   QList<QPoint> runwayCenters;
@@ -170,37 +234,46 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
       painter->resetTransform();
     }
 
-  // For taxipaths
-  const QList<MapTaxiPath> *taxipaths = query->getTaxiPaths(airport.id);
+  // Project all taxipath end points and apron outlines once since they are used in several passes
+  const QVector<MapTaxiPath> *taxipaths = query->getTaxiPaths(airport.id);
+  QVector<QPoint> taxiStarts, taxiEnds;
+  QVector<bool> taxiVisible;
+  taxiStarts.reserve(taxipaths->size());
+  taxiEnds.reserve(taxipaths->size());
+  taxiVisible.reserve(taxipaths->size());
   for(const MapTaxiPath& taxipath : *taxipaths)
   {
-    bool visible;
-    QPoint start = wToS(taxipath.start, DEFAULT_WTOS_SIZE, &visible);
-    QPoint end = wToS(taxipath.end, DEFAULT_WTOS_SIZE, &visible);
-    painter->drawLine(start, end);
+    bool visibleStart, visibleEnd;
+    taxiStarts.append(wToS(taxipath.start, DEFAULT_WTOS_SIZE, &visibleStart));
+    taxiEnds.append(wToS(taxipath.end, DEFAULT_WTOS_SIZE, &visibleEnd));
+    taxiVisible.append(visibleEnd);
   }
 
-  // For aprons
-  const QList<MapApron> *aprons = query->getAprons(airport.id);
-  QVector<QPoint> points;
-  for(const MapApron& apron : *aprons)
+  const QVector<MapApron> *aprons = query->getAprons(airport.id);
+  QVector<QVector<QPoint> > apronPoints(aprons->size());
+  for(int i = 0; i < aprons->size(); i++)
   {
-    points.clear();
+    QVector<QPoint>& points = apronPoints[i];
+    points.reserve(aprons->at(i).vertices.size());
     bool visible;
-    for(const Pos& pos : apron.vertices)
+    for(const Pos& pos : aprons->at(i).vertices)
       points.append(wToS(pos, DEFAULT_WTOS_SIZE, &visible));
+  }
+
+  // For taxipaths
+  for(int i = 0; i < taxiStarts.size(); i++)
+    painter->drawLine(taxiStarts.at(i), taxiEnds.at(i));
 
+  // For aprons
+  for(const QVector<QPoint>& points : apronPoints)
     painter->QPainter::drawPolyline(points.data(), points.size());
-  }
 
   // Draw aprons ---------------------------------
   painter->setBackground(Qt::transparent);
-  for(const MapApron& apron : *aprons)
+  for(int i = 0; i < aprons->size(); i++)
   {
-    points.clear();
-    bool visible;
-    for(const Pos& pos : apron.vertices)
-      points.append(wToS(pos, DEFAULT_WTOS_SIZE, &visible));
+    const MapApron& apron = aprons->at(i);
+    const QVector<QPoint>& points = apronPoints.at(i);
 
     // Draw aprons a bit darker so we can see the taxiways
     QColor col = mapcolors::colorForSurface(apron.surface);
@@ -218,8 +291,9 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
   }
 
   // Draw taxiways ---------------------------------
-  for(const MapTaxiPath& taxipath : *taxipaths)
+  for(int i = 0; i < taxipaths->size(); i++)
   {
+    const MapTaxiPath& taxipath = taxipaths->at(i);
     int pathThickness = scale->getPixelIntForFeet(taxipath.width);
     QColor col = mapcolors::colorForSurface(taxipath.surface);
 
@@ -229,10 +303,7 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
       painter->setPen(QPen(col, pathThickness, Qt::SolidLine, Qt::RoundCap));
 
     // Do not do any clipping here
-    bool visible;
-    QPoint start = wToS(taxipath.start, DEFAULT_WTOS_SIZE, &visible);
-    QPoint end = wToS(taxipath.end, DEFAULT_WTOS_SIZE, &visible);
-    painter->drawLine(start, end);
+    painter->drawLine(taxiStarts.at(i), taxiEnds.at(i));
   }
 
   // Draw taxiway names ---------------------------------
@@ -242,24 +313,19 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
     painter->setBackgroundMode(Qt::TransparentMode);
     painter->setPen(QPen(mapcolors::taxiwayNameColor, 2, Qt::SolidLine, Qt::FlatCap));
 
-    // Map all visible names to paths
-    QMultiMap<QString, MapTaxiPath> map;
-    for(const MapTaxiPath& taxipath : *taxipaths)
+    // Map all visible names to path indexes
+    QMultiMap<QString, int> map;
+    for(int i = 0; i < taxipaths->size(); i++)
     {
-      if(!taxipath.name.isEmpty())
-      {
-        bool visible;
-        wToS(taxipath.start, DEFAULT_WTOS_SIZE, &visible);
-        wToS(taxipath.end, DEFAULT_WTOS_SIZE, &visible);
-        if(visible)
-          map.insert(taxipath.name, taxipath);
-      }
+      const MapTaxiPath& taxipath = taxipaths->at(i);
+      if(!taxipath.name.isEmpty() && taxiVisible.at(i))
+        map.insert(taxipath.name, i);
     }
 
-    for(QString taxiname : map.keys())
+    for(QString taxiname : map.uniqueKeys())
     {
-      QList<MapTaxiPath> paths = map.values(taxiname);
-      QList<MapTaxiPath> pathsToLabel;
+      QList<int> paths = map.values(taxiname);
+      QList<int> pathsToLabel;
 
       // Simplified text placement - take first, last and middle name for a path
       pathsToLabel.append(paths.first());
@@ -267,11 +333,10 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
         pathsToLabel.append(paths.at(paths.size() / 2));
       pathsToLabel.append(paths.last());
 
-      for(const MapTaxiPath& taxipath : pathsToLabel)
+      for(int index : pathsToLabel)
       {
-        bool visible;
-        QPoint start = wToS(taxipath.start, DEFAULT_WTOS_SIZE, &visible);
-        QPoint end = wToS(taxipath.end, DEFAULT_WTOS_SIZE, &visible);
+        const QPoint& start = taxiStarts.at(index);
+        const QPoint& end = taxiEnds.at(index);
 
         QRect textrect = taxiMetrics.boundingRect(taxiname);
 
@@ -419,7 +484,7 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
   }
 
   // Draw parking --------------------------------
-  const QList<MapParking> *parkings = query->getParkingsForAirport(airport.id);
+  const QVector<MapParking> *parkings = query->getParkingsForAirport(airport.id);
   if(!parkings->isEmpty())
     painter->setPen(QPen(mapcolors::parkingOutlineColor, 2, Qt::SolidLine, Qt::FlatCap));
   for(const MapParking& parking : *parkings)
@@ -451,7 +516,7 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
   }
 
   // Draw helipads ------------------------------------------------
-  const QList<MapHelipad> *helipads = query->getHelipads(airport.id);
+  const QVector<MapHelipad> *helipads = query->getHelipads(airport.id);
   if(!helipads->isEmpty())
     painter->setPen(QPen(mapcolors::helipadOutlineColor, 2, Qt::SolidLine, Qt::FlatCap));
   for(const MapHelipad& helipad : *helipads)
@@ -727,54 +792,56 @@ void MapPainterAirport::drawAirportDiagram(const PaintContext *context, const ma
   painter->restore();
 }
 
-/* Draw airport runway overview as in VFR maps (runways with white center line) */
-void MapPainterAirport::drawAirportSymbolOverview(const PaintContext *context, const maptypes::MapAirport& ap)
+bool MapPainterAirport::hasRunwayOverview(const PaintContext *context, const maptypes::MapAirport& ap)
+{
+  // Draw only for airports with a runway longer than 8000 feet otherwise use symbol
+  return ap.longestRunwayLength >= RUNWAY_OVERVIEW_MIN_LENGTH_FEET &&
+         context->mapLayerEffective->isAirportOverviewRunway() &&
+         !context->mapLayerEffective->isAirportDiagram() &&
+         !ap.flags.testFlag(maptypes::AP_CLOSED) && !ap.waterOnly();
+}
+
+/* Draw airport runway overview as in VFR maps (runways with white center line).
+ * rw contains all runways longer than 4000 feet. */
+void MapPainterAirport::drawAirportSymbolOverview(const PaintContext *context, const maptypes::MapAirport& ap,
+                                                  const QVector<maptypes::MapRunway> *rw)
 {
   Marble::GeoPainter *painter = context->painter;
 
-  if(ap.longestRunwayLength >= RUNWAY_OVERVIEW_MIN_LENGTH_FEET &&
-     context->mapLayerEffective->isAirportOverviewRunway() &&
-     !ap.flags.testFlag(maptypes::AP_CLOSED) && !ap.waterOnly())
-  {
-    // Draw only for airports with a runway longer than 8000 feet otherwise use symbol
-    painter->save();
+  painter->save();
 
-    QColor apColor = mapcolors::colorForAirport(ap);
-    painter->setBackgroundMode(Qt::OpaqueMode);
+  QColor apColor = mapcolors::colorForAirport(ap);
+  painter->setBackgroundMode(Qt::OpaqueMode);
 
-    // Get all runways longer than 4000 feet
-    const QList<maptypes::MapRunway> *rw = query->getRunwaysForOverview(ap.id);
+  QList<QPoint> centers;
+  QList<QRect> rects, innerRects;
+  runwayCoords(rw, &centers, &rects, &innerRects, nullptr);
 
-    QList<QPoint> centers;
-    QList<QRect> rects, innerRects;
-    runwayCoords(rw, &centers, &rects, &innerRects, nullptr);
+  // Draw outline in airport color (magenta or green depending on tower)
+  painter->setBrush(QBrush(apColor));
+  painter->setPen(QPen(QBrush(apColor), 1, Qt::SolidLine, Qt::FlatCap));
+  for(int i = 0; i < centers.size(); i++)
+  {
+    painter->translate(centers.at(i));
+    painter->rotate(rw->at(i).heading);
+    painter->drawRect(rects.at(i));
+    painter->resetTransform();
+  }
 
-    // Draw outline in airport color (magenta or green depending on tower)
-    painter->setBrush(QBrush(apColor));
-    painter->setPen(QPen(QBrush(apColor), 1, Qt::SolidLine, Qt::FlatCap));
+  if(!context->drawFast || context->mapLayerEffective->isAirportDiagram())
+  {
+    // Draw white center lines
+    painter->setPen(QPen(QBrush(mapcolors::airportSymbolFillColor), 1, Qt::SolidLine, Qt::FlatCap));
+    painter->setBrush(QBrush(mapcolors::airportSymbolFillColor));
     for(int i = 0; i < centers.size(); i++)
     {
       painter->translate(centers.at(i));
       painter->rotate(rw->at(i).heading);
-      painter->drawRect(rects.at(i));
+      painter->drawRect(innerRects.at(i));
       painter->resetTransform();
     }
-
-    if(!context->drawFast || context->mapLayerEffective->isAirportDiagram())
-    {
-      // Draw white center lines
-      painter->setPen(QPen(QBrush(mapcolors::airportSymbolFillColor), 1, Qt::SolidLine, Qt::FlatCap));
-      painter->setBrush(QBrush(mapcolors::airportSymbolFillColor));
-      for(int i = 0; i < centers.size(); i++)
-      {
-        painter->translate(centers.at(i));
-        painter->rotate(rw->at(i).heading);
-        painter->drawRect(innerRects.at(i));
-        painter->resetTransform();
-      }
-    }
-    painter->restore();
   }
+  painter->restore();
 }
 
 /* Draws the airport symbol. This is not drawn if the airport is drawn using runway overview */
@@ -800,7 +867,7 @@ void MapPainterAirport::drawAirportSymbol(const PaintContext *context, const map
  * @param innerRects Fill rectangles
  * @param outlineRects Big white outline
  */
-void MapPainterAirport::runwayCoords(const QList<maptypes::MapRunway> *runways, QList<QPoint> *centers,
+void MapPainterAirport::runwayCoords(const QVector<maptypes::MapRunway> *runways, QList<QPoint> *centers,
                                      QList<QRect> *rects, QList<QRect> *innerRects,
                                      QList<QRect> *outlineRects)
 {
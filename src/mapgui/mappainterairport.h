@@ -46,11 +46,31 @@ public:
 
   virtual void render(const PaintContext *context) override;
 
+  /* Copy airports and runways needed for the runway overview from the query. Call on the GUI thread. */
+  void fetchObjects(const PaintContext *context, PaintObjects& objects);
+
+  /* Draw the given airports without accessing the query. Airport diagrams are not supported. */
+  void renderObjects(const PaintContext *context, const PaintObjects& objects);
+
 private:
+  /* Get airports for view and flight plan. Returns false if nothing is to be drawn. */
+  bool collectAirports(const PaintContext *context, QHash<int, const maptypes::MapAirport *>& airportMap,
+                       QSet<int>& routeAirportIds);
+  bool isAirportVisible(const PaintContext *context, const maptypes::MapAirport& airport, bool routeAirport,
+                        int& x, int& y);
+
+  /* Draw diagram or runway overview, symbol and text */
+  void paintAirport(const PaintContext *context, const maptypes::MapAirport& airport, int x, int y,
+                    bool routeAirport, const QVector<maptypes::MapRunway> *overviewRunways);
+
   void drawAirportSymbol(const PaintContext *context, const maptypes::MapAirport& ap, int x, int y);
   void drawAirportDiagram(const PaintContext *context, const maptypes::MapAirport& airport, bool fast);
-  void drawAirportSymbolOverview(const PaintContext *context, const maptypes::MapAirport& ap);
-  void runwayCoords(const QList<maptypes::MapRunway> *runways, QList<QPoint> *centers, QList<QRect> *rects,
+
+  /* true if airport is drawn as runway overview instead of a symbol */
+  bool hasRunwayOverview(const PaintContext *context, const maptypes::MapAirport& ap);
+  void drawAirportSymbolOverview(const PaintContext *context, const maptypes::MapAirport& ap,
+                                 const QVector<maptypes::MapRunway> *rw);
+  void runwayCoords(const QVector<maptypes::MapRunway> *runways, QList<QPoint> *centers, QList<QRect> *rects,
                     QList<QRect> *innerRects, QList<QRect> *outlineRects);
 
   /* All sizes in pixel */
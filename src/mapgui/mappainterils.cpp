@@ -52,23 +52,43 @@ void MapPainterIls::render(const PaintContext *context)
 
     const QList<MapIls> *ilsList = query->getIls(curBox, context->mapLayer, context->drawFast);
     if(ilsList != nullptr)
-    {
-      setRenderHints(context->painter);
+      paintIls(context, ilsList);
+  }
+}
 
-      for(const MapIls& ils : *ilsList)
-      {
-        int x, y;
-        // Need to get the real ILS size on the screen for mercator projection - otherwise feather may vanish
-        bool visible = wToS(ils.position, x, y, scale->getScreeenSizeForRect(ils.bounding));
+void MapPainterIls::fetchObjects(const PaintContext *context, PaintObjects& objects)
+{
+  if(context->objectTypes.testFlag(maptypes::ILS) && context->mapLayer->isIls())
+  {
+    const GeoDataLatLonBox& curBox = context->viewport->viewLatLonAltBox();
 
-        if(!visible)
-          // Check bounding rect for visibility
-          visible = ils.bounding.overlaps(context->viewportRect);
+    const QList<MapIls> *ilsList = query->getIls(curBox, context->mapLayer, context->drawFast);
+    if(ilsList != nullptr)
+      objects.ils = *ilsList;
+  }
+}
 
-        if(visible)
-          drawIlsSymbol(context, ils);
-      }
-    }
+void MapPainterIls::renderObjects(const PaintContext *context, const PaintObjects& objects)
+{
+  paintIls(context, &objects.ils);
+}
+
+void MapPainterIls::paintIls(const PaintContext *context, const QList<maptypes::MapIls> *ilsList)
+{
+  setRenderHints(context->painter);
+
+  for(const MapIls& ils : *ilsList)
+  {
+    int x, y;
+    // Need to get the real ILS size on the screen for mercator projection - otherwise feather may vanish
+    bool visible = wToS(ils.position, x, y, scale->getScreeenSizeForRect(ils.bounding));
+
+    if(!visible)
+      // Check bounding rect for visibility
+      visible = ils.bounding.overlaps(context->viewportRect);
+
+    if(visible)
+      drawIlsSymbol(context, ils);
   }
 }
 
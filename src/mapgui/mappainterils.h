@@ -36,11 +36,18 @@ public:
 
   virtual void render(const PaintContext *context) override;
 
+  /* Copy ILS from the query. Call on the GUI thread. */
+  void fetchObjects(const PaintContext *context, PaintObjects& objects);
+
+  /* Draw the given ILS without accessing the query */
+  void renderObjects(const PaintContext *context, const PaintObjects& objects);
+
 private:
   /* Fixed value that is used when writing the database. See atools::fs::db::IlsWriter */
   static Q_DECL_CONSTEXPR int FEATHER_LEN_NM = 9;
   static Q_DECL_CONSTEXPR int MIN_LENGHT_FOR_TEXT = 40;
 
+  void paintIls(const PaintContext *context, const QList<maptypes::MapIls> *ilsList);
   void drawIlsSymbol(const PaintContext *context, const maptypes::MapIls& ils);
 
 };
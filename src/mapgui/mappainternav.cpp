@@ -18,12 +18,12 @@
 #include "mapgui/mappainternav.h"
 
 #include "common/symbolpainter.h"
+#include "common/maplabellayout.h"
 #include "common/mapcolors.h"
 #include "mapgui/mapwidget.h"
 
 #include <QElapsedTimer>
 
-#include <marble/GeoDataLineString.h>
 #include <marble/GeoPainter.h>
 #include <marble/ViewportParams.h>
 
@@ -42,30 +42,46 @@ MapPainterNav::~MapPainterNav()
 
 void MapPainterNav::render(const PaintContext *context)
 {
-  const GeoDataLatLonAltBox& curBox = context->viewport->viewLatLonAltBox();
+  renderAirways(context);
 
-  setRenderHints(context->painter);
+  PaintObjects objects;
+  fetchObjects(context, objects);
+  renderObjects(context, objects);
+}
 
-  // Airways -------------------------------------------------
+void MapPainterNav::renderAirways(const PaintContext *context)
+{
   bool drawAirway = context->mapLayer->isAirway() &&
                     (context->objectTypes.testFlag(maptypes::AIRWAYJ) ||
                      context->objectTypes.testFlag(maptypes::AIRWAYV));
   if(drawAirway)
   {
+    const GeoDataLatLonAltBox& curBox = context->viewport->viewLatLonAltBox();
+
+    setRenderHints(context->painter);
+
     // Draw airway lines
     const QList<MapAirway> *airways = query->getAirways(curBox, context->mapLayer, context->drawFast);
     if(airways != nullptr)
       paintAirways(context, airways, context->drawFast);
   }
+}
+
+void MapPainterNav::fetchObjects(const PaintContext *context, PaintObjects& objects)
+{
+  const GeoDataLatLonAltBox& curBox = context->viewport->viewLatLonAltBox();
 
   // Waypoints -------------------------------------------------
+  bool drawAirway = context->mapLayer->isAirway() &&
+                    (context->objectTypes.testFlag(maptypes::AIRWAYJ) ||
+                     context->objectTypes.testFlag(maptypes::AIRWAYV));
   bool drawWaypoint = context->mapLayer->isWaypoint() && context->objectTypes.testFlag(maptypes::WAYPOINT);
   if(drawWaypoint || drawAirway)
   {
     // If airways are drawn we also have to go through waypoints
     const QList<MapWaypoint> *waypoints = query->getWaypoints(curBox, context->mapLayer, context->drawFast);
     if(waypoints != nullptr)
-      paintWaypoints(context, waypoints, drawWaypoint, context->drawFast);
+      objects.waypoints = *waypoints;
   }
 
   // VOR -------------------------------------------------
@@ -73,7 +89,7 @@ void MapPainterNav::render(const PaintContext *context)
   {
     const QList<MapVor> *vors = query->getVors(curBox, context->mapLayer, context->drawFast);
     if(vors != nullptr)
-      paintVors(context, vors, context->drawFast);
+      objects.vors = *vors;
   }
 
   // NDB -------------------------------------------------
@@ -81,7 +97,7 @@ void MapPainterNav::render(const PaintContext *context)
   {
     const QList<MapNdb> *ndbs = query->getNdbs(curBox, context->mapLayer, context->drawFast);
     if(ndbs != nullptr)
-      paintNdbs(context, ndbs, context->drawFast);
+      objects.ndbs = *ndbs;
   }
 
   // Marker -------------------------------------------------
@@ -89,10 +105,22 @@ void MapPainterNav::render(const PaintContext *context)
   {
     const QList<MapMarker> *markers = query->getMarkers(curBox, context->mapLayer, context->drawFast);
     if(markers != nullptr)
-      paintMarkers(context, markers, context->drawFast);
+      objects.markers = *markers;
   }
 }
 
+void MapPainterNav::renderObjects(const PaintContext *context, const PaintObjects& objects)
+{
+  setRenderHints(context->painter);
+
+  bool drawWaypoint = context->mapLayer->isWaypoint() && context->objectTypes.testFlag(maptypes::WAYPOINT);
+
+  paintWaypoints(context, &objects.waypoints, drawWaypoint, context->drawFast);
+  paintVors(context, &objects.vors, context->drawFast);
+  paintNdbs(context, &objects.ndbs, context->drawFast);
+  paintMarkers(context, &objects.markers, context->drawFast);
+}
+
 /* Draw airways and texts */
 void MapPainterNav::paintAirways(const PaintContext *context, const QList<MapAirway> *airways, bool fast)
 {
@@ -106,6 +134,12 @@ void MapPainterNav::paintAirways(const PaintContext *context, const QList<MapAir
   // points to index or airway in airway list
   QList<int> airwayIndex;
 
+  MapAirwayGeometry *geometry = query->getAirwayGeometry();
+  geometry->beginFrame(context->viewport, scale);
+
+  // GeoPainter hides the QPainter overloads for screen coordinates
+  QPainter *painter = context->painter;
+
   for(int i = 0; i < airways->size(); i++)
   {
     const MapAirway& airway = airways->at(i);
@@ -134,12 +168,14 @@ void MapPainterNav::paintAirways(const PaintContext *context, const QList<MapAir
     if(visible1 || visible2)
     {
       // Draw line if both points are visible or line intersects screen coordinates
-      GeoDataCoordinates from(airway.from.getLonX(), airway.from.getLatY(), 0, DEG);
-      GeoDataCoordinates to(airway.to.getLonX(), airway.to.getLatY(), 0, DEG);
-      GeoDataLineString line;
-      line.setTessellate(true);
-      line << from << to;
-      context->painter->drawPolyline(line);
+      // Use the precalculated great circle which is projected only once per frame
+      int first;
+      int numPolylines = geometry->project(airway, first);
+      for(int j = first; j < first + numPolylines; j++)
+      {
+        const MapAirwayGeometry::Polyline& polyline = geometry->getPolyline(j);
+        painter->drawPolyline(geometry->getPoints(polyline), polyline.size);
+      }
 
       if(!fast)
       {
@@ -156,8 +192,10 @@ void MapPainterNav::paintAirways(const PaintContext *context, const QList<MapAir
 
         if(!text.isEmpty())
         {
-          QString firstStr = line.first().toString(GeoDataCoordinates::Decimal, 3);
-          QString lastStr = line.last().toString(GeoDataCoordinates::Decimal, 3);
+          GeoDataCoordinates from(airway.from.getLonX(), airway.from.getLatY(), 0, DEG);
+          GeoDataCoordinates to(airway.to.getLonX(), airway.to.getLatY(), 0, DEG);
+          QString firstStr = from.toString(GeoDataCoordinates::Decimal, 3);
+          QString lastStr = to.toString(GeoDataCoordinates::Decimal, 3);
 
           // Create string key for index by using the coordinates
           QString lineTextKey = firstStr + "|" + lastStr;
@@ -218,6 +256,8 @@ void MapPainterNav::paintAirways(const PaintContext *context, const QList<MapAir
 void MapPainterNav::paintWaypoints(const PaintContext *context, const QList<MapWaypoint> *waypoints,
                                    bool drawWaypoint, bool drawFast)
 {
+  symbolPainter->setLabelPriority(labelprio::WAYPOINT);
+
   bool drawAirwayV = context->mapLayer->isAirway() && context->objectTypes.testFlag(maptypes::AIRWAYV);
   bool drawAirwayJ = context->mapLayer->isAirway() && context->objectTypes.testFlag(maptypes::AIRWAYJ);
 
@@ -245,6 +285,8 @@ void MapPainterNav::paintWaypoints(const PaintContext *context, const QList<MapW
 
 void MapPainterNav::paintVors(const PaintContext *context, const QList<MapVor> *vors, bool drawFast)
 {
+  symbolPainter->setLabelPriority(labelprio::VOR);
+
   for(const MapVor& vor : *vors)
   {
     int x, y;
@@ -271,6 +313,8 @@ void MapPainterNav::paintVors(const PaintContext *context, const QList<MapVor> *
 
 void MapPainterNav::paintNdbs(const PaintContext *context, const QList<MapNdb> *ndbs, bool drawFast)
 {
+  symbolPainter->setLabelPriority(labelprio::NDB);
+
   for(const MapNdb& ndb : *ndbs)
   {
     int x, y;
@@ -295,6 +339,8 @@ void MapPainterNav::paintNdbs(const PaintContext *context, const QList<MapNdb> *
 
 void MapPainterNav::paintMarkers(const PaintContext *context, const QList<MapMarker> *markers, bool drawFast)
 {
+  symbolPainter->setLabelPriority(labelprio::MARKER);
+
   for(const MapMarker& marker : *markers)
   {
     int x, y;
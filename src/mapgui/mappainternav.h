@@ -38,6 +38,15 @@ public:
 
   virtual void render(const PaintContext *context) override;
 
+  /* Draw airways only */
+  void renderAirways(const PaintContext *context);
+
+  /* Copy waypoints, VOR, NDB and markers from the query. Call on the GUI thread. */
+  void fetchObjects(const PaintContext *context, PaintObjects& objects);
+
+  /* Draw the given navaids without airways and without accessing the query */
+  void renderObjects(const PaintContext *context, const PaintObjects& objects);
+
 private:
   void paintMarkers(const PaintContext *context, const QList<maptypes::MapMarker> *markers, bool drawFast);
   void paintNdbs(const PaintContext *context, const QList<maptypes::MapNdb> *ndbs, bool drawFast);
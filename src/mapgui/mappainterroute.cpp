@@ -19,6 +19,7 @@
 
 #include "mapgui/mapwidget.h"
 #include "common/symbolpainter.h"
+#include "common/maplabellayout.h"
 #include "mapgui/maplayer.h"
 #include "common/mapcolors.h"
 #include "geo/calculations.h"
@@ -50,6 +51,9 @@ void MapPainterRoute::render(const PaintContext *context)
 
   setRenderHints(context->painter);
 
+  // Flight plan texts are placed before all other labels
+  symbolPainter->setLabelPriority(labelprio::ROUTE);
+
   context->painter->save();
 
   paintRoute(context);
@@ -17,6 +17,8 @@
 
 #include "mapgui/mappaintlayer.h"
 
+#include "common/constants.h"
+#include "common/maplabellayout.h"
 #include "connect/connectclient.h"
 #include "gui/mainwindow.h"
 #include "mapgui/mapwidget.h"
@@ -28,15 +30,22 @@
 #include "mapgui/mappainternav.h"
 #include "mapgui/mappainterroute.h"
 #include "mapgui/mapscale.h"
+#include "mapgui/maptilerenderer.h"
 #include "route/routecontroller.h"
 #include "options/optiondata.h"
+#include "geo/calculations.h"
+#include "settings/settings.h"
 
 #include <QElapsedTimer>
+#include <QThread>
+
+#include <cmath>
 
 #include <marble/GeoPainter.h>
 
 using namespace Marble;
 using namespace atools::geo;
+using atools::settings::Settings;
 
 MapPaintLayer::MapPaintLayer(MapWidget *widget, MapQuery *mapQueries)
   : mapQuery(mapQueries), mapWidget(widget)
@@ -54,6 +63,17 @@ MapPaintLayer::MapPaintLayer(MapWidget *widget, MapQuery *mapQueries)
   mapPainterRoute = new MapPainterRoute(mapWidget, mapQuery, mapScale, mapWidget->getRouteController());
   mapPainterAircraft = new MapPainterAircraft(mapWidget, mapQuery, mapScale);
 
+  // Marks and aircraft draw their texts directly
+  labelLayout = new MapLabelLayout();
+  mapPainterNav->setLabelLayout(labelLayout);
+  mapPainterAirport->setLabelLayout(labelLayout);
+  mapPainterRoute->setLabelLayout(labelLayout);
+
+  // Split drawing of the offscreen image into tiles on multi core machines
+  if(Settings::instance().getAndStoreValue(lnm::OPTIONS_MAP_TILED_RENDERING, false).toBool() &&
+     QThread::idealThreadCount() > 1)
+    tileRenderer = new MapTileRenderer(mapWidget, mapQuery, mapScale);
+
   // Default for visible object types
   objectTypes = maptypes::MapObjectTypes(
     maptypes::AIRPORT | maptypes::VOR | maptypes::NDB | maptypes::AP_ILS | maptypes::MARKER |
@@ -67,6 +87,8 @@ MapPaintLayer::~MapPaintLayer()
   delete mapPainterAirport;
   delete mapPainterMark;
   delete mapPainterRoute;
+  delete labelLayout;
+  delete tileRenderer;
 
   delete layers;
   delete mapScale;
@@ -80,6 +102,18 @@ void MapPaintLayer::preDatabaseLoad()
 void MapPaintLayer::postDatabaseLoad()
 {
   databaseLoadStatus = false;
+  overlayValid = false;
+
+  // Texts are cached by database id
+  clearTextCache();
+}
+
+void MapPaintLayer::clearTextCache()
+{
+  labelLayout->clearTextCache();
+  if(tileRenderer != nullptr)
+    tileRenderer->clearTextCache();
+  overlayValid = false;
 }
 
 void MapPaintLayer::setShowMapObjects(maptypes::MapObjectTypes type, bool show)
@@ -237,6 +271,9 @@ bool MapPaintLayer::render(GeoPainter *painter, ViewportParams *viewport,
   Q_UNUSED(renderPos);
   Q_UNUSED(layer);
 
+  // View or cached objects might change - screen coordinates are recalculated on next mouse lookup
+  mapQuery->invalidateScreenGrids();
+
   if(!databaseLoadStatus)
   {
     // Update map scale for screen distance approximation
@@ -279,29 +316,199 @@ bool MapPaintLayer::render(GeoPainter *painter, ViewportParams *viewport,
 
       context.symbolScale = OptionData::instance().getMapSymbolSize() / 100.f;
 
-      if(mapWidget->distance() < DISTANCE_CUT_OFF_LIMIT)
+      if(context.viewContext == Marble::Still)
       {
-        if(context.mapLayerEffective->isAirportDiagram())
+        int devicePixelRatio = painter->device()->devicePixelRatio();
+
+        OverlayKey key;
+        key.centerLonX = viewport->centerLongitude();
+        key.centerLatY = viewport->centerLatitude();
+        key.radius = viewport->radius();
+        key.devicePixelRatio = devicePixelRatio;
+        key.size = viewport->size();
+        key.projection = viewport->projection();
+        key.mapLayer = context.mapLayer;
+        key.mapLayerEffective = context.mapLayerEffective;
+        key.objectTypes = context.objectTypes;
+        key.drawFast = context.drawFast;
+        key.cutOff = mapWidget->distance() >= DISTANCE_CUT_OFF_LIMIT;
+
+        if(!overlayValid || !(key == overlayKey))
         {
-          // Put ILS below and navaids on top of airport diagram
-          mapPainterIls->render(&context);
-          mapPainterAirport->render(&context);
-          mapPainterNav->render(&context);
-        }
-        else
-        {
-          // Airports on top of all
-          mapPainterIls->render(&context);
-          mapPainterNav->render(&context);
-          mapPainterAirport->render(&context);
+          // View or content has changed - draw all into the offscreen image
+          QSize imageSize = viewport->size() * devicePixelRatio;
+          if(overlayImage.size() != imageSize)
+            overlayImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+          overlayImage.setDevicePixelRatio(devicePixelRatio);
+          overlayImage.fill(Qt::transparent);
+
+          GeoPainter overlayPainter(&overlayImage, viewport, mapWidget->mapQuality());
+          overlayPainter.setFont(context.defaultFontScaled);
+          context.painter = &overlayPainter;
+          renderOverlay(&context, &overlayImage);
+          overlayPainter.end();
+          context.painter = painter;
+
+          overlayKey = key;
+          overlayValid = true;
         }
+
+        // GeoPainter hides the QPainter overloads for screen coordinates
+        static_cast<QPainter *>(painter)->drawImage(QPoint(0, 0), overlayImage);
       }
-      mapPainterRoute->render(&context);
+      else
+      {
+        // Map is moving - no use in keeping the overlay
+        overlayValid = false;
+        renderOverlay(&context, nullptr);
+      }
+
       mapPainterMark->render(&context);
 
       mapPainterAircraft->render(&context);
+
+      // Load data for the next paint events in the background
+      prefetch(context);
     }
   }
 
   return true;
 }
+
+void MapPaintLayer::renderOverlay(const PaintContext *context, QImage *image)
+{
+  labelLayout->beginFrame(context->painter, context->viewport->size());
+
+  if(mapWidget->distance() < DISTANCE_CUT_OFF_LIMIT)
+  {
+    if(tileRenderer != nullptr && image != nullptr && !context->mapLayerEffective->isAirportDiagram())
+    {
+      // Airways are below all other objects - ILS, navaids and airports are drawn in parallel
+      mapPainterNav->renderAirways(context);
+      tileRenderer->render(context, image, labelLayout);
+    }
+    else if(context->mapLayerEffective->isAirportDiagram())
+    {
+      // Put ILS below and navaids on top of airport diagram
+      mapPainterIls->render(context);
+      mapPainterAirport->render(context);
+      mapPainterNav->render(context);
+    }
+    else
+    {
+      // Airports on top of all
+      mapPainterIls->render(context);
+      mapPainterNav->render(context);
+      mapPainterAirport->render(context);
+    }
+  }
+  mapPainterRoute->render(context);
+
+  // Labels on top of all symbols
+  labelLayout->drawLabels(context->painter);
+}
+
+bool MapPaintLayer::OverlayKey::operator==(const OverlayKey& other) const
+{
+  return centerLonX == other.centerLonX && centerLatY == other.centerLatY && radius == other.radius &&
+         devicePixelRatio == other.devicePixelRatio && size == other.size && projection == other.projection &&
+         mapLayer == other.mapLayer && mapLayerEffective == other.mapLayerEffective &&
+         objectTypes == other.objectTypes && drawFast == other.drawFast && cutOff == other.cutOff;
+}
+
+void MapPaintLayer::prefetch(const PaintContext& context)
+{
+  const GeoDataLatLonAltBox& box = context.viewport->viewLatLonAltBox();
+  double width = box.width(GeoDataCoordinates::Degree), height = box.height(GeoDataCoordinates::Degree);
+  double centerLonX = box.center().longitude(GeoDataCoordinates::Degree);
+  double centerLatY = box.center().latitude(GeoDataCoordinates::Degree);
+
+  // Same conditions as used by the painters
+  maptypes::MapObjectTypes types = maptypes::NONE;
+  if(mapWidget->distance() < DISTANCE_CUT_OFF_LIMIT)
+  {
+    const MapLayer *layer = context.mapLayer;
+    const maptypes::MapObjectTypes& shown = context.objectTypes;
+
+    if(layer->isAirport() && shown.testFlag(maptypes::AIRPORT))
+      types |= maptypes::AIRPORT;
+    if(layer->isAirway() && (shown.testFlag(maptypes::AIRWAYJ) || shown.testFlag(maptypes::AIRWAYV)))
+      types |= maptypes::AIRWAY | maptypes::WAYPOINT;
+    if(layer->isWaypoint() && shown.testFlag(maptypes::WAYPOINT))
+      types |= maptypes::WAYPOINT;
+    if(layer->isVor() && shown.testFlag(maptypes::VOR))
+      types |= maptypes::VOR;
+    if(layer->isNdb() && shown.testFlag(maptypes::NDB))
+      types |= maptypes::NDB;
+    if(layer->isMarker() && shown.testFlag(maptypes::ILS))
+      types |= maptypes::MARKER;
+    if(layer->isIls() && shown.testFlag(maptypes::ILS))
+      types |= maptypes::ILS;
+  }
+
+  QList<GeoDataLatLonBox> rects;
+  if(types != maptypes::NONE)
+  {
+    // Highest priority for the area where the view is moving to
+    if(lastCenterValid)
+    {
+      double moveLonX = std::remainder(centerLonX - lastCenterLonX, 360.) * PREFETCH_MOTION_FACTOR;
+      double moveLatY = (centerLatY - lastCenterLatY) * PREFETCH_MOTION_FACTOR;
+      if(std::abs(moveLonX) > 0. || std::abs(moveLatY) > 0.)
+      {
+        moveLonX = std::max(std::min(moveLonX, width), -width);
+        moveLatY = std::max(std::min(moveLatY, height), -height);
+        rects.append(prefetchRect(centerLonX + moveLonX, centerLatY + moveLatY, width, height));
+      }
+    }
+
+    // Border around the view
+    rects.append(prefetchRect(centerLonX, centerLatY, width * (1. + 2. * PREFETCH_BORDER_FACTOR),
+                              height * (1. + 2. * PREFETCH_BORDER_FACTOR)));
+
+    // Flight plan legs close to the view
+    if(context.objectTypes.testFlag(maptypes::ROUTE))
+    {
+      const RouteMapObjectList& routeMapObjects = mapWidget->getRouteController()->getRouteMapObjects();
+      Pos center(static_cast<float>(centerLonX), static_cast<float>(centerLatY));
+      float range = static_cast<float>(std::max(width, height) * PREFETCH_ROUTE_FACTOR);
+      float step = static_cast<float>(std::max(width, height) / 2.);
+
+      for(int i = 1; i < routeMapObjects.size(); i++)
+      {
+        const Pos& p1 = routeMapObjects.at(i - 1).getPosition(), &p2 = routeMapObjects.at(i).getPosition();
+        float distanceMeter = p1.distanceMeterTo(p2);
+
+        // Sample leg in steps of half a view size - distance in degree is only a rough approximation
+        int numSteps = std::max(1, static_cast<int>(std::ceil(meterToNm(distanceMeter) / 60.f / step)));
+        for(int j = 0; j <= numSteps; j++)
+        {
+          Pos pos = p1.interpolate(p2, distanceMeter, static_cast<float>(j) / numSteps);
+          if(std::abs(pos.getLatY() - center.getLatY()) < range &&
+             std::abs(std::remainder(pos.getLonX() - center.getLonX(), 360.f)) < range)
+            rects.append(prefetchRect(pos.getLonX(), pos.getLatY(), step, step));
+        }
+      }
+    }
+  }
+
+  // Tiles that are already cached or requested are ignored
+  mapQuery->prefetch(box, rects, types, context.mapLayer);
+
+  lastCenterLonX = centerLonX;
+  lastCenterLatY = centerLatY;
+  lastCenterValid = true;
+}
+
+GeoDataLatLonBox MapPaintLayer::prefetchRect(double centerLonX, double centerLatY, double width,
+                                             double height)
+{
+  double north = std::min(centerLatY + height / 2., 90.), south = std::max(centerLatY - height / 2., -90.);
+  if(width >= 360.)
+    return GeoDataLatLonBox(north, south, 180., -180., GeoDataCoordinates::Degree);
+
+  // East is smaller than west if the rectangle crosses the anti-meridian
+  double east = std::remainder(centerLonX + width / 2., 360.);
+  double west = std::remainder(centerLonX - width / 2., 360.);
+  return GeoDataLatLonBox(north, south, east, west, GeoDataCoordinates::Degree);
+}
@@ -20,8 +20,11 @@
 
 #include "mapgui/mappainter.h"
 
+#include <QImage>
 #include <QPen>
 
+#include <marble/GeoDataLatLonBox.h>
+
 #include <marble/LayerInterface.h>
 
 namespace Marble {
@@ -41,10 +44,20 @@ class MapPainterIls;
 class MapPainterMark;
 class MapPainterRoute;
 class MapPainterAircraft;
+class MapLabelLayout;
+class MapTileRenderer;
 
 /*
  * Implements the Marble layer interface that paints upon the Marble map. Contains all painter instances
  * and calls them in order for each paint event.
+ *
+ * Airports, navaids, airways and the flight plan are retained in an offscreen image while the map is not
+ * moving. The image is reused as long as the viewport and the shown objects do not change. Marks and the
+ * user aircraft are drawn on top for each paint event.
+ *
+ * Texts of the overlay painters are collected and placed by priority after all symbols are drawn.
+ *
+ * Optionally ILS, navaids and airports of the offscreen image are drawn in parallel tiles.
  */
 class MapPaintLayer :
   public Marble::LayerInterface
@@ -81,6 +94,16 @@ public:
     return objectTypes;
   }
 
+  /* Repaint airports, navaids and flight plan on next paint event. Call if the content of these layers
+   * changed without a change of the view, e.g. after loading missing objects or changing the route. */
+  void invalidateOverlay()
+  {
+    overlayValid = false;
+  }
+
+  /* Drop cached label texts. Call if fonts or text related options have changed. */
+  void clearTextCache();
+
   /* Get the map scale that allows simple distance approximations for screen coordinates */
   const MapScale *getMapScale() const
   {
@@ -88,9 +111,36 @@ public:
   }
 
 private:
+  /* Identifies the content of the retained overlay image */
+  struct OverlayKey
+  {
+    double centerLonX = 0., centerLatY = 0.;
+    int radius = 0, devicePixelRatio = 1;
+    QSize size;
+    Marble::Projection projection = Marble::VerticalPerspective;
+    const MapLayer *mapLayer = nullptr, *mapLayerEffective = nullptr;
+    maptypes::MapObjectTypes objectTypes;
+    bool drawFast = false, cutOff = false;
+
+    bool operator==(const OverlayKey& other) const;
+
+  };
+
   void initMapLayerSettings();
   void updateLayers();
 
+  /* Draw airports, navaids, airways and flight plan. Marks and aircraft are excluded.
+   * image is the paint device of context->painter or null if drawing directly into the widget. */
+  void renderOverlay(const PaintContext *context, QImage *image);
+
+  /* Send tiles around the view, in direction of the last movement and along the flight plan to the
+   * background prefetch worker */
+  void prefetch(const PaintContext& context);
+
+  /* Rectangle with the given center and size. Clamped at the poles and wrapped at the anti-meridian. */
+  static Marble::GeoDataLatLonBox prefetchRect(double centerLonX, double centerLatY, double width,
+                                               double height);
+
   /* Implemented from LayerInterface: We  draw above all but below user tools */
   virtual QStringList renderPosition() const override
   {
@@ -104,6 +154,16 @@ private:
   /* Do not show anything at all above this zoom distance */
   static Q_DECL_CONSTEXPR float DISTANCE_CUT_OFF_LIMIT = 4000.f;
 
+  /* Prefetch a border of this size relative to the view size around the view */
+  static Q_DECL_CONSTEXPR double PREFETCH_BORDER_FACTOR = 0.5;
+
+  /* Prefetch a view shifted by this factor times the movement since the last paint event.
+   * Limited to one view size. */
+  static Q_DECL_CONSTEXPR double PREFETCH_MOTION_FACTOR = 4.;
+
+  /* Prefetch flight plan legs within this distance relative to the view size from the view center */
+  static Q_DECL_CONSTEXPR double PREFETCH_ROUTE_FACTOR = 1.5;
+
   /* Map objects currently shown */
   maptypes::MapObjectTypes objectTypes;
 
@@ -120,6 +180,12 @@ private:
   MapPainterRoute *mapPainterRoute;
   MapPainterAircraft *mapPainterAircraft;
 
+  /* Removes overlapping airport, navaid and flight plan labels */
+  MapLabelLayout *labelLayout;
+
+  /* Draws into the offscreen image using all cores. Null if disabled. */
+  MapTileRenderer *tileRenderer = nullptr;
+
   /* Database source */
   MapQuery *mapQuery = nullptr;
 
@@ -128,6 +194,15 @@ private:
   MapWidget *mapWidget = nullptr;
   const MapLayer *mapLayer = nullptr, *mapLayerEffective = nullptr;
 
+  /* Offscreen image and key for airports, navaids, airways and flight plan */
+  QImage overlayImage;
+  OverlayKey overlayKey;
+  bool overlayValid = false;
+
+  /* View center of the last paint event in degree used to detect movement */
+  double lastCenterLonX = 0., lastCenterLatY = 0.;
+  bool lastCenterValid = false;
+
 };
 
 #endif // LITTLENAVMAP_MAPPAINTLAYER_H
@@ -0,0 +1,104 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mapgui/mapprefetchworker.h"
+
+#include "mapgui/maplayer.h"
+#include "sql/sqldatabase.h"
+#include "exception.h"
+
+
+using atools::sql::SqlDatabase;
+
+MapPrefetchWorker::MapPrefetchWorker()
+{
+}
+
+MapPrefetchWorker::~MapPrefetchWorker()
+{
+  delete mapQuery;
+
+  if(db != nullptr)
+  {
+    db->close();
+    delete db;
+    SqlDatabase::removeDatabase(DATABASE_NAME);
+  }
+}
+
+void MapPrefetchWorker::initDatabase(const QString& databaseName)
+{
+  try
+  {
+    if(db == nullptr)
+      db = new SqlDatabase(SqlDatabase::addDatabase(DATABASE_TYPE, DATABASE_NAME));
+
+    qDebug() << "Map prefetch opening database" << databaseName;
+    db->setDatabaseName(databaseName);
+    db->open();
+
+    if(mapQuery == nullptr)
+      // Never started prefetch itself
+      mapQuery = new MapQuery(nullptr, db);
+    mapQuery->initQueries();
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << "Map prefetch cannot open database" << e.what();
+  }
+}
+
+void MapPrefetchWorker::deInitDatabase()
+{
+  if(mapQuery != nullptr)
+    mapQuery->deInitQueries();
+
+  if(db != nullptr && db->isOpen())
+    db->close();
+}
+
+void MapPrefetchWorker::loadTiles(const mq::PrefetchRequest& request)
+{
+  QList<MapQuery::TileData> tileData;
+
+  if(mapQuery != nullptr && db->isOpen())
+  {
+    // Only parameters that are used by the airport queries
+    MapLayer mapLayer(0.f);
+    mapLayer.airportSource(request.airportSource).minRunwayLength(request.minRunwayLength);
+
+    try
+    {
+      for(const MapQuery::PrefetchTile& tile : request.tiles)
+      {
+        if(!request.visible && request.requestId < latestPrefetchId.load())
+          // View has moved - remaining tiles are requested again if still needed
+          break;
+
+        MapQuery::TileData data;
+        mapQuery->loadTile(tile.key, tile.types, &mapLayer, data);
+        tileData.append(data);
+      }
+    }
+    catch(atools::Exception& e)
+    {
+      qWarning() << "Map prefetch failed" << e.what();
+    }
+  }
+
+  emit tilesLoaded(request.requestId, tileData);
+}
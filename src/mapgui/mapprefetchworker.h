@@ -0,0 +1,95 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPPREFETCHWORKER_H
+#define LITTLENAVMAP_MAPPREFETCHWORKER_H
+
+#include "mapgui/mapquery.h"
+
+#include <QAtomicInt>
+#include <QObject>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+}
+}
+
+namespace mq {
+/* Tiles that are passed to the prefetch worker */
+struct PrefetchRequest
+{
+  int requestId;
+  QVector<MapQuery::PrefetchTile> tiles;
+
+  /* Map layer parameters needed to load airports */
+  layer::AirportSource airportSource;
+  int minRunwayLength;
+
+  /* Tiles are missing in the current view. Not skipped by newer requests. */
+  bool visible;
+};
+
+}
+
+Q_DECLARE_METATYPE(mq::PrefetchRequest);
+Q_DECLARE_METATYPE(QList<MapQuery::TileData>);
+
+/*
+ * Loads map object tiles in a separate thread ahead of time. Owns an own database connection and map query
+ * which are used only in the worker thread. Move the object to a thread and call the Q_INVOKABLE methods
+ * using a queued connection. Loaded tiles are sent back using a signal and added to the caches of the
+ * map query in the GUI thread.
+ */
+class MapPrefetchWorker :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  MapPrefetchWorker();
+  virtual ~MapPrefetchWorker();
+
+  /* Open own connection to the given database file and prepare queries */
+  Q_INVOKABLE void initDatabase(const QString& databaseName);
+
+  /* Close database connection */
+  Q_INVOKABLE void deInitDatabase();
+
+  /* Load all tiles of the request and emit tilesLoaded. Stops early if a newer prefetch request was sent. */
+  Q_INVOKABLE void loadTiles(const mq::PrefetchRequest& request);
+
+  /* Id of the newest prefetch request. Older ones that are not visible are skipped. Thread safe. */
+  void setLatestPrefetchId(int requestId)
+  {
+    latestPrefetchId.store(requestId);
+  }
+
+signals:
+  /* Loaded tiles of a request. Can contain less tiles than requested. */
+  void tilesLoaded(int requestId, QList<MapQuery::TileData> tileData);
+
+private:
+  atools::sql::SqlDatabase *db = nullptr;
+  MapQuery *mapQuery = nullptr;
+  QAtomicInt latestPrefetchId;
+
+  const QString DATABASE_NAME = "LNMDB_PREFETCH";
+  const QString DATABASE_TYPE = "QSQLITE";
+};
+
+#endif // LITTLENAVMAP_MAPPREFETCHWORKER_H
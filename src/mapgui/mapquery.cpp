@@ -18,8 +18,16 @@
 #include "mapgui/mapquery.h"
 
 #include "common/maptypesfactory.h"
+#include "mapgui/mapprefetchworker.h"
+#include "mapgui/maplodbuilder.h"
+#include "db/spatialindexbuilder.h"
 #include "sql/sqlquery.h"
 #include "common/maptools.h"
+#include "common/coordinateconverter.h"
+
+#include <QThread>
+
+#include <cmath>
 
 using namespace Marble;
 using namespace atools::sql;
@@ -32,16 +40,24 @@ using maptypes::MapMarker;
 using maptypes::MapIls;
 using maptypes::MapParking;
 using maptypes::MapHelipad;
+using maptypes::MapAirway;
 
 MapQuery::MapQuery(QObject *parent, atools::sql::SqlDatabase *sqlDb)
   : QObject(parent), db(sqlDb)
 {
   mapTypesFactory = new MapTypesFactory();
+  diagramCache.setMaxCost(DIAGRAM_CACHE_SIZE_KB);
 }
 
 MapQuery::~MapQuery()
 {
   deInitQueries();
+
+  if(prefetchThread != nullptr)
+  {
+    prefetchThread->quit();
+    prefetchThread->wait();
+  }
   delete mapTypesFactory;
 }
 
@@ -209,418 +225,464 @@ void MapQuery::getNearestObjects(const CoordinateConverter& conv, const MapLayer
   using maptools::insertSortedByDistance;
   using maptools::insertSortedByTowerDistance;
 
-  int x, y;
+  // Only objects close to xs/ys are taken from the screen grids. Objects are traversed in reverse order.
+  QVector<int> indexes;
   if(mapLayer->isAirport() && types.testFlag(maptypes::AIRPORT))
   {
-    for(int i = airportCache.list.size() - 1; i >= 0; i--)
-    {
-      const MapAirport& airport = airportCache.list.at(i);
+    updateScreenGrid(conv, airportCache.list, airportGrid, [](const MapAirport& airport) -> const Pos &
+                     {
+                       return airport.position;
+                     });
 
+    airportGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
+    {
+      const MapAirport& airport = airportCache.list.at(indexes.at(i));
       if(airport.isVisible(types))
+        insertSortedByDistance(conv, result.airports, &result.airportIds, xs, ys, airport);
+    }
+
+    if(airportDiagram)
+    {
+      // Include tower for airport diagrams
+      updateScreenGrid(conv, airportCache.list, towerGrid, [](const MapAirport& airport) -> const Pos &
+                       {
+                         return airport.towerCoords;
+                       });
+
+      towerGrid.getNearest(xs, ys, screenDistance, indexes);
+      for(int i = indexes.size() - 1; i >= 0; i--)
       {
-        if(conv.wToS(airport.position, x, y))
-          if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-            insertSortedByDistance(conv, result.airports, &result.airportIds, xs, ys, airport);
-
-        if(airportDiagram)
-        {
-          // Include tower for airport diagrams
-          if(conv.wToS(airport.towerCoords, x, y) &&
-             atools::geo::manhattanDistance(x, y, xs, ys) < screenDistance)
-            insertSortedByTowerDistance(conv, result.towers, xs, ys, airport);
-        }
+        const MapAirport& airport = airportCache.list.at(indexes.at(i));
+        if(airport.isVisible(types))
+          insertSortedByTowerDistance(conv, result.towers, xs, ys, airport);
       }
     }
   }
 
   if(mapLayer->isVor() && types.testFlag(maptypes::VOR))
   {
-    for(int i = vorCache.list.size() - 1; i >= 0; i--)
-    {
-      const MapVor& vor = vorCache.list.at(i);
-      if(conv.wToS(vor.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.vors, &result.vorIds, xs, ys, vor);
-    }
+    updateScreenGrid(conv, vorCache.list, vorGrid, positionOf<MapVor>);
+    vorGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
+      insertSortedByDistance(conv, result.vors, &result.vorIds, xs, ys, vorCache.list.at(indexes.at(i)));
   }
 
   if(mapLayer->isNdb() && types.testFlag(maptypes::NDB))
   {
-    for(int i = ndbCache.list.size() - 1; i >= 0; i--)
-    {
-      const MapNdb& ndb = ndbCache.list.at(i);
-      if(conv.wToS(ndb.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.ndbs, &result.ndbIds, xs, ys, ndb);
-    }
+    updateScreenGrid(conv, ndbCache.list, ndbGrid, positionOf<MapNdb>);
+    ndbGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
+      insertSortedByDistance(conv, result.ndbs, &result.ndbIds, xs, ys, ndbCache.list.at(indexes.at(i)));
   }
 
   if(mapLayer->isWaypoint() && types.testFlag(maptypes::WAYPOINT))
   {
-    for(int i = waypointCache.list.size() - 1; i >= 0; i--)
-    {
-      const MapWaypoint& wp = waypointCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys, wp);
-    }
+    updateScreenGrid(conv, waypointCache.list, waypointGrid, positionOf<MapWaypoint>);
+    waypointGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
+      insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys,
+                             waypointCache.list.at(indexes.at(i)));
   }
 
   if(mapLayer->isAirway())
   {
-    for(int i = waypointCache.list.size() - 1; i >= 0; i--)
+    updateScreenGrid(conv, waypointCache.list, waypointGrid, positionOf<MapWaypoint>);
+    waypointGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
     {
-      const MapWaypoint& wp = waypointCache.list.at(i);
+      const MapWaypoint& wp = waypointCache.list.at(indexes.at(i));
       if((wp.hasVictorAirways && types.testFlag(maptypes::AIRWAYV)) ||
          (wp.hasJetAirways && types.testFlag(maptypes::AIRWAYJ)))
-        if(conv.wToS(wp.position, x, y))
-          if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-            insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys, wp);
+        insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys, wp);
     }
   }
 
   if(mapLayer->isMarker() && types.testFlag(maptypes::MARKER))
   {
-    for(int i = markerCache.list.size() - 1; i >= 0; i--)
-    {
-      const MapMarker& wp = markerCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.markers, nullptr, xs, ys, wp);
-    }
+    updateScreenGrid(conv, markerCache.list, markerGrid, positionOf<MapMarker>);
+    markerGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
+      insertSortedByDistance(conv, result.markers, nullptr, xs, ys, markerCache.list.at(indexes.at(i)));
   }
 
   if(mapLayer->isIls() && types.testFlag(maptypes::ILS))
   {
-    for(int i = ilsCache.list.size() - 1; i >= 0; i--)
-    {
-      const MapIls& wp = ilsCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.ils, nullptr, xs, ys, wp);
-    }
+    updateScreenGrid(conv, ilsCache.list, ilsGrid, positionOf<MapIls>);
+    ilsGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int i = indexes.size() - 1; i >= 0; i--)
+      insertSortedByDistance(conv, result.ils, nullptr, xs, ys, ilsCache.list.at(indexes.at(i)));
   }
 
   if(airportDiagram)
   {
     // Also check parking and helipads in airport diagrams
-    for(int id : parkingCache.keys())
+    if(!parkingGrid.isValid())
     {
-      QList<MapParking> *parkings = parkingCache.object(id);
-      for(const MapParking& p : *parkings)
-      {
-        if(conv.wToS(p.position, x, y) && atools::geo::manhattanDistance(x, y, xs, ys) < screenDistance)
-          insertSortedByDistance(conv, result.parkings, nullptr, xs, ys, p);
-      }
+      // Collect all cached parking spots into one list
+      gridParkings.clear();
+      for(int id : diagramCache.keys())
+        gridParkings.append(diagramCache.object(id)->parkings.toList());
     }
+    updateScreenGrid(conv, gridParkings, parkingGrid, positionOf<MapParking>);
+    parkingGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int index : indexes)
+      insertSortedByDistance(conv, result.parkings, nullptr, xs, ys, gridParkings.at(index));
 
-    for(int id : helipadCache.keys())
+    if(!helipadGrid.isValid())
     {
-      QList<MapHelipad> *helipads = helipadCache.object(id);
-      for(const MapHelipad& p : *helipads)
-      {
-        if(conv.wToS(p.position, x, y) && atools::geo::manhattanDistance(x, y, xs, ys) < screenDistance)
-          insertSortedByDistance(conv, result.helipads, nullptr, xs, ys, p);
-      }
+      gridHelipads.clear();
+      for(int id : diagramCache.keys())
+        gridHelipads.append(diagramCache.object(id)->helipads.toList());
     }
+    updateScreenGrid(conv, gridHelipads, helipadGrid, positionOf<MapHelipad>);
+    helipadGrid.getNearest(xs, ys, screenDistance, indexes);
+    for(int index : indexes)
+      insertSortedByDistance(conv, result.helipads, nullptr, xs, ys, gridHelipads.at(index));
   }
+
+  // Names are needed for tooltips and information - objects from the cache lists have none
+  for(MapAirport& airport : result.airports)
+    fillName(airport);
+  for(MapAirport& airport : result.towers)
+    fillName(airport);
+  for(MapVor& vor : result.vors)
+    fillName(vor);
+  for(MapNdb& ndb : result.ndbs)
+    fillName(ndb);
 }
 
-const QList<maptypes::MapAirport> *MapQuery::getAirports(const Marble::GeoDataLatLonBox& rect,
-                                                         const MapLayer *mapLayer, bool lazy)
+void MapQuery::fillName(maptypes::MapAirport& airport) const
 {
-  airportCache.updateCache(rect, mapLayer, lazy);
+  if(airport.name.isEmpty())
+    airport.name = airportCache.name(airport.id);
+}
 
-  switch(mapLayer->getDataSource())
-  {
-    case layer::ALL:
-      airportByRectQuery->bindValue(":minlength", mapLayer->getMinRunwayLength());
-      return fetchAirports(rect, airportByRectQuery, true /* reverse */, lazy, false /* overview */);
+void MapQuery::fillName(maptypes::MapVor& vor) const
+{
+  if(vor.name.isEmpty())
+    vor.name = vorCache.name(vor.id);
+}
 
-    case layer::MEDIUM:
-      // Airports > 4000 ft
-      return fetchAirports(rect, airportMediumByRectQuery, false /* reverse */, lazy, true /* overview */);
+void MapQuery::fillName(maptypes::MapNdb& ndb) const
+{
+  if(ndb.name.isEmpty())
+    ndb.name = ndbCache.name(ndb.id);
+}
 
-    case layer::LARGE:
-      // Airports > 8000 ft
-      return fetchAirports(rect, airportLargeByRectQuery, false /* reverse */, lazy, true /* overview */);
+void MapQuery::invalidateScreenGrids()
+{
+  airportGrid.invalidate();
+  towerGrid.invalidate();
+  vorGrid.invalidate();
+  ndbGrid.invalidate();
+  waypointGrid.invalidate();
+  markerGrid.invalidate();
+  ilsGrid.invalidate();
+  parkingGrid.invalidate();
+  helipadGrid.invalidate();
+}
+
+/* Fill grid with screen coordinates of all visible objects if it is outdated */
+template<typename TYPE, typename POSFUNC>
+void MapQuery::updateScreenGrid(const CoordinateConverter& conv, const QList<TYPE>& list, MapScreenGrid& grid,
+                                POSFUNC position)
+{
+  if(grid.isValid())
+    return;
 
+  grid.clear();
+  int x, y;
+  for(int i = 0; i < list.size(); i++)
+  {
+    if(conv.wToS(position(list.at(i)), x, y))
+      grid.addPoint(i, x, y);
   }
-  return nullptr;
+  grid.finish();
+}
+
+const QList<maptypes::MapAirport> *MapQuery::getAirports(const Marble::GeoDataLatLonBox& rect,
+                                                         const MapLayer *mapLayer, bool lazy)
+{
+  auto loader = [this, mapLayer](const GeoDataLatLonBox& r, int level, QList<MapAirport>& airports) -> void
+                {
+                  loadAirports(r, level, mapLayer, airports);
+                };
+
+  if(airportCache.updateCache(rect, mapLayer->getQueryParameterKey(), lazy, loader))
+    checkOverflow(airportCache, maptypes::AIRPORT, !isAirportLod(mapLayer));
+  requestMissingTiles(airportCache, maptypes::AIRPORT, mapLayer);
+  return &airportCache.list;
 }
 
 const QList<maptypes::MapWaypoint> *MapQuery::getWaypoints(const GeoDataLatLonBox& rect,
                                                            const MapLayer *mapLayer, bool lazy)
 {
-  waypointCache.updateCache(rect, mapLayer, lazy);
-
-  if(waypointCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, waypointsByRectQuery);
-      waypointsByRectQuery->exec();
-      while(waypointsByRectQuery->next())
-      {
-        maptypes::MapWaypoint wp;
-        mapTypesFactory->fillWaypoint(waypointsByRectQuery->record(), wp);
-        waypointCache.list.append(wp);
-      }
-    }
-    checkOverflow(waypointCache.list, maptypes::WAYPOINT);
-  }
+  auto loader = [this](const GeoDataLatLonBox& r, int level, QList<MapWaypoint>& waypoints) -> void
+                {
+                  loadWaypoints(r, level, waypoints);
+                };
+
+  if(waypointCache.updateCache(rect, 0, lazy, loader))
+    checkOverflow(waypointCache, maptypes::WAYPOINT, !lodTypes.testFlag(maptypes::WAYPOINT));
+  requestMissingTiles(waypointCache, maptypes::WAYPOINT, mapLayer);
   return &waypointCache.list;
 }
 
 const QList<maptypes::MapVor> *MapQuery::getVors(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                                                  bool lazy)
 {
-  vorCache.updateCache(rect, mapLayer, lazy);
-
-  if(vorCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, vorsByRectQuery);
-      vorsByRectQuery->exec();
-      while(vorsByRectQuery->next())
-      {
-        maptypes::MapVor vor;
-        mapTypesFactory->fillVor(vorsByRectQuery->record(), vor);
-        vorCache.list.append(vor);
-      }
-    }
-    checkOverflow(vorCache.list, maptypes::VOR);
-  }
+  auto loader = [this](const GeoDataLatLonBox& r, int level, QList<MapVor>& vors) -> void
+                {
+                  loadVors(r, level, vors);
+                };
+
+  if(vorCache.updateCache(rect, 0, lazy, loader))
+    checkOverflow(vorCache, maptypes::VOR, !lodTypes.testFlag(maptypes::VOR));
+  requestMissingTiles(vorCache, maptypes::VOR, mapLayer);
   return &vorCache.list;
 }
 
 const QList<maptypes::MapNdb> *MapQuery::getNdbs(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                                                  bool lazy)
 {
-  ndbCache.updateCache(rect, mapLayer, lazy);
-
-  if(ndbCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, ndbsByRectQuery);
-      ndbsByRectQuery->exec();
-      while(ndbsByRectQuery->next())
-      {
-        maptypes::MapNdb ndb;
-        mapTypesFactory->fillNdb(ndbsByRectQuery->record(), ndb);
-        ndbCache.list.append(ndb);
-      }
-    }
-    checkOverflow(ndbCache.list, maptypes::NDB);
-  }
+  auto loader = [this](const GeoDataLatLonBox& r, int level, QList<MapNdb>& ndbs) -> void
+                {
+                  loadNdbs(r, level, ndbs);
+                };
+
+  if(ndbCache.updateCache(rect, 0, lazy, loader))
+    checkOverflow(ndbCache, maptypes::NDB, !lodTypes.testFlag(maptypes::NDB));
+  requestMissingTiles(ndbCache, maptypes::NDB, mapLayer);
   return &ndbCache.list;
 }
 
 const QList<maptypes::MapMarker> *MapQuery::getMarkers(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                                                        bool lazy)
 {
-  markerCache.updateCache(rect, mapLayer, lazy);
+  auto loader = [this](const GeoDataLatLonBox& r, int, QList<MapMarker>& markers) -> void
+                {
+                  loadMarkers(r, markers);
+                };
 
-  if(markerCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, markersByRectQuery);
-      markersByRectQuery->exec();
-      while(markersByRectQuery->next())
-      {
-        maptypes::MapMarker marker;
-        mapTypesFactory->fillMarker(markersByRectQuery->record(), marker);
-        markerCache.list.append(marker);
-      }
-    }
-  }
+  markerCache.updateCache(rect, 0, lazy, loader);
+  requestMissingTiles(markerCache, maptypes::MARKER, mapLayer);
   return &markerCache.list;
 }
 
 const QList<maptypes::MapIls> *MapQuery::getIls(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                                                 bool lazy)
 {
-  ilsCache.updateCache(rect, mapLayer, lazy);
+  auto loader = [this](const GeoDataLatLonBox& r, int, QList<MapIls>& ilsList) -> void
+                {
+                  loadIls(r, ilsList);
+                };
 
-  if(ilsCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, ilsByRectQuery);
-      ilsByRectQuery->exec();
-      while(ilsByRectQuery->next())
-      {
-        maptypes::MapIls ils;
-        mapTypesFactory->fillIls(ilsByRectQuery->record(), ils);
-        ilsCache.list.append(ils);
-      }
-    }
-  }
+  ilsCache.updateCache(rect, 0, lazy, loader);
+  requestMissingTiles(ilsCache, maptypes::ILS, mapLayer);
   return &ilsCache.list;
 }
 
 const QList<maptypes::MapAirway> *MapQuery::getAirways(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                                                        bool lazy)
 {
-  airwayCache.updateCache(rect, mapLayer, lazy);
-
-  if(airwayCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, airwayByRectQuery);
-      airwayByRectQuery->exec();
-      while(airwayByRectQuery->next())
-      {
-        maptypes::MapAirway airway;
-        mapTypesFactory->fillAirway(airwayByRectQuery->record(), airway);
-        airwayCache.list.append(airway);
-      }
-    }
-    checkOverflow(airwayCache.list, maptypes::AIRWAY);
-  }
+  // Airways overlapping several tiles are loaded for each tile but added only once to the list
+  auto loader = [this](const GeoDataLatLonBox& r, int, QList<MapAirway>& airways) -> void
+                {
+                  loadAirways(r, airways);
+                };
+
+  if(airwayCache.updateCache(rect, 0, lazy, loader))
+    checkOverflow(airwayCache, maptypes::AIRWAY, true);
+  requestMissingTiles(airwayCache, maptypes::AIRWAY, mapLayer);
   return &airwayCache.list;
 }
 
 /*
- * Get airport cache
- * @param reverse reverse order of airports to have unimportant small ones below in painting order
- * @param lazy do not update cache - instead return incomplete resut
- * @param overview fetch only incomplete data for overview airports
- * @return pointer to the airport cache
+ * Load airports for one tile depending on the airport source of the map layer.
+ * Airports from the full table are added in reverse order to have unimportant small ones below in
+ * painting order. Order is kept only within each tile.
  */
-const QList<maptypes::MapAirport> *MapQuery::fetchAirports(const Marble::GeoDataLatLonBox& rect,
-                                                           atools::sql::SqlQuery *query, bool reverse,
-                                                           bool lazy, bool overview)
+void MapQuery::loadAirports(const Marble::GeoDataLatLonBox& rect, int level, const MapLayer *mapLayer,
+                            QList<maptypes::MapAirport>& airports)
 {
-  if(airportCache.list.isEmpty() && !lazy)
+  SqlQuery *query = nullptr;
+  bool overview = true, reverse = false;
+  switch(mapLayer->getDataSource())
   {
-    for(const GeoDataLatLonBox& r : splitAtAntiMeridian(rect))
-    {
-      bindCoordinatePointInRect(r, query);
-      query->exec();
-      while(query->next())
+    case layer::ALL:
+      if(isAirportLod(mapLayer))
       {
-        maptypes::MapAirport ap;
-        if(overview)
-          // Fill only a part of the object
-          mapTypesFactory->fillAirportForOverview(query->record(), ap);
-        else
-          mapTypesFactory->fillAirport(query->record(), ap, true);
-
-        if(reverse)
-          airportCache.list.prepend(ap);
-        else
-          airportCache.list.append(ap);
+        bindLodLevels(airportLodByRectQuery, level);
+        query = airportLodByRectQuery;
       }
-    }
-    checkOverflow(airportCache.list, maptypes::AIRPORT);
+      else
+      {
+        airportByRectQuery->bindValue(":minlength", mapLayer->getMinRunwayLength());
+        query = airportByRectQuery;
+      }
+      overview = false;
+      reverse = true;
+      break;
+
+    case layer::MEDIUM:
+      // Airports > 4000 ft
+      query = airportMediumByRectQuery;
+      break;
+
+    case layer::LARGE:
+      // Airports > 8000 ft
+      query = airportLargeByRectQuery;
+      break;
   }
-  return &airportCache.list;
-}
 
-const QList<maptypes::MapRunway> *MapQuery::getRunwaysForOverview(int airportId)
-{
-  if(runwayOverwiewCache.contains(airportId))
-    return runwayOverwiewCache.object(airportId);
-  else
-  {
-    using atools::geo::Pos;
+  if(query == nullptr)
+    return;
 
-    runwayOverviewQuery->bindValue(":airportId", airportId);
-    runwayOverviewQuery->exec();
+  // Each query has its own column indexes
+  MapTypesColumns& columns = query == airportByRectQuery || query == airportLodByRectQuery ? airportColumns :
+                             (query == airportMediumByRectQuery ? airportMediumColumns : airportLargeColumns);
 
-    QList<maptypes::MapRunway> *rws = new QList<maptypes::MapRunway>;
-    while(runwayOverviewQuery->next())
-    {
-      maptypes::MapRunway runway;
-      mapTypesFactory->fillRunway(runwayOverviewQuery->record(), runway, true);
-      rws->append(runway);
-    }
-    runwayOverwiewCache.insert(airportId, rws);
-    return rws;
+  bindCoordinatePointInRect(rect, query);
+  query->exec();
+  while(query->next())
+  {
+    maptypes::MapAirport ap;
+    if(overview)
+      // Fill only a part of the object
+      mapTypesFactory->fillAirportForOverview(*query, columns, ap);
+    else
+      mapTypesFactory->fillAirport(*query, columns, ap);
+
+    if(reverse)
+      airports.prepend(ap);
+    else
+      airports.append(ap);
   }
 }
 
-const QList<maptypes::MapApron> *MapQuery::getAprons(int airportId)
+void MapQuery::loadWaypoints(const Marble::GeoDataLatLonBox& rect, int level,
+                             QList<maptypes::MapWaypoint>& waypoints)
 {
-  if(apronCache.contains(airportId))
-    return apronCache.object(airportId);
-  else
+  bindCoordinatePointInRect(rect, waypointsByRectQuery);
+  if(lodTypes.testFlag(maptypes::WAYPOINT))
+    bindLodLevels(waypointsByRectQuery, level);
+  waypointsByRectQuery->exec();
+  while(waypointsByRectQuery->next())
   {
-    apronQuery->bindValue(":airportId", airportId);
-    apronQuery->exec();
-
-    QList<maptypes::MapApron> *aps = new QList<maptypes::MapApron>;
-    while(apronQuery->next())
-    {
-      maptypes::MapApron ap;
-
-      ap.surface = apronQuery->value("surface").toString();
-      ap.drawSurface = apronQuery->value("is_draw_surface").toInt() > 0;
+    maptypes::MapWaypoint wp;
+    mapTypesFactory->fillWaypoint(*waypointsByRectQuery, waypointColumns, wp);
+    waypoints.append(wp);
+  }
+}
 
-      // Decode vertices into a position list
-      QString vertices = apronQuery->value("vertices").toString();
-      QStringList vertexList = vertices.split(",");
-      for(QString vertex : vertexList)
-      {
-        QStringList ordinates = vertex.split(" ", QString::SkipEmptyParts);
+void MapQuery::loadVors(const Marble::GeoDataLatLonBox& rect, int level, QList<maptypes::MapVor>& vors)
+{
+  bindCoordinatePointInRect(rect, vorsByRectQuery);
+  if(lodTypes.testFlag(maptypes::VOR))
+    bindLodLevels(vorsByRectQuery, level);
+  vorsByRectQuery->exec();
+  while(vorsByRectQuery->next())
+  {
+    maptypes::MapVor vor;
+    mapTypesFactory->fillVor(*vorsByRectQuery, vorColumns, vor);
+    vors.append(vor);
+  }
+}
 
-        if(ordinates.size() == 2)
-          // Skip any invalid parts (should not happen since data is checked in the converter)
-          ap.vertices.append(ordinates.at(0).toFloat(), ordinates.at(1).toFloat());
-      }
-      aps->append(ap);
-    }
-    apronCache.insert(airportId, aps);
-    return aps;
+void MapQuery::loadNdbs(const Marble::GeoDataLatLonBox& rect, int level, QList<maptypes::MapNdb>& ndbs)
+{
+  bindCoordinatePointInRect(rect, ndbsByRectQuery);
+  if(lodTypes.testFlag(maptypes::NDB))
+    bindLodLevels(ndbsByRectQuery, level);
+  ndbsByRectQuery->exec();
+  while(ndbsByRectQuery->next())
+  {
+    maptypes::MapNdb ndb;
+    mapTypesFactory->fillNdb(*ndbsByRectQuery, ndbColumns, ndb);
+    ndbs.append(ndb);
   }
 }
 
-const QList<maptypes::MapParking> *MapQuery::getParkingsForAirport(int airportId)
+void MapQuery::loadMarkers(const Marble::GeoDataLatLonBox& rect, QList<maptypes::MapMarker>& markers)
 {
-  if(parkingCache.contains(airportId))
-    return parkingCache.object(airportId);
-  else
+  bindCoordinatePointInRect(rect, markersByRectQuery);
+  markersByRectQuery->exec();
+  while(markersByRectQuery->next())
   {
-    parkingQuery->bindValue(":airportId", airportId);
-    parkingQuery->exec();
+    maptypes::MapMarker marker;
+    mapTypesFactory->fillMarker(markersByRectQuery->record(), marker);
+    markers.append(marker);
+  }
+}
 
-    QList<maptypes::MapParking> *ps = new QList<maptypes::MapParking>;
-    while(parkingQuery->next())
-    {
-      maptypes::MapParking p;
+void MapQuery::loadIls(const Marble::GeoDataLatLonBox& rect, QList<maptypes::MapIls>& ilsList)
+{
+  bindCoordinatePointInRect(rect, ilsByRectQuery);
+  ilsByRectQuery->exec();
+  while(ilsByRectQuery->next())
+  {
+    maptypes::MapIls ils;
+    mapTypesFactory->fillIls(ilsByRectQuery->record(), ils);
+    ilsList.append(ils);
+  }
+}
 
-      // Vehicle paths are filtered out in the compiler
-      mapTypesFactory->fillParking(parkingQuery->record(), p);
-      ps->append(p);
-    }
-    parkingCache.insert(airportId, ps);
-    return ps;
+void MapQuery::loadAirways(const Marble::GeoDataLatLonBox& rect, QList<maptypes::MapAirway>& airways)
+{
+  bindCoordinatePointInRect(rect, airwayByRectQuery);
+  airwayByRectQuery->exec();
+  while(airwayByRectQuery->next())
+  {
+    maptypes::MapAirway airway;
+    mapTypesFactory->fillAirway(airwayByRectQuery->record(), airway);
+    airways.append(airway);
   }
 }
 
-const QList<maptypes::MapStart> *MapQuery::getStartPositionsForAirport(int airportId)
+void MapQuery::loadTile(const TileKey& key, maptypes::MapObjectTypes types, const MapLayer *mapLayer,
+                        TileData& data)
+{
+  GeoDataLatLonBox rect = tileRect(key);
+  data.key = key;
+  data.types = types;
+
+  if(types.testFlag(maptypes::AIRPORT))
+    loadAirports(rect, key.level, mapLayer, data.airports);
+  if(types.testFlag(maptypes::WAYPOINT))
+    loadWaypoints(rect, key.level, data.waypoints);
+  if(types.testFlag(maptypes::VOR))
+    loadVors(rect, key.level, data.vors);
+  if(types.testFlag(maptypes::NDB))
+    loadNdbs(rect, key.level, data.ndbs);
+  if(types.testFlag(maptypes::MARKER))
+    loadMarkers(rect, data.markers);
+  if(types.testFlag(maptypes::ILS))
+    loadIls(rect, data.ils);
+  if(types.testFlag(maptypes::AIRWAY))
+    loadAirways(rect, data.airways);
+}
+
+const QVector<maptypes::MapRunway> *MapQuery::getRunwaysForOverview(int airportId)
 {
-  if(startCache.contains(airportId))
-    return startCache.object(airportId);
+  if(runwayOverwiewCache.contains(airportId))
+    return runwayOverwiewCache.object(airportId);
   else
   {
-    startQuery->bindValue(":airportId", airportId);
-    startQuery->exec();
+    using atools::geo::Pos;
 
-    QList<maptypes::MapStart> *ps = new QList<maptypes::MapStart>;
-    while(startQuery->next())
+    runwayOverviewQuery->bindValue(":airportId", airportId);
+    runwayOverviewQuery->exec();
+
+    QVector<maptypes::MapRunway> *rws = new QVector<maptypes::MapRunway>;
+    while(runwayOverviewQuery->next())
     {
-      maptypes::MapStart p;
-      mapTypesFactory->fillStart(startQuery->record(), p);
-      ps->append(p);
+      maptypes::MapRunway runway;
+      mapTypesFactory->fillRunway(runwayOverviewQuery->record(), runway, true);
+      rws->append(runway);
     }
-    startCache.insert(airportId, ps);
-    return ps;
+    runwayOverwiewCache.insert(airportId, rws);
+    return rws;
   }
 }
 
@@ -727,90 +789,153 @@ void MapQuery::getParkingByNameAndNumber(QList<maptypes::MapParking>& parkings,
   }
 }
 
-const QList<maptypes::MapHelipad> *MapQuery::getHelipads(int airportId)
+const maptypes::MapAirportDiagram *MapQuery::getAirportDiagram(int airportId)
 {
-  if(helipadCache.contains(airportId))
-    return helipadCache.object(airportId);
-  else
+  maptypes::MapAirportDiagram *diagram = diagramCache.object(airportId);
+  if(diagram == nullptr)
   {
-    helipadQuery->bindValue(":airportId", airportId);
-    helipadQuery->exec();
-
-    QList<maptypes::MapHelipad> *hs = new QList<maptypes::MapHelipad>;
-    while(helipadQuery->next())
-    {
-      // TODO should be moved to MapTypesFactory
-      maptypes::MapHelipad hp;
-
-      hp.position = Pos(helipadQuery->value("lonx").toFloat(), helipadQuery->value("laty").toFloat()),
-      hp.width = helipadQuery->value("width").toInt();
-      hp.length = helipadQuery->value("length").toInt();
-      hp.heading = static_cast<int>(std::roundf(helipadQuery->value("heading").toFloat()));
-      hp.surface = helipadQuery->value("surface").toString();
-      hp.type = helipadQuery->value("type").toString();
-      hp.transparent = helipadQuery->value("is_transparent").toInt() > 0;
-      hp.closed = helipadQuery->value("is_closed").toInt() > 0;
-
-      hs->append(hp);
-    }
-    helipadCache.insert(airportId, hs);
-    return hs;
+    diagram = new maptypes::MapAirportDiagram;
+    loadAirportDiagram(airportId, *diagram);
+
+    // Limit cost to the maximum since the cache would delete the object immediately otherwise
+    int cost = diagram->memorySize() / 1024 + 1;
+    if(cost > DIAGRAM_CACHE_SIZE_KB)
+      cost = DIAGRAM_CACHE_SIZE_KB;
+    diagramCache.insert(airportId, diagram, cost);
   }
+  return diagram;
 }
 
-const QList<maptypes::MapTaxiPath> *MapQuery::getTaxiPaths(int airportId)
+const QVector<maptypes::MapRunway> *MapQuery::getRunways(int airportId)
 {
-  if(taxipathCache.contains(airportId))
-    return taxipathCache.object(airportId);
-  else
-  {
-    taxiparthQuery->bindValue(":airportId", airportId);
-    taxiparthQuery->exec();
+  return &getAirportDiagram(airportId)->runways;
+}
 
-    QList<maptypes::MapTaxiPath> *tps = new QList<maptypes::MapTaxiPath>;
-    while(taxiparthQuery->next())
-    {
-      // TODO should be moved to MapTypesFactory
-      maptypes::MapTaxiPath tp;
-      QString type = taxiparthQuery->value("type").toString();
-      tp.drawSurface = taxiparthQuery->value("is_draw_surface").toInt() > 0;
-      tp.start = Pos(taxiparthQuery->value("start_lonx").toFloat(), taxiparthQuery->value(
-                       "start_laty").toFloat()),
-      tp.end = Pos(taxiparthQuery->value("end_lonx").toFloat(), taxiparthQuery->value("end_laty").toFloat()),
-      tp.surface = taxiparthQuery->value("surface").toString();
-      tp.name = taxiparthQuery->value("name").toString();
-      tp.width = taxiparthQuery->value("width").toInt();
-
-      tps->append(tp);
-    }
-    taxipathCache.insert(airportId, tps);
-    return tps;
-  }
+const QVector<maptypes::MapApron> *MapQuery::getAprons(int airportId)
+{
+  return &getAirportDiagram(airportId)->aprons;
 }
 
-const QList<maptypes::MapRunway> *MapQuery::getRunways(int airportId)
+const QVector<maptypes::MapTaxiPath> *MapQuery::getTaxiPaths(int airportId)
 {
-  if(runwayCache.contains(airportId))
-    return runwayCache.object(airportId);
-  else
+  return &getAirportDiagram(airportId)->taxiPaths;
+}
+
+const QVector<maptypes::MapParking> *MapQuery::getParkingsForAirport(int airportId)
+{
+  return &getAirportDiagram(airportId)->parkings;
+}
+
+const QVector<maptypes::MapStart> *MapQuery::getStartPositionsForAirport(int airportId)
+{
+  return &getAirportDiagram(airportId)->starts;
+}
+
+const QVector<maptypes::MapHelipad> *MapQuery::getHelipads(int airportId)
+{
+  return &getAirportDiagram(airportId)->helipads;
+}
+
+/* Run all diagram queries for an airport one after another */
+void MapQuery::loadAirportDiagram(int airportId, maptypes::MapAirportDiagram& diagram)
+{
+  // Runways ----------------------------------------------
+  runwaysQuery->bindValue(":airportId", airportId);
+  runwaysQuery->exec();
+  while(runwaysQuery->next())
   {
-    runwaysQuery->bindValue(":airportId", airportId);
-    runwaysQuery->exec();
+    maptypes::MapRunway runway;
+    mapTypesFactory->fillRunway(runwaysQuery->record(), runway, false);
+    diagram.runways.append(runway);
+  }
 
-    QList<maptypes::MapRunway> *rs = new QList<maptypes::MapRunway>;
-    while(runwaysQuery->next())
+  // Sort to draw the hard/better runways last on top of other grass, turf, etc.
+  using namespace std::placeholders;
+  std::sort(diagram.runways.begin(), diagram.runways.end(),
+            std::bind(&MapQuery::runwayCompare, this, _1, _2));
+
+  // Aprons ----------------------------------------------
+  apronQuery->bindValue(":airportId", airportId);
+  apronQuery->exec();
+  while(apronQuery->next())
+  {
+    maptypes::MapApron ap;
+
+    ap.surface = apronQuery->value("surface").toString();
+    ap.drawSurface = apronQuery->value("is_draw_surface").toInt() > 0;
+
+    // Decode vertices into a position list
+    QString vertices = apronQuery->value("vertices").toString();
+    QStringList vertexList = vertices.split(",");
+    for(QString vertex : vertexList)
     {
-      maptypes::MapRunway runway;
-      mapTypesFactory->fillRunway(runwaysQuery->record(), runway, false);
-      rs->append(runway);
+      QStringList ordinates = vertex.split(" ", QString::SkipEmptyParts);
+
+      if(ordinates.size() == 2)
+        // Skip any invalid parts (should not happen since data is checked in the converter)
+        ap.vertices.append(ordinates.at(0).toFloat(), ordinates.at(1).toFloat());
     }
+    diagram.aprons.append(ap);
+  }
+
+  // Taxiways ----------------------------------------------
+  taxiparthQuery->bindValue(":airportId", airportId);
+  taxiparthQuery->exec();
+  while(taxiparthQuery->next())
+  {
+    // TODO should be moved to MapTypesFactory
+    maptypes::MapTaxiPath tp;
+    tp.drawSurface = taxiparthQuery->value("is_draw_surface").toInt() > 0;
+    tp.start = Pos(taxiparthQuery->value("start_lonx").toFloat(),
+                   taxiparthQuery->value("start_laty").toFloat());
+    tp.end = Pos(taxiparthQuery->value("end_lonx").toFloat(), taxiparthQuery->value("end_laty").toFloat());
+    tp.surface = taxiparthQuery->value("surface").toString();
+    tp.name = taxiparthQuery->value("name").toString();
+    tp.width = taxiparthQuery->value("width").toInt();
+
+    diagram.taxiPaths.append(tp);
+  }
+
+  // Parking ----------------------------------------------
+  parkingQuery->bindValue(":airportId", airportId);
+  parkingQuery->exec();
+  while(parkingQuery->next())
+  {
+    maptypes::MapParking p;
+
+    // Vehicle paths are filtered out in the compiler
+    mapTypesFactory->fillParking(parkingQuery->record(), p);
+    diagram.parkings.append(p);
+  }
 
-    // Sort to draw the hard/better runways last on top of other grass, turf, etc.
-    using namespace std::placeholders;
-    std::sort(rs->begin(), rs->end(), std::bind(&MapQuery::runwayCompare, this, _1, _2));
+  // Start positions ----------------------------------------------
+  startQuery->bindValue(":airportId", airportId);
+  startQuery->exec();
+  while(startQuery->next())
+  {
+    maptypes::MapStart p;
+    mapTypesFactory->fillStart(startQuery->record(), p);
+    diagram.starts.append(p);
+  }
 
-    runwayCache.insert(airportId, rs);
-    return rs;
+  // Helipads ----------------------------------------------
+  helipadQuery->bindValue(":airportId", airportId);
+  helipadQuery->exec();
+  while(helipadQuery->next())
+  {
+    // TODO should be moved to MapTypesFactory
+    maptypes::MapHelipad hp;
+
+    hp.position = Pos(helipadQuery->value("lonx").toFloat(), helipadQuery->value("laty").toFloat());
+    hp.width = helipadQuery->value("width").toInt();
+    hp.length = helipadQuery->value("length").toInt();
+    hp.heading = static_cast<int>(std::roundf(helipadQuery->value("heading").toFloat()));
+    hp.surface = helipadQuery->value("surface").toString();
+    hp.type = helipadQuery->value("type").toString();
+    hp.transparent = helipadQuery->value("is_transparent").toInt() > 0;
+    hp.closed = helipadQuery->value("is_closed").toInt() > 0;
+
+    diagram.helipads.append(hp);
   }
 }
 
@@ -842,55 +967,254 @@ void MapQuery::bindCoordinatePointInRect(const Marble::GeoDataLatLonBox& rect, a
   query->bindValue(":" + prefix + "topy", rect.north(GeoDataCoordinates::Degree));
 }
 
-/* Inflates the rectangle and splits it at the antimeridian (date line) if it overlaps */
-QList<Marble::GeoDataLatLonBox> MapQuery::splitAtAntiMeridian(const Marble::GeoDataLatLonBox& rect)
+bool MapQuery::isAirportLod(const MapLayer *mapLayer) const
+{
+  // The level of detail tables do not consider runway length - a cell might keep only a short runway airport
+  return lodTypes.testFlag(maptypes::AIRPORT) && mapLayer->getDataSource() == layer::ALL &&
+         mapLayer->getMinRunwayLength() == 0;
+}
+
+void MapQuery::bindLodLevels(atools::sql::SqlQuery *query, int level)
+{
+  // Levels finer than the tile level get a value that does not exist in the tables
+  for(int lodLevel = MIN_TILE_LEVEL; lodLevel <= MAX_TILE_LEVEL; lodLevel++)
+    query->bindValue(":lod" + QString::number(lodLevel - MIN_TILE_LEVEL),
+                     lodLevel >= level ? lodLevel : MAX_TILE_LEVEL + 1);
+}
+
+int MapQuery::tileLevelForRect(const Marble::GeoDataLatLonBox& rect)
 {
-  GeoDataLatLonBox newRect = rect;
-  inflateRect(newRect,
-              newRect.width(GeoDataCoordinates::Degree) * RECT_INFLATION_FACTOR_DEG + RECT_INFLATION_ADD_DEG,
-              newRect.height(GeoDataCoordinates::Degree) * RECT_INFLATION_FACTOR_DEG + RECT_INFLATION_ADD_DEG);
+  // Use the smallest tile size where the larger rectangle side covers at most TILES_PER_VIEW tiles
+  double minSize = std::max(rect.width(GeoDataCoordinates::Degree),
+                            rect.height(GeoDataCoordinates::Degree)) / TILES_PER_VIEW;
+  int level = MIN_TILE_LEVEL;
+  while(level < MAX_TILE_LEVEL && std::ldexp(1., level) < minSize)
+    level++;
+  return level;
+}
 
-  if(newRect.crossesDateLine())
+void MapQuery::tilesForRect(const Marble::GeoDataLatLonBox& rect, int layerKey, QVector<TileKey>& keys)
+{
+  tilesForRect(rect, tileLevelForRect(rect), layerKey, keys);
+}
+
+void MapQuery::tilesForRect(const Marble::GeoDataLatLonBox& rect, int level, int layerKey,
+                            QVector<TileKey>& keys)
+{
+  keys.clear();
+  if(rect.isEmpty())
+    return;
+
+  double size = std::ldexp(1., level);
+  int numX = static_cast<int>(std::ceil(360. / size)), numY = static_cast<int>(std::ceil(180. / size));
+
+  auto tileX = [ = ](double lonX) -> int
+               {
+                 return std::min(std::max(static_cast<int>(std::floor((lonX + 180.) / size)), 0), numX - 1);
+               };
+  auto tileY = [ = ](double latY) -> int
+               {
+                 return std::min(std::max(static_cast<int>(std::floor((latY + 90.) / size)), 0), numY - 1);
+               };
+
+  int west = tileX(rect.west(GeoDataCoordinates::Degree));
+  int east = tileX(rect.east(GeoDataCoordinates::Degree));
+  int south = tileY(rect.south(GeoDataCoordinates::Degree));
+  int north = tileY(rect.north(GeoDataCoordinates::Degree));
+
+  if(rect.crossesDateLine())
+    // Continue east of the anti-meridian
+    east += numX;
+
+  for(int y = south; y <= north; y++)
   {
-    // Split in western and eastern part
-    GeoDataLatLonBox westOf;
-    westOf.setBoundaries(newRect.north(GeoDataCoordinates::Degree),
-                         newRect.south(GeoDataCoordinates::Degree),
-                         180.,
-                         newRect.west(GeoDataCoordinates::Degree), GeoDataCoordinates::Degree);
-
-    GeoDataLatLonBox eastOf;
-    eastOf.setBoundaries(newRect.north(GeoDataCoordinates::Degree),
-                         newRect.south(GeoDataCoordinates::Degree),
-                         newRect.east(GeoDataCoordinates::Degree),
-                         -180., GeoDataCoordinates::Degree);
-
-    return QList<GeoDataLatLonBox>({westOf, eastOf});
+    for(int x = west; x <= east && x < west + numX; x++)
+      keys.append({x % numX, y, level, layerKey});
   }
-  else
-    return QList<GeoDataLatLonBox>({newRect});
 }
 
-/* Inflate rect by width and height in degrees. If it crosses the poles or date line it will be limited */
-void MapQuery::inflateRect(Marble::GeoDataLatLonBox& rect, double width, double height)
+GeoDataLatLonBox MapQuery::tileRect(const TileKey& key)
 {
-  rect.setNorth(std::min(rect.north(GeoDataCoordinates::Degree) + height, 89.), GeoDataCoordinates::Degree);
-  rect.setSouth(std::max(rect.south(GeoDataCoordinates::Degree) - height, -89.), GeoDataCoordinates::Degree);
-  rect.setWest(std::max(rect.west(GeoDataCoordinates::Degree) - width, -179.), GeoDataCoordinates::Degree);
-  rect.setEast(std::min(rect.east(GeoDataCoordinates::Degree) + width, 179.), GeoDataCoordinates::Degree);
+  double size = std::ldexp(1., key.level);
+  double west = -180. + key.x * size, south = -90. + key.y * size;
+  return GeoDataLatLonBox(std::min(south + size, 90.), south, std::min(west + size, 180.), west,
+                          GeoDataCoordinates::Degree);
 }
 
-/* Check for overflow if result is equal to QUERY_ROW_LIMIT. Emit resultTruncated if that is the case.
+/* Emit resultTruncated with QUERY_ROW_LIMIT if any tile query reached the limit.
  * Otherwise emit resultTruncated with value 0. */
 template<typename TYPE>
-void MapQuery::checkOverflow(const QList<TYPE>& list, maptypes::MapObjectTypes type)
+void MapQuery::checkOverflow(const TileRectCache<TYPE>& cache, maptypes::MapObjectTypes type, bool limited)
 {
-  if(list.size() >= QUERY_ROW_LIMIT)
+  if(limited && cache.truncated)
     emit resultTruncated(type, QUERY_ROW_LIMIT);
   else
     emit resultTruncated(type, 0);
 }
 
+void MapQuery::startPrefetch()
+{
+  if(prefetchWorker != nullptr)
+    return;
+
+  qRegisterMetaType<mq::PrefetchRequest>();
+  qRegisterMetaType<QList<MapQuery::TileData> >();
+
+  prefetchThread = new QThread(this);
+  prefetchWorker = new MapPrefetchWorker();
+  prefetchWorker->moveToThread(prefetchThread);
+  connect(prefetchThread, &QThread::finished, prefetchWorker, &QObject::deleteLater);
+  connect(prefetchWorker, &MapPrefetchWorker::tilesLoaded, this, &MapQuery::prefetchTilesLoaded);
+  prefetchThread->start();
+
+  QMetaObject::invokeMethod(prefetchWorker, "initDatabase", Qt::QueuedConnection,
+                            Q_ARG(QString, db->databaseName()));
+}
+
+void MapQuery::prefetch(const Marble::GeoDataLatLonBox& viewRect,
+                        const QList<Marble::GeoDataLatLonBox>& rects, maptypes::MapObjectTypes types,
+                        const MapLayer *mapLayer)
+{
+  if(prefetchWorker == nullptr || types == maptypes::NONE || viewRect.isEmpty())
+    return;
+
+  // Use the same tile size as the painters for the current view
+  int level = tileLevelForRect(viewRect);
+  int layerKey = mapLayer->getQueryParameterKey();
+
+  QVector<PrefetchTile> prefetchTiles;
+  QSet<TileKey> found;
+  QVector<TileKey> keys;
+  for(const GeoDataLatLonBox& rect : rects)
+  {
+    tilesForRect(rect, level, layerKey, keys);
+    for(const TileKey& key : keys)
+    {
+      if(prefetchTiles.size() >= MAX_PREFETCH_TILES)
+        break;
+
+      if(!found.contains(key))
+      {
+        found.insert(key);
+        maptypes::MapObjectTypes missing = missingTypes(key, types);
+        if(missing != maptypes::NONE)
+          prefetchTiles.append({key, missing});
+      }
+    }
+  }
+  requestTiles(prefetchTiles, mapLayer, false /* visible */);
+}
+
+maptypes::MapObjectTypes MapQuery::missingTypes(const TileKey& key, maptypes::MapObjectTypes types) const
+{
+  // Navaid caches do not depend on map layer parameters
+  TileKey navKey = key;
+  navKey.layerKey = 0;
+
+  maptypes::MapObjectTypes missing = maptypes::NONE;
+  if(types.testFlag(maptypes::AIRPORT) && !airportCache.tiles.contains(key))
+    missing |= maptypes::AIRPORT;
+  if(types.testFlag(maptypes::WAYPOINT) && !waypointCache.tiles.contains(navKey))
+    missing |= maptypes::WAYPOINT;
+  if(types.testFlag(maptypes::VOR) && !vorCache.tiles.contains(navKey))
+    missing |= maptypes::VOR;
+  if(types.testFlag(maptypes::NDB) && !ndbCache.tiles.contains(navKey))
+    missing |= maptypes::NDB;
+  if(types.testFlag(maptypes::MARKER) && !markerCache.tiles.contains(navKey))
+    missing |= maptypes::MARKER;
+  if(types.testFlag(maptypes::ILS) && !ilsCache.tiles.contains(navKey))
+    missing |= maptypes::ILS;
+  if(types.testFlag(maptypes::AIRWAY) && !airwayCache.tiles.contains(navKey))
+    missing |= maptypes::AIRWAY;
+
+  // Remove types that are already on the way
+  return missing & ~requestedTiles.value(key, maptypes::NONE);
+}
+
+template<typename TYPE>
+void MapQuery::requestMissingTiles(const TileRectCache<TYPE>& cache, maptypes::MapObjectTypes type,
+                                   const MapLayer *mapLayer)
+{
+  if(prefetchWorker == nullptr || cache.missingTiles.isEmpty())
+    return;
+
+  QVector<PrefetchTile> prefetchTiles;
+  for(TileKey key : cache.missingTiles)
+  {
+    // Requests are tracked using the airport layer key
+    key.layerKey = mapLayer->getQueryParameterKey();
+    if(!requestedTiles.value(key, maptypes::NONE).testFlag(type))
+      prefetchTiles.append({key, type});
+  }
+  requestTiles(prefetchTiles, mapLayer, true /* visible */);
+}
+
+void MapQuery::requestTiles(const QVector<PrefetchTile>& prefetchTiles, const MapLayer *mapLayer,
+                            bool visible)
+{
+  if(prefetchTiles.isEmpty())
+    return;
+
+  mq::PrefetchRequest request;
+  request.requestId = ++lastPrefetchRequestId;
+  request.tiles = prefetchTiles;
+  request.airportSource = mapLayer->getDataSource();
+  request.minRunwayLength = mapLayer->getMinRunwayLength();
+  request.visible = visible;
+
+  for(const PrefetchTile& tile : prefetchTiles)
+    requestedTiles[tile.key] |= tile.types;
+  prefetchRequests.insert(request.requestId, prefetchTiles);
+
+  if(!visible)
+    // Let the worker skip older prefetch requests that are still queued
+    prefetchWorker->setLatestPrefetchId(request.requestId);
+  QMetaObject::invokeMethod(prefetchWorker, "loadTiles", Qt::QueuedConnection,
+                            Q_ARG(mq::PrefetchRequest, request));
+}
+
+void MapQuery::prefetchTilesLoaded(int requestId, QList<MapQuery::TileData> tileData)
+{
+  if(!prefetchRequests.contains(requestId))
+    // Request was sent before the database was changed
+    return;
+
+  // Tiles that were skipped by the worker can be requested again
+  for(const PrefetchTile& tile : prefetchRequests.take(requestId))
+  {
+    maptypes::MapObjectTypes remaining = requestedTiles.value(tile.key, maptypes::NONE) & ~tile.types;
+    if(remaining == maptypes::NONE)
+      requestedTiles.remove(tile.key);
+    else
+      requestedTiles.insert(tile.key, remaining);
+  }
+
+  bool visible = false;
+  for(const TileData& data : tileData)
+  {
+    TileKey navKey = data.key;
+    navKey.layerKey = 0;
+
+    if(data.types.testFlag(maptypes::AIRPORT))
+      visible |= airportCache.insertTile(data.key, data.airports);
+    if(data.types.testFlag(maptypes::WAYPOINT))
+      visible |= waypointCache.insertTile(navKey, data.waypoints);
+    if(data.types.testFlag(maptypes::VOR))
+      visible |= vorCache.insertTile(navKey, data.vors);
+    if(data.types.testFlag(maptypes::NDB))
+      visible |= ndbCache.insertTile(navKey, data.ndbs);
+    if(data.types.testFlag(maptypes::MARKER))
+      visible |= markerCache.insertTile(navKey, data.markers);
+    if(data.types.testFlag(maptypes::ILS))
+      visible |= ilsCache.insertTile(navKey, data.ils);
+    if(data.types.testFlag(maptypes::AIRWAY))
+      visible |= airwayCache.insertTile(navKey, data.airways);
+  }
+
+  if(visible)
+    emit tilesPrefetched();
+}
+
 void MapQuery::initQueries()
 {
   // Common where clauses
@@ -939,6 +1263,33 @@ void MapQuery::initQueries()
 
   deInitQueries();
 
+  // Use level of detail tables instead of truncating results if they match the loaded scenery
+  lodTypes = maptypes::NONE;
+  if(MapLodBuilder::isValid(db))
+    lodTypes = maptypes::AIRPORT | maptypes::WAYPOINT | maptypes::VOR | maptypes::NDB;
+  qDebug() << "Map level of detail tables used" << (lodTypes != maptypes::NONE);
+
+  // Use R*Tree tables for rectangle queries if they match the loaded scenery
+  bool spatialIndex = SpatialIndexBuilder::isValid(db);
+  qDebug() << "Map spatial index used" << spatialIndex;
+
+  auto whereRectFor = [spatialIndex](const QString& table) -> QString
+                      {
+                        return spatialIndex ?
+                               SpatialIndexBuilder::whereRect(table, table + "_id") : whereRect;
+                      };
+
+  // Selects all object ids of the level of detail table with one index lookup per level
+  QStringList lodParams;
+  for(int level = MIN_TILE_LEVEL; level <= MAX_TILE_LEVEL; level++)
+    lodParams.append(":lod" + QString::number(level - MIN_TILE_LEVEL));
+
+  auto whereLod = [&lodParams](const QString& table) -> QString
+                  {
+                    return table + "_id in (select " + table + "_id from " + table + "_lod where " +
+                           "lod_level in (" + lodParams.join(", ") + ") and " + whereRect + ")";
+                  };
+
   airportByIdQuery = new SqlQuery(db);
   airportByIdQuery->prepare(airportQueryBase + " from airport where airport_id = :id ");
 
@@ -978,12 +1329,21 @@ void MapQuery::initQueries()
   waypointByIdQuery = new SqlQuery(db);
   waypointByIdQuery->prepare(waypointQueryBase + " from waypoint where waypoint_id = :id");
 
+  // Truncated query used for layers with minimum runway length or if no level of detail tables exist
   airportByRectQuery = new SqlQuery(db);
   airportByRectQuery->prepare(
-    airportQueryBase + " from airport where " + whereRect +
+    airportQueryBase + " from airport where " + whereRectFor("airport") +
     " and longest_runway_length >= :minlength order by rating desc, longest_runway_length desc "
     + whereLimit);
 
+  if(lodTypes.testFlag(maptypes::AIRPORT))
+  {
+    airportLodByRectQuery = new SqlQuery(db);
+    airportLodByRectQuery->prepare(
+      airportQueryBase + " from airport where " + whereLod("airport") +
+      " order by rating desc, longest_runway_length desc");
+  }
+
   airportMediumByRectQuery = new SqlQuery(db);
   airportMediumByRectQuery->prepare(
     airportQueryBaseOverview + "from airport_medium where " + whereRect + " " + whereLimit);
@@ -1045,30 +1405,39 @@ void MapQuery::initQueries()
     "where airport_id = :airportId");
 
   waypointsByRectQuery = new SqlQuery(db);
-  waypointsByRectQuery->prepare(waypointQueryBase + " from waypoint where " + whereRect + " " + whereLimit);
-
   vorsByRectQuery = new SqlQuery(db);
-  vorsByRectQuery->prepare(vorQueryBase + " from vor where " + whereRect + " " + whereLimit);
-
   ndbsByRectQuery = new SqlQuery(db);
-  ndbsByRectQuery->prepare(ndbQueryBase + " from ndb where " + whereRect + " " + whereLimit);
+  if(lodTypes != maptypes::NONE)
+  {
+    waypointsByRectQuery->prepare(waypointQueryBase + " from waypoint where " + whereLod("waypoint"));
+    vorsByRectQuery->prepare(vorQueryBase + " from vor where " + whereLod("vor"));
+    ndbsByRectQuery->prepare(ndbQueryBase + " from ndb where " + whereLod("ndb"));
+  }
+  else
+  {
+    waypointsByRectQuery->prepare(
+      waypointQueryBase + " from waypoint where " + whereRectFor("waypoint") + " " + whereLimit);
+    vorsByRectQuery->prepare(vorQueryBase + " from vor where " + whereRectFor("vor") + " " + whereLimit);
+    ndbsByRectQuery->prepare(ndbQueryBase + " from ndb where " + whereRectFor("ndb") + " " + whereLimit);
+  }
 
   markersByRectQuery = new SqlQuery(db);
   markersByRectQuery->prepare(
     "select marker_id, type, heading, lonx, laty "
     "from marker "
-    "where " + whereRect + " " + whereLimit);
+    "where " + whereRectFor("marker") + " " + whereLimit);
 
   ilsByRectQuery = new SqlQuery(db);
   ilsByRectQuery->prepare(
     "select ils_id, ident, name, mag_var, loc_heading, gs_pitch, frequency, range, dme_range, loc_width, "
     "end1_lonx, end1_laty, end_mid_lonx, end_mid_laty, end2_lonx, end2_laty, altitude, lonx, laty "
-    "from ils where " + whereRect + " " + whereLimit);
+    "from ils where " + whereRectFor("ils") + " " + whereLimit);
 
   airwayByRectQuery = new SqlQuery(db);
   airwayByRectQuery->prepare(
     airwayQueryBase + " from airway where " +
-    "not (right_lonx < :leftx or left_lonx > :rightx or bottom_laty > :topy or top_laty < :bottomy) ");
+    (spatialIndex ? whereRectFor("airway") :
+     "not (right_lonx < :leftx or left_lonx > :rightx or bottom_laty > :topy or top_laty < :bottomy) "));
 
   airwayByWaypointIdQuery = new SqlQuery(db);
   airwayByWaypointIdQuery->prepare(
@@ -1076,10 +1445,34 @@ void MapQuery::initQueries()
 
   airwayByIdQuery = new SqlQuery(db);
   airwayByIdQuery->prepare(airwayQueryBase + " from airway where airway_id = :id");
+
+  if(prefetchWorker != nullptr)
+    QMetaObject::invokeMethod(prefetchWorker, "initDatabase", Qt::QueuedConnection,
+                              Q_ARG(QString, db->databaseName()));
 }
 
 void MapQuery::deInitQueries()
 {
+  if(prefetchWorker != nullptr)
+    // Wait until the worker has finished the current tile and closed the database
+    QMetaObject::invokeMethod(prefetchWorker, "deInitDatabase", Qt::BlockingQueuedConnection);
+
+  // Results of running requests are ignored
+  prefetchRequests.clear();
+  requestedTiles.clear();
+
+  invalidateScreenGrids();
+  gridParkings.clear();
+  gridHelipads.clear();
+
+  // Queries are prepared again and might select different columns
+  airportColumns.clear();
+  airportMediumColumns.clear();
+  airportLargeColumns.clear();
+  waypointColumns.clear();
+  vorColumns.clear();
+  ndbColumns.clear();
+
   airportCache.clear();
   waypointCache.clear();
   vorCache.clear();
@@ -1087,16 +1480,15 @@ void MapQuery::deInitQueries()
   markerCache.clear();
   ilsCache.clear();
   airwayCache.clear();
+  airwayGeometry.clear();
 
-  runwayCache.clear();
   runwayOverwiewCache.clear();
-  apronCache.clear();
-  taxipathCache.clear();
-  parkingCache.clear();
-  helipadCache.clear();
+  diagramCache.clear();
 
   delete airportByRectQuery;
   airportByRectQuery = nullptr;
+  delete airportLodByRectQuery;
+  airportLodByRectQuery = nullptr;
   delete airportMediumByRectQuery;
   airportMediumByRectQuery = nullptr;
   delete airportLargeByRectQuery;
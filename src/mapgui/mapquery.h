@@ -19,10 +19,18 @@
 #define LITTLENAVMAP_MAPQUERY_H
 
 #include "common/maptypes.h"
+#include "common/maptypesfactory.h"
+#include "mapgui/mapairwaygeometry.h"
 #include "mapgui/maplayer.h"
+#include "mapgui/mapobjectstore.h"
+#include "mapgui/mapscreengrid.h"
 
 #include <QCache>
+#include <QHash>
 #include <QList>
+#include <QSet>
+
+#include <functional>
 
 #include <marble/GeoDataLatLonBox.h>
 
@@ -37,14 +45,18 @@ class SqlQuery;
 }
 
 class CoordinateConverter;
-class MapTypesFactory;
 class MapLayer;
+class MapPrefetchWorker;
+class QThread;
 
 /*
  * Provides map related database queries. Fill objects of the maptypes namespace and maintains a cache.
  * Objects from methods returning a pointer to a list might be deleted from the cache and should be copied
  * if they have to be kept between event loop calls.
  * All ids are database ids.
+ *
+ * If prefetch is started tiles around the view are loaded by a worker thread. Lazy requests during
+ * scrolling only use cached tiles and request missing ones from the worker.
  */
 class MapQuery
   : public QObject
@@ -52,6 +64,49 @@ class MapQuery
   Q_OBJECT
 
 public:
+  /* Fixed lat/lon tile of size 2^level degrees. x and y count from -180 and -90 degrees. */
+  struct TileKey
+  {
+    int x, y, level;
+
+    /* Tiles are kept separately for each set of map layer query parameters */
+    int layerKey;
+
+    bool operator==(const TileKey& other) const
+    {
+      return x == other.x && y == other.y && level == other.level && layerKey == other.layerKey;
+    }
+
+    friend uint qHash(const TileKey& key)
+    {
+      return static_cast<uint>(key.x) ^ (static_cast<uint>(key.y) << 10) ^
+             (static_cast<uint>(key.level) << 20) ^ (static_cast<uint>(key.layerKey) << 24) ^
+             static_cast<uint>(key.layerKey);
+    }
+
+  };
+
+  /* Objects of one tile that were loaded by the prefetch worker. Only lists for types are filled. */
+  struct TileData
+  {
+    TileKey key;
+    maptypes::MapObjectTypes types;
+    QList<maptypes::MapAirport> airports;
+    QList<maptypes::MapWaypoint> waypoints;
+    QList<maptypes::MapVor> vors;
+    QList<maptypes::MapNdb> ndbs;
+    QList<maptypes::MapMarker> markers;
+    QList<maptypes::MapIls> ils;
+    QList<maptypes::MapAirway> airways;
+  };
+
+  /* Tile and object types that are requested from the prefetch worker */
+  struct PrefetchTile
+  {
+    TileKey key;
+    maptypes::MapObjectTypes types;
+  };
+
   MapQuery(QObject *parent, atools::sql::SqlDatabase *sqlDb);
   ~MapQuery();
 
@@ -90,7 +145,8 @@ public:
 
   /*
    * Get objects near a screen coordinate from the cache which will cover all visible objects.
-   * No objects are loaded from the database.
+   * No objects are loaded from the database. Screen coordinates are kept in grids until the next call of
+   * invalidateScreenGrids.
    *
    * @param conv Converter to calcualte screen coordinates
    * @param mapLayer current map layer
@@ -104,6 +160,9 @@ public:
                          maptypes::MapObjectTypes types, int xs, int ys, int screenDistance,
                          maptypes::MapSearchResult& result);
 
+  /* Screen coordinates of all objects have to be recalculated. Call on each paint event. */
+  void invalidateScreenGrids();
+
   /*
    * Get a parking spot of an airport by name and number
    * @param parkings result
@@ -133,11 +192,17 @@ public:
    * @param mapLayer used to find source table
    * @param lazy do not reload from database and return (probably incomplete) result from cache if true
    * @return pointer to airport cache. Create a copy if this is needed for a longer
-   * time than for e.g. one drawing request.
+   * time than for e.g. one drawing request. Names are not filled - use fillName if needed.
    */
   const QList<maptypes::MapAirport> *getAirports(const Marble::GeoDataLatLonBox& rect,
                                                  const MapLayer *mapLayer, bool lazy);
 
+  /* Fill the name of an object from the lists of getAirports, getVors or getNdbs if it is empty.
+   * Valid until the next call of these methods. */
+  void fillName(maptypes::MapAirport& airport) const;
+  void fillName(maptypes::MapVor& vor) const;
+  void fillName(maptypes::MapNdb& ndb) const;
+
   /* Similar to getAirports */
   const QList<maptypes::MapWaypoint> *getWaypoints(const Marble::GeoDataLatLonBox& rect,
                                                    const MapLayer *mapLayer, bool lazy);
@@ -162,21 +227,33 @@ public:
   const QList<maptypes::MapAirway> *getAirways(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                                                bool lazy);
 
+  /* Great circle polylines of airway segments shared by painter and screen index */
+  MapAirwayGeometry *getAirwayGeometry()
+  {
+    return &airwayGeometry;
+  }
+
   /* Get a partially filled runway list for the overview */
-  const QList<maptypes::MapRunway> *getRunwaysForOverview(int airportId);
+  const QVector<maptypes::MapRunway> *getRunwaysForOverview(int airportId);
+
+  /*
+   * Get all objects needed to draw the airport diagram. All are loaded at once on first access and kept in
+   * a cache with a memory limit. The methods below return parts of the diagram.
+   */
+  const maptypes::MapAirportDiagram *getAirportDiagram(int airportId);
 
   /* Get a completely filled runway list for the airport */
-  const QList<maptypes::MapRunway> *getRunways(int airportId);
+  const QVector<maptypes::MapRunway> *getRunways(int airportId);
 
-  const QList<maptypes::MapApron> *getAprons(int airportId);
+  const QVector<maptypes::MapApron> *getAprons(int airportId);
 
-  const QList<maptypes::MapTaxiPath> *getTaxiPaths(int airportId);
+  const QVector<maptypes::MapTaxiPath> *getTaxiPaths(int airportId);
 
-  const QList<maptypes::MapParking> *getParkingsForAirport(int airportId);
+  const QVector<maptypes::MapParking> *getParkingsForAirport(int airportId);
 
-  const QList<maptypes::MapStart> *getStartPositionsForAirport(int airportId);
+  const QVector<maptypes::MapStart> *getStartPositionsForAirport(int airportId);
 
-  const QList<maptypes::MapHelipad> *getHelipads(int airportId);
+  const QVector<maptypes::MapHelipad> *getHelipads(int airportId);
 
   /* Close all query objects thus disconnecting from the database */
   void initQueries();
@@ -184,74 +261,232 @@ public:
   /* Create and prepare all queries */
   void deInitQueries();
 
+  /* Start the background worker that loads tiles around the view. Call once after initQueries. */
+  void startPrefetch();
+
+  /*
+   * Request all tiles covering rects from the prefetch worker that are neither cached nor already requested.
+   * Tile size is selected by the size of viewRect so that the tiles match the ones used for painting.
+   * @param rects rectangles in order of priority
+   * @param types AIRPORT, WAYPOINT, VOR, NDB, MARKER, ILS and AIRWAY
+   */
+  void prefetch(const Marble::GeoDataLatLonBox& viewRect, const QList<Marble::GeoDataLatLonBox>& rects,
+                maptypes::MapObjectTypes types, const MapLayer *mapLayer);
+
+  /* Load all objects of the given types for one tile from the database. Used by the prefetch worker. */
+  void loadTile(const TileKey& key, maptypes::MapObjectTypes types, const MapLayer *mapLayer, TileData& data);
+
+  /* Get all tiles covering rect. Tile size is selected by rectangle size. */
+  static void tilesForRect(const Marble::GeoDataLatLonBox& rect, int layerKey, QVector<TileKey>& keys);
+
+  /* Get all tiles of the given level covering rect */
+  static void tilesForRect(const Marble::GeoDataLatLonBox& rect, int level, int layerKey,
+                           QVector<TileKey>& keys);
+  static Marble::GeoDataLatLonBox tileRect(const TileKey& key);
+
+  /* Tile level used for rect */
+  static int tileLevelForRect(const Marble::GeoDataLatLonBox& rect);
+
+  /* Tile size is 2^level degrees. Smallest is about 4 nm and largest 64 degrees. */
+  static Q_DECL_CONSTEXPR int MIN_TILE_LEVEL = -4;
+  static Q_DECL_CONSTEXPR int MAX_TILE_LEVEL = 6;
+
+  /* Row limit for each tile query without level of detail tables */
+  static Q_DECL_CONSTEXPR int QUERY_ROW_LIMIT = 3000;
+
 signals:
   /* Emitted whenever the result exceeds the limit clause in the queries */
   void resultTruncated(maptypes::MapObjectTypes type, int truncatedTo);
 
+  /* Emitted when the prefetch worker delivered tiles that are visible in the last painted view */
+  void tilesPrefetched();
+
 private:
-  /* Simple spatial cache that deals with objects in a bounding rectangle but does not run any queries to load data */
+  /*
+   * Spatial cache that keeps query results for fixed lat/lon tiles in a LRU cache with a memory limit.
+   * Tile size depends on the size of the requested rectangle. Only tiles that are not cached are loaded
+   * when panning or zooming back to a previous level. Does not run any queries itself.
+   * Tiles are kept in compact stores. Full objects are created only for the merged list of the current view.
+   * Names are not filled in the list objects and can be fetched using name().
+   */
   template<typename TYPE>
-  struct SimpleRectCache
+  struct TileRectCache
   {
+    /* Loads all objects for the given tile rectangle and tile level from the database */
+    typedef std::function<void (const Marble::GeoDataLatLonBox& rect, int level,
+                                QList<TYPE>& objects)> LoaderType;
+
+    TileRectCache()
+    {
+      tiles.setMaxCost(TILE_CACHE_SIZE_KB);
+    }
+
     /*
+     * Fill list with all objects of the tiles covering rect. Missing tiles are loaded using loader.
+     * Objects found in more than one tile are added only once.
      * @param rect bounding rectangle - all objects inside this rectangle are returned
-     * @param mapLayer current map layer
-     * @param lazy if true do not fetch new data but return the old potentially incomplete dataset
-     * @return true after clearing the cache. The caller has to request new data
+     * @param layerKey query parameters of the map layer
+     * @param lazy if true do not access the database and build the list from cached tiles only.
+     * Tiles that are not cached are added to missingTiles.
+     * @return true if the list was rebuilt
      */
-    bool updateCache(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy);
+    bool updateCache(const Marble::GeoDataLatLonBox& rect, int layerKey, bool lazy, const LoaderType& loader);
+
+    /* Add a tile that was loaded in the background. Does nothing if the tile is already cached.
+     * @return true if the tile is part of the current list which will be rebuilt on next update */
+    bool insertTile(const TileKey& key, const QList<TYPE>& objects);
     void clear();
 
-    Marble::GeoDataLatLonBox curRect;
-    const MapLayer *curMapLayer = nullptr;
+    /* Name of an object in list. Empty if not found or the type has no separate name. */
+    QString name(int id) const
+    {
+      return strings.string(listIds.value(id, 0));
+    }
+
+    /* Merged objects of all tiles in curTiles */
     QList<TYPE> list;
+
+    /* Object ids in list mapped to the string id of the name */
+    QHash<int, quint32> listIds;
+
+    /* true if any tile in curTiles was truncated by QUERY_ROW_LIMIT */
+    bool truncated = false;
+
+    QVector<TileKey> curTiles;
+
+    /* Tiles of curTiles that were not cached in the last lazy update */
+    QVector<TileKey> missingTiles;
+    QCache<TileKey, MapObjectStore<TYPE> > tiles;
+
+    /* Strings of all tiles. Strings of evicted tiles are removed by compactStrings. */
+    MapStringPool strings;
+
+    /* Pool size after the last compaction */
+    int compactedStrings = 0;
+
+  private:
+    MapObjectStore<TYPE> *createStore(const QList<TYPE>& objects);
+
+    /* Rebuild the string pool from all cached tiles if it has grown too much. Invalidates all string ids
+     * and must be called only before rebuilding the list. */
+    void compactStrings();
+
   };
 
-  const QList<maptypes::MapAirport> *fetchAirports(const Marble::GeoDataLatLonBox& rect,
-                                                   atools::sql::SqlQuery *query, bool reverse,
-                                                   bool lazy, bool overview);
+  /* Database loaders for one tile rectangle. level selects the level of detail if available. */
+  void loadAirports(const Marble::GeoDataLatLonBox& rect, int level, const MapLayer *mapLayer,
+                    QList<maptypes::MapAirport>& airports);
+  void loadWaypoints(const Marble::GeoDataLatLonBox& rect, int level,
+                     QList<maptypes::MapWaypoint>& waypoints);
+  void loadVors(const Marble::GeoDataLatLonBox& rect, int level, QList<maptypes::MapVor>& vors);
+  void loadNdbs(const Marble::GeoDataLatLonBox& rect, int level, QList<maptypes::MapNdb>& ndbs);
+  void loadMarkers(const Marble::GeoDataLatLonBox& rect, QList<maptypes::MapMarker>& markers);
+  void loadIls(const Marble::GeoDataLatLonBox& rect, QList<maptypes::MapIls>& ilsList);
+  void loadAirways(const Marble::GeoDataLatLonBox& rect, QList<maptypes::MapAirway>& airways);
 
   void bindCoordinatePointInRect(const Marble::GeoDataLatLonBox& rect, atools::sql::SqlQuery *query,
                                  const QString& prefix = QString());
 
-  QList<Marble::GeoDataLatLonBox> splitAtAntiMeridian(const Marble::GeoDataLatLonBox& rect);
+  /* true if airports for the layer are loaded using the level of detail table */
+  bool isAirportLod(const MapLayer *mapLayer) const;
+
+  /* Bind all levels of detail that are shown for a tile of the given level */
+  void bindLodLevels(atools::sql::SqlQuery *query, int level);
+
+  /* Object types of the given tile which are neither cached nor requested */
+  maptypes::MapObjectTypes missingTypes(const TileKey& key, maptypes::MapObjectTypes types) const;
+
+  /* Send tiles that were not cached in the last lazy update to the prefetch worker */
+  template<typename TYPE>
+  void requestMissingTiles(const TileRectCache<TYPE>& cache, maptypes::MapObjectTypes type,
+                           const MapLayer *mapLayer);
+  /* visible is true for tiles needed by the current view that were not painted */
+  void requestTiles(const QVector<PrefetchTile>& prefetchTiles, const MapLayer *mapLayer, bool visible);
 
-  static void inflateRect(Marble::GeoDataLatLonBox& rect, double width, double height);
+  /* Called by the prefetch worker with the loaded tiles of a request */
+  void prefetchTilesLoaded(int requestId, QList<MapQuery::TileData> tileData);
 
+  void loadAirportDiagram(int airportId, maptypes::MapAirportDiagram& diagram);
   bool runwayCompare(const maptypes::MapRunway& r1, const maptypes::MapRunway& r2);
 
+  /* limited is false if the query uses levels of detail and does not truncate results */
   template<typename TYPE>
-  void checkOverflow(const QList<TYPE>& list, maptypes::MapObjectTypes type);
+  void checkOverflow(const TileRectCache<TYPE>& cache, maptypes::MapObjectTypes type, bool limited);
+
+  template<typename TYPE, typename POSFUNC>
+  void updateScreenGrid(const CoordinateConverter& conv, const QList<TYPE>& list, MapScreenGrid& grid,
+                        POSFUNC position);
+
+  template<typename TYPE>
+  static const atools::geo::Pos& positionOf(const TYPE& obj)
+  {
+    return obj.getPosition();
+  }
 
   MapTypesFactory *mapTypesFactory;
   atools::sql::SqlDatabase *db;
 
-  /* Simple bounding rectangle caches */
-  SimpleRectCache<maptypes::MapAirport> airportCache;
-  SimpleRectCache<maptypes::MapWaypoint> waypointCache;
-  SimpleRectCache<maptypes::MapVor> vorCache;
-  SimpleRectCache<maptypes::MapNdb> ndbCache;
-  SimpleRectCache<maptypes::MapMarker> markerCache;
-  SimpleRectCache<maptypes::MapIls> ilsCache;
-  SimpleRectCache<maptypes::MapAirway> airwayCache;
+  /* Column indexes for the streaming fill methods of the bounding rectangle queries */
+  MapTypesColumns airportColumns, airportMediumColumns, airportLargeColumns, waypointColumns, vorColumns,
+                  ndbColumns;
+
+  /* Tile caches for bounding rectangle queries */
+  TileRectCache<maptypes::MapAirport> airportCache;
+  TileRectCache<maptypes::MapWaypoint> waypointCache;
+  TileRectCache<maptypes::MapVor> vorCache;
+  TileRectCache<maptypes::MapNdb> ndbCache;
+  TileRectCache<maptypes::MapMarker> markerCache;
+  TileRectCache<maptypes::MapIls> ilsCache;
+  TileRectCache<maptypes::MapAirway> airwayCache;
+  MapAirwayGeometry airwayGeometry;
 
   /* ID/object caches */
-  QCache<int, QList<maptypes::MapRunway> > runwayCache;
-  QCache<int, QList<maptypes::MapRunway> > runwayOverwiewCache;
-  QCache<int, QList<maptypes::MapApron> > apronCache;
-  QCache<int, QList<maptypes::MapTaxiPath> > taxipathCache;
-  QCache<int, QList<maptypes::MapParking> > parkingCache;
-  QCache<int, QList<maptypes::MapStart> > startCache;
-  QCache<int, QList<maptypes::MapHelipad> > helipadCache;
-
-  /* Inflate bounding rectangle before passing it to query */
-  static Q_DECL_CONSTEXPR double RECT_INFLATION_FACTOR_DEG = 0.3;
-  static Q_DECL_CONSTEXPR double RECT_INFLATION_ADD_DEG = 0.1;
-  static Q_DECL_CONSTEXPR int QUERY_ROW_LIMIT = 3000;
+  QCache<int, QVector<maptypes::MapRunway> > runwayOverwiewCache;
+
+  /* Airport diagrams by airport id. Cost is memory size in kB. */
+  QCache<int, maptypes::MapAirportDiagram> diagramCache;
+
+  /* Screen index for getNearestObjects. Valid until the next paint event. */
+  MapScreenGrid airportGrid, towerGrid, vorGrid, ndbGrid, waypointGrid, markerGrid, ilsGrid,
+                parkingGrid, helipadGrid;
+
+  /* Copy of all parking spots and helipads of cached diagrams used by parkingGrid and helipadGrid */
+  QList<maptypes::MapParking> gridParkings;
+  QList<maptypes::MapHelipad> gridHelipads;
+
+  /* Select the tile size so that the larger side of the requested rectangle covers this number of tiles */
+  static Q_DECL_CONSTEXPR double TILES_PER_VIEW = 2.;
+
+  /* Approximate memory limit for each tile cache in kB */
+  static Q_DECL_CONSTEXPR int TILE_CACHE_SIZE_KB = 10000;
+
+  /* Approximate memory limit for all airport diagrams in kB */
+  static Q_DECL_CONSTEXPR int DIAGRAM_CACHE_SIZE_KB = 20000;
+
+  /* Compact the string pool of a tile cache when it has more strings than this and doubled in size */
+  static Q_DECL_CONSTEXPR int MIN_COMPACT_STRINGS = 20000;
+
+  /* Types using level of detail tables built by MapLodBuilder. Airports only for the full airport table
+   * without minimum runway length. */
+  maptypes::MapObjectTypes lodTypes = maptypes::NONE;
+
+  /* Maximum number of tiles sent to the prefetch worker for one view */
+  static Q_DECL_CONSTEXPR int MAX_PREFETCH_TILES = 64;
+
+  /* Loads tiles using its own database connection in prefetchThread. Null if prefetch is not started. */
+  MapPrefetchWorker *prefetchWorker = nullptr;
+  QThread *prefetchThread = nullptr;
+
+  /* Object types of tiles that are requested but not delivered yet. Key uses the airport layer key. */
+  QHash<TileKey, maptypes::MapObjectTypes> requestedTiles;
+
+  /* Tiles for each running prefetch request */
+  QHash<int, QVector<PrefetchTile> > prefetchRequests;
+  int lastPrefetchRequestId = 0;
 
   /* Database queries */
-  atools::sql::SqlQuery *airportByRectQuery = nullptr, *airportMediumByRectQuery = nullptr,
-  *airportLargeByRectQuery = nullptr;
+  atools::sql::SqlQuery *airportByRectQuery = nullptr, *airportLodByRectQuery = nullptr,
+  *airportMediumByRectQuery = nullptr, *airportLargeByRectQuery = nullptr;
 
   atools::sql::SqlQuery *runwayOverviewQuery = nullptr, *apronQuery = nullptr,
   *parkingQuery = nullptr, *startQuery = nullptr, *helipadQuery = nullptr,
@@ -276,39 +511,115 @@ private:
 
 // ---------------------------------------------------------------------------------
 template<typename TYPE>
-bool MapQuery::SimpleRectCache<TYPE>::updateCache(const Marble::GeoDataLatLonBox& rect,
-                                                  const MapLayer *mapLayer,
-                                                  bool lazy)
+bool MapQuery::TileRectCache<TYPE>::updateCache(const Marble::GeoDataLatLonBox& rect, int layerKey, bool lazy,
+                                                const LoaderType& loader)
 {
-  if(lazy)
-    // Nothing changed
+  QVector<TileKey> keys;
+  MapQuery::tilesForRect(rect, layerKey, keys);
+
+  if(keys == curTiles && (missingTiles.isEmpty() || lazy))
+    // Same tiles as last time - list is still valid or tiles are still not available
     return false;
 
-  // Store bounding rectangle and inflate it
-  Marble::GeoDataLatLonBox cur(curRect);
-  MapQuery::inflateRect(cur, cur.width(Marble::GeoDataCoordinates::Degree) *
-                        RECT_INFLATION_FACTOR_DEG + RECT_INFLATION_ADD_DEG,
-                        cur.height(Marble::GeoDataCoordinates::Degree) *
-                        RECT_INFLATION_FACTOR_DEG + RECT_INFLATION_ADD_DEG);
+  list.clear();
+  listIds.clear();
+  truncated = false;
+  missingTiles.clear();
+  compactStrings();
 
-  if(curRect.isEmpty() || !cur.contains(rect) ||
-     !curMapLayer->hasSameQueryParameters(mapLayer))
+  // Objects are found in more than one tile if they are placed on a border or overlap tiles like airways
+  for(const TileKey& key : keys)
   {
-    // Rectangle not covered by loaded data or new layer selected
-    list.clear();
-    curRect = rect;
-    curMapLayer = mapLayer;
+    MapObjectStore<TYPE> *store = tiles.object(key);
+    bool missing = store == nullptr;
+    if(missing && lazy)
+    {
+      // Painted later when the prefetch worker delivers the tile
+      missingTiles.append(key);
+      continue;
+    }
+    else if(missing)
+    {
+      // Not cached or evicted - load from database
+      QList<TYPE> objects;
+      loader(MapQuery::tileRect(key), key.level, objects);
+      store = createStore(objects);
+    }
+
+    truncated |= store->size() >= QUERY_ROW_LIMIT;
+    for(int i = 0; i < store->size(); i++)
+    {
+      int id = store->getId(i);
+      if(!listIds.contains(id))
+      {
+        listIds.insert(id, store->getNameId(i));
+        list.append(TYPE());
+        store->get(i, strings, list.last());
+      }
+    }
+
+    if(missing)
+      // Cache takes ownership and might delete the store immediately if it exceeds the limit
+      tiles.insert(key, store, store->memorySize() / 1024 + 1);
+  }
+
+  curTiles = keys;
+  return true;
+}
+
+template<typename TYPE>
+bool MapQuery::TileRectCache<TYPE>::insertTile(const TileKey& key, const QList<TYPE>& objects)
+{
+  if(tiles.contains(key))
+    return false;
+
+  MapObjectStore<TYPE> *store = createStore(objects);
+  tiles.insert(key, store, store->memorySize() / 1024 + 1);
+
+  if(curTiles.contains(key))
+  {
+    // Force rebuild of the list
+    curTiles.clear();
     return true;
   }
   return false;
 }
 
 template<typename TYPE>
-void MapQuery::SimpleRectCache<TYPE>::clear()
+MapObjectStore<TYPE> *MapQuery::TileRectCache<TYPE>::createStore(const QList<TYPE>& objects)
+{
+  MapObjectStore<TYPE> *store = new MapObjectStore<TYPE>;
+  for(const TYPE& obj : objects)
+    store->append(obj, strings);
+  return store;
+}
+
+template<typename TYPE>
+void MapQuery::TileRectCache<TYPE>::compactStrings()
+{
+  if(strings.size() < MIN_COMPACT_STRINGS || strings.size() < compactedStrings * 2)
+    return;
+
+  // Touching all tiles changes the LRU order which is acceptable since this happens rarely
+  MapStringPool compacted;
+  for(const TileKey& key : tiles.keys())
+    tiles.object(key)->remapStrings(strings, compacted);
+
+  strings = compacted;
+  compactedStrings = strings.size();
+}
+
+template<typename TYPE>
+void MapQuery::TileRectCache<TYPE>::clear()
 {
   list.clear();
-  curRect.clear();
-  curMapLayer = nullptr;
+  listIds.clear();
+  truncated = false;
+  curTiles.clear();
+  missingTiles.clear();
+  tiles.clear();
+  strings.clear();
+  compactedStrings = 0;
 }
 
 #endif // LITTLENAVMAP_MAPQUERY_H
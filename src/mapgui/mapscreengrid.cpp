@@ -0,0 +1,117 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mapgui/mapscreengrid.h"
+
+#include "geo/calculations.h"
+
+#include <algorithm>
+
+MapScreenGrid::MapScreenGrid()
+{
+}
+
+MapScreenGrid::~MapScreenGrid()
+{
+}
+
+void MapScreenGrid::clear()
+{
+  points.clear();
+  unsortedPoints.clear();
+  cellStart.clear();
+  numX = numY = 0;
+  valid = false;
+}
+
+void MapScreenGrid::addPoint(int index, int x, int y)
+{
+  unsortedPoints.append({index, x, y});
+}
+
+void MapScreenGrid::finish()
+{
+  valid = true;
+  if(unsortedPoints.isEmpty())
+    return;
+
+  int maxX = unsortedPoints.first().x, maxY = unsortedPoints.first().y;
+  minX = maxX;
+  minY = maxY;
+  for(const Point& point : unsortedPoints)
+  {
+    minX = std::min(minX, point.x);
+    minY = std::min(minY, point.y);
+    maxX = std::max(maxX, point.x);
+    maxY = std::max(maxY, point.y);
+  }
+
+  int extent = std::max(maxX - minX, maxY - minY);
+  cellSize = std::max(MIN_CELL_SIZE, extent / MAX_CELLS + 1);
+  numX = (maxX - minX) / cellSize + 1;
+  numY = (maxY - minY) / cellSize + 1;
+
+  // Counting sort of points by cell
+  cellStart.fill(0, numX * numY + 1);
+  for(const Point& point : unsortedPoints)
+    cellStart[cellY(point.y) * numX + cellX(point.x) + 1]++;
+
+  for(int i = 1; i < cellStart.size(); i++)
+    cellStart[i] += cellStart.at(i - 1);
+
+  QVector<int> fill(cellStart);
+  points.resize(unsortedPoints.size());
+  for(const Point& point : unsortedPoints)
+    points[fill[cellY(point.y) * numX + cellX(point.x)]++] = point;
+  unsortedPoints.clear();
+}
+
+void MapScreenGrid::getNearest(int xs, int ys, int maxDistance, QVector<int>& indexes) const
+{
+  indexes.clear();
+  if(points.isEmpty())
+    return;
+
+  // Points outside of the grid are clamped into the border cells
+  int x1 = cellX(xs - maxDistance), x2 = cellX(xs + maxDistance);
+  int y1 = cellY(ys - maxDistance), y2 = cellY(ys + maxDistance);
+
+  for(int y = y1; y <= y2; y++)
+  {
+    for(int x = x1; x <= x2; x++)
+    {
+      int cell = y * numX + x;
+      for(int i = cellStart.at(cell); i < cellStart.at(cell + 1); i++)
+      {
+        const Point& point = points.at(i);
+        if(atools::geo::manhattanDistance(point.x, point.y, xs, ys) < maxDistance)
+          indexes.append(point.index);
+      }
+    }
+  }
+  std::sort(indexes.begin(), indexes.end());
+}
+
+int MapScreenGrid::cellX(int x) const
+{
+  return std::min(std::max((x - minX) / cellSize, 0), numX - 1);
+}
+
+int MapScreenGrid::cellY(int y) const
+{
+  return std::min(std::max((y - minY) / cellSize, 0), numY - 1);
+}
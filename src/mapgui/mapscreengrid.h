@@ -0,0 +1,83 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPSCREENGRID_H
+#define LITTLENAVMAP_MAPSCREENGRID_H
+
+#include <QVector>
+
+/*
+ * Uniform grid of screen cells that stores object indexes and screen coordinates for fast nearest lookups.
+ * Filled once after a paint event and used by all following mouse clicks and tooltips until the view
+ * changes. Grid covers the bounding rectangle of all points.
+ */
+class MapScreenGrid
+{
+public:
+  MapScreenGrid();
+  ~MapScreenGrid();
+
+  /* Mark as outdated after the view or the object list has changed */
+  void invalidate()
+  {
+    valid = false;
+  }
+
+  bool isValid() const
+  {
+    return valid;
+  }
+
+  /* Remove all points before adding new ones */
+  void clear();
+
+  /* Add screen coordinates for an object index. Call finish after adding all points. */
+  void addPoint(int index, int x, int y);
+
+  /* Sort points into cells and mark grid as valid */
+  void finish();
+
+  /*
+   * Get indexes of all objects with a manhattan distance to xs/ys smaller than maxDistance.
+   * @param indexes receives object indexes in ascending order
+   */
+  void getNearest(int xs, int ys, int maxDistance, QVector<int>& indexes) const;
+
+private:
+  struct Point
+  {
+    int index, x, y;
+  };
+
+  int cellX(int x) const;
+  int cellY(int y) const;
+
+  /* Points ordered by cell after finish and points added since last clear */
+  QVector<Point> points, unsortedPoints;
+
+  /* Index of the first point for each cell. Has one more entry than cells. */
+  QVector<int> cellStart;
+
+  int minX = 0, minY = 0, numX = 0, numY = 0, cellSize = MIN_CELL_SIZE;
+  bool valid = false;
+
+  /* Cell size in pixel. Increased for large extents to limit number of cells. */
+  static Q_DECL_CONSTEXPR int MIN_CELL_SIZE = 32;
+  static Q_DECL_CONSTEXPR int MAX_CELLS = 256;
+};
+
+#endif // LITTLENAVMAP_MAPSCREENGRID_H
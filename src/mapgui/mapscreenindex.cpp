@@ -31,6 +31,8 @@
 #include "common/constants.h"
 #include "settings/settings.h"
 
+#include <cmath>
+
 MapScreenIndex::MapScreenIndex(MapWidget *parentWidget, MapQuery *mapQueryParam, MapPaintLayer *mapPaintLayer)
   : mapWidget(parentWidget), mapQuery(mapQueryParam), paintLayer(mapPaintLayer)
 {
@@ -48,7 +50,6 @@ void MapScreenIndex::updateAirwayScreenGeometry(const Marble::GeoDataLatLonAltBo
 
   airwayLines.clear();
 
-  CoordinateConverter conv(mapWidget->viewport());
   const MapScale *scale = paintLayer->getMapScale();
   bool showJet = paintLayer->getShownMapObjects().testFlag(maptypes::AIRWAYJ);
   bool showVictor = paintLayer->getShownMapObjects().testFlag(maptypes::AIRWAYV);
@@ -59,6 +60,10 @@ void MapScreenIndex::updateAirwayScreenGeometry(const Marble::GeoDataLatLonAltBo
     const QList<MapAirway> *airways = mapQuery->getAirways(curBox, paintLayer->getMapLayer(), false);
     const QRect& mapGeo = mapWidget->rect();
 
+    // Reuses the points projected by the painter if the view has not changed
+    MapAirwayGeometry *geometry = mapQuery->getAirwayGeometry();
+    geometry->beginFrame(mapWidget->viewport(), scale);
+
     for(int i = 0; i < airways->size(); i++)
     {
       const MapAirway& airway = airways->at(i);
@@ -72,21 +77,19 @@ void MapScreenIndex::updateAirwayScreenGeometry(const Marble::GeoDataLatLonAltBo
       if(airwaybox.intersects(curBox))
       {
         // Airway segment intersects with view rectangle
-        float distanceMeter = airway.from.distanceMeterTo(airway.to);
-        // Approximate the needed number of line segments
-        float numSegments = std::min(std::max(scale->getPixelIntForMeter(distanceMeter) / 40.f, 2.f), 72.f);
-        float step = 1.f / numSegments;
-
-        // Split the segments into smaller lines and add them only if visible
-        for(int j = 0; j < numSegments; j++)
+        int first;
+        int numPolylines = geometry->project(airway, first);
+        for(int j = first; j < first + numPolylines; j++)
         {
-          float cur = step * static_cast<float>(j);
-          int xs1, ys1, xs2, ys2;
-          conv.wToS(airway.from.interpolate(airway.to, distanceMeter, cur), xs1, ys1);
-          conv.wToS(airway.from.interpolate(airway.to, distanceMeter, cur + step), xs2, ys2);
-
-          if(mapGeo.intersects(QRect(QPoint(xs1, ys1), QPoint(xs2, ys2))))
-            airwayLines.append(std::make_pair(airway.id, QLine(xs1, ys1, xs2, ys2)));
+          const MapAirwayGeometry::Polyline& polyline = geometry->getPolyline(j);
+          const QPoint *points = geometry->getPoints(polyline);
+
+          // Add the lines of the great circle only if visible
+          for(int k = 0; k < polyline.size - 1; k++)
+          {
+            if(mapGeo.intersects(QRect(points[k], points[k + 1])))
+              airwayLines.append(std::make_pair(airway.id, QLine(points[k], points[k + 1])));
+          }
         }
       }
     }
@@ -119,12 +122,14 @@ void MapScreenIndex::updateRouteScreenGeometry()
   QList<std::pair<int, QPoint> > airportPoints;
   QList<std::pair<int, QPoint> > otherPoints;
 
-  CoordinateConverter conv(mapWidget->viewport());
+  CoordinateConverter conv(mapWidget->viewport(), mapWidget->getProjectionCache());
   const MapScale *scale = paintLayer->getMapScale();
   if(scale->isValid())
   {
     Pos p1;
     const QRect& mapGeo = mapWidget->rect();
+    QVector<Pos> legPositions;
+    QVector<QPoint> legPoints;
 
     for(int i = 0; i < routeMapObjects.size(); i++)
     {
@@ -143,19 +148,21 @@ void MapScreenIndex::updateRouteScreenGeometry()
       {
         float distanceMeter = p2.distanceMeterTo(p1);
         // Approximate the needed number of line segments
-        float numSegments = std::min(std::max(scale->getPixelIntForMeter(distanceMeter) / 140.f, 4.f), 288.f);
-        float step = 1.f / numSegments;
+        float segments = std::min(std::max(scale->getPixelIntForMeter(distanceMeter) / 140.f, 4.f), 288.f);
+        int numSegments = static_cast<int>(std::ceil(segments));
 
-        // Split the legs into smaller lines and add them only if visible
+        // Split the legs into smaller lines and project all points in one pass
+        legPositions.resize(numSegments + 1);
+        for(int j = 0; j <= numSegments; j++)
+          legPositions[j] = p1.interpolate(p2, distanceMeter,
+                                           static_cast<float>(j) / static_cast<float>(numSegments));
+        conv.wToS(legPositions, legPoints);
+
+        // Add lines only if visible
         for(int j = 0; j < numSegments; j++)
         {
-          float cur = step * static_cast<float>(j);
-          int xs1, ys1, xs2, ys2;
-          conv.wToS(p1.interpolate(p2, distanceMeter, cur), xs1, ys1);
-          conv.wToS(p1.interpolate(p2, distanceMeter, cur + step), xs2, ys2);
-
-          if(mapGeo.intersects(QRect(QPoint(xs1, ys1), QPoint(xs2, ys2))))
-            routeLines.append(std::make_pair(i - 1, QLine(xs1, ys1, xs2, ys2)));
+          if(mapGeo.intersects(QRect(legPoints.at(j), legPoints.at(j + 1))))
+            routeLines.append(std::make_pair(i - 1, QLine(legPoints.at(j), legPoints.at(j + 1))));
         }
       }
       p1 = p2;
@@ -168,7 +175,7 @@ void MapScreenIndex::updateRouteScreenGeometry()
 
 void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, maptypes::MapSearchResult& result)
 {
-  CoordinateConverter conv(mapWidget->viewport());
+  CoordinateConverter conv(mapWidget->viewport(), mapWidget->getProjectionCache());
   const MapLayer *mapLayer = paintLayer->getMapLayer();
   const MapLayer *mapLayerEffective = paintLayer->getMapLayerEffective();
 
@@ -197,7 +204,7 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, maptypes::Ma
 
 void MapScreenIndex::getNearestHighlights(int xs, int ys, int maxDistance, maptypes::MapSearchResult& result)
 {
-  CoordinateConverter conv(mapWidget->viewport());
+  CoordinateConverter conv(mapWidget->viewport(), mapWidget->getProjectionCache());
   int x, y;
 
   using maptools::insertSortedByDistance;
@@ -225,7 +232,7 @@ void MapScreenIndex::getNearestHighlights(int xs, int ys, int maxDistance, mapty
 
 int MapScreenIndex::getNearestDistanceMarkIndex(int xs, int ys, int maxDistance)
 {
-  CoordinateConverter conv(mapWidget->viewport());
+  CoordinateConverter conv(mapWidget->viewport(), mapWidget->getProjectionCache());
   int index = 0;
   int x, y;
   for(const maptypes::DistanceMarker& marker : distanceMarks)
@@ -309,7 +316,7 @@ int MapScreenIndex::getNearestRouteLegIndex(int xs, int ys, int maxDistance)
 
 int MapScreenIndex::getNearestRangeMarkIndex(int xs, int ys, int maxDistance)
 {
-  CoordinateConverter conv(mapWidget->viewport());
+  CoordinateConverter conv(mapWidget->viewport(), mapWidget->getProjectionCache());
   int index = 0;
   int x, y;
   for(const maptypes::RangeMarker& marker : rangeMarks)
@@ -0,0 +1,246 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mapgui/maptilerenderer.h"
+
+#include "common/maplabellayout.h"
+#include "mapgui/maplayer.h"
+#include "mapgui/mappainterairport.h"
+#include "mapgui/mappainterils.h"
+#include "mapgui/mappainternav.h"
+#include "mapgui/mapscale.h"
+#include "mapgui/mapwidget.h"
+
+#include <QFuture>
+#include <QImage>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+
+#include <marble/GeoPainter.h>
+#include <marble/ViewportParams.h>
+
+using namespace Marble;
+using namespace maptypes;
+
+MapTileRenderer::MapTileRenderer(MapWidget *widget, MapQuery *mapQuery, MapScale *mapScale)
+  : mapWidget(widget), converter(widget->viewport(), widget->getProjectionCache()), scale(mapScale)
+{
+  RouteController *routeController = mapWidget->getRouteController();
+
+  painterIls = new MapPainterIls(mapWidget, mapQuery, mapScale);
+  painterNav = new MapPainterNav(mapWidget, mapQuery, mapScale);
+  painterAirport = new MapPainterAirport(mapWidget, mapQuery, mapScale, routeController);
+
+  // Use a grid that is as square as possible
+  int numTiles = std::min(std::max(QThread::idealThreadCount(), 1), MAX_TILES);
+  tileColumns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numTiles))));
+  tileRows = (numTiles + tileColumns - 1) / tileColumns;
+
+  for(int i = 0; i < tileColumns * tileRows; i++)
+  {
+    Tile *tile = new Tile;
+    tile->viewport = new ViewportParams();
+    tile->labelLayout = new MapLabelLayout();
+
+    // Painters of tiles do not use the projection cache since it is not thread safe
+    tile->painterIls = new MapPainterIls(mapWidget, mapQuery, mapScale);
+    tile->painterNav = new MapPainterNav(mapWidget, mapQuery, mapScale);
+    tile->painterAirport = new MapPainterAirport(mapWidget, mapQuery, mapScale, routeController);
+    for(MapPainter *painter : {static_cast<MapPainter *>(tile->painterIls),
+                               static_cast<MapPainter *>(tile->painterNav),
+                               static_cast<MapPainter *>(tile->painterAirport)})
+    {
+      painter->setViewport(tile->viewport, nullptr);
+      painter->setLabelLayout(tile->labelLayout);
+    }
+    tiles.append(tile);
+  }
+}
+
+MapTileRenderer::~MapTileRenderer()
+{
+  for(Tile *tile : tiles)
+  {
+    delete tile->painterIls;
+    delete tile->painterNav;
+    delete tile->painterAirport;
+    delete tile->labelLayout;
+    delete tile->viewport;
+    delete tile;
+  }
+
+  delete painterIls;
+  delete painterNav;
+  delete painterAirport;
+}
+
+void MapTileRenderer::clearTextCache()
+{
+  for(Tile *tile : tiles)
+    tile->labelLayout->clearTextCache();
+}
+
+void MapTileRenderer::render(const PaintContext *context, QImage *image, MapLabelLayout *labelLayout)
+{
+  updateTiles(context->viewport);
+
+  // Get all objects from the caches on the GUI thread - lists are shared with the caches
+  PaintObjects objects;
+  painterIls->fetchObjects(context, objects);
+  painterNav->fetchObjects(context, objects);
+  painterAirport->fetchObjects(context, objects);
+
+  // Symbols are drawn by all tiles touched by the largest symbol. Large VOR have a compass rose
+  // of five times the symbol size.
+  const MapLayer *layer = context->mapLayerEffective;
+  int vorSize = layer->isVorLarge() ? layer->getVorSymbolSize() * 5 : layer->getVorSymbolSize();
+  int margin = context->symSize(std::max({layer->getAirportSymbolSize(), layer->getWaypointSymbolSize(),
+                                          vorSize, layer->getNdbSymbolSize(),
+                                          layer->getMarkerSymbolSize()})) / 2 + SYMBOL_MARGIN;
+
+  // Rectangle around an object or all tiles if position is not visible but bounding is
+  auto objectRect = [this, context, margin](const atools::geo::Pos& pos,
+                                            const atools::geo::Rect *bounding) -> QRect
+                    {
+                      int x, y;
+                      if(bounding != nullptr)
+                      {
+                        QSize size = scale->getScreeenSizeForRect(*bounding);
+                        if(converter.wToS(pos, x, y, size))
+                        {
+                          int extent = std::max(size.width(), size.height()) + margin;
+                          return QRect(x - extent, y - extent, 2 * extent, 2 * extent);
+                        }
+                        else if(bounding->overlaps(context->viewportRect))
+                          return QRect(QPoint(0, 0), context->viewport->size());
+                      }
+                      else if(converter.wToS(pos, x, y))
+                        return QRect(x - margin, y - margin, 2 * margin, 2 * margin);
+                      return QRect();
+                    };
+
+  for(Tile *tile : tiles)
+    tile->objects = PaintObjects();
+
+  for(const MapIls& ils : objects.ils)
+    distribute(objectRect(ils.position, &ils.bounding), ils, &PaintObjects::ils);
+  for(const MapWaypoint& waypoint : objects.waypoints)
+    distribute(objectRect(waypoint.position, nullptr), waypoint, &PaintObjects::waypoints);
+  for(const MapVor& vor : objects.vors)
+    distribute(objectRect(vor.position, nullptr), vor, &PaintObjects::vors);
+  for(const MapNdb& ndb : objects.ndbs)
+    distribute(objectRect(ndb.position, nullptr), ndb, &PaintObjects::ndbs);
+  for(const MapMarker& marker : objects.markers)
+    distribute(objectRect(marker.position, nullptr), marker, &PaintObjects::markers);
+  for(const MapAirport& airport : objects.airports)
+    distribute(objectRect(airport.position, &airport.bounding), airport, &PaintObjects::airports);
+
+  for(Tile *tile : tiles)
+  {
+    // Read only in tiles
+    tile->objects.routeAirportIds = objects.routeAirportIds;
+    tile->objects.overviewRunways = objects.overviewRunways;
+  }
+
+  // Run all tiles in the global thread pool and wait - GUI thread objects are not modified meanwhile
+  // Detach image only once here and not in the threads
+  uchar *bits = image->bits();
+  MapQuality quality = mapWidget->mapQuality();
+  QList<QFuture<void> > futures;
+  for(Tile *tile : tiles)
+  {
+    if(!tile->rect.isEmpty())
+      futures.append(QtConcurrent::run(this, &MapTileRenderer::renderTile, tile, context, bits,
+                                       static_cast<const QImage *>(image), quality));
+  }
+  for(QFuture<void>& future : futures)
+    future.waitForFinished();
+
+  for(Tile *tile : tiles)
+    labelLayout->addLabels(context->painter, *tile->labelLayout);
+}
+
+void MapTileRenderer::renderTile(Tile *tile, const PaintContext *context, uchar *bits, const QImage *image,
+                                 MapQuality quality)
+{
+  // Image header sharing the memory of the overlay image. The painter is clipped to the tile
+  // so no other tile is touched.
+  QImage tileImage(bits, image->width(), image->height(), image->bytesPerLine(), image->format());
+  tileImage.setDevicePixelRatio(image->devicePixelRatio());
+
+  GeoPainter painter(&tileImage, tile->viewport, quality);
+  painter.setClipRect(tile->rect);
+  painter.setFont(context->defaultFontScaled);
+
+  PaintContext tileContext = *context;
+  tileContext.painter = &painter;
+  tileContext.viewport = tile->viewport;
+
+  tile->labelLayout->beginFrame(&painter, tile->viewport->size());
+  tile->labelLayout->setPositionRect(tile->labelRect);
+
+  tile->painterIls->renderObjects(&tileContext, tile->objects);
+  tile->painterNav->renderObjects(&tileContext, tile->objects);
+  tile->painterAirport->renderObjects(&tileContext, tile->objects);
+
+  painter.end();
+}
+
+void MapTileRenderer::updateTiles(const ViewportParams *viewport)
+{
+  QSize size = viewport->size();
+  int tileWidth = (size.width() + tileColumns - 1) / tileColumns;
+  int tileHeight = (size.height() + tileRows - 1) / tileRows;
+
+  for(int row = 0; row < tileRows; row++)
+  {
+    for(int column = 0; column < tileColumns; column++)
+    {
+      Tile *tile = tiles.at(row * tileColumns + column);
+      tile->rect = QRect(column * tileWidth, row * tileHeight, tileWidth, tileHeight) &
+                   QRect(QPoint(0, 0), size);
+
+      // Labels positioned outside of the screen belong to the tiles at the border
+      QPoint topLeft(column == 0 ? -size.width() : tile->rect.left(),
+                     row == 0 ? -size.height() : tile->rect.top());
+      QPoint bottomRight(column == tileColumns - 1 ? 2 * size.width() : tile->rect.right(),
+                         row == tileRows - 1 ? 2 * size.height() : tile->rect.bottom());
+      tile->labelRect = QRect(topLeft, bottomRight);
+
+      tile->viewport->setProjection(viewport->projection());
+      tile->viewport->setRadius(viewport->radius());
+      tile->viewport->centerOn(viewport->centerLongitude(), viewport->centerLatitude());
+      tile->viewport->setSize(size);
+    }
+  }
+}
+
+template<typename TYPE>
+void MapTileRenderer::distribute(const QRect& rect, const TYPE& obj, QList<TYPE> PaintObjects::*list)
+{
+  if(rect.isEmpty())
+    return;
+
+  for(Tile *tile : tiles)
+  {
+    if(tile->rect.intersects(rect))
+      (tile->objects.*list).append(obj);
+  }
+}
@@ -0,0 +1,115 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPTILERENDERER_H
+#define LITTLENAVMAP_MAPTILERENDERER_H
+
+#include "mapgui/mappainter.h"
+
+#include <QRect>
+#include <QVector>
+
+namespace Marble {
+class ViewportParams;
+}
+
+class MapLabelLayout;
+class MapPainterAirport;
+class MapPainterIls;
+class MapPainterNav;
+class MapQuery;
+class MapScale;
+class MapWidget;
+class QImage;
+
+/*
+ * Draws ILS, navaids and airports in parallel into the offscreen overlay image. The image is split into
+ * a grid of tiles with one tile per processor core.
+ *
+ * Objects are copied from the query caches on the GUI thread and distributed to all tiles touched by
+ * their symbols. Each tile has its own painters, viewport copy and label layout so the worker threads in
+ * the global thread pool share no mutable state. Tiles draw directly into the overlay image memory using
+ * a painter clipped to the tile rectangle. Labels of all tiles are passed to the label layout of the
+ * overlay afterwards.
+ *
+ * Airways, airport diagrams and the flight plan are not drawn by tiles.
+ */
+class MapTileRenderer
+{
+public:
+  MapTileRenderer(MapWidget *widget, MapQuery *mapQuery, MapScale *mapScale);
+  ~MapTileRenderer();
+
+  /* Draw ILS, navaids and airports into image which has to be the paint device of context->painter.
+   * Blocks until all tiles are done. Labels are added to labelLayout. */
+  void render(const PaintContext *context, QImage *image, MapLabelLayout *labelLayout);
+
+  /* Drop cached label texts of all tiles */
+  void clearTextCache();
+
+  int getNumTiles() const
+  {
+    return tiles.size();
+  }
+
+private:
+  struct Tile
+  {
+    QRect rect; /* Screen rectangle without margin */
+    QRect labelRect; /* Labels positioned in this rectangle belong to the tile */
+    PaintObjects objects;
+    Marble::ViewportParams *viewport;
+    MapPainterIls *painterIls;
+    MapPainterNav *painterNav;
+    MapPainterAirport *painterAirport;
+    MapLabelLayout *labelLayout;
+  };
+
+  /* Called in thread pool */
+  void renderTile(Tile *tile, const PaintContext *context, uchar *bits, const QImage *image,
+                  Marble::MapQuality quality);
+
+  /* Calculate tile rectangles and update the viewport copies */
+  void updateTiles(const Marble::ViewportParams *viewport);
+
+  /* Copy objects to all tiles overlapping the given screen rectangle */
+  template<typename TYPE>
+  void distribute(const QRect& rect, const TYPE& obj, QList<TYPE> PaintObjects::*list);
+
+  QVector<Tile *> tiles;
+  int tileColumns = 1, tileRows = 1;
+
+  MapWidget *mapWidget;
+
+  /* Used on the GUI thread to fetch all objects */
+  MapPainterIls *painterIls;
+  MapPainterNav *painterNav;
+  MapPainterAirport *painterAirport;
+
+  /* Projects object positions on the GUI thread using the shared projection cache */
+  CoordinateConverter converter;
+
+  MapScale *scale;
+
+  /* Margin in pixel around symbols in addition to the symbol size */
+  static Q_DECL_CONSTEXPR int SYMBOL_MARGIN = 8;
+
+  /* Limits number of tiles on machines with many cores */
+  static Q_DECL_CONSTEXPR int MAX_TILES = 16;
+};
+
+#endif // LITTLENAVMAP_MAPTILERENDERER_H
@@ -95,6 +95,13 @@ MapWidget::MapWidget(MainWindow *parent, MapQuery *query)
 
   screenIndex = new MapScreenIndex(this, mapQuery, paintLayer);
 
+  // Repaint when the background prefetch delivered missing map objects
+  connect(mapQuery, &MapQuery::tilesPrefetched, this, [ = ]()
+          {
+            paintLayer->invalidateOverlay();
+            update();
+          });
+
   // Disable all unwante popups on mouse click
   MarbleWidgetInputHandler *input = inputHandler();
   input->setMouseButtonPopupEnabled(Qt::RightButton, false);
@@ -149,6 +156,10 @@ void MapWidget::optionsChanged()
   screenSearchDistance = OptionData::instance().getMapClickSensitivity();
   screenSearchDistanceTooltip = OptionData::instance().getMapTooltipSensitivity();
 
+  // Symbol and text sizes or colors might have changed
+  paintLayer->invalidateOverlay();
+  paintLayer->clearTextCache();
+
   updateCacheSizes();
 }
 
@@ -468,6 +479,9 @@ void MapWidget::changeRouteHighlights(const RouteMapObjectList& routeHighlight)
 
 void MapWidget::routeChanged(bool geometryChanged)
 {
+  // Flight plan is part of the retained overlay
+  paintLayer->invalidateOverlay();
+
   if(geometryChanged)
   {
     cancelDragAll();
@@ -483,7 +497,7 @@ void MapWidget::simDataChanged(const atools::fs::sc::SimConnectData& simulatorDa
 
   simData = simulatorData;
 
-  CoordinateConverter conv(viewport());
+  CoordinateConverter conv(viewport(), &projectionCache);
   QPoint curPos = conv.wToS(simulatorData.getPosition());
   QPoint diff = curPos - conv.wToS(lastSimData.getPosition());
 
@@ -550,7 +564,7 @@ void MapWidget::highlightProfilePoint(const atools::geo::Pos& pos)
 {
   if(pos.isValid())
   {
-    CoordinateConverter conv(viewport());
+    CoordinateConverter conv(viewport(), &projectionCache);
     int x, y;
     if(conv.wToS(pos, x, y))
     {
@@ -629,7 +643,7 @@ void MapWidget::updateRouteFromDrag(QPoint newPoint, mw::MouseStates state, int
   maptypes::MapSearchResult result;
   screenIndex->getAllNearest(newPoint.x(), newPoint.y(), screenSearchDistance, result);
 
-  CoordinateConverter conv(viewport());
+  CoordinateConverter conv(viewport(), &projectionCache);
 
   // Get objects from cache - already present objects will be skipped
   mapQuery->getNearestObjects(conv, paintLayer->getMapLayer(), false,
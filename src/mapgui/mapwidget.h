@@ -22,6 +22,7 @@
 #include "gui/mapposhistory.h"
 #include "fs/sc/simconnectdata.h"
 #include "common/aircrafttrack.h"
+#include "common/projectioncache.h"
 
 #include <QWidget>
 
@@ -211,6 +212,12 @@ public:
 
   RouteController *getRouteController() const;
 
+  /* Screen coordinates shared by all painters and the screen index for the current frame */
+  ProjectionCache *getProjectionCache()
+  {
+    return &projectionCache;
+  }
+
   /* Update the shown map object types depending on action status (toolbar or menu) */
   void updateMapObjectsShown();
 
@@ -345,6 +352,7 @@ private:
   MapPaintLayer *paintLayer;
   MapQuery *mapQuery;
   MapScreenIndex *screenIndex = nullptr;
+  ProjectionCache projectionCache;
 
   atools::geo::Pos searchMarkPos, homePos;
   double homeDistance = 0.;
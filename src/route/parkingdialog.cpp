@@ -33,12 +33,12 @@ ParkingDialog::ParkingDialog(QWidget *parent, MapQuery *mapQuery,
   // Update label with airport name/ident
   ui->labelSelectParking->setText(ui->labelSelectParking->text().arg(maptypes::airportText(departureAirport)));
 
-  const QList<maptypes::MapStart> *startCache = mapQuery->getStartPositionsForAirport(departureAirport.id);
+  const QVector<maptypes::MapStart> *startCache = mapQuery->getStartPositionsForAirport(departureAirport.id);
   // Create a copy from the cached start objects to allow sorting
   for(const maptypes::MapStart& start : *startCache)
     entries.append({maptypes::MapParking(), start});
 
-  const QList<maptypes::MapParking> *parkingCache = mapQuery->getParkingsForAirport(departureAirport.id);
+  const QVector<maptypes::MapParking> *parkingCache = mapQuery->getParkingsForAirport(departureAirport.id);
   // Create a copy from the cached parking objects and exclude fuel
   for(const maptypes::MapParking& parking : *parkingCache)
     // Vehicles are already omitted in database creation
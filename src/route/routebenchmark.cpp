@@ -0,0 +1,265 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routebenchmark.h"
+
+#include "common/benchmarkarguments.h"
+#include "route/routecalcworker.h"
+#include "route/routefinder.h"
+#include "route/routenetworkairway.h"
+#include "route/routenetworkradio.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "exception.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegExp>
+#include <QTextStream>
+
+using atools::sql::SqlDatabase;
+using atools::sql::SqlQuery;
+using atools::geo::Pos;
+
+namespace {
+/* Command line option that starts the benchmark */
+const QString BENCHMARK_OPTION("--route-benchmark");
+
+/* CSV header. Keep in sync with RouteBenchmark::calculate. */
+const QString CSV_HEADER("departure,destination,altitude_ft,mode,bidirectional,incremental,found,too_long,"
+                         "expanded_nodes,loaded_nodes,queries,time_ms,distance_nm,direct_nm,ratio");
+
+}
+
+RouteBenchmark::RouteBenchmark(const QStringList& arguments)
+{
+  BenchmarkArguments args(arguments, BENCHMARK_OPTION,
+                          {"--bidirectional", "--no-preload", "--no-landmarks", "--no-hierarchies",
+                           "--no-incremental"}, {"--altitude"});
+  bidirectional = args.hasFlag("--bidirectional");
+  preloadGraph = !args.hasFlag("--no-preload");
+  useLandmarks = !args.hasFlag("--no-landmarks");
+  useHierarchies = !args.hasFlag("--no-hierarchies");
+  incremental = !args.hasFlag("--no-incremental");
+
+  bool altitudeValid;
+  defaultAltitude = args.intValue("--altitude", defaultAltitude, altitudeValid);
+
+  const QStringList& files = args.getFiles();
+  if(args.isValid() && altitudeValid && defaultAltitude >= 0 && (files.size() == 2 || files.size() == 3))
+  {
+    databaseFile = files.at(0);
+    corpusFile = files.at(1);
+    outputFile = files.value(2);
+    argumentsValid = true;
+  }
+}
+
+RouteBenchmark::~RouteBenchmark()
+{
+  qDeleteAll(routeFinders);
+
+  if(db != nullptr)
+  {
+    db->close();
+    delete db;
+    SqlDatabase::removeDatabase(DATABASE_NAME);
+  }
+}
+
+bool RouteBenchmark::isBenchmark(const QStringList& arguments)
+{
+  return BenchmarkArguments::isBenchmark(arguments, BENCHMARK_OPTION);
+}
+
+int RouteBenchmark::run()
+{
+  if(!argumentsValid)
+  {
+    BenchmarkArguments::printUsage(BENCHMARK_OPTION, "DATABASE CORPUS [OUTPUT] [--bidirectional] "
+                                                     "[--no-preload] [--no-landmarks] [--no-hierarchies] "
+                                                     "[--no-incremental] [--altitude FT]");
+    return 1;
+  }
+
+  QList<AirportPair> pairs;
+  if(!readCorpus(pairs))
+    return 1;
+
+  QFile outFile;
+  if(!BenchmarkArguments::openOutput(outFile, outputFile))
+    return 1;
+  QTextStream out(&outFile);
+
+  RouteNetwork *networkRadio = nullptr, *networkAirway = nullptr;
+  try
+  {
+    db = new SqlDatabase(SqlDatabase::addDatabase(DATABASE_TYPE, DATABASE_NAME));
+    db->setDatabaseName(databaseFile);
+    db->open();
+
+    networkRadio = new RouteNetworkRadio(db);
+    networkAirway = new RouteNetworkAirway(db);
+    for(RouteNetwork *network : {networkRadio, networkAirway})
+    {
+      network->setPreloadGraph(preloadGraph);
+      network->setUseLandmarks(useLandmarks);
+      network->setUseHierarchies(useHierarchies && network == networkAirway);
+
+      // Load graph and landmarks up front to measure only the calculation
+      QElapsedTimer timer;
+      timer.start();
+      network->loadGraph();
+      qInfo() << "Network loaded in" << timer.elapsed() << "ms";
+    }
+
+    // All mode combinations that are supported by the networks
+    const QList<ModeVariant> variants({
+      {"radionav", nw::ROUTE_RADIONAV, false},
+      {"victor", nw::ROUTE_VICTOR, true},
+      {"jet", nw::ROUTE_JET, true},
+      {"victor_jet", nw::ROUTE_VICTOR | nw::ROUTE_JET, true}
+    });
+
+    for(const ModeVariant& variant : variants)
+    {
+      RouteFinder *routeFinder = new RouteFinder(variant.airway ? networkAirway : networkRadio);
+      routeFinder->setBidirectional(bidirectional);
+      routeFinder->setIncremental(incremental);
+      routeFinders.insert(variant.name, routeFinder);
+    }
+
+    out << CSV_HEADER << endl;
+
+    SqlQuery airportQuery(db);
+    airportQuery.prepare("select lonx, laty from airport where ident = :ident");
+
+    for(const AirportPair& pair : pairs)
+    {
+      Pos departure, destination;
+      if(!airportPos(airportQuery, pair.departure, departure) ||
+         !airportPos(airportQuery, pair.destination, destination))
+        continue;
+
+      for(const ModeVariant& variant : variants)
+        calculate(variant.airway ? networkAirway : networkRadio, routeFinders.value(variant.name), variant,
+                  pair, departure, destination, out);
+    }
+  }
+  catch(atools::Exception& e)
+  {
+    qCritical() << "Benchmark failed" << e.what();
+    qDeleteAll(routeFinders);
+    routeFinders.clear();
+    delete networkRadio;
+    delete networkAirway;
+    return 1;
+  }
+
+  // Finders refer to the networks
+  qDeleteAll(routeFinders);
+  routeFinders.clear();
+  delete networkRadio;
+  delete networkAirway;
+
+  qInfo() << "Benchmark done. Calculations" << numCalculations << "found" << numFound
+          << "total time" << totalTimeMs << "ms";
+  return 0;
+}
+
+bool RouteBenchmark::readCorpus(QList<AirportPair>& pairs)
+{
+  QFile file(corpusFile);
+  if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+  {
+    qCritical() << "Cannot open corpus" << corpusFile << file.errorString();
+    return false;
+  }
+
+  QTextStream stream(&file);
+  while(!stream.atEnd())
+  {
+    QString line = stream.readLine().trimmed();
+    if(line.isEmpty() || line.startsWith("#"))
+      continue;
+
+    QStringList columns = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    bool altitudeValid = true;
+    int altitude = columns.size() == 3 ? columns.at(2).toInt(&altitudeValid) : defaultAltitude;
+
+    if((columns.size() == 2 || columns.size() == 3) && altitudeValid && altitude >= 0)
+      pairs.append({columns.at(0).toUpper(), columns.at(1).toUpper(), altitude});
+    else
+      qWarning() << "Invalid corpus line" << line;
+  }
+  return true;
+}
+
+bool RouteBenchmark::airportPos(SqlQuery& query, const QString& ident, Pos& pos)
+{
+  query.bindValue(":ident", ident);
+  query.exec();
+  if(query.next())
+  {
+    pos = Pos(query.value("lonx").toFloat(), query.value("laty").toFloat());
+    query.finish();
+    return true;
+  }
+
+  qWarning() << "Airport not found" << ident;
+  return false;
+}
+
+/* Calculate one route and write a CSV line */
+void RouteBenchmark::calculate(RouteNetwork *network, RouteFinder *routeFinder, const ModeVariant& variant,
+                               const AirportPair& pair, const Pos& departure, const Pos& destination,
+                               QTextStream& out)
+{
+  // Both airway modes share one network
+  network->setMode(variant.mode);
+
+  int queriesBefore = network->getNumberOfQueries(), nodesLoadedBefore = network->getNumberOfNodesLoaded();
+
+  QElapsedTimer timer;
+  timer.start();
+  bool found = routeFinder->calculateRoute(departure, destination, pair.altitude);
+  qint64 timeMs = timer.elapsed();
+
+  float distanceMeter = 0.f, directMeter = departure.distanceMeterTo(destination), ratio = 0.f;
+  if(found)
+  {
+    QVector<rf::RouteEntry> route;
+    routeFinder->extractRoute(route, distanceMeter);
+    ratio = directMeter > 0.f ? distanceMeter / directMeter : 0.f;
+  }
+  // Same check as in RouteCalcWorker which also rejects equal departure and destination
+  bool tooLong = found && !(directMeter > 0.f && ratio < RouteCalcWorker::MAX_DISTANCE_DIRECT_RATIO);
+
+  out << pair.departure << "," << pair.destination << "," << pair.altitude << "," << variant.name << ","
+      << (bidirectional ? 1 : 0) << "," << (incremental ? 1 : 0) << "," << (found ? 1 : 0) << ","
+      << (tooLong ? 1 : 0) << "," << routeFinder->getNumberOfExpandedNodes() << ","
+      << network->getNumberOfNodesLoaded() - nodesLoadedBefore << ","
+      << network->getNumberOfQueries() - queriesBefore << "," << timeMs << ","
+      << QString::number(atools::geo::meterToNm(distanceMeter), 'f', 1) << ","
+      << QString::number(atools::geo::meterToNm(directMeter), 'f', 1) << ","
+      << QString::number(ratio, 'f', 3) << endl;
+
+  numCalculations++;
+  if(found && !tooLong)
+    numFound++;
+  totalTimeMs += timeMs;
+}
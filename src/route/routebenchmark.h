@@ -0,0 +1,103 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTEBENCHMARK_H
+#define LITTLENAVMAP_ROUTEBENCHMARK_H
+
+#include "route/routenetwork.h"
+
+#include <QHash>
+#include <QStringList>
+
+class QTextStream;
+class RouteFinder;
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+class SqlQuery;
+}
+}
+
+/*
+ * Headless benchmark for the flight plan calculation. Runs a list of airport pairs through all network
+ * modes and writes the statistics for each calculation as CSV which allows to compare different builds.
+ *
+ * Started from main using the command line:
+ * littlenavmap --route-benchmark DATABASE CORPUS [OUTPUT] [--bidirectional] [--no-preload] [--no-landmarks]
+ *                                [--no-hierarchies] [--no-incremental] [--altitude FT]
+ *
+ * CORPUS is a text file containing a departure and a destination airport ident and an optional flown
+ * altitude in feet separated by space on each line. The altitude defaults to the value of "--altitude" or 0
+ * which ignores airway altitude restrictions. Empty lines and lines starting with "#" are ignored.
+ * Output goes to stdout if OUTPUT is not given. Add "-platform offscreen" if no display is available.
+ *
+ * One route finder is kept for each mode. Consecutive pairs sharing departure or destination measure the
+ * incremental search unless "--no-incremental" is given.
+ */
+class RouteBenchmark
+{
+public:
+  /* All application command line arguments */
+  RouteBenchmark(const QStringList& arguments);
+  ~RouteBenchmark();
+
+  /* Run all calculations. Returns the process exit code. */
+  int run();
+
+  /* true if the application command line requests a benchmark run */
+  static bool isBenchmark(const QStringList& arguments);
+
+private:
+  struct AirportPair
+  {
+    QString departure, destination;
+    int altitude;
+  };
+
+  struct ModeVariant
+  {
+    QString name;
+    nw::Modes mode;
+    bool airway;
+  };
+
+  bool readCorpus(QList<AirportPair>& pairs);
+  bool airportPos(atools::sql::SqlQuery& query, const QString& ident, atools::geo::Pos& pos);
+  void calculate(RouteNetwork *network, RouteFinder *routeFinder, const ModeVariant& variant,
+                 const AirportPair& pair, const atools::geo::Pos& departure,
+                 const atools::geo::Pos& destination, QTextStream& out);
+
+  QString databaseFile, corpusFile, outputFile;
+  bool bidirectional = false, preloadGraph = true, useLandmarks = true, useHierarchies = true,
+       incremental = true, argumentsValid = false;
+  int defaultAltitude = 0;
+
+  /* Used for all calculations */
+  atools::sql::SqlDatabase *db = nullptr;
+
+  /* Route finders by mode variant name. Kept over all pairs to allow incremental search. */
+  QHash<QString, RouteFinder *> routeFinders;
+
+  int numFound = 0, numCalculations = 0;
+  qint64 totalTimeMs = 0;
+
+  const QString DATABASE_NAME = "LNMDB_BENCHMARK";
+  const QString DATABASE_TYPE = "QSQLITE";
+};
+
+#endif // LITTLENAVMAP_ROUTEBENCHMARK_H
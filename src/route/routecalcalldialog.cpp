@@ -0,0 +1,126 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routecalcalldialog.h"
+
+#include "ui_routecalcalldialog.h"
+#include "geo/calculations.h"
+
+#include <QPushButton>
+
+namespace rca {
+// Result table column indexes
+enum Columns
+{
+  TYPE,
+  STATUS,
+  DISTANCE,
+  LEGS,
+  MIN_ALTITUDE
+};
+
+}
+
+using namespace rca;
+
+RouteCalcAllDialog::RouteCalcAllDialog(QWidget *parent)
+  : QDialog(parent), ui(new Ui::RouteCalcAllDialog)
+{
+  ui->setupUi(this);
+
+  ui->tableWidgetRouteCalcAll->setColumnCount(MIN_ALTITUDE + 1);
+  ui->tableWidgetRouteCalcAll->setHorizontalHeaderLabels({tr("Flight Plan Type"), tr("Status"),
+                                                          tr("Distance\nnm"), tr("Legs"),
+                                                          tr("Min Altitude\nft")});
+
+  ui->buttonBoxRouteCalcAll->button(QDialogButtonBox::Apply)->setText(tr("&Use Flight Plan"));
+
+  updateButtons();
+  connect(ui->tableWidgetRouteCalcAll, &QTableWidget::itemSelectionChanged, this,
+          &RouteCalcAllDialog::updateButtons);
+
+  // Activated on double click or return
+  connect(ui->tableWidgetRouteCalcAll, &QTableWidget::itemActivated, this, &RouteCalcAllDialog::useSelected);
+
+  connect(ui->buttonBoxRouteCalcAll->button(QDialogButtonBox::Apply), &QPushButton::clicked, this,
+          &RouteCalcAllDialog::useSelected);
+  connect(ui->buttonBoxRouteCalcAll, &QDialogButtonBox::rejected, this, &QDialog::reject);
+}
+
+RouteCalcAllDialog::~RouteCalcAllDialog()
+{
+  delete ui;
+}
+
+void RouteCalcAllDialog::setVariants(const QVector<rf::RouteVariant>& routeVariants)
+{
+  QTableWidget *table = ui->tableWidgetRouteCalcAll;
+  table->clearContents();
+  table->setRowCount(routeVariants.size());
+  found.fill(false, routeVariants.size());
+
+  for(int row = 0; row < routeVariants.size(); row++)
+  {
+    table->setItem(row, TYPE, new QTableWidgetItem(routeVariants.at(row).name));
+    table->setItem(row, STATUS, new QTableWidgetItem(tr("Calculating ...")));
+    for(int col = DISTANCE; col <= MIN_ALTITUDE; col++)
+      table->setItem(row, col, new QTableWidgetItem());
+  }
+  table->resizeColumnsToContents();
+  updateButtons();
+}
+
+void RouteCalcAllDialog::setResult(int index, const rf::RouteResult& result)
+{
+  QTableWidget *table = ui->tableWidgetRouteCalcAll;
+  if(index >= table->rowCount())
+    return;
+
+  found[index] = result.found;
+
+  if(result.found || result.tooLong)
+  {
+    table->item(index, STATUS)->setText(result.found ? tr("Found") : tr("Too long"));
+    table->item(index, DISTANCE)->setText(
+      QLocale().toString(atools::geo::meterToNm(result.distanceMeter), 'f', 0));
+    table->item(index, LEGS)->setText(QLocale().toString(result.route.size() + 1));
+    table->item(index, MIN_ALTITUDE)->setText(
+      result.minAltitude > 0 ? QLocale().toString(result.minAltitude) : QString());
+
+    for(int col = DISTANCE; col <= MIN_ALTITUDE; col++)
+      table->item(index, col)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+  }
+  else
+    table->item(index, STATUS)->setText(tr("No route found"));
+
+  table->resizeColumnsToContents();
+  updateButtons();
+}
+
+void RouteCalcAllDialog::useSelected()
+{
+  int row = ui->tableWidgetRouteCalcAll->currentRow();
+  if(row >= 0 && row < found.size() && found.at(row))
+    emit variantSelected(row);
+}
+
+void RouteCalcAllDialog::updateButtons()
+{
+  int row = ui->tableWidgetRouteCalcAll->currentRow();
+  ui->buttonBoxRouteCalcAll->button(QDialogButtonBox::Apply)->setEnabled(
+    row >= 0 && row < found.size() && found.at(row));
+}
@@ -0,0 +1,61 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTECALCALLDIALOG_H
+#define LITTLENAVMAP_ROUTECALCALLDIALOG_H
+
+#include "route/routecalcworker.h"
+
+#include <QDialog>
+
+namespace Ui {
+class RouteCalcAllDialog;
+}
+
+/*
+ * Shows the results of all flight plan calculation variants as they arrive and allows to select one.
+ * The dialog is not modal so the main window stays usable while calculation is running.
+ */
+class RouteCalcAllDialog :
+  public QDialog
+{
+  Q_OBJECT
+
+public:
+  RouteCalcAllDialog(QWidget *parent);
+  virtual ~RouteCalcAllDialog();
+
+  /* Clear table and add a row for each variant which is marked as calculating */
+  void setVariants(const QVector<rf::RouteVariant>& routeVariants);
+
+  /* Update the row of a finished variant */
+  void setResult(int index, const rf::RouteResult& result);
+
+signals:
+  /* Emitted if the user wants to use the flight plan of the variant with the given index */
+  void variantSelected(int index);
+
+private:
+  void updateButtons();
+  void useSelected();
+
+  /* Variants that have a usable flight plan */
+  QVector<bool> found;
+  Ui::RouteCalcAllDialog *ui;
+};
+
+#endif // LITTLENAVMAP_ROUTECALCALLDIALOG_H
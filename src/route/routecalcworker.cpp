@@ -0,0 +1,288 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routecalcworker.h"
+
+#include "route/routenetworkairway.h"
+#include "route/routenetworkradio.h"
+#include "sql/sqldatabase.h"
+#include "exception.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+
+using atools::sql::SqlDatabase;
+
+RouteCalcWorker::RouteCalcWorker(bool preloadGraph, bool useLandmarks, bool useHierarchies, bool incremental)
+  : preloadNetworkGraph(preloadGraph), useNetworkLandmarks(useLandmarks),
+  useNetworkHierarchies(useHierarchies), incrementalSearch(incremental)
+{
+}
+
+RouteCalcWorker::~RouteCalcWorker()
+{
+  // Stop all calculate all threads and wait since they use this object
+  {
+    QMutexLocker locker(&cancelMutex);
+    cancelAll = true;
+  }
+  for(QFuture<void>& future : variantFutures)
+    future.waitForFinished();
+
+  delete routeFinderRadio;
+  delete routeFinderAirway;
+  delete routeNetworkRadio;
+  delete routeNetworkAirway;
+
+  if(db != nullptr)
+  {
+    db->close();
+    delete db;
+    SqlDatabase::removeDatabase(DATABASE_NAME);
+  }
+}
+
+void RouteCalcWorker::initDatabase(const QString& databaseName)
+{
+  try
+  {
+    if(db == nullptr)
+      db = new SqlDatabase(SqlDatabase::addDatabase(DATABASE_TYPE, DATABASE_NAME));
+
+    qDebug() << "Route calculation opening database" << databaseName;
+    db->setDatabaseName(databaseName);
+    db->open();
+
+    if(routeNetworkRadio == nullptr)
+    {
+      // Networks prepare their queries in the constructor
+      routeNetworkRadio = new RouteNetworkRadio(db);
+      routeNetworkAirway = new RouteNetworkAirway(db);
+
+      routeNetworkRadio->setPreloadGraph(preloadNetworkGraph);
+      routeNetworkAirway->setPreloadGraph(preloadNetworkGraph);
+      routeNetworkRadio->setUseLandmarks(useNetworkLandmarks);
+      routeNetworkAirway->setUseLandmarks(useNetworkLandmarks);
+      routeNetworkAirway->setUseHierarchies(useNetworkHierarchies);
+
+      routeFinderRadio = new RouteFinder(routeNetworkRadio);
+      routeFinderAirway = new RouteFinder(routeNetworkAirway);
+      routeFinderRadio->setIncremental(incrementalSearch);
+      routeFinderAirway->setIncremental(incrementalSearch);
+    }
+    else
+    {
+      routeNetworkRadio->initQueries();
+      routeNetworkAirway->initQueries();
+    }
+
+    // Map graph cache files now so that the first calculation is not slowed down
+    routeNetworkRadio->loadGraph();
+    routeNetworkAirway->loadGraph();
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << "Route calculation cannot open database" << e.what();
+  }
+}
+
+void RouteCalcWorker::deInitDatabase()
+{
+  if(routeNetworkRadio != nullptr)
+  {
+    routeNetworkRadio->deInitQueries();
+    routeNetworkAirway->deInitQueries();
+  }
+
+  if(db != nullptr && db->isOpen())
+    db->close();
+
+  QMutexLocker locker(&cancelMutex);
+  canceledRequests.clear();
+  runningRequests.clear();
+}
+
+void RouteCalcWorker::calculateRoute(const rf::RouteRequest& request)
+{
+  rf::RouteResult result;
+  startRequest(request.requestId, 1);
+
+  if(routeNetworkRadio != nullptr && !isCanceled(request.requestId))
+  {
+    RouteNetwork *network = request.variant.fetchAirways ? routeNetworkAirway : routeNetworkRadio;
+    network->setMode(request.variant.mode);
+    calculateInternal(request.variant.fetchAirways ? *routeFinderAirway : *routeFinderRadio,
+                      request, result, true /* send progress */);
+  }
+  else
+    result.canceled = true;
+
+  finishRequest(request.requestId);
+  emit routeCalculated(request.requestId, result);
+}
+
+void RouteCalcWorker::calculateAll(const rf::RouteRequest& request, const QVector<rf::RouteVariant>& variants)
+{
+  // Remove threads that are done
+  QList<QFuture<void> >::iterator it = std::remove_if(variantFutures.begin(), variantFutures.end(),
+                                                      [](const QFuture<void>& future)->bool
+                                                      {
+                                                        return future.isFinished();
+                                                      });
+  variantFutures.erase(it, variantFutures.end());
+
+  startRequest(request.requestId, variants.size());
+
+  for(int i = 0; i < variants.size(); i++)
+  {
+    rf::RouteRequest variantRequest = request;
+    variantRequest.index = i;
+    variantRequest.variant = variants.at(i);
+
+    // Each thread gets an own network that shares the read-only graph.
+    // Graph is loaded here in the worker thread on first use.
+    QSharedPointer<RouteNetwork> snapshot;
+    if(routeNetworkRadio != nullptr)
+    {
+      RouteNetwork *network = variantRequest.variant.fetchAirways ? routeNetworkAirway : routeNetworkRadio;
+      try
+      {
+        snapshot.reset(network->createSnapshot());
+      }
+      catch(atools::Exception& e)
+      {
+        qWarning() << "Route calculation cannot load network" << e.what();
+      }
+    }
+
+    if(!snapshot.isNull())
+    {
+      snapshot->setMode(variantRequest.variant.mode);
+      variantFutures.append(QtConcurrent::run(this, &RouteCalcWorker::calculateVariantThread,
+                                              snapshot, variantRequest));
+    }
+    else
+    {
+      finishRequest(request.requestId);
+      emit variantCalculated(request.requestId, i, rf::RouteResult());
+    }
+  }
+}
+
+/* Called in thread pool. Snapshot network is deleted when the thread is finished. */
+void RouteCalcWorker::calculateVariantThread(QSharedPointer<RouteNetwork> network, rf::RouteRequest request)
+{
+  rf::RouteResult result;
+  RouteFinder routeFinder(network.data());
+  calculateInternal(routeFinder, request, result, false /* send progress */);
+  finishRequest(request.requestId);
+
+  // Signal is queued since receiver lives in another thread
+  emit variantCalculated(request.requestId, request.index, result);
+}
+
+void RouteCalcWorker::calculateInternal(RouteFinder& routeFinder, const rf::RouteRequest& request,
+                                        rf::RouteResult& result, bool sendProgress)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  routeFinder.setPreferVorToAirway(request.variant.preferVorToAirway);
+  routeFinder.setPreferNdbToAirway(request.variant.preferNdbToAirway);
+  routeFinder.setBidirectional(request.variant.bidirectional);
+
+  int requestId = request.requestId;
+  routeFinder.setProgressCallback([ = ](int numExpanded, int numOpen)->bool
+                                  {
+                                    if(sendProgress)
+                                      emit routeProgress(requestId, numExpanded, numOpen);
+                                    return isCanceled(requestId);
+                                  });
+
+  try
+  {
+    result.found = routeFinder.calculateRoute(request.departure, request.destination,
+                                              request.variant.altitude);
+    result.canceled = routeFinder.isCanceled();
+
+    if(result.found)
+    {
+      routeFinder.extractRoute(result.route, result.distanceMeter);
+
+      for(const rf::RouteEntry& entry : result.route)
+        result.minAltitude = std::max(result.minAltitude, entry.minAltitude);
+
+      // Compare to direct connection and check if route is too long - also rejects equal departure and
+      // destination like the ratio check before
+      float directDistance = request.departure.distanceMeterTo(request.destination);
+      if(!(directDistance > 0.f && result.distanceMeter / directDistance < MAX_DISTANCE_DIRECT_RATIO))
+      {
+        result.found = false;
+        result.tooLong = true;
+      }
+    }
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << "Route calculation failed" << e.what();
+    result.found = false;
+  }
+
+  result.timeMs = timer.elapsed();
+  qDebug() << "Route calculation" << request.variant.name << "found" << result.found
+           << "distance" << result.distanceMeter << "time" << result.timeMs << "ms";
+}
+
+void RouteCalcWorker::cancel(int requestId)
+{
+  QMutexLocker locker(&cancelMutex);
+  canceledRequests.insert(requestId);
+}
+
+void RouteCalcWorker::startRequest(int requestId, int numCalculations)
+{
+  QMutexLocker locker(&cancelMutex);
+  if(numCalculations > 0)
+    runningRequests[requestId] += numCalculations;
+
+  // Requests are started in order of their ids - remove cancel marks of older ones that are done
+  for(QSet<int>::iterator it = canceledRequests.begin(); it != canceledRequests.end();)
+  {
+    if(*it < requestId && !runningRequests.contains(*it))
+      it = canceledRequests.erase(it);
+    else
+      ++it;
+  }
+}
+
+void RouteCalcWorker::finishRequest(int requestId)
+{
+  QMutexLocker locker(&cancelMutex);
+  if(--runningRequests[requestId] <= 0)
+  {
+    runningRequests.remove(requestId);
+    canceledRequests.remove(requestId);
+  }
+}
+
+bool RouteCalcWorker::isCanceled(int requestId)
+{
+  QMutexLocker locker(&cancelMutex);
+  return cancelAll || canceledRequests.contains(requestId);
+}
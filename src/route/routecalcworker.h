@@ -0,0 +1,153 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTECALCWORKER_H
+#define LITTLENAVMAP_ROUTECALCWORKER_H
+
+#include "route/routefinder.h"
+#include "fs/pln/flightplan.h"
+#include "geo/pos.h"
+
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+}
+}
+
+class RouteNetwork;
+
+namespace rf {
+/* One flight plan calculation type */
+struct RouteVariant
+{
+  QString name;
+  atools::fs::pln::RouteType type;
+  nw::Modes mode;
+  int altitude; /* Flown altitude in feet or 0 if not restricted */
+  bool fetchAirways, preferVorToAirway, preferNdbToAirway, bidirectional;
+};
+
+/* Calculation request that is passed to the worker */
+struct RouteRequest
+{
+  int requestId;
+  int index; /* Index of variant for calculate all */
+  rf::RouteVariant variant;
+  atools::geo::Pos departure, destination;
+};
+
+/* Result of a flight plan calculation that is passed back from the worker thread */
+struct RouteResult
+{
+  QVector<rf::RouteEntry> route;
+  float distanceMeter = 0.f;
+  int minAltitude = 0; /* Highest minimum altitude of all airway segments in feet */
+  qint64 timeMs = 0;
+  bool found = false, tooLong = false, canceled = false;
+};
+
+}
+
+Q_DECLARE_METATYPE(rf::RouteRequest);
+Q_DECLARE_METATYPE(rf::RouteResult);
+Q_DECLARE_METATYPE(QVector<rf::RouteVariant>);
+
+/*
+ * Calculates flight plans in a separate thread. Owns an own database connection and the route networks
+ * which are used only in the worker thread. Move the object to a thread and call the Q_INVOKABLE methods
+ * using a queued connection. Results are sent back using signals.
+ *
+ * Calculate all runs each variant in the global thread pool on a network snapshot.
+ */
+class RouteCalcWorker :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  RouteCalcWorker(bool preloadGraph, bool useLandmarks, bool useHierarchies, bool incremental);
+  virtual ~RouteCalcWorker();
+
+  /* Open own connection to the given database file and create networks */
+  Q_INVOKABLE void initDatabase(const QString& databaseName);
+
+  /* Close database connection and clear all network caches */
+  Q_INVOKABLE void deInitDatabase();
+
+  /* Calculate a single flight plan and send progress and result. */
+  Q_INVOKABLE void calculateRoute(const rf::RouteRequest& request);
+
+  /* Calculate all variants in parallel. Index in request is ignored.
+   * Emits variantCalculated for each one. */
+  Q_INVOKABLE void calculateAll(const rf::RouteRequest& request, const QVector<rf::RouteVariant>& variants);
+
+  /* Stop calculation of the given request as soon as possible. Thread safe. */
+  void cancel(int requestId);
+
+  /* Maximum route distance / direct distance */
+  static Q_DECL_CONSTEXPR float MAX_DISTANCE_DIRECT_RATIO = 1.5f;
+
+signals:
+  /* Number of expanded and open nodes of a running calculateRoute */
+  void routeProgress(int requestId, int numExpanded, int numOpen);
+
+  /* Result of calculateRoute */
+  void routeCalculated(int requestId, rf::RouteResult result);
+
+  /* Result of one variant of calculateAll */
+  void variantCalculated(int requestId, int index, rf::RouteResult result);
+
+private:
+  void calculateVariantThread(QSharedPointer<RouteNetwork> network, rf::RouteRequest request);
+  void calculateInternal(RouteFinder& routeFinder, const rf::RouteRequest& request, rf::RouteResult& result,
+                         bool sendProgress);
+  bool isCanceled(int requestId);
+
+  /* Count running calculations for a request and remove its cancel mark when all are finished */
+  void startRequest(int requestId, int numCalculations);
+  void finishRequest(int requestId);
+
+  atools::sql::SqlDatabase *db = nullptr;
+  RouteNetwork *routeNetworkRadio = nullptr, *routeNetworkAirway = nullptr;
+
+  /* Kept for all single calculations to allow incremental search */
+  RouteFinder *routeFinderRadio = nullptr, *routeFinderAirway = nullptr;
+  bool preloadNetworkGraph, useNetworkLandmarks, useNetworkHierarchies, incrementalSearch;
+
+  /* Protects canceledRequests and runningRequests which are accessed by GUI and worker threads */
+  QMutex cancelMutex;
+  QSet<int> canceledRequests;
+
+  /* Number of running calculations for each request id */
+  QHash<int, int> runningRequests;
+  bool cancelAll = false;
+
+  /* Running calculate all threads */
+  QList<QFuture<void> > variantFutures;
+
+  const QString DATABASE_NAME = "LNMDB_ROUTE";
+  const QString DATABASE_TYPE = "QSQLITE";
+};
+
+#endif // LITTLENAVMAP_ROUTECALCWORKER_H
@@ -32,16 +32,17 @@
 #include "parkingdialog.h"
 #include "route/routefinder.h"
 #include "route/routeicondelegate.h"
-#include "route/routenetworkairway.h"
-#include "route/routenetworkradio.h"
 #include "settings/settings.h"
+#include "sql/sqldatabase.h"
 #include "ui_mainwindow.h"
 #include "gui/dialog.h"
 #include "atools.h"
 
 #include <QClipboard>
 #include <QFile>
+#include <QProgressDialog>
 #include <QStandardItemModel>
+#include <QThread>
 
 // Route table colum headings
 const QList<QString> ROUTE_COLUMNS({QObject::tr("Ident"),
@@ -57,6 +58,11 @@ const QList<QString> ROUTE_COLUMNS({QObject::tr("Ident"),
                                     QObject::tr("Leg Time\nhh:mm"),
                                     QObject::tr("ETA\nhh:mm UTC")});
 
+// Label text for flight plan calculation progress
+const QString ROUTE_PROGRESS_TEXT(QObject::tr("Calculating flight plan ...\n\n"
+                                              "Expanded nodes: %1\n"
+                                              "Open nodes: %2"));
+
 namespace rc {
 // Route table column indexes
 enum RouteColumns
@@ -90,9 +96,39 @@ RouteController::RouteController(MainWindow *parentWindow, MapQuery *mapQuery, Q
 
   view->setContextMenuPolicy(Qt::CustomContextMenu);
 
-  // Create flight plan calculation caches
-  routeNetworkRadio = new RouteNetworkRadio(mainWindow->getDatabase());
-  routeNetworkAirway = new RouteNetworkAirway(mainWindow->getDatabase());
+  // Load complete networks into memory on first calculation instead of fetching node by node
+  atools::settings::Settings& settings = atools::settings::Settings::instance();
+  bool preloadNetwork = settings.getAndStoreValue(lnm::OPTIONS_ROUTE_PRELOAD_NETWORK, true).toBool();
+
+  // Landmark distance tables are saved next to the database and speed up calculation
+  bool useLandmarks = settings.getAndStoreValue(lnm::OPTIONS_ROUTE_LANDMARKS, true).toBool();
+
+  // Contraction hierarchies are built after loading the scenery database and answer airway queries
+  bool useHierarchies = settings.getAndStoreValue(lnm::OPTIONS_ROUTE_HIERARCHIES, true).toBool();
+
+  routeBidirectional = settings.getAndStoreValue(lnm::OPTIONS_ROUTE_BIDIRECTIONAL, false).toBool();
+
+  // Keep search trees to speed up calculation if only departure or destination changes
+  bool incremental = settings.getAndStoreValue(lnm::OPTIONS_ROUTE_INCREMENTAL, true).toBool();
+
+  // Flight plan calculation runs in a separate thread with an own database connection
+  qRegisterMetaType<rf::RouteRequest>();
+  qRegisterMetaType<rf::RouteResult>();
+  qRegisterMetaType<QVector<rf::RouteVariant> >();
+  calcRequest.requestId = -1;
+  calcAllRequest.requestId = -1;
+
+  routeCalcThread = new QThread(this);
+  routeCalcWorker = new RouteCalcWorker(preloadNetwork, useLandmarks, useHierarchies, incremental);
+  routeCalcWorker->moveToThread(routeCalcThread);
+  connect(routeCalcThread, &QThread::finished, routeCalcWorker, &QObject::deleteLater);
+  connect(routeCalcWorker, &RouteCalcWorker::routeProgress, this, &RouteController::calculateRouteProgress);
+  connect(routeCalcWorker, &RouteCalcWorker::routeCalculated, this, &RouteController::calculateRouteFinished);
+  connect(routeCalcWorker, &RouteCalcWorker::variantCalculated, this, &RouteController::calculateAllFinished);
+  routeCalcThread->start();
+
+  QMetaObject::invokeMethod(routeCalcWorker, "initDatabase", Qt::QueuedConnection,
+                            Q_ARG(QString, mainWindow->getDatabase()->databaseName()));
 
   // Set up undo/redo framework
   undoStack = new QUndoStack(mainWindow);
@@ -178,11 +214,19 @@ RouteController::RouteController(MainWindow *parentWindow, MapQuery *mapQuery, Q
 
 RouteController::~RouteController()
 {
+  // Stop running calculations
+  if(calcRequest.requestId != -1)
+    routeCalcWorker->cancel(calcRequest.requestId);
+  cancelCalculateAll();
+
+  // Worker is deleted when the thread event loop is finished
+  routeCalcThread->quit();
+  routeCalcThread->wait();
+
+  delete calcAllDialog;
   delete model;
   delete iconDelegate;
   delete undoStack;
-  delete routeNetworkRadio;
-  delete routeNetworkAirway;
   delete zoomHandler;
 }
 
@@ -481,178 +525,316 @@ void RouteController::calculateDirect()
 void RouteController::calculateRadionav()
 {
   qDebug() << "calculateRadionav";
-  // Changing mode might need a clear
-  routeNetworkRadio->setMode(nw::ROUTE_RADIONAV);
-
-  RouteFinder routeFinder(routeNetworkRadio);
-
-  if(calculateRouteInternal(&routeFinder, atools::fs::pln::VOR, tr("Radionnav Flight Plan Calculation"),
-                            false /* fetch airways */, false /* Use altitude */))
-    mainWindow->setStatusMessage(tr("Calculated radio navaid flight plan."));
-  else
-    mainWindow->setStatusMessage(tr("No route found."));
+  calculateRouteAsync({tr("Radio Navaids"), atools::fs::pln::VOR, nw::ROUTE_RADIONAV, 0,
+                       false /* fetch airways */, false, false, false},
+                      tr("Radionnav Flight Plan Calculation"), tr("Calculated radio navaid flight plan."));
 }
 
 void RouteController::calculateHighAlt()
 {
   qDebug() << "calculateHighAlt";
-  routeNetworkAirway->setMode(nw::ROUTE_JET);
-
-  RouteFinder routeFinder(routeNetworkAirway);
-
-  if(calculateRouteInternal(&routeFinder, atools::fs::pln::HIGH_ALTITUDE,
-                            tr("High altitude Flight Plan Calculation"),
-                            true /* fetch airways */, false /* Use altitude */))
-    mainWindow->setStatusMessage(tr("Calculated high altitude (Jet airways) flight plan."));
-  else
-    mainWindow->setStatusMessage(tr("No route found."));
+  calculateRouteAsync({tr("High Altitude (Jet Airways)"), atools::fs::pln::HIGH_ALTITUDE, nw::ROUTE_JET, 0,
+                       true /* fetch airways */, false, false, false},
+                      tr("High altitude Flight Plan Calculation"),
+                      tr("Calculated high altitude (Jet airways) flight plan."));
 }
 
 void RouteController::calculateLowAlt()
 {
   qDebug() << "calculateLowAlt";
-  routeNetworkAirway->setMode(nw::ROUTE_VICTOR);
-
-  RouteFinder routeFinder(routeNetworkAirway);
-
-  if(calculateRouteInternal(&routeFinder, atools::fs::pln::LOW_ALTITUDE,
-                            tr("Low altitude Flight Plan Calculation"),
-                            /* fetch airways */ true, false /* Use altitude */))
-    mainWindow->setStatusMessage(tr("Calculated low altitude (Victor airways) flight plan."));
-  else
-    mainWindow->setStatusMessage(tr("No route found."));
+  calculateRouteAsync({tr("Low Altitude (Victor Airways)"), atools::fs::pln::LOW_ALTITUDE,
+                       nw::ROUTE_VICTOR, 0, true /* fetch airways */, false, false, false},
+                      tr("Low altitude Flight Plan Calculation"),
+                      tr("Calculated low altitude (Victor airways) flight plan."));
 }
 
 void RouteController::calculateSetAlt()
 {
   qDebug() << "calculateSetAlt";
-  routeNetworkAirway->setMode(nw::ROUTE_VICTOR | nw::ROUTE_JET);
-
-  RouteFinder routeFinder(routeNetworkAirway);
 
   // Just decide by given altiude if this is a high or low plan
+  int altitude = route.getFlightplan().getCruisingAltitude();
   atools::fs::pln::RouteType type;
-  if(route.getFlightplan().getCruisingAltitude() > 20000)
+  if(altitude > 20000)
     type = atools::fs::pln::HIGH_ALTITUDE;
   else
     type = atools::fs::pln::LOW_ALTITUDE;
 
-  if(calculateRouteInternal(&routeFinder, type, tr("Low altitude flight plan"),
-                            true /* fetch airways */, true /* Use altitude */))
-    mainWindow->setStatusMessage(tr("Calculated high/low flight plan for given altitude."));
+  calculateRouteAsync({tr("Airways at %1 ft").arg(QLocale().toString(altitude)), type,
+                       nw::ROUTE_VICTOR | nw::ROUTE_JET, altitude,
+                       true /* fetch airways */, false, false, false},
+                      tr("Low altitude flight plan"),
+                      tr("Calculated high/low flight plan for given altitude."), true /* Use altitude */);
+}
+
+/* Start calculation in the worker thread and show a progress dialog that allows to cancel */
+void RouteController::calculateRouteAsync(rf::RouteVariant variant, const QString& commandName,
+                                          const QString& doneMessage, bool useSetAltitude)
+{
+  cancelCalculateRoute();
+
+  variant.preferVorToAirway = OptionData::instance().getFlags() & opts::ROUTE_PREFER_VOR;
+  variant.preferNdbToAirway = OptionData::instance().getFlags() & opts::ROUTE_PREFER_NDB;
+  variant.bidirectional = routeBidirectional;
+
+  const Flightplan& flightplan = route.getFlightplan();
+  calcRequest = {++lastRequestId, 0, variant, flightplan.getDeparturePosition(),
+                 flightplan.getDestinationPosition()};
+  calcCommandName = commandName;
+  calcDoneMessage = doneMessage;
+  calcUseSetAltitude = useSetAltitude;
+
+  delete calcProgressDialog;
+  calcProgressDialog = new QProgressDialog(mainWindow);
+  calcProgressDialog->setWindowTitle(QApplication::applicationName());
+  calcProgressDialog->setLabelText(ROUTE_PROGRESS_TEXT.arg(0).arg(0));
+  calcProgressDialog->setWindowModality(Qt::NonModal);
+  calcProgressDialog->setRange(0, 0);
+  calcProgressDialog->setAutoClose(false);
+  calcProgressDialog->setAutoReset(false);
+  calcProgressDialog->setMinimumDuration(0);
+  connect(calcProgressDialog, &QProgressDialog::canceled, this, &RouteController::cancelCalculateRoute);
+  calcProgressDialog->show();
+
+  mainWindow->setStatusMessage(tr("Calculating flight plan."));
+  QMetaObject::invokeMethod(routeCalcWorker, "calculateRoute", Qt::QueuedConnection,
+                            Q_ARG(rf::RouteRequest, calcRequest));
+}
+
+/* Called by worker */
+void RouteController::calculateRouteProgress(int requestId, int numExpanded, int numOpen)
+{
+  if(requestId == calcRequest.requestId && calcProgressDialog != nullptr)
+    calcProgressDialog->setLabelText(ROUTE_PROGRESS_TEXT.arg(QLocale().toString(numExpanded)).
+                                     arg(QLocale().toString(numOpen)));
+}
+
+/* Called by worker when calculation is finished or canceled */
+void RouteController::calculateRouteFinished(int requestId, rf::RouteResult result)
+{
+  if(requestId != calcRequest.requestId)
+    // Result of a canceled request
+    return;
+
+  calcRequest.requestId = -1;
+  delete calcProgressDialog;
+  calcProgressDialog = nullptr;
+
+  if(result.canceled)
+    return;
+
+  const Flightplan& flightplan = route.getFlightplan();
+  if(flightplan.getDeparturePosition() != calcRequest.departure ||
+     flightplan.getDestinationPosition() != calcRequest.destination)
+  {
+    // Plan was changed by the user while calculating
+    mainWindow->setStatusMessage(tr("Departure or destination changed. Calculate again."));
+    return;
+  }
+
+  if(result.found)
+  {
+    applyCalculatedRoute(result.route, calcRequest.variant.type, calcCommandName,
+                         calcRequest.variant.fetchAirways, calcRequest.variant.altitude, calcUseSetAltitude);
+    mainWindow->setStatusMessage(calcDoneMessage);
+  }
   else
+  {
     mainWindow->setStatusMessage(tr("No route found."));
+    atools::gui::Dialog(mainWindow).showInfoMsgBox(lnm::ACTIONS_SHOWROUTEERROR,
+                                                   tr("Cannot find a route.\n"
+                                                      "Try another routing type or create the flight plan manually."),
+                                                   tr("Do not &show this dialog again."));
+  }
 }
 
-/* Calculate a flight plan to all types */
-bool RouteController::calculateRouteInternal(RouteFinder *routeFinder, atools::fs::pln::RouteType type,
-                                             const QString& commandName, bool fetchAirways,
-                                             bool useSetAltitude)
+/* Cancel calculation in worker and close progress dialog */
+void RouteController::cancelCalculateRoute()
 {
-  // Create wait cursor if calculation takes too long
-  QGuiApplication::setOverrideCursor(Qt::WaitCursor);
+  if(calcRequest.requestId != -1)
+  {
+    routeCalcWorker->cancel(calcRequest.requestId);
+    calcRequest.requestId = -1;
+    mainWindow->setStatusMessage(tr("Flight plan calculation canceled."));
+  }
 
+  if(calcProgressDialog != nullptr)
+  {
+    // Delete later since this might be called by the dialog signal
+    calcProgressDialog->deleteLater();
+    calcProgressDialog = nullptr;
+  }
+}
+
+/* Apply calculated route to the flight plan and create an undo command.
+ * Cruise altitude is set to setAltitude if greater than 0 or kept if useSetAltitude is true.
+ * Otherwise it is set to the minimum airway altitude. */
+void RouteController::applyCalculatedRoute(const QVector<rf::RouteEntry>& calculatedRoute,
+                                           atools::fs::pln::RouteType type, const QString& commandName,
+                                           bool fetchAirways, int setAltitude, bool useSetAltitude)
+{
   Flightplan& flightplan = route.getFlightplan();
 
-  int altitude = useSetAltitude ? flightplan.getCruisingAltitude() : 0;
+  // Start undo
+  RouteCommand *undoCommand = preChange(commandName);
 
-  routeFinder->setPreferVorToAirway(OptionData::instance().getFlags() & opts::ROUTE_PREFER_VOR);
-  routeFinder->setPreferNdbToAirway(OptionData::instance().getFlags() & opts::ROUTE_PREFER_NDB);
+  QList<FlightplanEntry>& entries = flightplan.getEntries();
 
-  bool found = routeFinder->calculateRoute(flightplan.getDeparturePosition(),
-                                           flightplan.getDestinationPosition(), altitude);
+  flightplan.setRouteType(type);
+  // Erase all but start and destination
+  entries.erase(flightplan.getEntries().begin() + 1, entries.end() - 1);
 
-  if(found)
+  // Create flight plan entries - will be copied later to the route map objects
+  int minAltitude = 0;
+  for(const rf::RouteEntry& routeEntry : calculatedRoute)
   {
-    // A route was found
-    float distance = 0.f;
-    QVector<rf::RouteEntry> calculatedRoute;
+    FlightplanEntry flightplanEentry;
+    buildFlightplanEntry(routeEntry.ref.id, atools::geo::EMPTY_POS, routeEntry.ref.type, flightplanEentry,
+                         fetchAirways);
 
-    // Fetch waypoints
-    routeFinder->extractRoute(calculatedRoute, distance);
+    if(fetchAirways && routeEntry.airwayId != -1)
+    {
+      int alt = 0;
+      updateFlightplanEntryAirway(routeEntry.airwayId, flightplanEentry, alt);
+      minAltitude = std::max(minAltitude, alt);
+    }
 
-    // Compare to direct connection and check if route is too long
-    float directDistance = flightplan.getDeparturePosition().distanceMeterTo(
-      flightplan.getDestinationPosition());
-    float ratio = distance / directDistance;
-    qDebug() << "route distance" << QString::number(distance, 'f', 0)
-             << "direct distance" << QString::number(directDistance, 'f', 0) << "ratio" << ratio;
+    entries.insert(entries.end() - 1, flightplanEentry);
+  }
 
-    if(ratio < MAX_DISTANCE_DIRECT_RATIO)
+  if(setAltitude > 0)
+    flightplan.setCruisingAltitude(setAltitude);
+  else if(minAltitude != 0 && !useSetAltitude)
+  {
+    if(OptionData::instance().getFlags() & opts::ROUTE_EAST_WEST_RULE)
     {
-      // Start undo
-      RouteCommand *undoCommand = preChange(commandName);
+      // Apply simplified east/west rule
+      float fpDir = flightplan.getDeparturePosition().angleDegToRhumb(flightplan.getDestinationPosition());
 
-      QList<FlightplanEntry>& entries = flightplan.getEntries();
+      qDebug() << "minAltitude" << minAltitude << "fp dir" << fpDir;
 
-      flightplan.setRouteType(type);
-      // Erase all but start and destination
-      entries.erase(flightplan.getEntries().begin() + 1, entries.end() - 1);
+      if(fpDir >= 0.f && fpDir <= 180.f)
+        // General direction is east - round up to the next odd value
+        minAltitude = static_cast<int>(std::ceil((minAltitude - 1000.f) / 2000.f) * 2000.f + 1000.f);
+      else
+        // General direction is west - round up to the next even value
+        minAltitude = static_cast<int>(std::ceil(minAltitude / 2000.f) * 2000.f);
 
-      // Create flight plan entries - will be copied later to the route map objects
-      int minAltitude = 0;
-      for(const rf::RouteEntry& routeEntry : calculatedRoute)
-      {
-        FlightplanEntry flightplanEentry;
-        buildFlightplanEntry(routeEntry.ref.id, atools::geo::EMPTY_POS, routeEntry.ref.type, flightplanEentry,
-                             fetchAirways);
+      if(flightplan.getFlightplanType() == atools::fs::pln::VFR)
+        minAltitude += 500;
 
-        if(fetchAirways && routeEntry.airwayId != -1)
-        {
-          int alt = 0;
-          updateFlightplanEntryAirway(routeEntry.airwayId, flightplanEentry, alt);
-          minAltitude = std::max(minAltitude, alt);
-        }
+      qDebug() << "corrected minAltitude" << minAltitude;
+    }
 
-        entries.insert(entries.end() - 1, flightplanEentry);
-      }
+    flightplan.setCruisingAltitude(minAltitude);
+  }
 
-      if(minAltitude != 0 && !useSetAltitude)
-      {
-        if(OptionData::instance().getFlags() & opts::ROUTE_EAST_WEST_RULE)
-        {
-          // Apply simplified east/west rule
-          float fpDir = flightplan.getDeparturePosition().angleDegToRhumb(flightplan.getDestinationPosition());
+  createRouteMapObjects();
+  updateTableModel();
+  updateWindowLabel();
+  postChange(undoCommand);
+  mainWindow->updateWindowTitle();
+  emit routeChanged(true);
+}
 
-          qDebug() << "minAltitude" << minAltitude << "fp dir" << fpDir;
+void RouteController::calculateAll()
+{
+  qDebug() << "calculateAll";
 
-          if(fpDir >= 0.f && fpDir <= 180.f)
-            // General direction is east - round up to the next odd value
-            minAltitude = static_cast<int>(std::ceil((minAltitude - 1000.f) / 2000.f) * 2000.f + 1000.f);
-          else
-            // General direction is west - round up to the next even value
-            minAltitude = static_cast<int>(std::ceil(minAltitude / 2000.f) * 2000.f);
+  cancelCalculateAll();
 
-          if(flightplan.getFlightplanType() == atools::fs::pln::VFR)
-            minAltitude += 500;
+  const Flightplan& flightplan = route.getFlightplan();
+  bool preferVor = OptionData::instance().getFlags() & opts::ROUTE_PREFER_VOR;
+  bool preferNdb = OptionData::instance().getFlags() & opts::ROUTE_PREFER_NDB;
+
+  calcAllVariants.clear();
+  calcAllVariants.append({tr("Radio Navaids"), atools::fs::pln::VOR, nw::ROUTE_RADIONAV, 0,
+                          false /* fetch airways */, preferVor, preferNdb, routeBidirectional});
+  calcAllVariants.append({tr("High Altitude (Jet Airways)"), atools::fs::pln::HIGH_ALTITUDE, nw::ROUTE_JET, 0,
+                          true /* fetch airways */, preferVor, preferNdb, routeBidirectional});
+  calcAllVariants.append({tr("Low Altitude (Victor Airways)"), atools::fs::pln::LOW_ALTITUDE,
+                          nw::ROUTE_VICTOR, 0, true /* fetch airways */,
+                          preferVor, preferNdb, routeBidirectional});
+
+  int cruiseAltitude = flightplan.getCruisingAltitude();
+  if(cruiseAltitude > 0)
+  {
+    // Airways for the given altitude and two flight levels below and above
+    for(int offset : {-4000, -2000, 0, 2000, 4000})
+    {
+      int altitude = cruiseAltitude + offset;
+      atools::fs::pln::RouteType type =
+        altitude > 20000 ? atools::fs::pln::HIGH_ALTITUDE : atools::fs::pln::LOW_ALTITUDE;
+
+      if(altitude > 0)
+        calcAllVariants.append({tr("Airways at %1 ft").arg(QLocale().toString(altitude)), type,
+                                nw::ROUTE_VICTOR | nw::ROUTE_JET, altitude,
+                                true /* fetch airways */, preferVor, preferNdb, routeBidirectional});
+    }
+  }
 
-          qDebug() << "corrected minAltitude" << minAltitude;
-        }
+  calcAllResults.fill(rf::RouteResult(), calcAllVariants.size());
+  calcAllRequest = {++lastRequestId, 0, rf::RouteVariant(), flightplan.getDeparturePosition(),
+                    flightplan.getDestinationPosition()};
 
-        flightplan.setCruisingAltitude(minAltitude);
-      }
+  if(calcAllDialog == nullptr)
+  {
+    calcAllDialog = new RouteCalcAllDialog(mainWindow);
+    connect(calcAllDialog, &RouteCalcAllDialog::variantSelected,
+            this, &RouteController::calculateAllSelected);
+  }
+  calcAllDialog->setVariants(calcAllVariants);
+  calcAllDialog->show();
+  calcAllDialog->raise();
+  calcAllDialog->activateWindow();
 
-      QGuiApplication::restoreOverrideCursor();
-      createRouteMapObjects();
-      updateTableModel();
-      updateWindowLabel();
-      postChange(undoCommand);
-      mainWindow->updateWindowTitle();
-      emit routeChanged(true);
-    }
-    else
-      // Too long
-      found = false;
+  // Worker creates network snapshots and distributes calculation into the thread pool
+  QMetaObject::invokeMethod(routeCalcWorker, "calculateAll", Qt::QueuedConnection,
+                            Q_ARG(rf::RouteRequest, calcAllRequest),
+                            Q_ARG(QVector<rf::RouteVariant>, calcAllVariants));
+
+  mainWindow->setStatusMessage(tr("Calculating %1 flight plans.").arg(calcAllVariants.size()));
+}
+
+/* Called by worker when a variant is finished */
+void RouteController::calculateAllFinished(int requestId, int index, rf::RouteResult result)
+{
+  if(requestId != calcAllRequest.requestId || index >= calcAllResults.size())
+    // Result of a canceled request
+    return;
+
+  calcAllResults[index] = result;
+
+  if(calcAllDialog != nullptr)
+    calcAllDialog->setResult(index, result);
+}
+
+void RouteController::calculateAllSelected(int index)
+{
+  const Flightplan& flightplan = route.getFlightplan();
+  if(flightplan.getDeparturePosition() != calcAllRequest.departure ||
+     flightplan.getDestinationPosition() != calcAllRequest.destination)
+  {
+    mainWindow->setStatusMessage(tr("Departure or destination changed. Calculate again."));
+    return;
   }
 
-  QGuiApplication::restoreOverrideCursor();
-  if(!found)
-    atools::gui::Dialog(mainWindow).showInfoMsgBox(lnm::ACTIONS_SHOWROUTEERROR,
-                                                   tr("Cannot find a route.\n"
-                                                      "Try another routing type or create the flight plan manually."),
-                                                   tr("Do not &show this dialog again."));
+  const rf::RouteVariant& variant = calcAllVariants.at(index);
+  applyCalculatedRoute(calcAllResults.at(index).route, variant.type,
+                       tr("%1 Flight Plan Calculation").arg(variant.name), variant.fetchAirways,
+                       variant.altitude, variant.altitude > 0);
+  mainWindow->setStatusMessage(tr("Calculated %1 flight plan.").arg(variant.name));
+}
 
-  return found;
+void RouteController::cancelCalculateAll()
+{
+  if(calcAllRequest.requestId != -1)
+  {
+    // Threads stop as soon as possible and results are ignored
+    routeCalcWorker->cancel(calcAllRequest.requestId);
+    calcAllRequest.requestId = -1;
+  }
+  calcAllResults.clear();
 }
 
 void RouteController::reverse()
@@ -725,14 +907,20 @@ bool RouteController::hasEntries() const
 
 void RouteController::preDatabaseLoad()
 {
-  routeNetworkRadio->deInitQueries();
-  routeNetworkAirway->deInitQueries();
+  // Results refer to the old database
+  cancelCalculateRoute();
+  cancelCalculateAll();
+  if(calcAllDialog != nullptr)
+    calcAllDialog->close();
+
+  // Wait until a running calculation stopped and the connection is closed
+  QMetaObject::invokeMethod(routeCalcWorker, "deInitDatabase", Qt::BlockingQueuedConnection);
 }
 
 void RouteController::postDatabaseLoad()
 {
-  routeNetworkRadio->initQueries();
-  routeNetworkAirway->initQueries();
+  QMetaObject::invokeMethod(routeCalcWorker, "initDatabase", Qt::QueuedConnection,
+                            Q_ARG(QString, mainWindow->getDatabase()->databaseName()));
   createRouteMapObjects();
   updateTableModel();
   mainWindow->updateWindowTitle();
@@ -19,6 +19,7 @@
 #define LITTLENAVMAP_ROUTECONTROLLER_H
 
 #include "route/routecommand.h"
+#include "route/routecalcalldialog.h"
 #include "route/routemapobjectlist.h"
 #include "common/maptypes.h"
 
@@ -42,8 +43,8 @@ class QTableView;
 class QStandardItemModel;
 class QItemSelection;
 class RouteIconDelegate;
-class RouteNetwork;
-class RouteFinder;
+class QProgressDialog;
+class QThread;
 
 /*
  * All flight plan related tasks like saving, loading, modification, calculation and table
@@ -173,6 +174,10 @@ public:
    *  the spin box as minimum altitude */
   void calculateSetAlt();
 
+  /* Calculate radio navaid, high, low and several altitude based flight plans in parallel in background
+   * threads. Shows a dialog that collects the results as they arrive and allows to select one. */
+  void calculateAll();
+
   /* Reverse order of all waypoints, swap departure and destination and automatically
    * select a new start position (best runway) */
   void reverse();
@@ -249,9 +254,24 @@ private:
 
   void clearRoute();
 
-  bool calculateRouteInternal(RouteFinder *routeFinder, atools::fs::pln::RouteType type,
-                              const QString& commandName,
-                              bool fetchAirways, bool useSetAltitude);
+  /* Start calculation in worker thread. Result is applied with undo support when finished.
+   * The cruise altitude is not changed if useSetAltitude is true. */
+  void calculateRouteAsync(rf::RouteVariant variant, const QString& commandName, const QString& doneMessage,
+                           bool useSetAltitude = false);
+  void calculateRouteProgress(int requestId, int numExpanded, int numOpen);
+  void calculateRouteFinished(int requestId, rf::RouteResult result);
+  void cancelCalculateRoute();
+
+  /* Replace all waypoints between departure and destination with the calculated route */
+  void applyCalculatedRoute(const QVector<rf::RouteEntry>& calculatedRoute, atools::fs::pln::RouteType type,
+                            const QString& commandName, bool fetchAirways, int setAltitude,
+                            bool useSetAltitude);
+
+  void calculateAllFinished(int requestId, int index, rf::RouteResult result);
+  void calculateAllSelected(int index);
+
+  /* Stop all running calculations. Results of running threads are discarded. */
+  void cancelCalculateAll();
 
   void updateFlightplanEntryAirway(int airwayId, atools::fs::pln::FlightplanEntry& entry, int& minAltitude);
 
@@ -273,9 +293,6 @@ private:
 
   void dockVisibilityChanged(bool visible);
 
-  /* If route distance / direct distance if bigger than this value fail routing */
-  static Q_DECL_CONSTEXPR float MAX_DISTANCE_DIRECT_RATIO = 1.5f;
-
   static Q_DECL_CONSTEXPR int ROUTE_UNDO_LIMIT = 50;
 
   /* Move selected rows */
@@ -290,8 +307,25 @@ private:
   /* Used to number user defined positions */
   int curUserpointNumber = 1;
 
-  /* Network cache for flight plan calculation */
-  RouteNetwork *routeNetworkRadio = nullptr, *routeNetworkAirway = nullptr;
+  /* Flight plan calculation worker and its thread. Worker owns the network caches. */
+  QThread *routeCalcThread = nullptr;
+  RouteCalcWorker *routeCalcWorker = nullptr;
+  int lastRequestId = 0;
+
+  /* Use bidirectional search in flight plan calculation */
+  bool routeBidirectional = false;
+
+  /* Running single calculation. Request id is -1 if nothing is running. */
+  rf::RouteRequest calcRequest;
+  QString calcCommandName, calcDoneMessage;
+  bool calcUseSetAltitude = false;
+  QProgressDialog *calcProgressDialog = nullptr;
+
+  /* Calculate all - variants and results */
+  RouteCalcAllDialog *calcAllDialog = nullptr;
+  rf::RouteRequest calcAllRequest;
+  QVector<rf::RouteVariant> calcAllVariants;
+  QVector<rf::RouteResult> calcAllResults;
   atools::geo::Rect boundingRect;
   RouteMapObjectList route;
   /* Current filename of empty if no route */
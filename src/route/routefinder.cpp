@@ -16,21 +16,21 @@
 *****************************************************************************/
 
 #include "route/routefinder.h"
+#include "route/routehierarchy.h"
+#include "route/routelandmarks.h"
 #include "geo/calculations.h"
 #include "atools.h"
 
+#include <algorithm>
+#include <limits>
+
 using nw::Node;
 using nw::Edge;
 using atools::geo::Pos;
 
 RouteFinder::RouteFinder(RouteNetwork *routeNetwork)
-  : network(routeNetwork), openNodesHeap(5000)
+  : network(routeNetwork)
 {
-  closedNodes.reserve(10000);
-  nodeCosts.reserve(10000);
-  nodePredecessor.reserve(10000);
-  nodeAirwayId.reserve(10000);
-
   successorNodes.reserve(500);
   successorEdges.reserve(500);
 }
@@ -49,43 +49,348 @@ bool RouteFinder::calculateRoute(const atools::geo::Pos& from, const atools::geo
 
   int numNodesTotal = network->getNumberOfNodesDatabase();
 
+  routeIndexes.clear();
+  routeAirwayIds.clear();
+  canceled = false;
+
   if(startNode.edges.isEmpty())
     return false;
 
-  openNodesHeap.push(startNode, 0.f);
-  nodeCosts[startNode.id] = 0.f;
+  landmarks = network->getLandmarks();
+  if(landmarks != nullptr)
+  {
+    // Collect lower bounds for nodes attached to destination and departure
+    successorNodes.clear();
+    successorEdges.clear();
+    network->getPredecessors(destNode, successorNodes, successorEdges);
+    updateLandmarkBounds(successorNodes, successorEdges, destinationBounds);
+
+    successorNodes.clear();
+    successorEdges.clear();
+    network->getNeighbours(startNode, successorNodes, successorEdges);
+    updateLandmarkBounds(successorNodes, successorEdges, departureBounds);
+  }
+
+  parameters.mode = network->getMode();
+  parameters.altitude = altitude;
+  parameters.preferVorToAirway = preferVorToAirway;
+  parameters.preferNdbToAirway = preferNdbToAirway;
+  parameters.networkIndexVersion = network->getIndexVersion();
+
+  // Reverse search needs predecessors of the graph nodes
+  bool reverseAvailable = network->isGraphLoaded();
+  bool resumeForward = incremental && canResume(forwardState, from, parameters);
+  bool resumeReverse = incremental && reverseAvailable && !resumeForward &&
+                       canResume(reverseState, to, parameters);
+
+  // Hierarchy is available for airway routing if prepared after loading the scenery database
+  const RouteHierarchy *hierarchy = network->getHierarchy(altitude);
+
+  bool destinationFound;
+  if(hierarchy != nullptr)
+    destinationFound = searchHierarchy(startNode, destNode, *hierarchy);
+  else if(resumeForward)
+    // Departure unchanged - continue the tree from the departure towards the new destination
+    destinationFound = searchSingle(startNode, destNode, forwardState, destinationBounds, false, true,
+                                    numNodesTotal);
+  else if(resumeReverse)
+    // Destination unchanged - continue the tree from the destination towards the new departure
+    destinationFound = searchSingle(destNode, startNode, reverseState, departureBounds, true, true,
+                                    numNodesTotal);
+  else if(bidirectional && reverseAvailable)
+    destinationFound = searchBidirectional(startNode, destNode, numNodesTotal);
+  else if(incremental && reverseAvailable && lastDestinationPos == to && lastDeparturePos != from)
+    // Only departure changed - start a new tree from the destination so that further
+    // departure changes can reuse it
+    destinationFound = searchSingle(destNode, startNode, reverseState, departureBounds, true, false,
+                                    numNodesTotal);
+  else
+    destinationFound = searchSingle(startNode, destNode, forwardState, destinationBounds, false, false,
+                                    numNodesTotal);
+
+  lastDeparturePos = from;
+  lastDestinationPos = to;
+
+  qDebug() << "found" << destinationFound
+           << "heap size" << forwardState.heap.size() + reverseState.heap.size()
+           << "close nodes size" << forwardState.numClosedNodes + reverseState.numClosedNodes
+           << "landmarks" << (landmarks != nullptr) << "bidirectional" << bidirectional
+           << "resumed" << (resumeForward || resumeReverse) << "hierarchy" << (hierarchy != nullptr);
+
+  qDebug() << "num nodes database" << network->getNumberOfNodesDatabase()
+           << "num nodes cache" << network->getNumberOfNodesCache();
+
+  return destinationFound;
+}
+
+bool RouteFinder::searchSingle(const nw::Node& rootNode, const nw::Node& targetNode, rf::SearchState& state,
+                               const rf::LandmarkBounds& bounds, bool reverse, bool resume, int numNodesTotal)
+{
+  // Statistics of the other direction are not valid for this calculation
+  rf::SearchState& otherState = reverse ? forwardState : reverseState;
+  otherState.numClosedNodes = 0;
 
-  Node currentNode;
-  bool destinationFound = false;
-  while(!openNodesHeap.isEmpty())
+  if(resume)
+  {
+    // Keep the tree and count only the nodes expanded in this calculation
+    state.numClosedNodes = 0;
+    resumeState(targetNode, state, bounds, reverse);
+  }
+  else
+  {
+    startGeneration(state);
+    state.rootPos = rootNode.pos;
+    initState(state, rootNode, 0.f);
+  }
+
+  bool targetFound = false;
+  while(!state.heap.isEmpty())
   {
     // Contains known nodes
-    openNodesHeap.pop(currentNode);
+    int currentIndex = state.heap.pop();
 
-    if(currentNode.id == destNode.id)
+    if(currentIndex == targetNode.index)
     {
-      destinationFound = true;
+      targetFound = true;
       break;
     }
 
     // Contains nodes with known shortest path
-    closedNodes.insert(currentNode.id);
+    state.closedGeneration[currentIndex] = state.generation;
+    state.numClosedNodes++;
 
-    if(closedNodes.size() > numNodesTotal / 2)
+    if(state.numClosedNodes > numNodesTotal / 2)
       // If we read too much nodes routing will fail
       break;
 
-    // Work on successors
-    expandNode(currentNode, destNode);
+    if(reportProgress(state.numClosedNodes, state.heap.size()))
+      break;
+
+    // Work on successors or predecessors
+    expandNode(network->getNodeByIndex(currentIndex), targetNode, state, bounds, reverse, nullptr);
   }
 
-  qDebug() << "found" << destinationFound << "heap size" << openNodesHeap.size()
-           << "close nodes size" << closedNodes.size();
+  if(targetFound)
+  {
+    if(reverse)
+    {
+      // Predecessors in the reverse tree lead from departure to the destination already
+      // Airway of the edge belongs to the following node
+      routeIndexes.append(targetNode.index);
+      routeAirwayIds.append(-1);
+      for(int index = targetNode.index; state.nodePredecessor.at(index) != -1;
+          index = state.nodePredecessor.at(index))
+      {
+        routeIndexes.append(state.nodePredecessor.at(index));
+        routeAirwayIds.append(state.nodeAirwayId.at(index));
+      }
+    }
+    else
+    {
+      // Collect route from destination back to departure
+      for(int index = targetNode.index; index != -1; index = state.nodePredecessor.at(index))
+      {
+        routeIndexes.append(index);
+        routeAirwayIds.append(state.nodeAirwayId.at(index));
+      }
+      std::reverse(routeIndexes.begin(), routeIndexes.end());
+      std::reverse(routeAirwayIds.begin(), routeAirwayIds.end());
+    }
+  }
+  return targetFound;
+}
 
-  qDebug() << "num nodes database" << network->getNumberOfNodesDatabase()
-           << "num nodes cache" << network->getNumberOfNodesCache();
+bool RouteFinder::searchHierarchy(const nw::Node& startNode, const nw::Node& destNode,
+                                  const RouteHierarchy& hierarchy)
+{
+  // Search trees are not touched and can still be resumed later
+  const float noDirect = std::numeric_limits<float>::max();
+  float directCosts = noDirect;
+  QVector<nw::HierarchyTerminal> sources, targets;
 
-  return destinationFound;
+  successorNodes.clear();
+  successorEdges.clear();
+  network->getNeighbours(startNode, successorNodes, successorEdges);
+  for(int i = 0; i < successorNodes.size(); i++)
+  {
+    const Node& node = successorNodes.at(i);
+    float costs = calculateEdgeCost(startNode, node, successorEdges.at(i).lengthMeter);
+    if(node.index == destNode.index)
+      directCosts = costs;
+    else
+      sources.append({node.index, costs});
+  }
+
+  successorNodes.clear();
+  successorEdges.clear();
+  network->getPredecessors(destNode, successorNodes, successorEdges);
+  for(int i = 0; i < successorNodes.size(); i++)
+  {
+    const Node& node = successorNodes.at(i);
+    if(node.index != startNode.index)
+      targets.append({node.index, calculateEdgeCost(node, destNode, successorEdges.at(i).lengthMeter)});
+  }
+
+  QVector<int> path, airwayIds;
+  float costs;
+  int numSettled;
+  bool found = hierarchy.query(sources, targets, path, airwayIds, costs, numSettled);
+  forwardState.numClosedNodes = numSettled;
+  reverseState.numClosedNodes = 0;
+
+  if(found && costs <= directCosts)
+  {
+    // Virtual edges from departure and to destination have no airway
+    routeIndexes.append(startNode.index);
+    routeAirwayIds.append(-1);
+    routeIndexes.append(path);
+    routeAirwayIds.append(airwayIds);
+    routeIndexes.append(destNode.index);
+    routeAirwayIds.append(-1);
+    return true;
+  }
+  else if(directCosts < noDirect)
+  {
+    routeIndexes << startNode.index << destNode.index;
+    routeAirwayIds << -1 << -1;
+    return true;
+  }
+  return false;
+}
+
+/* Closed nodes keep their shortest path. Open nodes get new estimates for the changed target and closed
+ * nodes adjacent to the target are connected since they will not be expanded again. */
+void RouteFinder::resumeState(const nw::Node& targetNode, rf::SearchState& state,
+                              const rf::LandmarkBounds& bounds, bool reverse)
+{
+  // Target is a virtual node that might have been reached in the last calculation - drop it
+  if(targetNode.index < state.nodeGeneration.size())
+  {
+    state.nodeGeneration[targetNode.index] = 0;
+    state.closedGeneration[targetNode.index] = 0;
+  }
+
+  // Rebuild heap with estimates to the new target
+  QVector<int> openIndexes;
+  for(int index = 0; index < state.nodeGeneration.size(); index++)
+  {
+    if(state.heap.contains(index) && index != targetNode.index)
+      openIndexes.append(index);
+  }
+
+  state.heap.clear();
+  for(int index : openIndexes)
+  {
+    Node node = network->getNodeByIndex(index);
+    state.heap.push(index, state.nodeCosts.at(index) + costEstimate(node, targetNode, bounds));
+  }
+
+  // Connect the target to all closed nodes that have an edge to it
+  successorNodes.clear();
+  successorEdges.clear();
+  if(reverse)
+    network->getNeighbours(targetNode, successorNodes, successorEdges);
+  else
+    network->getPredecessors(targetNode, successorNodes, successorEdges);
+
+  updateStateSize(state, targetNode.index);
+  for(int i = 0; i < successorNodes.size(); i++)
+  {
+    const Node& node = successorNodes.at(i);
+    if(!isClosed(state, node.index))
+      // Open nodes will add the target when expanded
+      continue;
+
+    const Edge& edge = successorEdges.at(i);
+    float costs = state.nodeCosts.at(node.index) + (reverse ?
+                                                     calculateEdgeCost(targetNode, node, edge.lengthMeter) :
+                                                     calculateEdgeCost(node, targetNode, edge.lengthMeter));
+
+    if(!isVisited(state, targetNode.index) || costs < state.nodeCosts.at(targetNode.index))
+    {
+      state.nodeGeneration[targetNode.index] = state.generation;
+      state.nodeCosts[targetNode.index] = costs;
+      state.nodePredecessor[targetNode.index] = node.index;
+      state.nodeAirwayId[targetNode.index] = edge.airwayId;
+
+      if(state.heap.contains(targetNode.index))
+        state.heap.change(targetNode.index, costs);
+      else
+        state.heap.push(targetNode.index, costs);
+    }
+  }
+}
+
+bool RouteFinder::canResume(const rf::SearchState& state, const atools::geo::Pos& rootPos,
+                            const rf::SearchParameters& parameters) const
+{
+  return state.generation > 0 && state.rootPos == rootPos && state.parameters == parameters;
+}
+
+/* A* from departure and destination. Stops if the lowest estimate in one of the heaps is not lower than
+ * the best connection found so far. */
+bool RouteFinder::searchBidirectional(const nw::Node& startNode, const nw::Node& destNode, int numNodesTotal)
+{
+  startGeneration(forwardState);
+  startGeneration(reverseState);
+  forwardState.rootPos = startNode.pos;
+  reverseState.rootPos = destNode.pos;
+  initState(forwardState, startNode, 0.f);
+  initState(reverseState, destNode, 0.f);
+
+  bestMeetingCost = std::numeric_limits<float>::max();
+  meetingIndex = -1;
+
+  while(!forwardState.heap.isEmpty() && !reverseState.heap.isEmpty())
+  {
+    if(forwardState.heap.topCost() >= bestMeetingCost || reverseState.heap.topCost() >= bestMeetingCost)
+      // No better connection possible
+      break;
+
+    // Work on the smaller search front
+    bool reverse = reverseState.heap.size() < forwardState.heap.size();
+    rf::SearchState& state = reverse ? reverseState : forwardState;
+    const rf::SearchState& otherState = reverse ? forwardState : reverseState;
+
+    int currentIndex = state.heap.pop();
+    state.closedGeneration[currentIndex] = state.generation;
+    state.numClosedNodes++;
+
+    if(forwardState.numClosedNodes + reverseState.numClosedNodes > numNodesTotal / 2)
+      // If we read too much nodes routing will fail
+      break;
+
+    if(reportProgress(forwardState.numClosedNodes + reverseState.numClosedNodes,
+                      forwardState.heap.size() + reverseState.heap.size()))
+      break;
+
+    if(reverse)
+      expandNode(network->getNodeByIndex(currentIndex), startNode, state, departureBounds, true, &otherState);
+    else
+      expandNode(network->getNodeByIndex(currentIndex), destNode, state, destinationBounds, false,
+                 &otherState);
+  }
+
+  if(meetingIndex == -1 || canceled)
+    return false;
+
+  // Collect forward part from meeting point back to departure
+  for(int index = meetingIndex; index != -1; index = forwardState.nodePredecessor.at(index))
+  {
+    routeIndexes.append(index);
+    routeAirwayIds.append(forwardState.nodeAirwayId.at(index));
+  }
+  std::reverse(routeIndexes.begin(), routeIndexes.end());
+  std::reverse(routeAirwayIds.begin(), routeAirwayIds.end());
+
+  // Append reverse part from meeting point to destination - airway of edge belongs to the following node
+  for(int index = meetingIndex; reverseState.nodePredecessor.at(index) != -1;
+      index = reverseState.nodePredecessor.at(index))
+  {
+    routeIndexes.append(reverseState.nodePredecessor.at(index));
+    routeAirwayIds.append(reverseState.nodeAirwayId.at(index));
+  }
+  return true;
 }
 
 void RouteFinder::extractRoute(QVector<rf::RouteEntry>& route, float& distanceMeter)
@@ -94,40 +399,63 @@ void RouteFinder::extractRoute(QVector<rf::RouteEntry>& route, float& distanceMe
   route.reserve(500);
 
   // Build route
-  nw::Node pred = network->getDestinationNode();
-  while(pred.id != -1)
+  nw::Node last;
+  for(int i = 0; i < routeIndexes.size(); i++)
   {
+    nw::Node node = network->getNodeByIndex(routeIndexes.at(i));
+
     int navId;
     nw::NodeType type;
-    network->getNavIdAndTypeForNode(pred.id, navId, type);
+    network->getNavIdAndTypeForNode(node.id, navId, type);
 
     if(type != nw::DEPARTURE && type != nw::DESTINATION)
     {
       rf::RouteEntry entry;
       entry.ref = {navId, toMapObjectType(type)};
-      entry.airwayId = nodeAirwayId.value(pred.id, -1);
-      route.prepend(entry);
+      entry.airwayId = routeAirwayIds.at(i);
+      entry.minAltitude = entry.airwayId != -1 ? edgeMinAltitude(last, node, entry.airwayId) : 0;
+      route.append(entry);
     }
 
-    nw::Node next = network->getNode(nodePredecessor.value(pred.id, -1));
-    if(next.pos.isValid())
-      distanceMeter += pred.pos.distanceMeterTo(next.pos);
-    pred = next;
+    if(last.pos.isValid())
+      distanceMeter += last.pos.distanceMeterTo(node.pos);
+    last = node;
   }
 }
 
-/* Expands a node by investigating all successors */
-void RouteFinder::expandNode(const nw::Node& currentNode, const nw::Node& destNode)
+/* Get minimum altitude of the airway edge between the two nodes */
+int RouteFinder::edgeMinAltitude(const nw::Node& fromNode, const nw::Node& toNode, int airwayId)
 {
   successorNodes.clear();
   successorEdges.clear();
-  network->getNeighbours(currentNode, successorNodes, successorEdges);
+  network->getNeighbours(fromNode, successorNodes, successorEdges);
+
+  for(const nw::Edge& edge : successorEdges)
+  {
+    if(edge.toNodeId == toNode.id && edge.airwayId == airwayId)
+      return edge.minAltFt;
+  }
+  return 0;
+}
+
+/* Expands a node by investigating all successors or all predecessors if reverse is true */
+void RouteFinder::expandNode(const nw::Node& currentNode, const nw::Node& targetNode,
+                             rf::SearchState& state, const rf::LandmarkBounds& bounds, bool reverse,
+                             const rf::SearchState *otherState)
+{
+  successorNodes.clear();
+  successorEdges.clear();
+  if(reverse)
+    network->getPredecessors(currentNode, successorNodes, successorEdges);
+  else
+    network->getNeighbours(currentNode, successorNodes, successorEdges);
 
   for(int i = 0; i < successorNodes.size(); i++)
   {
     const Node& successor = successorNodes.at(i);
+    int successorIndex = successor.index;
 
-    if(closedNodes.contains(successor.id))
+    if(isClosed(state, successorIndex))
       // Already has a shortest path
       continue;
 
@@ -143,31 +471,134 @@ void RouteFinder::expandNode(const nw::Node& currentNode, const nw::Node& destNo
       // No distance given for airways - have to calculate this here
       lengthMeter = static_cast<int>(currentNode.pos.distanceMeterTo(successor.pos));
 
-    float successorEdgeCosts = calculateEdgeCost(currentNode, successor, lengthMeter);
-    float successorNodeCosts = nodeCosts.value(currentNode.id) + successorEdgeCosts;
+    // Edge direction is always from predecessor to successor
+    float successorEdgeCosts = reverse ?
+                               calculateEdgeCost(successor, currentNode, lengthMeter) :
+                               calculateEdgeCost(currentNode, successor, lengthMeter);
+    float successorNodeCosts = state.nodeCosts.at(currentNode.index) + successorEdgeCosts;
 
-    if(successorNodeCosts >= nodeCosts.value(successor.id) && openNodesHeap.contains(successor))
-      // New path is not cheaper
-      continue;
+    bool open = state.heap.contains(successorIndex);
+    if(!open || successorNodeCosts < state.nodeCosts.at(successorIndex))
+    {
+      // New path is cheaper - update node
+      updateStateSize(state, successorIndex);
+      state.nodeGeneration[successorIndex] = state.generation;
+      state.nodeAirwayId[successorIndex] = edge.airwayId;
+      state.nodePredecessor[successorIndex] = currentNode.index;
+      state.nodeCosts[successorIndex] = successorNodeCosts;
+
+      // Costs from start to successor + estimate to target = sort order in heap
+      float totalCost = successorNodeCosts + costEstimate(successor, targetNode, bounds);
+
+      if(open)
+        // Update node and resort heap
+        state.heap.change(successorIndex, totalCost);
+      else
+        state.heap.push(successorIndex, totalCost);
+    }
+
+    if(otherState != nullptr && isVisited(*otherState, successorIndex))
+    {
+      // Node was reached from the other side - remember cheapest connection
+      float meetingCost = state.nodeCosts.at(successorIndex) + otherState->nodeCosts.at(successorIndex);
+      if(meetingCost < bestMeetingCost)
+      {
+        bestMeetingCost = meetingCost;
+        meetingIndex = successorIndex;
+      }
+    }
+  }
+}
 
-    // New path is cheaper - update node
-    nodeAirwayId[successor.id] = successorEdges.at(i).airwayId;
-    nodePredecessor[successor.id] = currentNode.id;
-    nodeCosts[successor.id] = successorNodeCosts;
+/* Call progress callback periodically. Returns true if calculation was canceled. */
+bool RouteFinder::reportProgress(int numExpanded, int numOpen)
+{
+  if(progressCallback && numExpanded % PROGRESS_NODE_INTERVAL == 0)
+    canceled = progressCallback(numExpanded, numOpen);
+  return canceled;
+}
 
-    // Costs from start to successor + estimate to destination = sort order in heap
-    float totalCost = successorNodeCosts + costEstimate(successor, destNode);
+/* Put the start node into the empty state */
+void RouteFinder::initState(rf::SearchState& state, const nw::Node& node, float estimate)
+{
+  updateStateSize(state, node.index);
+  state.nodeGeneration[node.index] = state.generation;
+  state.nodeCosts[node.index] = 0.f;
+  state.nodePredecessor[node.index] = -1;
+  state.nodeAirwayId[node.index] = -1;
+  state.heap.push(node.index, estimate);
+}
 
-    if(openNodesHeap.contains(successor))
-      // Update node and resort heap
-      openNodesHeap.change(successor, totalCost);
-    else
-      openNodesHeap.push(successor, totalCost);
+/* Invalidate the search tree of the last calculation by increasing the generation counter */
+void RouteFinder::startGeneration(rf::SearchState& state)
+{
+  state.heap.clear();
+  state.numClosedNodes = 0;
+  state.parameters = parameters;
+  state.generation++;
+
+  if(state.generation == 0)
+  {
+    // Counter overflow - reset all arrays
+    state.nodeGeneration.fill(0);
+    state.closedGeneration.fill(0);
+    state.generation = 1;
+  }
+}
+
+/* Make sure the index fits into the state arrays. Arrays can grow during the calculation
+ * if the network loads nodes on demand. */
+void RouteFinder::updateStateSize(rf::SearchState& state, int index)
+{
+  if(index >= state.nodeGeneration.size())
+  {
+    int size = std::max(index + 1, network->getNumberOfIndexes());
+    state.nodeGeneration.resize(size);
+    state.closedGeneration.resize(size);
+    state.nodeCosts.resize(size);
+    state.nodePredecessor.resize(size);
+    state.nodeAirwayId.resize(size);
+  }
+}
+
+/* Calculate minimum and maximum landmark distances over all nodes attached to a virtual node */
+void RouteFinder::updateLandmarkBounds(const QVector<nw::Node>& nodes, const QVector<nw::Edge>& edges,
+                                       rf::LandmarkBounds& bounds)
+{
+  int numLandmarks = landmarks->getNumLandmarks();
+  bounds.minDistance.fill(RouteLandmarks::UNREACHABLE, numLandmarks);
+  bounds.maxDistance.fill(-1.f, numLandmarks);
+
+  for(int i = 0; i < nodes.size(); i++)
+  {
+    int index = nodes.at(i).index;
+    if(index < 0 || index >= landmarks->getNumNodes())
+      // Virtual node
+      continue;
+
+    const float *dist = landmarks->nodeDistances(index);
+    for(int l = 0; l < numLandmarks; l++)
+    {
+      if(dist[l] < RouteLandmarks::UNREACHABLE)
+      {
+        bounds.minDistance[l] = std::min(bounds.minDistance.at(l), dist[l] + edges.at(i).lengthMeter);
+        bounds.maxDistance[l] = std::max(bounds.maxDistance.at(l), dist[l]);
+      }
+    }
   }
 }
 
 /* Calculates the costs to travel from current to successor. Base is the distance between the nodes in meter that
  * will have several factors applied to get reasonable routes */
+float RouteFinder::airwayEdgeCost(int lengthMeter)
+{
+  float costs = lengthMeter;
+  if(lengthMeter > DISTANCE_LONG_AIRWAY_METER)
+    // Avoid certain airway segments that have an excessive length
+    costs *= COST_FACTOR_LONG_AIRWAY;
+  return costs;
+}
+
 float RouteFinder::calculateEdgeCost(const nw::Node& currentNode, const nw::Node& successorNode,
                                      int lengthMeter)
 {
@@ -236,10 +667,28 @@ float RouteFinder::calculateEdgeCost(const nw::Node& currentNode, const nw::Node
   return costs;
 }
 
-/* GC distance in meter as costs between nodes */
-float RouteFinder::costEstimate(const nw::Node& currentNode, const nw::Node& destNode)
+/* GC distance in meter as costs between nodes. Improved by landmark lower bounds if available. */
+float RouteFinder::costEstimate(const nw::Node& currentNode, const nw::Node& targetNode,
+                                const rf::LandmarkBounds& bounds)
 {
-  return currentNode.pos.distanceMeterTo(destNode.pos);
+  float estimate = currentNode.pos.distanceMeterTo(targetNode.pos);
+
+  if(landmarks != nullptr && currentNode.index >= 0 && currentNode.index < landmarks->getNumNodes())
+  {
+    // Triangle inequality for each landmark - use the largest lower bound
+    const float *dist = landmarks->nodeDistances(currentNode.index);
+    for(int l = 0; l < landmarks->getNumLandmarks(); l++)
+    {
+      if(dist[l] < RouteLandmarks::UNREACHABLE)
+      {
+        if(bounds.minDistance.at(l) < RouteLandmarks::UNREACHABLE)
+          estimate = std::max(estimate, bounds.minDistance.at(l) - dist[l]);
+        if(bounds.maxDistance.at(l) >= 0.f)
+          estimate = std::max(estimate, dist[l] - bounds.maxDistance.at(l));
+      }
+    }
+  }
+  return estimate;
 }
 
 /* Convert internal network type to MapObjectTypes for extract route */
@@ -19,16 +19,92 @@
 #define LITTLENAVMAP_ROUTEFINDER_H
 
 #include "common/maptypes.h"
-#include "util/heap.h"
+#include "route/routeindexheap.h"
 #include "route/routenetwork.h"
 #include "geo/calculations.h"
 
+#include <functional>
+
 namespace rf {
+/* Called periodically while calculating with the number of expanded and open nodes.
+ * Return true to cancel the calculation. */
+typedef std::function<bool (int numExpanded, int numOpen)> ProgressCallbackType;
+
 /* Used when fetching the route points after calculation. Adds airway id to node */
 struct RouteEntry
 {
   maptypes::MapObjectRef ref;
   int airwayId;
+  int minAltitude; /* Minimum altitude in feet of the airway segment leading to this entry or 0 */
+};
+
+/* Everything besides the root position that changes edge costs. A search tree can only be reused if these
+ * are unchanged. */
+struct SearchParameters
+{
+  nw::Modes mode = nw::ROUTE_NONE;
+  int altitude = 0;
+  bool preferVorToAirway = false, preferNdbToAirway = false;
+  quint32 networkIndexVersion = 0;
+
+  bool operator==(const rf::SearchParameters& other) const
+  {
+    return mode == other.mode && altitude == other.altitude && preferVorToAirway == other.preferVorToAirway &&
+           preferNdbToAirway == other.preferNdbToAirway && networkIndexVersion == other.networkIndexVersion;
+  }
+
+  bool operator!=(const rf::SearchParameters& other) const
+  {
+    return !operator==(other);
+  }
+
+};
+
+/* Search state for one direction. All arrays are indexed by the dense node index of the network. */
+struct SearchState
+{
+  SearchState()
+    : heap(5000)
+  {
+  }
+
+  /* Array entries are only valid if their generation matches */
+  quint32 generation = 0;
+
+  /* Position of the root node (departure for forward and destination for reverse search) and parameters
+   * which were used to build the search tree. */
+  atools::geo::Pos rootPos;
+  rf::SearchParameters parameters;
+
+  /* Heap structure storing indexes of open nodes.
+   * Sort order is defined by costs from start to node + estimate to destination */
+  RouteIndexHeap heap;
+
+  /* Generation when node was visited (costs, predecessor and airway are valid) */
+  QVector<quint32> nodeGeneration;
+
+  /* Generation when node was closed, i.e. has a known shortest path */
+  QVector<quint32> closedGeneration;
+  int numClosedNodes = 0;
+
+  /* Costs from start to this node. Costs are distance in meter adjusted by some factors. */
+  QVector<float> nodeCosts;
+
+  /* Maps node index to predecessor node index. Successor towards the destination for the reverse search. */
+  QVector<int> nodePredecessor;
+
+  /* Maps node index to airway id of the edge to nodePredecessor */
+  QVector<int> nodeAirwayId;
+};
+
+/* Lower bound helper for the landmark heuristic for one search target */
+struct LandmarkBounds
+{
+  /* Minimum of landmark distance plus virtual edge length over all nodes attached to the target */
+  QVector<float> minDistance;
+
+  /* Maximum of landmark distance over all nodes attached to the target */
+  QVector<float> maxDistance;
 };
 
 }
@@ -36,6 +112,20 @@ struct RouteEntry
 /*
  * Calculates flight plans within a route network which can be an airway or radio navaid network.
  * Use A* algorithm and several cost factor adjustments to get reasonable routes.
+ *
+ * All search state is kept in flat arrays indexed by the dense node index (nw::Node::index) of the network.
+ * The arrays are not cleared between calculations. A generation counter marks entries as valid instead.
+ *
+ * If the network provides landmark tables the estimate is improved by the ALT heuristic. An optional
+ * bidirectional search runs from departure and destination at the same time.
+ *
+ * In incremental mode the search trees of the last calculation are kept. Nodes that were closed have a known
+ * shortest path from the root which does not depend on the target. If only the destination moves the forward
+ * tree from the departure is continued towards the new destination. If only the departure moves the
+ * search runs backwards from the destination and continues this tree on the next change.
+ * Use the same route finder instance for all calculations to benefit from this.
+ *
+ * Airway routes are taken from a contraction hierarchy if the network provides one for mode and altitude.
  */
 class RouteFinder
 {
@@ -70,12 +160,91 @@ public:
     preferNdbToAirway = value;
   }
 
+  /* Search from departure and destination simultaneously. Needs a network with loaded graph. */
+  void setBidirectional(bool value)
+  {
+    bidirectional = value;
+  }
+
+  /* Reuse search trees of the last calculation if only departure or destination changed */
+  void setIncremental(bool value)
+  {
+    incremental = value;
+  }
+
+  /* Callback is called every PROGRESS_NODE_INTERVAL expanded nodes and can cancel the calculation */
+  void setProgressCallback(const rf::ProgressCallbackType& callback)
+  {
+    progressCallback = callback;
+  }
+
+  /* Number of nodes expanded in both directions by the last calculation */
+  int getNumberOfExpandedNodes() const
+  {
+    return forwardState.numClosedNodes + reverseState.numClosedNodes;
+  }
+
+  /* true if the last calculation was canceled by the progress callback */
+  bool isCanceled() const
+  {
+    return canceled;
+  }
+
+  /* Costs of an airway edge between two network nodes. Same as calculateEdgeCost for airway routing
+   * without departure or destination. Used to build contraction hierarchies. */
+  static float airwayEdgeCost(int lengthMeter);
+
 private:
-  void expandNode(const nw::Node& node, const nw::Node& destNode);
+  /* A* from root to target. Forward search if reverse is false. Continues the existing search tree in state
+   * if resume is true. */
+  bool searchSingle(const nw::Node& rootNode, const nw::Node& targetNode, rf::SearchState& state,
+                    const rf::LandmarkBounds& bounds, bool reverse, bool resume, int numNodesTotal);
+  bool searchBidirectional(const nw::Node& startNode, const nw::Node& destNode, int numNodesTotal);
+
+  /* Query contraction hierarchy between the nodes attached to departure and destination */
+  bool searchHierarchy(const nw::Node& startNode, const nw::Node& destNode, const RouteHierarchy& hierarchy);
+
+  /* Prepare a search tree for a new target. Resorts the open nodes and connects closed nodes
+   * to the target. */
+  void resumeState(const nw::Node& targetNode, rf::SearchState& state, const rf::LandmarkBounds& bounds,
+                   bool reverse);
+  bool canResume(const rf::SearchState& state, const atools::geo::Pos& rootPos,
+                 const rf::SearchParameters& parameters) const;
+
+  /* Expand node in forward direction or in reverse direction if reverse is true.
+   * Updates best meeting point if otherState is not null. */
+  void expandNode(const nw::Node& node, const nw::Node& targetNode, rf::SearchState& state,
+                  const rf::LandmarkBounds& bounds, bool reverse, const rf::SearchState *otherState);
+
+  void initState(rf::SearchState& state, const nw::Node& node, float estimate);
+  void startGeneration(rf::SearchState& state);
+  void updateStateSize(rf::SearchState& state, int index);
+  void updateLandmarkBounds(const QVector<nw::Node>& nodes, const QVector<nw::Edge>& edges,
+                            rf::LandmarkBounds& bounds);
+
+  /* true if index has costs and predecessor for the current calculation */
+  bool isVisited(const rf::SearchState& state, int index) const
+  {
+    return index < state.nodeGeneration.size() && state.nodeGeneration.at(index) == state.generation;
+  }
+
+  /* true if index has a known shortest path in the current calculation */
+  bool isClosed(const rf::SearchState& state, int index) const
+  {
+    return index < state.closedGeneration.size() && state.closedGeneration.at(index) == state.generation;
+  }
+
+  int edgeMinAltitude(const nw::Node& fromNode, const nw::Node& toNode, int airwayId);
+  bool reportProgress(int numExpanded, int numOpen);
+
   float calculateEdgeCost(const nw::Node& node, const nw::Node& successorNode, int lengthMeter);
-  float costEstimate(const nw::Node& currentNode, const nw::Node& destNode);
+  float costEstimate(const nw::Node& currentNode, const nw::Node& targetNode,
+                     const rf::LandmarkBounds& bounds);
   maptypes::MapObjectTypes toMapObjectType(nw::NodeType type);
 
+  /* Call progress callback after this number of expanded nodes */
+  static Q_DECL_CONSTEXPR int PROGRESS_NODE_INTERVAL = 1000;
+
   /* Force algortihm to avoid direct route from start to destination */
   static Q_DECL_CONSTEXPR float COST_FACTOR_DIRECT = 2.f;
 
@@ -109,27 +278,35 @@ private:
 
   RouteNetwork *network;
 
-  /* Heap structure storing open nodes.
-   * Sort order is defined by costs from start to node + estimate to destination */
-  atools::util::Heap<nw::Node> openNodesHeap;
+  /* Search from departure and from destination */
+  rf::SearchState forwardState, reverseState;
 
-  /* Nodes that have been processed already and have a known shortest path */
-  QSet<int> closedNodes;
+  /* Parameters of the current calculation. Assigned to new search trees. */
+  rf::SearchParameters parameters;
 
-  /* Costs from start to this node. Maps node id to costs. Costs are distance in meter
-   * adjusted by some factors. */
-  QHash<int, float> nodeCosts;
+  /* Positions of the last calculation */
+  atools::geo::Pos lastDeparturePos, lastDestinationPos;
 
-  /* Maps node id to predecessor node id */
-  QHash<int, int> nodePredecessor;
-  /* Maps node id to predecessor airway id */
-  QHash<int, int> nodeAirwayId;
+  /* Landmark tables from network or null */
+  const RouteLandmarks *landmarks = nullptr;
+  /* Lower bounds to destination for the forward and to departure for the reverse search */
+  rf::LandmarkBounds destinationBounds, departureBounds;
+
+  /* Best connection found in bidirectional search */
+  float bestMeetingCost;
+  int meetingIndex = -1;
+
+  /* Result of the last calculation from departure to destination including both */
+  QVector<int> routeIndexes, routeAirwayIds;
 
   /* For RouteNetwork::getNeighbours to avoid instantiations */
   QVector<nw::Node> successorNodes;
   QVector<nw::Edge> successorEdges;
 
-  bool preferVorToAirway = false, preferNdbToAirway = false;
+  rf::ProgressCallbackType progressCallback;
+
+  bool preferVorToAirway = false, preferNdbToAirway = false, bidirectional = false, incremental = false,
+       canceled = false;
 };
 
 #endif // LITTLENAVMAP_ROUTEFINDER_H
@@ -0,0 +1,467 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routegraph.h"
+
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlutil.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+using atools::sql::SqlDatabase;
+using atools::sql::SqlQuery;
+using nw::GraphEdge;
+
+namespace {
+/* Used to collect edges before building the sparse row structure */
+struct TempEdge
+{
+  int fromIndex;
+  GraphEdge edge;
+};
+
+/* Fixed size header of the cache file. Followed by the fingerprint and the arrays. */
+struct CacheHeader
+{
+  quint32 magic, version, edgeSize, fingerprintSize;
+  qint32 numNodes, numEdges, hasRange, reserved;
+};
+
+/* All sections in the cache file start at a multiple of this to allow direct access after mapping */
+const qint64 CACHE_ALIGNMENT = 8;
+
+qint64 alignedSize(qint64 size)
+{
+  return (size + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+
+const char PADDING[CACHE_ALIGNMENT] = {0};
+
+/* Write data and pad up to the next aligned position */
+bool writeSection(QIODevice& device, const void *data, qint64 size)
+{
+  if(size > 0 && device.write(static_cast<const char *>(data), size) != size)
+    return false;
+
+  qint64 padding = alignedSize(size) - size;
+  return padding == 0 || device.write(PADDING, padding) == padding;
+}
+
+/* Write edges field by field into a zeroed buffer so that struct padding is written as zeros */
+bool writeEdgeSection(QIODevice& device, const GraphEdge *edges, int numEdges)
+{
+  const int CHUNK_SIZE = 4096;
+  QVector<char> buffer(CHUNK_SIZE * static_cast<int>(sizeof(GraphEdge)));
+
+  for(int start = 0; start < numEdges; start += CHUNK_SIZE)
+  {
+    int num = std::min(CHUNK_SIZE, numEdges - start);
+    std::fill(buffer.begin(), buffer.end(), 0);
+
+    GraphEdge *out = reinterpret_cast<GraphEdge *>(buffer.data());
+    for(int i = 0; i < num; i++)
+    {
+      const GraphEdge& edge = edges[start + i];
+      out[i].toIndex = edge.toIndex;
+      out[i].lengthMeter = edge.lengthMeter;
+      out[i].minAltFt = edge.minAltFt;
+      out[i].airwayId = edge.airwayId;
+      out[i].type = edge.type;
+    }
+
+    qint64 size = num * static_cast<qint64>(sizeof(GraphEdge));
+    if(device.write(buffer.constData(), size) != size)
+      return false;
+  }
+
+  qint64 size = numEdges * static_cast<qint64>(sizeof(GraphEdge));
+  qint64 padding = alignedSize(size) - size;
+  return padding == 0 || device.write(PADDING, padding) == padding;
+}
+
+/* Get pointer to a section in the mapped file and advance offset. Returns null if beyond file end. */
+template<typename TYPE>
+const TYPE *mapSection(const uchar *base, qint64& offset, qint64 fileSize, qint64 count)
+{
+  qint64 size = count * static_cast<qint64>(sizeof(TYPE));
+  if(offset + size > fileSize)
+    return nullptr;
+
+  const TYPE *data = reinterpret_cast<const TYPE *>(base + offset);
+  offset += alignedSize(size);
+  return data;
+}
+
+}
+
+RouteGraph::RouteGraph()
+{
+
+}
+
+RouteGraph::~RouteGraph()
+{
+  clear();
+}
+
+void RouteGraph::load(SqlDatabase *db, const QString& nodeTable, const QString& edgeTable,
+                      const QStringList& nodeExtraColumns, const QStringList& edgeExtraColumns)
+{
+  clear();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  atools::sql::SqlUtil util(db);
+  bool hasRange = nodeExtraColumns.contains("range");
+
+  // Load nodes ====================================================
+  int nodeRows = util.rowCount(nodeTable);
+  nodeIds.reserve(nodeRows);
+  navIds.reserve(nodeRows);
+  lonX.reserve(nodeRows);
+  latY.reserve(nodeRows);
+  types.reserve(nodeRows);
+  if(hasRange)
+    ranges.reserve(nodeRows);
+
+  SqlQuery nodeQuery(db);
+  nodeQuery.exec("select node_id, nav_id, type, lonx, laty" + QString(hasRange ? ", range" : "") +
+                 " from " + nodeTable + " order by node_id");
+
+  while(nodeQuery.next())
+  {
+    nodeIds.append(nodeQuery.value(0).toInt());
+    navIds.append(nodeQuery.value(1).toInt());
+    types.append(static_cast<quint8>(nodeQuery.value(2).toInt()));
+    lonX.append(nodeQuery.value(3).toFloat());
+    latY.append(nodeQuery.value(4).toFloat());
+    if(hasRange)
+      ranges.append(nodeQuery.value(5).toInt());
+  }
+  updateDataPointers();
+
+  consecutiveIds = !nodeIds.isEmpty() && nodeIds.last() - nodeIds.first() + 1 == nodeIds.size();
+
+  // Load edges ====================================================
+  // Column indexes are fixed by the select statement below
+  int typeIndex = edgeExtraColumns.indexOf("type"), minAltIndex = edgeExtraColumns.indexOf("minimum_altitude"),
+      airwayIdIndex = edgeExtraColumns.indexOf("airway_id"), distanceIndex = edgeExtraColumns.indexOf("distance");
+
+  QString edgeCols = edgeExtraColumns.join(", ");
+  if(!edgeExtraColumns.isEmpty())
+    edgeCols.prepend(", ");
+
+  QVector<TempEdge> tempEdges;
+  tempEdges.reserve(util.rowCount(edgeTable) * 2);
+
+  SqlQuery edgeQuery(db);
+  edgeQuery.exec("select from_node_id, to_node_id" + edgeCols + " from " + edgeTable);
+
+  while(edgeQuery.next())
+  {
+    int fromIndex = indexOf(edgeQuery.value(0).toInt());
+    int toIndex = indexOf(edgeQuery.value(1).toInt());
+
+    if(fromIndex == -1 || toIndex == -1 || fromIndex == toIndex)
+      continue;
+
+    GraphEdge edge;
+    edge.type = typeIndex != -1 ? static_cast<quint8>(edgeQuery.value(typeIndex + 2).toInt()) : 0;
+    edge.minAltFt = minAltIndex != -1 ? edgeQuery.value(minAltIndex + 2).toInt() : 0;
+    edge.airwayId = airwayIdIndex != -1 ? edgeQuery.value(airwayIdIndex + 2).toInt() : -1;
+
+    if(distanceIndex != -1)
+      edge.lengthMeter = edgeQuery.value(distanceIndex + 2).toInt();
+    else
+      // No distance given for airways - calculate once here
+      edge.lengthMeter = static_cast<int>(getPos(fromIndex).distanceMeterTo(getPos(toIndex)));
+
+    // Add edge in both directions
+    edge.toIndex = toIndex;
+    tempEdges.append({fromIndex, edge});
+    edge.toIndex = fromIndex;
+    tempEdges.append({toIndex, edge});
+  }
+
+  // Sort by node and remove duplicates which are defined by same target and same type.
+  // Shortest duplicate comes first and is kept. Remaining fields make the order independent of the query.
+  std::sort(tempEdges.begin(), tempEdges.end(), [](const TempEdge& e1, const TempEdge& e2) -> bool
+            {
+              if(e1.fromIndex != e2.fromIndex)
+                return e1.fromIndex < e2.fromIndex;
+              else if(e1.edge.toIndex != e2.edge.toIndex)
+                return e1.edge.toIndex < e2.edge.toIndex;
+              else if(e1.edge.type != e2.edge.type)
+                return e1.edge.type < e2.edge.type;
+              else if(e1.edge.lengthMeter != e2.edge.lengthMeter)
+                return e1.edge.lengthMeter < e2.edge.lengthMeter;
+              else if(e1.edge.airwayId != e2.edge.airwayId)
+                return e1.edge.airwayId < e2.edge.airwayId;
+              else
+                return e1.edge.minAltFt < e2.edge.minAltFt;
+            });
+
+  QVector<TempEdge>::iterator it = std::unique(tempEdges.begin(), tempEdges.end(),
+                                               [](const TempEdge& e1, const TempEdge& e2) -> bool
+                                               {
+                                                 return e1.fromIndex == e2.fromIndex &&
+                                                 e1.edge.toIndex == e2.edge.toIndex &&
+                                                 e1.edge.type == e2.edge.type;
+                                               });
+  tempEdges.erase(it, tempEdges.end());
+
+  // Build offsets and packed edge array ==========================
+  edgeOffsets.fill(0, nodeIds.size() + 1);
+  edges.reserve(tempEdges.size());
+  for(const TempEdge& temp : tempEdges)
+  {
+    edgeOffsets[temp.fromIndex + 1]++;
+    edges.append(temp.edge);
+  }
+
+  for(int i = 1; i < edgeOffsets.size(); i++)
+    edgeOffsets[i] += edgeOffsets.at(i - 1);
+
+  updateDataPointers();
+  grid.build(*this);
+
+  qDebug() << "RouteGraph loaded" << nodeTable << "nodes" << numNodes << "edges" << numEdges
+           << "bytes" << getMemorySize() << "in" << timer.elapsed() << "ms";
+}
+
+bool RouteGraph::mapCache(const QString& filename, const QString& fingerprint)
+{
+  clear();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QFile *file = new QFile(filename);
+  if(!file->open(QIODevice::ReadOnly))
+  {
+    delete file;
+    return false;
+  }
+
+  qint64 fileSize = file->size();
+  uchar *base = fileSize >= static_cast<qint64>(sizeof(CacheHeader)) ? file->map(0, fileSize) : nullptr;
+  if(base == nullptr)
+  {
+    qWarning() << "RouteGraph cannot map file" << filename << file->errorString();
+    delete file;
+    return false;
+  }
+
+  // Keep mapping and file open until the graph is cleared
+  mappedFile = file;
+  mappedData = base;
+
+  // Header and fingerprint ===================================
+  const CacheHeader *header = reinterpret_cast<const CacheHeader *>(base);
+  if(header->magic != FILE_MAGIC || header->version != FILE_VERSION ||
+     header->edgeSize != sizeof(GraphEdge) || header->numNodes <= 0 || header->numEdges < 0)
+  {
+    qWarning() << "RouteGraph invalid file" << filename;
+    clear();
+    return false;
+  }
+
+  qint64 offset = alignedSize(sizeof(CacheHeader));
+  const char *fileFingerprint = mapSection<char>(base, offset, fileSize, header->fingerprintSize);
+  if(fileFingerprint == nullptr ||
+     QString::fromUtf8(fileFingerprint, static_cast<int>(header->fingerprintSize)) != fingerprint)
+  {
+    qInfo() << "RouteGraph outdated file" << filename;
+    clear();
+    return false;
+  }
+
+  // Arrays in the same order as written in saveCache =========
+  qint64 nodes = header->numNodes;
+  nodeIdData = mapSection<int>(base, offset, fileSize, nodes);
+  navIdData = mapSection<int>(base, offset, fileSize, nodes);
+  if(header->hasRange)
+    rangeData = mapSection<int>(base, offset, fileSize, nodes);
+  lonXData = mapSection<float>(base, offset, fileSize, nodes);
+  latYData = mapSection<float>(base, offset, fileSize, nodes);
+  typeData = mapSection<quint8>(base, offset, fileSize, nodes);
+  edgeOffsetData = mapSection<int>(base, offset, fileSize, nodes + 1);
+  edgeData = mapSection<GraphEdge>(base, offset, fileSize, header->numEdges);
+
+  if(nodeIdData == nullptr || navIdData == nullptr || (header->hasRange && rangeData == nullptr) ||
+     lonXData == nullptr || latYData == nullptr || typeData == nullptr || edgeOffsetData == nullptr ||
+     (header->numEdges > 0 && edgeData == nullptr) || edgeOffsetData[nodes] != header->numEdges)
+  {
+    qWarning() << "RouteGraph truncated file" << filename;
+    clear();
+    return false;
+  }
+
+  numNodes = header->numNodes;
+  numEdges = header->numEdges;
+  consecutiveIds = nodeIdData[numNodes - 1] - nodeIdData[0] + 1 == numNodes;
+  grid.build(*this);
+
+  qDebug() << "RouteGraph mapped" << filename << "nodes" << numNodes << "edges" << numEdges
+           << "in" << timer.elapsed() << "ms";
+  return true;
+}
+
+bool RouteGraph::saveCache(const QString& filename, const QString& fingerprint) const
+{
+  if(isEmpty())
+    return false;
+
+  // Writes into a temporary file and renames it on commit. Renaming can fail on Windows if another graph
+  // has the old file mapped. This graph stays usable from memory and the cache is written on the next load.
+  QSaveFile file(filename);
+  if(!file.open(QIODevice::WriteOnly))
+  {
+    qWarning() << "RouteGraph cannot write file" << filename << file.errorString();
+    return false;
+  }
+
+  QByteArray fingerprintUtf8 = fingerprint.toUtf8();
+
+  // Clear padding and unused fields to get reproducible files
+  CacheHeader header;
+  memset(&header, 0, sizeof(CacheHeader));
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.edgeSize = sizeof(GraphEdge);
+  header.fingerprintSize = static_cast<quint32>(fingerprintUtf8.size());
+  header.numNodes = numNodes;
+  header.numEdges = numEdges;
+  header.hasRange = rangeData != nullptr;
+
+  qint64 nodes = numNodes;
+  bool ok = writeSection(file, &header, sizeof(CacheHeader)) &&
+            writeSection(file, fingerprintUtf8.constData(), fingerprintUtf8.size()) &&
+            writeSection(file, nodeIdData, nodes * static_cast<qint64>(sizeof(int))) &&
+            writeSection(file, navIdData, nodes * static_cast<qint64>(sizeof(int))) &&
+            (rangeData == nullptr ||
+             writeSection(file, rangeData, nodes * static_cast<qint64>(sizeof(int)))) &&
+            writeSection(file, lonXData, nodes * static_cast<qint64>(sizeof(float))) &&
+            writeSection(file, latYData, nodes * static_cast<qint64>(sizeof(float))) &&
+            writeSection(file, typeData, nodes * static_cast<qint64>(sizeof(quint8))) &&
+            writeSection(file, edgeOffsetData, (nodes + 1) * static_cast<qint64>(sizeof(int))) &&
+            writeEdgeSection(file, edgeData, numEdges);
+
+  if(!ok || !file.commit())
+  {
+    qWarning() << "RouteGraph error writing file" << filename << file.errorString();
+    return false;
+  }
+
+  qDebug() << "RouteGraph saved" << filename;
+  return true;
+}
+
+void RouteGraph::updateDataPointers()
+{
+  nodeIdData = nodeIds.constData();
+  navIdData = navIds.constData();
+  rangeData = ranges.isEmpty() ? nullptr : ranges.constData();
+  lonXData = lonX.constData();
+  latYData = latY.constData();
+  typeData = types.constData();
+  edgeOffsetData = edgeOffsets.isEmpty() ? nullptr : edgeOffsets.constData();
+  edgeData = edges.constData();
+  numNodes = nodeIds.size();
+  numEdges = edges.size();
+}
+
+void RouteGraph::clearDataPointers()
+{
+  nodeIdData = navIdData = rangeData = edgeOffsetData = nullptr;
+  lonXData = latYData = nullptr;
+  typeData = nullptr;
+  edgeData = nullptr;
+  numNodes = numEdges = 0;
+}
+
+void RouteGraph::clear()
+{
+  clearDataPointers();
+  grid.clear();
+
+  if(mappedFile != nullptr)
+  {
+    mappedFile->unmap(mappedData);
+    mappedFile->close();
+    delete mappedFile;
+    mappedFile = nullptr;
+    mappedData = nullptr;
+  }
+
+  nodeIds.clear();
+  navIds.clear();
+  ranges.clear();
+  lonX.clear();
+  latY.clear();
+  types.clear();
+  edgeOffsets.clear();
+  edges.clear();
+
+  // Release memory
+  nodeIds.squeeze();
+  navIds.squeeze();
+  ranges.squeeze();
+  lonX.squeeze();
+  latY.squeeze();
+  types.squeeze();
+  edgeOffsets.squeeze();
+  edges.squeeze();
+  consecutiveIds = false;
+}
+
+int RouteGraph::indexOf(int nodeId) const
+{
+  if(numNodes == 0)
+    return -1;
+
+  if(consecutiveIds)
+  {
+    int index = nodeId - nodeIdData[0];
+    return index >= 0 && index < numNodes ? index : -1;
+  }
+
+  const int *end = nodeIdData + numNodes;
+  const int *it = std::lower_bound(nodeIdData, end, nodeId);
+  if(it != end && *it == nodeId)
+    return static_cast<int>(it - nodeIdData);
+
+  return -1;
+}
+
+qint64 RouteGraph::getMemorySize() const
+{
+  qint64 nodes = numNodes;
+  return nodes * static_cast<qint64>(sizeof(int)) * (rangeData != nullptr ? 3 : 2) +
+         nodes * static_cast<qint64>(sizeof(float)) * 2 +
+         nodes * static_cast<qint64>(sizeof(quint8)) +
+         (nodes + 1) * static_cast<qint64>(sizeof(int)) +
+         numEdges * static_cast<qint64>(sizeof(GraphEdge)) + grid.getMemorySize();
+}
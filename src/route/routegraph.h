@@ -0,0 +1,197 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTEGRAPH_H
+#define LITTLENAVMAP_ROUTEGRAPH_H
+
+#include "geo/pos.h"
+#include "route/routenodegrid.h"
+
+#include <QVector>
+#include <QStringList>
+
+class QFile;
+
+namespace  atools {
+namespace sql {
+class SqlDatabase;
+}
+}
+
+namespace nw {
+
+/* Packed edge as stored in the graph. Edges of a node are stored contiguously. */
+struct GraphEdge
+{
+  int toIndex; /* Index into the graph node arrays - not the database id */
+  int lengthMeter, minAltFt, airwayId;
+  quint8 type; /* nw::EdgeType */
+};
+
+}
+
+Q_DECLARE_TYPEINFO(nw::GraphEdge, Q_PRIMITIVE_TYPE);
+
+/*
+ * Compact in-memory copy of a complete routing network in compressed sparse row layout.
+ * Nodes are stored in parallel arrays sorted by database id. The edges of node i are
+ * found in the range edges[edgeOffsets[i]] to edges[edgeOffsets[i + 1]].
+ * Edges are added for both directions like in RouteNetwork::fetchNode.
+ *
+ * The graph can be saved to a binary cache file which is mapped read-only into memory on the next load.
+ * All accessors work on plain pointers which refer either to the owned arrays or into the mapped file.
+ *
+ * The graph is read-only after loading.
+ */
+class RouteGraph
+{
+public:
+  RouteGraph();
+  ~RouteGraph();
+
+  /*
+   * Load all nodes and edges from the database. Uses the same table layout as RouteNetwork.
+   * @param nodeExtraColumns Extra columns that are loaded with the nodes. Only "range" is used.
+   * @param edgeExtraColumns Extra columns that are loaded with the edges.
+   */
+  void load(atools::sql::SqlDatabase *db, const QString& nodeTable, const QString& edgeTable,
+            const QStringList& nodeExtraColumns, const QStringList& edgeExtraColumns);
+
+  /*
+   * Map a cache file read-only into memory.
+   * @return false if the file is missing, invalid or the fingerprint does not match.
+   */
+  bool mapCache(const QString& filename, const QString& fingerprint);
+
+  /* Save graph to a cache file including the fingerprint. The file is replaced atomically.
+   * @return false if writing or replacing failed, e.g. on Windows if the old file is still mapped. */
+  bool saveCache(const QString& filename, const QString& fingerprint) const;
+
+  /* Remove all nodes and edges, unmap file and free memory */
+  void clear();
+
+  bool isEmpty() const
+  {
+    return numNodes == 0;
+  }
+
+  /* Number of nodes */
+  int size() const
+  {
+    return numNodes;
+  }
+
+  int getNumEdges() const
+  {
+    return numEdges;
+  }
+
+  /* Spatial index over all nodes. Built after loading or mapping. */
+  const RouteNodeGrid& getGrid() const
+  {
+    return grid;
+  }
+
+  /* true if graph was mapped from a cache file */
+  bool isMapped() const
+  {
+    return mappedFile != nullptr;
+  }
+
+  /* Get index for database node id or -1 if not found */
+  int indexOf(int nodeId) const;
+
+  /* Database id "node_id" */
+  int getId(int index) const
+  {
+    return nodeIdData[index];
+  }
+
+  /* Database navaid id "nav_id" */
+  int getNavId(int index) const
+  {
+    return navIdData[index];
+  }
+
+  /* Type as stored in the database. Contains type and subtype for airway networks. */
+  int getType(int index) const
+  {
+    return typeData[index];
+  }
+
+  /* Radio navaid range or 0 */
+  int getRange(int index) const
+  {
+    return rangeData == nullptr ? 0 : rangeData[index];
+  }
+
+  atools::geo::Pos getPos(int index) const
+  {
+    return atools::geo::Pos(lonXData[index], latYData[index]);
+  }
+
+  /* Iterate over edges using pointers */
+  const nw::GraphEdge *edgesBegin(int index) const
+  {
+    return edgeData + edgeOffsetData[index];
+  }
+
+  const nw::GraphEdge *edgesEnd(int index) const
+  {
+    return edgeData + edgeOffsetData[index + 1];
+  }
+
+  /* Approximate memory usage in bytes. Includes the mapped file. */
+  qint64 getMemorySize() const;
+
+private:
+  /* Point data pointers to the owned arrays after loading from the database */
+  void updateDataPointers();
+  void clearDataPointers();
+
+  /* Increase when changing the file format or the graph contents */
+  static Q_DECL_CONSTEXPR quint32 FILE_MAGIC = 0x4C4E4D47;
+  static Q_DECL_CONSTEXPR quint32 FILE_VERSION = 2;
+
+  /* Node arrays. All have the same size. Empty if the graph is mapped from a file. */
+  QVector<int> nodeIds, navIds, ranges /* Empty if not a radio network */;
+  QVector<float> lonX, latY;
+  QVector<quint8> types;
+
+  /* Size is number of nodes + 1 */
+  QVector<int> edgeOffsets;
+  QVector<nw::GraphEdge> edges;
+
+  /* Used by all accessors. Point into the arrays above or into the mapped file. */
+  const int *nodeIdData = nullptr, *navIdData = nullptr, *rangeData = nullptr /* null if not radio */,
+            *edgeOffsetData = nullptr;
+  const float *lonXData = nullptr, *latYData = nullptr;
+  const quint8 *typeData = nullptr;
+  const nw::GraphEdge *edgeData = nullptr;
+  int numNodes = 0, numEdges = 0;
+
+  /* Open cache file and start of mapped memory if mapped or null */
+  QFile *mappedFile = nullptr;
+  uchar *mappedData = nullptr;
+
+  RouteNodeGrid grid;
+
+  /* Node ids are usually consecutive which allows to avoid the binary search */
+  bool consecutiveIds = false;
+};
+
+#endif // LITTLENAVMAP_ROUTEGRAPH_H
@@ -0,0 +1,684 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routehierarchy.h"
+
+#include "route/routefinder.h"
+#include "route/routegraph.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+using nw::GraphEdge;
+using nw::HierarchyTerminal;
+
+namespace {
+
+/* Minimum altitude buckets in feet. 0 means no restriction and is used if no altitude is given. */
+const int ALTITUDE_BUCKETS[] = {0, 5000, 10000, 18000, 25000};
+
+const int MODES[] = {nw::ROUTE_VICTOR, nw::ROUTE_JET, nw::ROUTE_VICTOR | nw::ROUTE_JET};
+
+/* Stop witness search after this number of settled nodes. Adds a few unneeded shortcuts if too low. */
+const int WITNESS_SETTLE_LIMIT = 500;
+
+const float INVALID_COSTS = std::numeric_limits<float>::max();
+
+/* Costs and node index for the Dijkstra queues. Outdated entries are skipped when popped. */
+typedef std::pair<float, int> QueueEntry;
+typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > CostQueue;
+
+/* Contraction order key and node index */
+typedef std::pair<int, int> PriorityEntry;
+typedef std::priority_queue<PriorityEntry, std::vector<PriorityEntry>, std::greater<PriorityEntry> >
+  PriorityQueue;
+
+/* Search label for one node in a query */
+struct Label
+{
+  float costs;
+  int predecessor, edgeId;
+};
+
+/* Uncontracted neighbour of a node during contraction */
+struct Neighbour
+{
+  int index, edgeId;
+  float costs;
+};
+
+/* Same filter as RouteNetwork::testEdgeType and the altitude check in RouteFinder::expandNode */
+bool includeEdge(const GraphEdge& edge, nw::Modes modes, int maxAltitude)
+{
+  bool typeOk;
+  switch(edge.type)
+  {
+    case nw::AIRWAY_VICTOR:
+      typeOk = modes & nw::ROUTE_VICTOR;
+      break;
+    case nw::AIRWAY_JET:
+      typeOk = modes & nw::ROUTE_JET;
+      break;
+    default:
+      typeOk = true;
+      break;
+  }
+  return typeOk && (maxAltitude == 0 || edge.minAltFt == 0 || edge.minAltFt <= maxAltitude);
+}
+
+}
+
+Q_DECLARE_TYPEINFO(Label, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(Neighbour, Q_PRIMITIVE_TYPE);
+
+RouteHierarchy::RouteHierarchy()
+{
+
+}
+
+RouteHierarchy::~RouteHierarchy()
+{
+
+}
+
+bool RouteHierarchy::build(const RouteGraph& graph, nw::Modes modes, int maxAltitude,
+                           const ProgressCallbackType& callback)
+{
+  clear();
+  mode = static_cast<int>(modes);
+  altitude = maxAltitude;
+
+  int numNodes = graph.size();
+  if(numNodes == 0)
+    return true;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Collect edges - graph contains both directions which have the same length.
+  // Keep only the cheapest edge if several airways connect the same nodes.
+  QHash<qint64, int> pairEdges;
+  for(int i = 0; i < numNodes; i++)
+  {
+    for(const GraphEdge *e = graph.edgesBegin(i); e != graph.edgesEnd(i); ++e)
+    {
+      if(e->toIndex <= i || !includeEdge(*e, modes, 0))
+        continue;
+
+      if(!includeEdge(*e, modes, maxAltitude))
+      {
+        // Remember where the hierarchy starts to differ from the full graph
+        if(nextAltitude == 0 || e->minAltFt < nextAltitude)
+          nextAltitude = e->minAltFt;
+        continue;
+      }
+
+      float costs = RouteFinder::airwayEdgeCost(e->lengthMeter);
+      qint64 key = (static_cast<qint64>(i) << 32) | e->toIndex;
+      int edgeId = pairEdges.value(key, -1);
+      if(edgeId == -1)
+        pairEdges.insert(key, addEdge(i, e->toIndex, costs, e->airwayId, -1, -1, -1));
+      else if(costs < edgeCosts.at(edgeId))
+      {
+        edgeCosts[edgeId] = costs;
+        edgeAirwayId[edgeId] = e->airwayId;
+      }
+    }
+  }
+  pairEdges.clear();
+  int numOriginalEdges = edgeFrom.size();
+
+  // Edge ids for each node including edges to already contracted nodes
+  QVector<QVector<int> > adjacency(numNodes);
+  for(int edgeId = 0; edgeId < edgeFrom.size(); edgeId++)
+  {
+    adjacency[edgeFrom.at(edgeId)].append(edgeId);
+    adjacency[edgeTo.at(edgeId)].append(edgeId);
+  }
+
+  QVector<bool> contracted(numNodes, false);
+  QVector<int> contractedNeighbours(numNodes, 0);
+
+  // Witness search scratch arrays. Only touched entries are reset after each search.
+  QVector<float> witnessCosts(numNodes, INVALID_COSTS);
+  QVector<int> touched;
+
+  // Get uncontracted neighbours with cheapest edge
+  auto collectNeighbours = [&](int index, QVector<Neighbour>& neighbours) -> void
+                           {
+                             neighbours.clear();
+                             for(int edgeId : adjacency.at(index))
+                             {
+                               int other = otherNode(edgeId, index);
+                               if(contracted.at(other))
+                                 continue;
+
+                               float costs = edgeCosts.at(edgeId);
+                               auto it = std::find_if(neighbours.begin(), neighbours.end(),
+                                                      [other](const Neighbour& n) -> bool
+                                                      {
+                                                        return n.index == other;
+                                                      });
+                               if(it == neighbours.end())
+                                 neighbours.append({other, edgeId, costs});
+                               else if(costs < it->costs)
+                               {
+                                 it->edgeId = edgeId;
+                                 it->costs = costs;
+                               }
+                             }
+                           };
+
+  // Dijkstra from start avoiding the node to contract. Stops at maxCosts or after a number of nodes.
+  auto witnessSearch = [&](int start, int excluded, float maxCosts) -> void
+                       {
+                         for(int index : touched)
+                           witnessCosts[index] = INVALID_COSTS;
+                         touched.clear();
+
+                         CostQueue queue;
+                         witnessCosts[start] = 0.f;
+                         touched.append(start);
+                         queue.push(QueueEntry(0.f, start));
+
+                         int settled = 0;
+                         while(!queue.empty() && settled < WITNESS_SETTLE_LIMIT)
+                         {
+                           QueueEntry entry = queue.top();
+                           queue.pop();
+                           if(entry.first > witnessCosts.at(entry.second))
+                             continue;
+                           if(entry.first > maxCosts)
+                             break;
+                           settled++;
+
+                           for(int edgeId : adjacency.at(entry.second))
+                           {
+                             int other = otherNode(edgeId, entry.second);
+                             if(other == excluded || contracted.at(other))
+                               continue;
+
+                             float costs = entry.first + edgeCosts.at(edgeId);
+                             if(costs < witnessCosts.at(other))
+                             {
+                               if(witnessCosts.at(other) == INVALID_COSTS)
+                                 touched.append(other);
+                               witnessCosts[other] = costs;
+                               queue.push(QueueEntry(costs, other));
+                             }
+                           }
+                         }
+                       };
+
+  // Count or add shortcuts needed to contract the node
+  QVector<Neighbour> neighbours;
+  auto contractNode = [&](int index, bool simulate) -> int
+                      {
+                        collectNeighbours(index, neighbours);
+
+                        float maxCosts = 0.f;
+                        for(const Neighbour& n : neighbours)
+                          maxCosts = std::max(maxCosts, n.costs);
+
+                        int numShortcuts = 0;
+                        for(int i = 0; i < neighbours.size(); i++)
+                        {
+                          const Neighbour& from = neighbours.at(i);
+                          witnessSearch(from.index, index, from.costs + maxCosts);
+
+                          for(int j = i + 1; j < neighbours.size(); j++)
+                          {
+                            const Neighbour& to = neighbours.at(j);
+                            float viaCosts = from.costs + to.costs;
+                            if(witnessCosts.at(to.index) <= viaCosts)
+                              // Path avoiding this node is not longer
+                              continue;
+
+                            numShortcuts++;
+                            if(!simulate)
+                            {
+                              int edgeId = addEdge(from.index, to.index, viaCosts, -1,
+                                                   from.edgeId, to.edgeId, index);
+                              adjacency[from.index].append(edgeId);
+                              adjacency[to.index].append(edgeId);
+                            }
+                          }
+                        }
+                        return numShortcuts;
+                      };
+
+  // Edge difference plus number of contracted neighbours to spread contraction evenly
+  auto priority = [&](int index) -> int
+                  {
+                    int numShortcuts = contractNode(index, true);
+                    return numShortcuts - neighbours.size() + contractedNeighbours.at(index);
+                  };
+
+  PriorityQueue queue;
+  for(int i = 0; i < numNodes; i++)
+  {
+    if(!adjacency.at(i).isEmpty())
+      queue.push(PriorityEntry(priority(i), i));
+  }
+
+  ranks.fill(-1, numNodes);
+  int rank = 0;
+  while(!queue.empty())
+  {
+    int index = queue.top().second;
+    queue.pop();
+
+    // Lazy update - put back if priority has changed and node is not the best anymore
+    int prio = priority(index);
+    if(!queue.empty() && prio > queue.top().first)
+    {
+      queue.push(PriorityEntry(prio, index));
+      continue;
+    }
+
+    contractNode(index, false);
+    for(const Neighbour& n : neighbours)
+      contractedNeighbours[n.index]++;
+    contracted[index] = true;
+    ranks[index] = rank++;
+
+    if(callback && rank % PROGRESS_NODE_INTERVAL == 0 && callback(rank, numNodes))
+    {
+      clear();
+      return false;
+    }
+  }
+
+  // Nodes without edges
+  for(int i = 0; i < numNodes; i++)
+  {
+    if(ranks.at(i) == -1)
+      ranks[i] = rank++;
+  }
+  adjacency.clear();
+
+  // Each edge is stored once at the node with the lower rank
+  upOffsets.fill(0, numNodes + 1);
+  for(int edgeId = 0; edgeId < edgeFrom.size(); edgeId++)
+  {
+    int from = edgeFrom.at(edgeId), to = edgeTo.at(edgeId);
+    upOffsets[(ranks.at(from) < ranks.at(to) ? from : to) + 1]++;
+  }
+
+  for(int i = 0; i < numNodes; i++)
+    upOffsets[i + 1] += upOffsets.at(i);
+
+  QVector<int> insertPos = upOffsets;
+  upEdges.resize(edgeFrom.size());
+  for(int edgeId = 0; edgeId < edgeFrom.size(); edgeId++)
+  {
+    int from = edgeFrom.at(edgeId), to = edgeTo.at(edgeId);
+    upEdges[insertPos[ranks.at(from) < ranks.at(to) ? from : to]++] = edgeId;
+  }
+
+  qDebug() << "RouteHierarchy built mode" << mode << "altitude" << altitude << "with" << numOriginalEdges
+           << "edges and" << edgeFrom.size() - numOriginalEdges << "shortcuts in" << timer.elapsed() << "ms";
+}
+
+int RouteHierarchy::addEdge(int from, int to, float costs, int airwayId, int child1, int child2, int middle)
+{
+  edgeFrom.append(from);
+  edgeTo.append(to);
+  edgeCosts.append(costs);
+  edgeAirwayId.append(airwayId);
+  edgeChild1.append(child1);
+  edgeChild2.append(child2);
+  edgeMiddle.append(middle);
+  return edgeFrom.size() - 1;
+}
+
+bool RouteHierarchy::query(const QVector<HierarchyTerminal>& sources,
+                           const QVector<HierarchyTerminal>& targets, QVector<int>& path,
+                           QVector<int>& airwayIds, float& costs, int& numSettled) const
+{
+  path.clear();
+  airwayIds.clear();
+  costs = INVALID_COSTS;
+  numSettled = 0;
+
+  int numNodes = ranks.size();
+  if(numNodes == 0)
+    return false;
+
+  // Search space is small - use hashes instead of arrays for all nodes
+  QHash<int, Label> labels[2];
+  CostQueue queues[2];
+
+  const QVector<HierarchyTerminal> *terminals[2] = {&sources, &targets};
+  for(int side = 0; side < 2; side++)
+  {
+    for(const HierarchyTerminal& terminal : *terminals[side])
+    {
+      if(terminal.index < 0 || terminal.index >= numNodes)
+        continue;
+
+      auto it = labels[side].constFind(terminal.index);
+      if(it == labels[side].constEnd() || terminal.costs < it->costs)
+      {
+        labels[side].insert(terminal.index, {terminal.costs, -1, -1});
+        queues[side].push(QueueEntry(terminal.costs, terminal.index));
+      }
+    }
+  }
+
+  // Search upwards from both sides. Forward and backward use the same edges since costs are symmetric.
+  int meetingIndex = -1;
+  while(!queues[0].empty() || !queues[1].empty())
+  {
+    int side = queues[1].empty() ||
+               (!queues[0].empty() && queues[0].top().first <= queues[1].top().first) ? 0 : 1;
+    QueueEntry entry = queues[side].top();
+    queues[side].pop();
+
+    if(entry.first >= costs)
+    {
+      // Nothing better can be found from this side
+      queues[side] = CostQueue();
+      continue;
+    }
+
+    int index = entry.second;
+    if(entry.first > labels[side].value(index).costs)
+      // Outdated entry
+      continue;
+    numSettled++;
+
+    auto other = labels[1 - side].constFind(index);
+    if(other != labels[1 - side].constEnd() && entry.first + other->costs < costs)
+    {
+      costs = entry.first + other->costs;
+      meetingIndex = index;
+    }
+
+    for(int i = upOffsets.at(index); i < upOffsets.at(index + 1); i++)
+    {
+      int edgeId = upEdges.at(i);
+      int to = otherNode(edgeId, index);
+      float newCosts = entry.first + edgeCosts.at(edgeId);
+
+      auto it = labels[side].constFind(to);
+      if(it == labels[side].constEnd() || newCosts < it->costs)
+      {
+        labels[side].insert(to, {newCosts, index, edgeId});
+        queues[side].push(QueueEntry(newCosts, to));
+      }
+    }
+  }
+
+  if(meetingIndex == -1)
+    return false;
+
+  // Collect edges from meeting point back to the source
+  QVector<int> sourceEdges;
+  int index = meetingIndex;
+  Label label = labels[0].value(index);
+  while(label.predecessor != -1)
+  {
+    sourceEdges.append(label.edgeId);
+    index = label.predecessor;
+    label = labels[0].value(index);
+  }
+
+  path.append(index);
+  airwayIds.append(-1);
+  for(int i = sourceEdges.size() - 1; i >= 0; i--)
+    unpackEdge(sourceEdges.at(i), path.last(), path, airwayIds);
+
+  // Follow edges from meeting point to the target
+  index = meetingIndex;
+  label = labels[1].value(index);
+  while(label.predecessor != -1)
+  {
+    unpackEdge(label.edgeId, index, path, airwayIds);
+    index = label.predecessor;
+    label = labels[1].value(index);
+  }
+
+  return true;
+}
+
+/* Append all nodes of the edge to path except fromIndex. Shortcuts are resolved recursively. */
+void RouteHierarchy::unpackEdge(int edgeId, int fromIndex, QVector<int>& path, QVector<int>& airwayIds) const
+{
+  int child1 = edgeChild1.at(edgeId);
+  if(child1 == -1)
+  {
+    path.append(otherNode(edgeId, fromIndex));
+    airwayIds.append(edgeAirwayId.at(edgeId));
+  }
+  else
+  {
+    // First part is the child attached to fromIndex
+    int child2 = edgeChild2.at(edgeId);
+    if(edgeFrom.at(child1) != fromIndex && edgeTo.at(child1) != fromIndex)
+      std::swap(child1, child2);
+
+    unpackEdge(child1, fromIndex, path, airwayIds);
+    unpackEdge(child2, edgeMiddle.at(edgeId), path, airwayIds);
+  }
+}
+
+bool RouteHierarchy::isValid() const
+{
+  int numEdges = edgeFrom.size();
+  return upOffsets.size() == ranks.size() + 1 && upEdges.size() == numEdges &&
+         edgeTo.size() == numEdges && edgeCosts.size() == numEdges && edgeAirwayId.size() == numEdges &&
+         edgeChild1.size() == numEdges && edgeChild2.size() == numEdges && edgeMiddle.size() == numEdges;
+}
+
+void RouteHierarchy::clear()
+{
+  mode = 0;
+  altitude = 0;
+  nextAltitude = 0;
+  ranks.clear();
+  upOffsets.clear();
+  upEdges.clear();
+  edgeFrom.clear();
+  edgeTo.clear();
+  edgeAirwayId.clear();
+  edgeChild1.clear();
+  edgeChild2.clear();
+  edgeMiddle.clear();
+  edgeCosts.clear();
+}
+
+QDataStream& operator<<(QDataStream& out, const RouteHierarchy& hierarchy)
+{
+  out << static_cast<qint32>(hierarchy.mode) << static_cast<qint32>(hierarchy.altitude)
+      << static_cast<qint32>(hierarchy.nextAltitude)
+      << hierarchy.ranks << hierarchy.upOffsets << hierarchy.upEdges
+      << hierarchy.edgeFrom << hierarchy.edgeTo << hierarchy.edgeAirwayId
+      << hierarchy.edgeChild1 << hierarchy.edgeChild2 << hierarchy.edgeMiddle << hierarchy.edgeCosts;
+  return out;
+}
+
+QDataStream& operator>>(QDataStream& in, RouteHierarchy& hierarchy)
+{
+  qint32 mode = 0, altitude = 0, nextAltitude = 0;
+  in >> mode >> altitude >> nextAltitude
+  >> hierarchy.ranks >> hierarchy.upOffsets >> hierarchy.upEdges
+  >> hierarchy.edgeFrom >> hierarchy.edgeTo >> hierarchy.edgeAirwayId
+  >> hierarchy.edgeChild1 >> hierarchy.edgeChild2 >> hierarchy.edgeMiddle >> hierarchy.edgeCosts;
+  hierarchy.mode = mode;
+  hierarchy.altitude = altitude;
+  hierarchy.nextAltitude = nextAltitude;
+  return in;
+}
+
+// ==========================================================================================
+RouteHierarchies::RouteHierarchies()
+{
+
+}
+
+RouteHierarchies::~RouteHierarchies()
+{
+
+}
+
+bool RouteHierarchies::build(const RouteGraph& graph, const ProgressCallbackType& callback)
+{
+  clear();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  int numHierarchies = static_cast<int>((sizeof(MODES) / sizeof(MODES[0])) *
+                                        (sizeof(ALTITUDE_BUCKETS) / sizeof(ALTITUDE_BUCKETS[0])));
+  int numNodes = graph.size();
+
+  // Sum up the progress of all hierarchies
+  RouteHierarchy::ProgressCallbackType hierarchyCallback;
+  if(callback)
+    hierarchyCallback = [this, &callback, numHierarchies, numNodes](int current, int) -> bool
+                        {
+                          return callback(hierarchies.size() * numNodes + current, numHierarchies * numNodes);
+                        };
+
+  for(int modes : MODES)
+  {
+    for(int bucket : ALTITUDE_BUCKETS)
+    {
+      RouteHierarchy hierarchy;
+      if(!hierarchy.build(graph, nw::Modes(modes), bucket, hierarchyCallback))
+      {
+        clear();
+        return false;
+      }
+      hierarchies.append(hierarchy);
+    }
+  }
+
+  qDebug() << "RouteHierarchies built" << hierarchies.size() << "hierarchies in" << timer.elapsed() << "ms";
+  return true;
+}
+
+bool RouteHierarchies::load(const QString& filename, const QString& fingerprint)
+{
+  clear();
+
+  QFile file(filename);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+  quint32 magic = 0, version = 0;
+  QString fileFingerprint;
+  in >> magic >> version;
+
+  if(magic != FILE_MAGIC || version != FILE_VERSION)
+  {
+    qWarning() << "RouteHierarchies invalid file" << filename;
+    return false;
+  }
+
+  in >> fileFingerprint;
+  if(fileFingerprint != fingerprint)
+  {
+    qInfo() << "RouteHierarchies outdated file" << filename;
+    return false;
+  }
+
+  in >> hierarchies;
+  bool valid = in.status() == QDataStream::Ok;
+  for(const RouteHierarchy& hierarchy : hierarchies)
+    valid &= hierarchy.isValid();
+
+  if(!valid)
+  {
+    qWarning() << "RouteHierarchies error reading file" << filename;
+    clear();
+    return false;
+  }
+
+  qDebug() << "RouteHierarchies loaded" << hierarchies.size() << "hierarchies from" << filename;
+  return true;
+}
+
+bool RouteHierarchies::save(const QString& filename, const QString& fingerprint) const
+{
+  QSaveFile file(filename);
+  if(!file.open(QIODevice::WriteOnly))
+  {
+    qWarning() << "RouteHierarchies cannot write file" << filename << file.errorString();
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  out << FILE_MAGIC << FILE_VERSION << fingerprint << hierarchies;
+
+  if(out.status() != QDataStream::Ok)
+  {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+void RouteHierarchies::clear()
+{
+  hierarchies.clear();
+}
+
+const RouteHierarchy *RouteHierarchies::getHierarchy(nw::Modes modes, int flownAltitude) const
+{
+  int airwayModes = static_cast<int>(modes & (nw::ROUTE_VICTOR | nw::ROUTE_JET));
+  if(airwayModes == 0)
+    return nullptr;
+
+  const RouteHierarchy *result = nullptr;
+  for(const RouteHierarchy& hierarchy : hierarchies)
+  {
+    if(static_cast<int>(hierarchy.getModes()) != airwayModes)
+      continue;
+
+    int bucket = hierarchy.getMaxAltitude();
+    if(flownAltitude == 0)
+    {
+      // Unrestricted hierarchy
+      if(bucket == 0)
+        return &hierarchy;
+    }
+    else if(bucket > 0 && bucket <= flownAltitude &&
+            (result == nullptr || bucket > result->getMaxAltitude()))
+      // Highest bucket that does not allow any edge above the flown altitude
+      result = &hierarchy;
+  }
+
+  if(result != nullptr && result->getNextAltitude() > 0 && flownAltitude >= result->getNextAltitude())
+    // Hierarchy misses edges usable at this altitude
+    return nullptr;
+
+  return result;
+}
@@ -0,0 +1,194 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTEHIERARCHY_H
+#define LITTLENAVMAP_ROUTEHIERARCHY_H
+
+#include "route/routenetwork.h"
+
+#include <QVector>
+
+#include <functional>
+
+class RouteGraph;
+class QDataStream;
+
+namespace nw {
+
+/* Graph node index with costs from the departure or to the destination used to start a query */
+struct HierarchyTerminal
+{
+  int index;
+  float costs;
+};
+
+}
+
+Q_DECLARE_TYPEINFO(nw::HierarchyTerminal, Q_PRIMITIVE_TYPE);
+
+/*
+ * Contraction hierarchy for one airway subgraph. Nodes are contracted in order of importance and shortcut
+ * edges are added where needed to keep all shortest paths. A query then runs a Dijkstra search from both
+ * sides which only follows edges leading to more important nodes. This touches only a few hundred nodes.
+ *
+ * Airway edges have the same costs in both directions. Therefore only one upward adjacency is needed for
+ * both search directions. Costs are the same as RouteFinder uses for airway routing.
+ *
+ * Node indexes are the graph node indexes. Shortcuts are unpacked into the original airway edges for the
+ * result.
+ */
+class RouteHierarchy
+{
+public:
+  RouteHierarchy();
+  ~RouteHierarchy();
+
+  /* Called with number of contracted and total nodes. Return true to cancel. */
+  typedef std::function<bool (int current, int total)> ProgressCallbackType;
+
+  /*
+   * Build the hierarchy for all graph edges matching the mode and altitude.
+   * @param modes Combination of nw::ROUTE_JET and nw::ROUTE_VICTOR
+   * @param maxAltitude Ignore edges having a higher minimum altitude. 0 uses all edges.
+   * @param callback called every PROGRESS_NODE_INTERVAL contracted nodes
+   * @return false if canceled
+   */
+  bool build(const RouteGraph& graph, nw::Modes modes, int maxAltitude,
+             const ProgressCallbackType& callback = ProgressCallbackType());
+
+  /*
+   * Find the cheapest path from any of the sources to any of the targets.
+   * @param path Graph node indexes from source to target
+   * @param airwayIds Airway id of the edge leading to each node in path. -1 for the first.
+   * @param costs Total costs including source and target costs
+   * @param numSettled Number of nodes settled by the search
+   * @return true if a path was found
+   */
+  bool query(const QVector<nw::HierarchyTerminal>& sources, const QVector<nw::HierarchyTerminal>& targets,
+             QVector<int>& path, QVector<int>& airwayIds, float& costs, int& numSettled) const;
+
+  nw::Modes getModes() const
+  {
+    return nw::Modes(mode);
+  }
+
+  int getMaxAltitude() const
+  {
+    return altitude;
+  }
+
+  /* Lowest minimum altitude of all ignored edges or 0 if no edge was ignored. The hierarchy gives the same
+   * result as the full graph for all flown altitudes below this. */
+  int getNextAltitude() const
+  {
+    return nextAltitude;
+  }
+
+  int getNumNodes() const
+  {
+    return ranks.size();
+  }
+
+  int getNumEdges() const
+  {
+    return edgeFrom.size();
+  }
+
+  void clear();
+
+  /* true if all arrays have consistent sizes after loading */
+  bool isValid() const;
+
+  friend QDataStream& operator<<(QDataStream& out, const RouteHierarchy& hierarchy);
+  friend QDataStream& operator>>(QDataStream& in, RouteHierarchy& hierarchy);
+
+private:
+  void unpackEdge(int edgeId, int fromIndex, QVector<int>& path, QVector<int>& airwayIds) const;
+  int addEdge(int from, int to, float costs, int airwayId, int child1, int child2, int middle);
+
+  int otherNode(int edgeId, int index) const
+  {
+    return edgeFrom.at(edgeId) == index ? edgeTo.at(edgeId) : edgeFrom.at(edgeId);
+  }
+
+  /* Report progress after this number of contracted nodes */
+  static Q_DECL_CONSTEXPR int PROGRESS_NODE_INTERVAL = 1000;
+
+  int mode = 0, altitude = 0, nextAltitude = 0;
+
+  /* Contraction order for each node */
+  QVector<int> ranks;
+
+  /* Edge ids leading to a node with a higher rank are found from upEdges[upOffsets[i]] to
+   * upEdges[upOffsets[i + 1]] */
+  QVector<int> upOffsets, upEdges;
+
+  /* Original and shortcut edges. Children are -1 and middle node is -1 for original edges.
+   * Airway id is -1 for shortcuts. */
+  QVector<int> edgeFrom, edgeTo, edgeAirwayId, edgeChild1, edgeChild2, edgeMiddle;
+  QVector<float> edgeCosts;
+};
+
+/*
+ * All contraction hierarchies for the airway network. One for Jet, Victor and both airway types and each
+ * of these for a set of altitude buckets. Built after loading the scenery database and saved to a file
+ * next to the database.
+ */
+class RouteHierarchies
+{
+public:
+  RouteHierarchies();
+  ~RouteHierarchies();
+
+  /* Called with the number of contracted nodes and the total over all hierarchies. Return true to cancel. */
+  typedef RouteHierarchy::ProgressCallbackType ProgressCallbackType;
+
+  /* Build all hierarchies. Returns false if canceled. */
+  bool build(const RouteGraph& graph, const ProgressCallbackType& callback);
+
+  /* Load from file. Returns false if file is missing, invalid or fingerprint does not match. */
+  bool load(const QString& filename, const QString& fingerprint);
+
+  /* Save all hierarchies including the fingerprint */
+  bool save(const QString& filename, const QString& fingerprint) const;
+
+  void clear();
+
+  bool isEmpty() const
+  {
+    return hierarchies.isEmpty();
+  }
+
+  /*
+   * Get the hierarchy for the mode and flown altitude. Uses the highest altitude bucket not above
+   * the given altitude. Returns null if the graph has edges with a minimum altitude between bucket and
+   * flown altitude since the hierarchy would miss these. The caller falls back to A* then.
+   * @param modes network mode. Only the airway flags are used.
+   * @param flownAltitude altitude in feet or 0 for no restrictions
+   * @return hierarchy or null if none is available
+   */
+  const RouteHierarchy *getHierarchy(nw::Modes modes, int flownAltitude) const;
+
+private:
+  /* Increase when changing the file format */
+  static Q_DECL_CONSTEXPR quint32 FILE_MAGIC = 0x4C4E4D48;
+  static Q_DECL_CONSTEXPR quint32 FILE_VERSION = 2;
+
+  QVector<RouteHierarchy> hierarchies;
+};
+
+#endif // LITTLENAVMAP_ROUTEHIERARCHY_H
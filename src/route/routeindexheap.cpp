@@ -0,0 +1,122 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routeindexheap.h"
+
+#include <algorithm>
+
+RouteIndexHeap::RouteIndexHeap(int reserveSize)
+{
+  heapIndexes.reserve(reserveSize);
+  heapCosts.reserve(reserveSize);
+}
+
+void RouteIndexHeap::push(int index, float cost)
+{
+  if(index >= positions.size())
+  {
+    // Grow position index by doubling - an empty vector grows to index + 1
+    int oldSize = positions.size();
+    positions.resize(std::max(index + 1, oldSize * 2));
+
+    // Mark new entries as not in heap
+    std::fill(positions.begin() + oldSize, positions.end(), -1);
+  }
+
+  heapIndexes.append(index);
+  heapCosts.append(cost);
+  positions[index] = heapIndexes.size() - 1;
+  siftUp(heapIndexes.size() - 1);
+}
+
+int RouteIndexHeap::pop()
+{
+  int index = heapIndexes.first();
+  int last = heapIndexes.size() - 1;
+
+  swap(0, last);
+  heapIndexes.removeLast();
+  heapCosts.removeLast();
+  positions[index] = -1;
+
+  if(!heapIndexes.isEmpty())
+    siftDown(0);
+  return index;
+}
+
+void RouteIndexHeap::change(int index, float cost)
+{
+  int pos = positions.at(index);
+  float oldCost = heapCosts.at(pos);
+  heapCosts[pos] = cost;
+
+  if(cost < oldCost)
+    siftUp(pos);
+  else
+    siftDown(pos);
+}
+
+void RouteIndexHeap::clear()
+{
+  // Reset only the positions that are in use
+  for(int index : heapIndexes)
+    positions[index] = -1;
+
+  heapIndexes.clear();
+  heapCosts.clear();
+}
+
+void RouteIndexHeap::siftUp(int pos)
+{
+  while(pos > 0)
+  {
+    int parent = (pos - 1) / 2;
+    if(heapCosts.at(parent) <= heapCosts.at(pos))
+      break;
+
+    swap(parent, pos);
+    pos = parent;
+  }
+}
+
+void RouteIndexHeap::siftDown(int pos)
+{
+  int size = heapIndexes.size();
+  while(true)
+  {
+    int smallest = pos, left = 2 * pos + 1, right = 2 * pos + 2;
+
+    if(left < size && heapCosts.at(left) < heapCosts.at(smallest))
+      smallest = left;
+    if(right < size && heapCosts.at(right) < heapCosts.at(smallest))
+      smallest = right;
+
+    if(smallest == pos)
+      break;
+
+    swap(smallest, pos);
+    pos = smallest;
+  }
+}
+
+void RouteIndexHeap::swap(int pos1, int pos2)
+{
+  std::swap(heapIndexes[pos1], heapIndexes[pos2]);
+  std::swap(heapCosts[pos1], heapCosts[pos2]);
+  positions[heapIndexes.at(pos1)] = pos1;
+  positions[heapIndexes.at(pos2)] = pos2;
+}
@@ -0,0 +1,84 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTEINDEXHEAP_H
+#define LITTLENAVMAP_ROUTEINDEXHEAP_H
+
+#include <QVector>
+
+/*
+ * Indexed binary min heap of dense node indexes sorted by float costs.
+ * Keeps the heap position of each index which allows contains in O(1) and change in O(log n).
+ */
+class RouteIndexHeap
+{
+public:
+  RouteIndexHeap(int reserveSize = 1000);
+
+  /* Add index with the given costs. Index must not be part of the heap. */
+  void push(int index, float cost);
+
+  /* Remove and return the index with the lowest costs */
+  int pop();
+
+  /* Update costs of an index that is already part of the heap and restore heap order */
+  void change(int index, float cost);
+
+  /* Index with the lowest costs. Heap must not be empty. */
+  int top() const
+  {
+    return heapIndexes.first();
+  }
+
+  /* Lowest costs in heap. Heap must not be empty. */
+  float topCost() const
+  {
+    return heapCosts.first();
+  }
+
+  bool contains(int index) const
+  {
+    return index < positions.size() && positions.at(index) != -1;
+  }
+
+  bool isEmpty() const
+  {
+    return heapIndexes.isEmpty();
+  }
+
+  int size() const
+  {
+    return heapIndexes.size();
+  }
+
+  /* Remove all entries. Does not free memory. */
+  void clear();
+
+private:
+  void siftUp(int pos);
+  void siftDown(int pos);
+  void swap(int pos1, int pos2);
+
+  /* Heap arrays */
+  QVector<int> heapIndexes;
+  QVector<float> heapCosts;
+
+  /* Maps node index to heap position or -1 if not in heap */
+  QVector<int> positions;
+};
+
+#endif // LITTLENAVMAP_ROUTEINDEXHEAP_H
@@ -0,0 +1,225 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routelandmarks.h"
+
+#include "route/routegraph.h"
+#include "route/routeindexheap.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+using nw::GraphEdge;
+
+Q_DECL_CONSTEXPR float RouteLandmarks::UNREACHABLE;
+
+RouteLandmarks::RouteLandmarks()
+{
+
+}
+
+RouteLandmarks::~RouteLandmarks()
+{
+
+}
+
+bool RouteLandmarks::build(const RouteGraph& graph, int numberOfLandmarks,
+                           const ProgressCallbackType& callback)
+{
+  clear();
+
+  if(graph.isEmpty())
+    return true;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  numNodes = graph.size();
+  numLandmarks = std::min(numberOfLandmarks, numNodes);
+  distanceTable.fill(UNREACHABLE, numNodes * numLandmarks);
+
+  // Start with the best connected node to avoid isolated parts of the network
+  int startIndex = 0, maxEdges = 0;
+  for(int i = 0; i < numNodes; i++)
+  {
+    int numEdges = static_cast<int>(graph.edgesEnd(i) - graph.edgesBegin(i));
+    if(numEdges > maxEdges)
+    {
+      maxEdges = numEdges;
+      startIndex = i;
+    }
+  }
+
+  QVector<float> result;
+  calculateDistances(graph, startIndex, result);
+
+  // Minimum distance of each node to all selected landmarks
+  QVector<float> minDistance(numNodes, UNREACHABLE);
+
+  // First landmark is the node farthest away from the start
+  int landmarkIndex = farthestNode(result);
+  for(int landmark = 0; landmark < numLandmarks; landmark++)
+  {
+    calculateDistances(graph, landmarkIndex, result);
+
+    for(int i = 0; i < numNodes; i++)
+    {
+      float dist = result.at(i);
+      distanceTable[i * numLandmarks + landmark] = dist;
+      if(dist < minDistance.at(i))
+        minDistance[i] = dist;
+    }
+
+    // Next landmark is the node with the largest distance to all landmarks selected so far
+    landmarkIndex = farthestNode(minDistance);
+
+    if(callback && callback(landmark + 1, numLandmarks))
+    {
+      clear();
+      return false;
+    }
+  }
+
+  qDebug() << "RouteLandmarks built" << numLandmarks << "landmarks for" << numNodes << "nodes in"
+           << timer.elapsed() << "ms";
+  return true;
+}
+
+/* Dijkstra using plain edge lengths from start to all nodes */
+void RouteLandmarks::calculateDistances(const RouteGraph& graph, int startIndex, QVector<float>& result)
+{
+  result.fill(UNREACHABLE, graph.size());
+
+  RouteIndexHeap heap(10000);
+  result[startIndex] = 0.f;
+  heap.push(startIndex, 0.f);
+
+  while(!heap.isEmpty())
+  {
+    float dist = heap.topCost();
+    int index = heap.pop();
+
+    for(const GraphEdge *e = graph.edgesBegin(index); e != graph.edgesEnd(index); ++e)
+    {
+      float newDist = dist + e->lengthMeter;
+      if(newDist < result.at(e->toIndex))
+      {
+        result[e->toIndex] = newDist;
+        if(heap.contains(e->toIndex))
+          heap.change(e->toIndex, newDist);
+        else
+          heap.push(e->toIndex, newDist);
+      }
+    }
+  }
+}
+
+/* Get index of the reachable node with the largest distance */
+int RouteLandmarks::farthestNode(const QVector<float>& dists) const
+{
+  int index = 0;
+  float maxDist = -1.f;
+  for(int i = 0; i < dists.size(); i++)
+  {
+    float dist = dists.at(i);
+    if(dist < UNREACHABLE && dist > maxDist)
+    {
+      maxDist = dist;
+      index = i;
+    }
+  }
+  return index;
+}
+
+bool RouteLandmarks::load(const QString& filename, const QString& fingerprint)
+{
+  clear();
+
+  QFile file(filename);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+  quint32 magic = 0, version = 0;
+  QString fileFingerprint;
+  qint32 landmarks = 0, nodes = 0;
+  in >> magic >> version;
+
+  if(magic != FILE_MAGIC || version != FILE_VERSION)
+  {
+    qWarning() << "RouteLandmarks invalid file" << filename;
+    return false;
+  }
+
+  in >> fileFingerprint >> landmarks >> nodes;
+  if(fileFingerprint != fingerprint)
+  {
+    qInfo() << "RouteLandmarks outdated file" << filename;
+    return false;
+  }
+
+  in >> distanceTable;
+  if(in.status() != QDataStream::Ok || distanceTable.size() != landmarks * nodes)
+  {
+    qWarning() << "RouteLandmarks error reading file" << filename;
+    clear();
+    return false;
+  }
+
+  numLandmarks = landmarks;
+  numNodes = nodes;
+  qDebug() << "RouteLandmarks loaded" << numLandmarks << "landmarks for" << numNodes << "nodes from" << filename;
+  return true;
+}
+
+bool RouteLandmarks::save(const QString& filename, const QString& fingerprint) const
+{
+  // Writes into a temporary file and renames it on commit so that a failed write keeps the old file
+  QSaveFile file(filename);
+  if(!file.open(QIODevice::WriteOnly))
+  {
+    qWarning() << "RouteLandmarks cannot write file" << filename << file.errorString();
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  out << FILE_MAGIC << FILE_VERSION << fingerprint << static_cast<qint32>(numLandmarks)
+      << static_cast<qint32>(numNodes) << distanceTable;
+
+  if(out.status() != QDataStream::Ok)
+  {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+void RouteLandmarks::clear()
+{
+  numLandmarks = 0;
+  numNodes = 0;
+  distanceTable.clear();
+  distanceTable.squeeze();
+}
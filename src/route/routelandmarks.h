@@ -0,0 +1,101 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTELANDMARKS_H
+#define LITTLENAVMAP_ROUTELANDMARKS_H
+
+#include <QVector>
+
+#include <functional>
+#include <limits>
+
+class RouteGraph;
+
+/*
+ * Distance tables for the landmark (ALT) heuristic. Contains the shortest path length in meter from a few
+ * selected landmark nodes to all nodes of a graph. Using the triangle inequality this gives a lower bound
+ * for the distance between any two nodes which is much better than the great circle distance.
+ *
+ * Distances are plain edge lengths over all edges regardless of type. Since all cost factors in the route
+ * finder are >= 1 and filtering edges only makes paths longer the lower bound stays admissible.
+ */
+class RouteLandmarks
+{
+public:
+  RouteLandmarks();
+  ~RouteLandmarks();
+
+  /* Called after each landmark with number done and total number. Return true to cancel. */
+  typedef std::function<bool (int current, int total)> ProgressCallbackType;
+
+  /* Select landmarks using farthest selection and calculate distance tables. Returns false if canceled. */
+  bool build(const RouteGraph& graph, int numberOfLandmarks,
+             const ProgressCallbackType& callback = ProgressCallbackType());
+
+  /* Load distance tables from file. Returns false if file is missing, invalid or fingerprint does not match. */
+  bool load(const QString& filename, const QString& fingerprint);
+
+  /* Save tables including the fingerprint */
+  bool save(const QString& filename, const QString& fingerprint) const;
+
+  void clear();
+
+  bool isEmpty() const
+  {
+    return distanceTable.isEmpty();
+  }
+
+  int getNumLandmarks() const
+  {
+    return numLandmarks;
+  }
+
+  /* Number of graph nodes covered by the tables */
+  int getNumNodes() const
+  {
+    return numNodes;
+  }
+
+  /* Distance in meter from landmark to graph node index or UNREACHABLE */
+  float distance(int landmark, int nodeIndex) const
+  {
+    return distanceTable.at(nodeIndex * numLandmarks + landmark);
+  }
+
+  /* Get all landmark distances of a node which are stored contiguously */
+  const float *nodeDistances(int nodeIndex) const
+  {
+    return distanceTable.constData() + nodeIndex * numLandmarks;
+  }
+
+  static Q_DECL_CONSTEXPR float UNREACHABLE = std::numeric_limits<float>::max();
+
+private:
+  void calculateDistances(const RouteGraph& graph, int startIndex, QVector<float>& result);
+  int farthestNode(const QVector<float>& dists) const;
+
+  /* Increase when changing the file format */
+  static Q_DECL_CONSTEXPR quint32 FILE_MAGIC = 0x4C4E4D4C;
+  static Q_DECL_CONSTEXPR quint32 FILE_VERSION = 1;
+
+  int numLandmarks = 0, numNodes = 0;
+
+  /* Node major: all landmark distances for node 0, then node 1, ... */
+  QVector<float> distanceTable;
+};
+
+#endif // LITTLENAVMAP_ROUTELANDMARKS_H
@@ -17,6 +17,9 @@
 
 #include "routenetwork.h"
 
+#include "route/routehierarchy.h"
+#include "db/spatialindexbuilder.h"
+
 #include "sql/sqldatabase.h"
 #include "sql/sqlquery.h"
 #include "sql/sqlrecord.h"
@@ -24,8 +27,13 @@
 
 #include "geo/pos.h"
 #include "geo/rect.h"
+#include "fs/db/databasemeta.h"
 
+#include <QDir>
 #include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <algorithm>
 
 using atools::sql::SqlDatabase;
 using atools::sql::SqlQuery;
@@ -41,8 +49,13 @@ RouteNetwork::RouteNetwork(atools::sql::SqlDatabase *sqlDb, const QString& nodeT
   : db(sqlDb), nodeTable(nodeTableName), edgeTable(edgeTableName), nodeExtraCols(nodeExtraColumns),
     edgeExtraCols(edgeExtraColumns)
 {
+  graph.reset(new RouteGraph);
+  landmarks.reset(new RouteLandmarks);
+  hierarchies.reset(new RouteHierarchies);
   nodeCache.reserve(60000);
   destinationNodePredecessors.reserve(1000);
+  indexToNodeId.reserve(60000);
+  indexToNodeId << DEPARTURE_NODE_ID << DESTINATION_NODE_ID;
   airwayRouting = mode & nw::ROUTE_JET || mode & nw::ROUTE_VICTOR;
   initQueries();
 }
@@ -55,13 +68,18 @@ RouteNetwork::~RouteNetwork()
 int RouteNetwork::getNumberOfNodesDatabase()
 {
   if(numNodesDb == -1)
-    numNodesDb = atools::sql::SqlUtil(db).rowCount(nodeTable);
+  {
+    if(isGraphLoaded())
+      numNodesDb = graph->size();
+    else
+      numNodesDb = atools::sql::SqlUtil(db).rowCount(nodeTable);
+  }
   return numNodesDb;
 }
 
 int RouteNetwork::getNumberOfNodesCache() const
 {
-  return nodeCache.size();
+  return nodeCache.size() + graph->size();
 }
 
 void RouteNetwork::setMode(nw::Modes routeMode)
@@ -81,57 +99,264 @@ void RouteNetwork::clearStartAndDestinationNodes()
   edgeIndexesCreated = false;
   nodeCache.reserve(60000);
   destinationNodePredecessors.reserve(1000);
+  indexToNodeId.clear();
+  indexToNodeId << DEPARTURE_NODE_ID << DESTINATION_NODE_ID;
+  departureNodeSuccessors.clear();
+  indexVersion++;
+
+  // Do not clear in place since snapshots might still use graph, landmarks and hierarchies
+  graph.reset(new RouteGraph);
+  landmarks.reset(new RouteLandmarks);
+  hierarchies.reset(new RouteHierarchies);
+}
+
+/* Load the whole network into the graph if requested and not done yet */
+void RouteNetwork::updateGraph()
+{
+  if(preloadGraph && graph->isEmpty() && db != nullptr)
+  {
+    // Drop all nodes that were loaded from the database before
+    nodeCache.clear();
+    destinationNodePredecessors.clear();
+    indexToNodeId.clear();
+    indexToNodeId << DEPARTURE_NODE_ID << DESTINATION_NODE_ID;
+    departurePos = atools::geo::EMPTY_POS;
+    destinationPos = atools::geo::EMPTY_POS;
+    numNodesDb = -1;
+    indexVersion++;
+
+    // Map the cache file next to the database or load from database and create the cache if outdated
+    QString filename = cacheFilename(".graph"), fingerprint = databaseFingerprint();
+    if(!graph->mapCache(filename, fingerprint))
+    {
+      graph->load(db, nodeTable, edgeTable, nodeExtraCols, edgeExtraCols);
+      graph->saveCache(filename, fingerprint);
+    }
+
+    // Hierarchies are only built after loading the scenery database
+    if(useHierarchies && !graph->isEmpty())
+      hierarchies->load(cacheFilename(".hierarchy"), fingerprint);
+  }
+
+  if(useLandmarks && isGraphLoaded() && landmarks->isEmpty() && db != nullptr)
+    updateLandmarks();
+}
+
+void RouteNetwork::loadGraph()
+{
+  updateGraph();
+}
+
+RouteNetwork *RouteNetwork::createSnapshot()
+{
+  if(graph->isEmpty())
+  {
+    // Force loading of the graph
+    bool preload = preloadGraph;
+    preloadGraph = true;
+    updateGraph();
+    preloadGraph = preload;
+  }
+
+  if(graph->isEmpty())
+    return nullptr;
+
+  RouteNetwork *snapshot = new RouteNetwork(nullptr, nodeTable, edgeTable, nodeExtraCols, edgeExtraCols);
+  snapshot->graph = graph;
+  snapshot->landmarks = landmarks;
+  snapshot->hierarchies = hierarchies;
+  snapshot->preloadGraph = true;
+  snapshot->useLandmarks = useLandmarks;
+  snapshot->setMode(mode);
+  return snapshot;
+}
+
+bool RouteNetwork::buildHierarchies(const std::function<bool(int current, int total)>& callback)
+{
+  bool preload = preloadGraph;
+  preloadGraph = true;
+  updateGraph();
+  preloadGraph = preload;
+
+  if(graph->isEmpty())
+    return false;
+
+  QSharedPointer<RouteHierarchies> newHierarchies(new RouteHierarchies);
+  if(!newHierarchies->build(*graph, callback))
+    return false;
+
+  hierarchies = newHierarchies;
+  return hierarchies->save(cacheFilename(".hierarchy"), databaseFingerprint());
+}
+
+bool RouteNetwork::buildLandmarks(const std::function<bool(int current, int total)>& callback)
+{
+  bool preload = preloadGraph;
+  preloadGraph = true;
+  updateGraph();
+  preloadGraph = preload;
+
+  if(graph->isEmpty())
+    return false;
+
+  QSharedPointer<RouteLandmarks> newLandmarks(new RouteLandmarks);
+  if(!newLandmarks->build(*graph, NUM_LANDMARKS, callback))
+    return false;
+
+  landmarks = newLandmarks;
+  return landmarks->save(cacheFilename(".landmarks"), databaseFingerprint());
+}
+
+const RouteHierarchy *RouteNetwork::getHierarchy(int flownAltitude) const
+{
+  if(!airwayRouting || graph->isEmpty())
+    return nullptr;
+
+  return hierarchies->getHierarchy(mode, flownAltitude);
+}
+
+/* Load landmark tables from the file next to the database or build and save them if outdated */
+void RouteNetwork::updateLandmarks()
+{
+  QString filename = cacheFilename(".landmarks");
+  QString fingerprint = databaseFingerprint();
+
+  if(!landmarks->load(filename, fingerprint))
+  {
+    landmarks->build(*graph, NUM_LANDMARKS);
+    landmarks->save(filename, fingerprint);
+  }
+}
+
+/* Cache files are placed in the database directory and are named after database and node table */
+QString RouteNetwork::cacheFilename(const QString& suffix) const
+{
+  QFileInfo dbFile(db->databaseName());
+  return dbFile.absolutePath() + QDir::separator() + dbFile.completeBaseName() + "_" + nodeTable + suffix;
+}
+
+/* Changes if the scenery database is reloaded. Does not need the graph. */
+QString RouteNetwork::databaseFingerprint() const
+{
+  atools::fs::db::DatabaseMeta meta(db);
+  atools::sql::SqlUtil util(db);
+  return QString("%1.%2;%3;%4;%5;%6").
+         arg(meta.getMajorVersion()).
+         arg(meta.getMinorVersion()).
+         arg(meta.getLastLoadTime().toString(Qt::ISODate)).
+         arg(nodeTable).
+         arg(util.rowCount(nodeTable)).
+         arg(util.rowCount(edgeTable));
 }
 
 void RouteNetwork::getNeighbours(const nw::Node& from, QVector<nw::Node>& neighbours,
                                  QVector<Edge>& edges)
 {
-  for(const Edge& e : from.edges)
+  int index = isGraphLoaded() && from.id >= 0 ? graph->indexOf(from.id) : -1;
+
+  if(index != -1)
   {
-    bool add = false;
-
-    // Handle airways differently to keep cache for low and high alt routes together
-    if(e.type == AIRWAY_BOTH)
-      add = mode & ROUTE_JET || mode & ROUTE_VICTOR;
-    else if(e.type == AIRWAY_JET)
-      add = mode & ROUTE_JET;
-    else if(e.type == AIRWAY_VICTOR)
-      add = mode & ROUTE_VICTOR;
-    else
-      add = true;
+    // Walk through the packed edges of the graph
+    for(const GraphEdge *e = graph->edgesBegin(index); e != graph->edgesEnd(index); ++e)
+    {
+      if(testEdgeType(static_cast<nw::EdgeType>(e->type)) &&
+         testType(static_cast<nw::NodeType>(graph->getType(e->toIndex))))
+      {
+        neighbours.append(createGraphNode(e->toIndex));
 
-    if(add)
+        Edge edge(graph->getId(e->toIndex), e->lengthMeter);
+        edge.minAltFt = e->minAltFt;
+        edge.airwayId = e->airwayId;
+        edge.type = static_cast<nw::EdgeType>(e->type);
+        edges.append(edge);
+      }
+    }
+  }
+  else
+  {
+    for(const Edge& e : from.edges)
     {
-      // Add nodes and edges only if they match airway mode
-      neighbours.append(fetchNode(e.toNodeId));
-      edges.append(e);
+      if(testEdgeType(e.type))
+      {
+        // Add nodes and edges only if they match airway mode
+        neighbours.append(fetchNode(e.toNodeId));
+        edges.append(e);
+      }
     }
   }
+
+  // Destination edges are not stored with the nodes - add virtual edge if node is near the destination
+  QHash<int, int>::const_iterator it = destinationNodePredecessors.constFind(from.id);
+  if(it != destinationNodePredecessors.constEnd())
+  {
+    neighbours.append(nodeCache.value(DESTINATION_NODE_ID));
+    edges.append(Edge(DESTINATION_NODE_ID, it.value()));
+  }
+}
+
+void RouteNetwork::getPredecessors(const nw::Node& to, QVector<nw::Node>& predecessors,
+                                   QVector<nw::Edge>& edges)
+{
+  if(to.id == DEPARTURE_NODE_ID)
+    // Nothing leads to the departure
+    return;
+
+  if(to.id == DESTINATION_NODE_ID)
+  {
+    // All nodes that have a virtual edge to the destination
+    for(QHash<int, int>::const_iterator it = destinationNodePredecessors.constBegin();
+        it != destinationNodePredecessors.constEnd(); ++it)
+    {
+      nw::Node node = fetchNode(it.key());
+      if(node.id != -1)
+      {
+        predecessors.append(node);
+        edges.append(Edge(it.key(), it.value()));
+      }
+    }
+    return;
+  }
+
+  // All edges are stored in both directions - the neighbours are the predecessors
+  QVector<nw::Node> neighbours;
+  QVector<nw::Edge> neighbourEdges;
+  getNeighbours(to, neighbours, neighbourEdges);
+  for(int i = 0; i < neighbours.size(); i++)
+  {
+    if(neighbours.at(i).id != DESTINATION_NODE_ID)
+    {
+      predecessors.append(neighbours.at(i));
+      edges.append(neighbourEdges.at(i));
+    }
+  }
+
+  if(departureNodeSuccessors.contains(to.id))
+  {
+    predecessors.append(nodeCache.value(DEPARTURE_NODE_ID));
+    edges.append(Edge(DEPARTURE_NODE_ID, departureNodeSuccessors.value(to.id)));
+  }
 }
 
 void RouteNetwork::addDepartureAndDestinationNodes(const atools::geo::Pos& from, const atools::geo::Pos& to)
 {
   qDebug() << "adding start and  destination to network";
 
+  updateGraph();
+
   if(departurePos == from && destinationPos == to)
     return;
 
   if(destinationPos != to)
   {
-    // Remove all references to destination node
-    cleanDestNodeEdges();
-
-    // Add destination first so it can be added to start successors
     destinationPos = to;
-
-    destinationNodeRect = Rect(to, NODE_SEARCH_RADIUS_METER);
-
-    // Will use the bounding rectangle to add any neighbor nodes to dest
     fetchNode(to.getLonX(), to.getLatY(), false, DESTINATION_NODE_ID);
 
-    for(int id : nodeCache.keys())
-      // Fill destination node predecessor index
-      addDestNodeEdges(nodeCache[id]);
+    // Fill destination node predecessor index - edges are added lazily in getNeighbours
+    QVector<Edge> nearest;
+    nearestNodes(to, nearest);
+    destinationNodePredecessors.clear();
+    for(const Edge& edge : nearest)
+      destinationNodePredecessors.insert(edge.toNodeId, edge.lengthMeter);
   }
 
   if(departurePos != from)
@@ -139,6 +364,14 @@ void RouteNetwork::addDepartureAndDestinationNodes(const atools::geo::Pos& from,
     departurePos = from;
     fetchNode(from.getLonX(), from.getLatY(), true, DEPARTURE_NODE_ID);
   }
+
+  // Direct connection from departure to destination if both are close
+  float directDistance = from.distanceMeterTo(to);
+  if(directDistance <= NODE_SEARCH_RADIUS_METER)
+    destinationNodePredecessors.insert(DEPARTURE_NODE_ID, static_cast<int>(directDistance));
+  else
+    destinationNodePredecessors.remove(DEPARTURE_NODE_ID);
+
   qDebug() << "adding start and  destination to network done";
 }
 
@@ -160,50 +393,34 @@ nw::Node RouteNetwork::getNode(int id)
     return fetchNode(id);
 }
 
-/* Remove all references to the destination node from the cache */
-void RouteNetwork::cleanDestNodeEdges()
+nw::Node RouteNetwork::getNodeByIndex(int index)
 {
-  // Remove all references to destination node
-  for(int i : destinationNodePredecessors)
+  if(isGraphLoaded())
   {
-    if(nodeCache.contains(i))
-    {
-      // node is in cache
-      // Remove all edges from the node that point to the destination node
-      QVector<Edge>& edges = nodeCache[i].edges;
-      QVector<Edge>::iterator it = std::remove_if(edges.begin(), edges.end(),
-                                                  [ = ](const Edge &e)->bool
-                                                  {
-                                                    return e.toNodeId == DESTINATION_NODE_ID;
-                                                  });
-
-      if(it == edges.end())
-        qWarning() << "No node destination predecessors deleted for node" << nodeCache.value(i).id;
-      else
-        edges.erase(it, edges.end());
-    }
+    if(index < graph->size())
+      return createGraphNode(index);
     else
-      qWarning() << "No node destination found" << nodeCache.value(i).id;
+      return nodeCache.value(index == virtualNodeIndex(DEPARTURE_NODE_ID) ?
+                             DEPARTURE_NODE_ID : DESTINATION_NODE_ID);
   }
-
-  // Clear predecessor cache
-  destinationNodePredecessors.clear();
+  else
+    return nodeCache.value(indexToNodeId.at(index));
 }
 
-/* Add a destination node virtual edge to the node if it is inside the destination bounding rectangle */
-void RouteNetwork::addDestNodeEdges(nw::Node& node)
+int RouteNetwork::getNumberOfIndexes() const
 {
-  if(destinationNodeRect.contains(node.pos) && !destinationNodePredecessors.contains(node.id) &&
-     node.id != DESTINATION_NODE_ID)
-  {
-    // Node is not dest and not indexed yet - create virtual edge
-    nw::Edge edge(DESTINATION_NODE_ID, static_cast<int>(node.pos.distanceMeterTo(destinationPos)));
+  if(isGraphLoaded())
+    // Graph nodes plus departure and destination
+    return graph->size() + 2;
+  else
+    return indexToNodeId.size();
+}
 
-    // Near destination - add as successor
-    node.edges.append(edge);
-    // Remember in cache for later cleanup
-    destinationNodePredecessors.insert(node.id);
-  }
+/* Departure and destination are placed behind the graph nodes or at the first two positions if no graph */
+int RouteNetwork::virtualNodeIndex(int id) const
+{
+  int offset = isGraphLoaded() ? graph->size() : 0;
+  return id == DEPARTURE_NODE_ID ? offset : offset + 1;
 }
 
 /* Get a node by navaid id (waypoint_id, vor_id, ...) */
@@ -212,6 +429,7 @@ nw::Node RouteNetwork::fetchNodeByNavId(int id, nw::NodeType type)
   nodeByNavIdQuery->bindValue(":id", id);
   nodeByNavIdQuery->bindValue(":type", type);
   nodeByNavIdQuery->exec();
+  numQueries++;
 
   if(nodeByNavIdQuery->next())
     // Found fetch node into the cache
@@ -223,6 +441,7 @@ nw::Node RouteNetwork::fetchNodeByNavId(int id, nw::NodeType type)
       // Not found and is an airway - look for waypoints
       nodeByNavIdQuery->bindValue(":type", nw::WAYPOINT_BOTH);
       nodeByNavIdQuery->exec();
+      numQueries++;
       if(nodeByNavIdQuery->next())
         return fetchNode(nodeByNavIdQuery->value("node_id").toInt());
     }
@@ -243,10 +462,28 @@ void RouteNetwork::getNavIdAndTypeForNode(int nodeId, int& navId, nw::NodeType&
     type = DESTINATION;
     navId = -1; // No database id available
   }
+  else if(isGraphLoaded())
+  {
+    int index = graph->indexOf(nodeId);
+    if(index != -1)
+    {
+      navId = graph->getNavId(index);
+      if(airwayRouting)
+        type = static_cast<nw::NodeType>(graph->getType(index) >> 4);
+      else
+        type = static_cast<nw::NodeType>(graph->getType(index));
+    }
+    else
+    {
+      navId = -1;
+      type = nw::NONE;
+    }
+  }
   else
   {
     nodeNavIdAndTypeQuery->bindValue(":id", nodeId);
     nodeNavIdAndTypeQuery->exec();
+    numQueries++;
 
     if(nodeNavIdAndTypeQuery->next())
     {
@@ -275,6 +512,7 @@ nw::Node RouteNetwork::fetchNode(float lonx, float laty, bool loadSuccessors, in
 
   Node node;
   node.id = id;
+  node.index = virtualNodeIndex(id);
   node.range = 0;
 
   if(id == DEPARTURE_NODE_ID)
@@ -289,31 +527,16 @@ nw::Node RouteNetwork::fetchNode(float lonx, float laty, bool loadSuccessors, in
 
   if(loadSuccessors)
   {
-    // Load all successor nodes within the query rectangle
-    Rect queryRect(Pos(lonx, laty), NODE_SEARCH_RADIUS_METER);
+    // Connect to the nearest nodes - edge to destination is added in getNeighbours
+    nearestNodes(node.pos, node.edges);
 
-    // Use a set for de-duplication
-    QSet<Edge> tempEdges;
-    tempEdges.reserve(1000);
-
-    for(const Rect& rect : queryRect.splitAtAntiMeridian())
+    if(id == DEPARTURE_NODE_ID)
     {
-      bindCoordRect(rect, nearestNodesQuery);
-      nearestNodesQuery->exec();
-      while(nearestNodesQuery->next())
-      {
-        int nodeId = nearestNodesQuery->value("node_id").toInt();
-        if(testType(static_cast<nw::NodeType>(nearestNodesQuery->value("type").toInt())))
-        {
-          Pos otherPos(nearestNodesQuery->value("lonx").toFloat(), nearestNodesQuery->value("laty").toFloat());
-          tempEdges.insert(Edge(nodeId, static_cast<int>(node.pos.distanceMeterTo(otherPos))));
-        }
-      }
+      // Remember successors for reverse search
+      departureNodeSuccessors.clear();
+      for(const Edge& edge : node.edges)
+        departureNodeSuccessors.insert(edge.toNodeId, edge.lengthMeter);
     }
-    node.edges = tempEdges.values().toVector();
-
-    // Add edges to destination node if there are any
-    addDestNodeEdges(node);
   }
 
   nodeCache.insert(node.id, node);
@@ -321,26 +544,84 @@ nw::Node RouteNetwork::fetchNode(float lonx, float laty, bool loadSuccessors, in
   return node;
 }
 
+/* Get edges to the nearest nodes around pos matching the current mode. Edges are sorted by length and
+ * limited to NODE_SEARCH_MAX_NODES. Uses the grid index if the graph is loaded. */
+void RouteNetwork::nearestNodes(const atools::geo::Pos& pos, QVector<nw::Edge>& edges)
+{
+  edges.clear();
+
+  if(isGraphLoaded())
+  {
+    QVector<nw::NodeDistance> nearest;
+    graph->getGrid().nearest(pos, NODE_SEARCH_RADIUS_METER, NODE_SEARCH_MAX_NODES,
+                             [this](int index) -> bool
+                             {
+                               return testType(static_cast<nw::NodeType>(graph->getType(index)));
+                             }, nearest);
+
+    for(const nw::NodeDistance& node : nearest)
+      edges.append(Edge(graph->getId(node.index), static_cast<int>(node.distanceMeter)));
+    return;
+  }
+
+  // Query database - rectangles do not overlap after splitting
+  for(const Rect& rect : Rect(pos, NODE_SEARCH_RADIUS_METER).splitAtAntiMeridian())
+  {
+    bindCoordRect(rect, nearestNodesQuery);
+    nearestNodesQuery->exec();
+    numQueries++;
+    while(nearestNodesQuery->next())
+    {
+      if(testType(static_cast<nw::NodeType>(nearestNodesQuery->value("type").toInt())))
+      {
+        Pos otherPos(nearestNodesQuery->value("lonx").toFloat(), nearestNodesQuery->value("laty").toFloat());
+        float distance = pos.distanceMeterTo(otherPos);
+        if(distance <= NODE_SEARCH_RADIUS_METER)
+          edges.append(Edge(nearestNodesQuery->value("node_id").toInt(), static_cast<int>(distance)));
+      }
+    }
+  }
+
+  std::sort(edges.begin(), edges.end(), [](const Edge& e1, const Edge& e2) -> bool
+            {
+              return e1.lengthMeter < e2.lengthMeter;
+            });
+  if(edges.size() > NODE_SEARCH_MAX_NODES)
+    edges.resize(NODE_SEARCH_MAX_NODES);
+}
+
 /* Get the node either from cache of from the database. The node will include all edges. */
 nw::Node RouteNetwork::fetchNode(int id)
 {
   if(nodeCache.contains(id))
     return nodeCache.value(id);
 
+  if(isGraphLoaded())
+  {
+    int index = graph->indexOf(id);
+    return index != -1 ? createGraphNode(index) : Node();
+  }
+
   nodeByIdQuery->bindValue(":id", id);
   nodeByIdQuery->exec();
+  numQueries++;
 
   if(nodeByIdQuery->next())
   {
     nw::Node node = createNode(nodeByIdQuery->record());
     node.id = id;
 
+    // Assign next free dense index
+    node.index = indexToNodeId.size();
+    indexToNodeId.append(id);
+
     QSet<Edge> tempEdges;
     tempEdges.reserve(1000);
 
     // Add ingoing edges
     edgeToQuery->bindValue(":id", id);
     edgeToQuery->exec();
+    numQueries++;
 
     while(edgeToQuery->next())
     {
@@ -352,6 +633,7 @@ nw::Node RouteNetwork::fetchNode(int id)
     // Add outgoing edges
     edgeFromQuery->bindValue(":id", id);
     edgeFromQuery->exec();
+    numQueries++;
 
     while(edgeFromQuery->next())
     {
@@ -361,9 +643,9 @@ nw::Node RouteNetwork::fetchNode(int id)
     }
 
     node.edges = tempEdges.values().toVector();
-    addDestNodeEdges(node);
 
     nodeCache.insert(node.id, node);
+    numNodesLoaded++;
     return node;
   }
   return Node();
@@ -371,6 +653,10 @@ nw::Node RouteNetwork::fetchNode(int id)
 
 void RouteNetwork::initQueries()
 {
+  if(db == nullptr)
+    // Snapshot that works on the graph only
+    return;
+
   QString nodeCols = nodeExtraCols.join(",");
   if(!nodeExtraCols.isEmpty())
     nodeCols.append(", ");
@@ -385,10 +671,13 @@ void RouteNetwork::initQueries()
   nodeNavIdAndTypeQuery = new SqlQuery(db);
   nodeNavIdAndTypeQuery->prepare("select nav_id, type from " + nodeTable + " where node_id = :id");
 
+  // Use the R*Tree table if it was built for the loaded scenery
+  QString whereRect = SpatialIndexBuilder::isValid(db) ?
+                      SpatialIndexBuilder::whereRect(nodeTable, "node_id") :
+                      "lonx between :leftx and :rightx and laty between :bottomy and :topy";
+
   nearestNodesQuery = new SqlQuery(db);
-  nearestNodesQuery->prepare(
-    "select node_id, type, lonx, laty from " + nodeTable +
-    " where lonx between :leftx and :rightx and laty between :bottomy and :topy");
+  nearestNodesQuery->prepare("select node_id, type, lonx, laty from " + nodeTable + " where " + whereRect);
 
   nodeByIdQuery = new SqlQuery(db);
   nodeByIdQuery->prepare(
@@ -451,6 +740,26 @@ nw::Node RouteNetwork::createNode(const SqlRecord& rec)
   return node;
 }
 
+/* Create node from graph without edges. Edges are read directly from the graph in getNeighbours */
+nw::Node RouteNetwork::createGraphNode(int index)
+{
+  Node node;
+  node.id = graph->getId(index);
+  node.index = index;
+  node.range = graph->getRange(index);
+  node.pos = graph->getPos(index);
+
+  int type = graph->getType(index);
+  if(airwayRouting)
+  {
+    node.type = static_cast<nw::NodeType>(type >> 4);
+    node.subtype = static_cast<nw::NodeType>(type & 0x0f);
+  }
+  else
+    node.type = static_cast<nw::NodeType>(type);
+  return node;
+}
+
 /* Update node index caches to avoid string lookups in SqlRecord */
 void RouteNetwork::updateNodeIndexes(const SqlRecord& rec)
 {
@@ -544,6 +853,20 @@ bool RouteNetwork::testType(nw::NodeType type)
   return false;
 }
 
+/* Check if the edge type is usable for the current mode */
+bool RouteNetwork::testEdgeType(nw::EdgeType type)
+{
+  // Handle airways differently to keep cache for low and high alt routes together
+  if(type == AIRWAY_BOTH)
+    return mode & ROUTE_JET || mode & ROUTE_VICTOR;
+  else if(type == AIRWAY_JET)
+    return mode & ROUTE_JET;
+  else if(type == AIRWAY_VICTOR)
+    return mode & ROUTE_VICTOR;
+  else
+    return true;
+}
+
 void RouteNetwork::bindCoordRect(const atools::geo::Rect& rect, atools::sql::SqlQuery *query)
 {
   query->bindValue(":leftx", rect.getWest());
@@ -20,10 +20,15 @@
 
 #include "common/maptypes.h"
 #include "geo/calculations.h"
+#include "route/routegraph.h"
+#include "route/routelandmarks.h"
 
 #include <QHash>
+#include <QSharedPointer>
 #include <QVector>
 
+#include <functional>
+
 namespace  atools {
 namespace sql {
 class SqlDatabase;
@@ -36,6 +41,9 @@ class Rect;
 }
 }
 
+class RouteHierarchies;
+class RouteHierarchy;
+
 namespace nw {
 
 /* Network mode. Changes some internal behavior of the network. */
@@ -123,6 +131,7 @@ struct Node
   }
 
   int id = -1; /* Database id ("node_id") */
+  int index = -1; /* Dense index 0 to RouteNetwork::getNumberOfIndexes() - 1 assigned by the network */
   int range; /* Range for a radio navaid or 0 if not applicable */
   QVector<Edge> edges; /* Attached edges leading to adjacent nodes */
   atools::geo::Pos pos;
@@ -184,6 +193,10 @@ public:
   /* Get all adjacent nodes and attached edges for the given node */
   void getNeighbours(const nw::Node& from, QVector<nw::Node>& neighbours, QVector<nw::Edge>& edges);
 
+  /* Get all nodes that have an edge to the given node. Edges point to the predecessor node.
+   * Used for reverse search. */
+  void getPredecessors(const nw::Node& to, QVector<nw::Node>& predecessors, QVector<nw::Edge>& edges);
+
   /* Integrate departure and destination positions into the network as virtual nodes/edges */
   void addDepartureAndDestinationNodes(const atools::geo::Pos& from, const atools::geo::Pos& to);
 
@@ -196,12 +209,32 @@ public:
   /* Get a node by routing network node id. If id is -1 an invalid node with id -1 is returned */
   nw::Node getNode(int id);
 
+  /* Get a node by dense index (nw::Node::index) */
+  nw::Node getNodeByIndex(int index);
+
+  /* Upper bound for all dense node indexes that are assigned currently. Indexes are stable until the
+   * network is cleared. Can grow while walking through the network if the graph is not loaded. */
+  int getNumberOfIndexes() const;
+
   /* Number of nodes in the database */
   int getNumberOfNodesDatabase();
 
   /* Number of nodes in the memory cache */
   int getNumberOfNodesCache() const;
 
+  /* Number of nodes loaded with edges from the database since creation. Does not change if the graph is
+   * preloaded. */
+  int getNumberOfNodesLoaded() const
+  {
+    return numNodesLoaded;
+  }
+
+  /* Number of database queries executed for node and edge lookups since creation */
+  int getNumberOfQueries() const
+  {
+    return numQueries;
+  }
+
   /* true if mode is either ROUTE_VICTOR, ROUTE_JET  or both flags */
   bool isAirwayRouting() const
   {
@@ -211,27 +244,115 @@ public:
   /* Sets the route mode. This will change some internal behavior like checking subtypes and more */
   void setMode(nw::Modes routeMode);
 
+  nw::Modes getMode() const
+  {
+    return mode;
+  }
+
+  /* Changes whenever dense node indexes are invalidated, i.e. the network is cleared or the graph loaded */
+  quint32 getIndexVersion() const
+  {
+    return indexVersion;
+  }
+
+  /* If true the whole network is loaded into a compact graph structure on first use after initQueries.
+   * Nodes and edges are then read from memory instead of the database.
+   * The graph is saved to a cache file next to the database and mapped from there on the next load. */
+  void setPreloadGraph(bool value)
+  {
+    preloadGraph = value;
+  }
+
+  /* Map the graph cache file or load the graph from the database now if preload is enabled.
+   * Avoids the delay on the first calculation after startup or database change. */
+  void loadGraph();
+
+  /* true if nodes and edges are taken from the preloaded graph */
+  bool isGraphLoaded() const
+  {
+    return !graph->isEmpty();
+  }
+
+  /* If true landmark distance tables are loaded or built together with the graph. Needs preload graph. */
+  void setUseLandmarks(bool value)
+  {
+    useLandmarks = value;
+  }
+
+  /* Get landmark distance tables for the graph node indexes or null if not available */
+  const RouteLandmarks *getLandmarks() const
+  {
+    return landmarks->isEmpty() ? nullptr : landmarks.data();
+  }
+
+  /* If true contraction hierarchies are loaded together with the graph if a valid file exists.
+   * Needs preload graph. */
+  void setUseHierarchies(bool value)
+  {
+    useHierarchies = value;
+  }
+
+  /*
+   * Load graph and build contraction hierarchies for all airway modes and altitude buckets.
+   * Saves them to a file next to the database. Called after loading the scenery database.
+   * @param callback called with number of contracted and total nodes over all hierarchies.
+   * Return true to cancel.
+   * @return false if canceled or failed
+   */
+  bool buildHierarchies(const std::function<bool(int current, int total)>& callback);
+
+  /*
+   * Load graph and build landmark distance tables. Saves them to a file next to the database. Called after
+   * loading the scenery database. Tables are otherwise built when the graph is loaded the first time.
+   * @param callback called with number of built and total landmarks. Return true to cancel.
+   * @return false if canceled or failed
+   */
+  bool buildLandmarks(const std::function<bool(int current, int total)>& callback);
+
+  /* Get contraction hierarchy for the current mode and altitude or null if not available */
+  const RouteHierarchy *getHierarchy(int flownAltitude) const;
+
+  /*
+   * Create a copy of this network for route calculation in another thread. The copy shares the read-only
+   * graph, landmark tables and hierarchies and does not access the database. Loads the graph if not done yet.
+   * Mode is copied but can be changed independently.
+   * @return new network that has to be deleted by the caller or null if the graph could not be loaded
+   */
+  RouteNetwork *createSnapshot();
+
 private:
   void clearStartAndDestinationNodes();
+  void updateGraph();
+  void updateLandmarks();
+  QString cacheFilename(const QString& suffix) const;
+  QString databaseFingerprint() const;
+  int virtualNodeIndex(int id) const;
 
   nw::Node fetchNodeByNavId(int id, nw::NodeType type);
   nw::Node fetchNode(int id);
   nw::Node fetchNode(float lonx, float laty, bool loadSuccessors, int id);
 
-  void addDestNodeEdges(nw::Node& node);
-  void cleanDestNodeEdges();
+  void nearestNodes(const atools::geo::Pos& pos, QVector<nw::Edge>& edges);
 
   void bindCoordRect(const atools::geo::Rect& rect, atools::sql::SqlQuery *query);
   bool testType(nw::NodeType type);
+  bool testEdgeType(nw::EdgeType type);
   nw::Node createNode(const atools::sql::SqlRecord& rec);
+  nw::Node createGraphNode(int index);
   nw::Edge createEdge(const atools::sql::SqlRecord& rec, int toNodeId);
 
   void updateNodeIndexes(const atools::sql::SqlRecord& rec);
   void updateEdgeIndexes(const atools::sql::SqlRecord& rec);
 
+  /* Number of landmarks for the ALT heuristic */
+  static Q_DECL_CONSTEXPR int NUM_LANDMARKS = 16;
+
   /* Search radius for nodes around departure and destination position */
   static Q_DECL_CONSTEXPR int NODE_SEARCH_RADIUS_METER = atools::geo::nmToMeter(200);
 
+  /* Maximum number of nodes connected to departure and destination */
+  static Q_DECL_CONSTEXPR int NODE_SEARCH_MAX_NODES = 200;
+
   /* Departure virtual node id */
   const int DEPARTURE_NODE_ID = -10;
   /* Destination virtual node id */
@@ -240,23 +361,48 @@ private:
   /* Cache the number of nodes in the database */
   int numNodesDb = -1;
 
+  /* Statistics for getNumberOfQueries and getNumberOfNodesLoaded */
+  int numQueries = 0, numNodesLoaded = 0;
+
+  /* Incremented when dense indexes change */
+  quint32 indexVersion = 0;
+
   atools::sql::SqlQuery *nodeByNavIdQuery = nullptr, *nodeNavIdAndTypeQuery = nullptr,
   *nearestNodesQuery = nullptr, *nodeByIdQuery = nullptr, *edgeToQuery = nullptr,
   *edgeFromQuery = nullptr;
 
-  /* Bounding rectangle around destination used to find virtual successor edges */
-  atools::geo::Rect destinationNodeRect;
   atools::geo::Pos departurePos, destinationPos;
 
-  /* Collected destination predecessor node ids */
-  QSet<int> destinationNodePredecessors;
+  /* Node ids near the destination with length of the virtual edge to the destination.
+   * Edges are added on the fly in getNeighbours. */
+  QHash<int, int> destinationNodePredecessors;
+
+  /* Departure successor node ids with edge length for reverse search */
+  QHash<int, int> departureNodeSuccessors;
 
   atools::sql::SqlDatabase *db;
   nw::Modes mode;
 
-  /* Cache for nodes (also containing edges) for the whole network. Filled on demand. */
+  /* Cache for nodes (also containing edges) for the whole network. Filled on demand.
+   * Contains only the virtual departure and destination nodes if the graph is loaded. */
   QHash<int, nw::Node> nodeCache;
 
+  /* Maps dense node index to node id for nodes loaded from the database. Not used if graph is loaded
+   * since the graph index is used directly. */
+  QVector<int> indexToNodeId;
+
+  /* Whole network in compressed sparse row layout. Empty if not loaded. Shared with snapshots. */
+  QSharedPointer<RouteGraph> graph;
+  bool preloadGraph = false;
+
+  /* Distance tables for graph. Empty if not loaded. Shared with snapshots. */
+  QSharedPointer<RouteLandmarks> landmarks;
+  bool useLandmarks = false;
+
+  /* Contraction hierarchies for graph. Empty if not loaded. Shared with snapshots. */
+  QSharedPointer<RouteHierarchies> hierarchies;
+  bool useHierarchies = false;
+
   /* Database tables and extra columns */
   QString nodeTable, edgeTable;
   QStringList nodeExtraCols, edgeExtraCols;
@@ -0,0 +1,139 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routenodegrid.h"
+
+#include "route/routegraph.h"
+#include "geo/pos.h"
+#include "geo/rect.h"
+
+#include <algorithm>
+
+using atools::geo::Pos;
+using atools::geo::Rect;
+using nw::NodeDistance;
+
+RouteNodeGrid::RouteNodeGrid()
+{
+
+}
+
+RouteNodeGrid::~RouteNodeGrid()
+{
+
+}
+
+void RouteNodeGrid::build(const RouteGraph& graph)
+{
+  clear();
+
+  int numNodes = graph.size();
+  if(numNodes == 0)
+    return;
+
+  // Count nodes per cell first ========================
+  QVector<int> nodeCells(numNodes);
+  cellOffsets.fill(0, NUM_COLUMNS * NUM_ROWS + 1);
+  for(int i = 0; i < numNodes; i++)
+  {
+    Pos pos = graph.getPos(i);
+    int cell = row(pos.getLatY()) * NUM_COLUMNS + column(pos.getLonX());
+    nodeCells[i] = cell;
+    cellOffsets[cell + 1]++;
+  }
+
+  for(int i = 1; i < cellOffsets.size(); i++)
+    cellOffsets[i] += cellOffsets.at(i - 1);
+
+  // Fill entries using a running insert position per cell ===
+  entries.resize(numNodes);
+  QVector<int> insertPos(cellOffsets);
+  for(int i = 0; i < numNodes; i++)
+  {
+    Pos pos = graph.getPos(i);
+    entries[insertPos[nodeCells.at(i)]++] = {i, pos.getLonX(), pos.getLatY()};
+  }
+}
+
+void RouteNodeGrid::clear()
+{
+  cellOffsets.clear();
+  cellOffsets.squeeze();
+  entries.clear();
+  entries.squeeze();
+}
+
+void RouteNodeGrid::nearest(const Pos& pos, float radiusMeter, int maxNodes,
+                            const std::function<bool(int index)>& filter, QVector<NodeDistance>& result) const
+{
+  result.clear();
+  if(isEmpty())
+    return;
+
+  for(const Rect& rect : Rect(pos, radiusMeter).splitAtAntiMeridian())
+  {
+    int colStart = column(rect.getWest()), colEnd = column(rect.getEast());
+    int rowStart = row(rect.getSouth()), rowEnd = row(rect.getNorth());
+
+    for(int r = rowStart; r <= rowEnd; r++)
+    {
+      for(int c = colStart; c <= colEnd; c++)
+      {
+        int cell = r * NUM_COLUMNS + c;
+        for(int i = cellOffsets.at(cell); i < cellOffsets.at(cell + 1); i++)
+        {
+          const Entry& entry = entries.at(i);
+          float distance = pos.distanceMeterTo(Pos(entry.lonX, entry.latY));
+          if(distance <= radiusMeter && filter(entry.index))
+            result.append({entry.index, distance});
+        }
+      }
+    }
+  }
+
+  // Keep only the nearest nodes
+  if(result.size() > maxNodes)
+  {
+    std::partial_sort(result.begin(), result.begin() + maxNodes, result.end(),
+                      [](const NodeDistance& n1, const NodeDistance& n2) -> bool
+                      {
+                        return n1.distanceMeter < n2.distanceMeter;
+                      });
+    result.resize(maxNodes);
+  }
+  else
+    std::sort(result.begin(), result.end(), [](const NodeDistance& n1, const NodeDistance& n2) -> bool
+              {
+                return n1.distanceMeter < n2.distanceMeter;
+              });
+}
+
+int RouteNodeGrid::column(float lonX) const
+{
+  return std::max(0, std::min(NUM_COLUMNS - 1, static_cast<int>((lonX + 180.f) / CELL_SIZE_DEG)));
+}
+
+int RouteNodeGrid::row(float latY) const
+{
+  return std::max(0, std::min(NUM_ROWS - 1, static_cast<int>((latY + 90.f) / CELL_SIZE_DEG)));
+}
+
+qint64 RouteNodeGrid::getMemorySize() const
+{
+  return cellOffsets.size() * static_cast<qint64>(sizeof(int)) +
+         entries.size() * static_cast<qint64>(sizeof(Entry));
+}
@@ -0,0 +1,105 @@
+/*****************************************************************************
+* Copyright 2015-2016 Alexander Barthel albar965@mailbox.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTENODEGRID_H
+#define LITTLENAVMAP_ROUTENODEGRID_H
+
+#include <QVector>
+
+#include <functional>
+
+class RouteGraph;
+
+namespace atools {
+namespace geo {
+class Pos;
+}
+}
+
+namespace nw {
+
+/* Graph node index and great circle distance to the query position */
+struct NodeDistance
+{
+  int index;
+  float distanceMeter;
+};
+
+}
+
+Q_DECLARE_TYPEINFO(nw::NodeDistance, Q_PRIMITIVE_TYPE);
+
+/*
+ * Spatial index over all nodes of a route graph. Nodes are sorted into buckets of a regular
+ * lat/lon grid which is stored in compressed sparse row layout like the graph itself.
+ *
+ * Used to find the nodes near departure and destination without scanning the whole graph.
+ * Read-only after building and can be used by several threads.
+ */
+class RouteNodeGrid
+{
+public:
+  RouteNodeGrid();
+  ~RouteNodeGrid();
+
+  /* Sort all nodes of the graph into the grid buckets */
+  void build(const RouteGraph& graph);
+
+  void clear();
+
+  bool isEmpty() const
+  {
+    return entries.isEmpty();
+  }
+
+  /*
+   * Find the nearest nodes within a radius. Queries crossing the anti-meridian are split.
+   * @param pos Center of the query
+   * @param radiusMeter Maximum distance of the nodes
+   * @param maxNodes Maximum number of nodes to return
+   * @param filter Gets the graph node index and returns false if the node should be ignored
+   * @param result Nodes sorted by distance ascending
+   */
+  void nearest(const atools::geo::Pos& pos, float radiusMeter, int maxNodes,
+               const std::function<bool(int index)>& filter, QVector<nw::NodeDistance>& result) const;
+
+  /* Approximate memory usage in bytes */
+  qint64 getMemorySize() const;
+
+private:
+  /* Node with a copy of the coordinates to avoid access to the graph arrays when scanning a bucket */
+  struct Entry
+  {
+    int index;
+    float lonX, latY;
+  };
+
+  int column(float lonX) const;
+  int row(float latY) const;
+
+  /* Size of a grid cell in degree */
+  static Q_DECL_CONSTEXPR int CELL_SIZE_DEG = 1;
+  static Q_DECL_CONSTEXPR int NUM_COLUMNS = 360 / CELL_SIZE_DEG;
+  static Q_DECL_CONSTEXPR int NUM_ROWS = 180 / CELL_SIZE_DEG;
+
+  /* Entries of cell (column, row) are found from cellOffsets[row * NUM_COLUMNS + column] to
+   * cellOffsets[row * NUM_COLUMNS + column + 1] */
+  QVector<int> cellOffsets;
+  QVector<Entry> entries;
+};
+
+#endif // LITTLENAVMAP_ROUTENODEGRID_H
@@ -25,6 +25,7 @@
 #include "exception.h"
 #include "search/column.h"
 #include "sql/sqlrecord.h"
+#include "db/spatialindexbuilder.h"
 
 #include <QLineEdit>
 #include <QCheckBox>
@@ -459,22 +460,30 @@ QString SqlModel::buildWhere()
 
   if(boundingRect.isValid())
   {
+    // Use the R*Tree table if available. Checked here since bounding rectangle searches are rare.
+    bool spatialIndex = SpatialIndexBuilder::isValid(db);
+    QString table = columns->getTablename(), idColumn = columns->getIdColumnName();
+    auto rectCondition = [ = ](const atools::geo::Rect& rect) -> QString
+                         {
+                           QString left = QString::number(rect.getTopLeft().getLonX()),
+                                   right = QString::number(rect.getBottomRight().getLonX()),
+                                   bottom = QString::number(rect.getBottomRight().getLatY()),
+                                   top = QString::number(rect.getTopLeft().getLatY());
+                           if(spatialIndex)
+                             return SpatialIndexBuilder::whereRect(table, idColumn, left, right, bottom, top);
+                           else
+                             return QString("lonx between %1 and %2 and laty between %3 and %4").
+                                    arg(left).arg(right).arg(bottom).arg(top);
+                         };
+
     QString rectCond;
     if(boundingRect.crossesAntiMeridian())
     {
       QList<atools::geo::Rect> rect = boundingRect.splitAtAntiMeridian();
-
-      rectCond = QString("((lonx between %1 and %2 and laty between %3 and %4) or "
-                         "(lonx between %5 and %6 and laty between %7 and %8))").
-                 arg(rect.at(0).getTopLeft().getLonX()).arg(rect.at(0).getBottomRight().getLonX()).
-                 arg(rect.at(0).getBottomRight().getLatY()).arg(rect.at(0).getTopLeft().getLatY()).
-                 arg(rect.at(1).getTopLeft().getLonX()).arg(rect.at(1).getBottomRight().getLonX()).
-                 arg(rect.at(1).getBottomRight().getLatY()).arg(rect.at(1).getTopLeft().getLatY());
+      rectCond = "((" + rectCondition(rect.at(0)) + ") or (" + rectCondition(rect.at(1)) + "))";
     }
     else
-      rectCond = QString("(lonx between %1 and %2 and laty between %3 and %4)").
-                 arg(boundingRect.getTopLeft().getLonX()).arg(boundingRect.getBottomRight().getLonX()).
-                 arg(boundingRect.getBottomRight().getLatY()).arg(boundingRect.getTopLeft().getLatY());
+      rectCond = "(" + rectCondition(boundingRect) + ")";
 
     if(numCond > 0)
       queryWhere += " " + WHERE_OPERATOR + " ";